@@ -5,6 +5,7 @@
  */
 
 #pragma once
+#include <stdbool.h>
 #include "freertos/FreeRTOS.h"
 #include "esp_err.h"
 #include "iot_usbh.h"
@@ -121,6 +122,48 @@ int usbh_cdc_write_bytes(const uint8_t* buf, size_t length);
  */
 int usbh_cdc_itf_write_bytes(uint8_t itf, const uint8_t* buf, size_t length);
 
+/**
+ * @brief Pack a frame straight into a free bulk out URB of the specified interface.
+ *
+ * Frames are copied once, into the URB being filled, and packed back to back as a byte stream up to the
+ * URB buffer size (CONFIG_CDC_BULK_OUT_URB_BUFFER_SIZE); a frame not fitting in the rest of the URB
+ * continues in the next free one. Full URBs are submitted by the CDC task right away, a partially filled
+ * one as soon as no out URB of the interface is in flight. While all URBs are queued or in flight the call
+ * blocks for a free one; bytes still finding none after the ringbuffer timeout, or following bytes still in
+ * the tx ringbuffer, are pushed to the tx ringbuffer instead, so the byte order is kept.
+ * Call it from one task per interface.
+ *
+ * @param itf the interface index
+ * @param buf frame address
+ * @param length frame length
+ * @return int The number of bytes packed or pushed to the tx buffer
+ */
+int usbh_cdc_itf_write_frame(uint8_t itf, const uint8_t* buf, size_t length);
+
+/**
+ * @brief Bulk out statistics of an interface, since the driver was installed.
+ */
+typedef struct {
+    uint32_t frames;                /*!< frames fully packed into URBs by usbh_cdc_itf_write_frame */
+    uint32_t fallbacks;             /*!< frames usbh_cdc_itf_write_frame pushed to the tx ringbuffer, in part or whole */
+    uint32_t urbs;                  /*!< out URBs submitted, with data */
+    uint64_t bytes;                 /*!< bytes submitted */
+    uint32_t max_frames_per_urb;    /*!< most frames, or parts of frames, coalesced into one URB */
+    uint32_t buffer_size;           /*!< buffer size of each out URB, utilization = bytes / (urbs * buffer_size) */
+} usbh_cdc_tx_stats_t;
+
+/**
+ * @brief Get bulk out statistics of the specified interface.
+ *
+ * @param itf the interface index
+ * @param stats statistics output
+ * @return ** esp_err_t
+ *         ESP_ERR_INVALID_STATE cdc not installed
+ *         ESP_ERR_INVALID_ARG args not supported
+ *         ESP_OK succeed
+ */
+esp_err_t usbh_cdc_itf_get_tx_stats(uint8_t itf, usbh_cdc_tx_stats_t* stats);
+
 /**
  * @brief Get USB interface 0 rx buffered data length.
  *
@@ -173,6 +216,33 @@ int usbh_cdc_itf_read_bytes(uint8_t itf, uint8_t* buf, size_t length, TickType_t
  */
 int usbh_cdc_get_itf_state(uint8_t itf);
 
+/**
+ * @brief Callback taking a received payload in place of the rx ringbuffer
+ *
+ * @param data URB buffer, only valid during the call
+ * @param len payload length
+ * @param arg user argument
+ * @return true the payload was consumed, false push it to the rx ringbuffer as usual
+ */
+typedef bool (*usbh_cdc_rx_direct_cb_t)(const uint8_t* data, size_t len, void* arg);
+
+/**
+ * @brief Lend received URB buffers of an interface to a consumer without copying them to the rx ringbuffer.
+ *
+ * The callback runs in the CDC task; the URB is re-enqueued as soon as it returns, so the number of
+ * buffers outside the driver never exceeds the in URBs of the interface (CONFIG_CDC_BULK_IN_URB_NUM).
+ * The callback must not block. The rx callback is not called for consumed payloads.
+ *
+ * @param itf the interface index
+ * @param cb callback, NULL to disable
+ * @param arg callback argument
+ * @return ** esp_err_t
+ *         ESP_ERR_INVALID_STATE cdc not installed
+ *         ESP_ERR_INVALID_ARG args not supported
+ *         ESP_OK succeed
+ */
+esp_err_t usbh_cdc_itf_set_rx_direct(uint8_t itf, usbh_cdc_rx_direct_cb_t cb, void* arg);
+
 /**
  * @brief Flush rx buffer, discard all the data in the ring-buffer.
  *
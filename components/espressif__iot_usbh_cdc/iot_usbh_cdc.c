@@ -5,6 +5,7 @@
  */
 
 #include <string.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/portmacro.h"
 #include "freertos/queue.h"
@@ -57,6 +58,21 @@ typedef enum {
     CDC_STATE_READY,
 } _cdc_state_t;
 
+typedef struct {
+    iot_usbh_urb_handle_t free[BULK_OUT_URB_NUM];               /*!< free out URBs, used as a stack */
+    size_t free_num;                                            /*!< number of free out URBs */
+    iot_usbh_urb_handle_t ready[BULK_OUT_URB_NUM];              /*!< full out URBs waiting for submit, FIFO */
+    size_t ready_len[BULK_OUT_URB_NUM];                         /*!< payload length of the full out URBs */
+    size_t ready_head;                                          /*!< index of the oldest full out URB */
+    size_t ready_num;                                           /*!< number of full out URBs */
+    iot_usbh_urb_handle_t fill;                                 /*!< out URB frames are being packed into */
+    size_t fill_len;                                            /*!< payload length of the URB being packed */
+    uint32_t fill_frames;                                       /*!< frames in the URB being packed */
+    size_t inflight;                                            /*!< out URBs enqueued to the pipe */
+    SemaphoreHandle_t free_sem;                                 /*!< given when an out URB is returned to the free list */
+    usbh_cdc_tx_stats_t stats;                                  /*!< bulk out statistics */
+} _cdc_out_t;
+
 typedef struct {
     int itf_num;                                                /*!< interface number enabled */
     _cdc_state_t state;                                         /*!< the driver state */
@@ -70,6 +86,10 @@ typedef struct {
     RingbufHandle_t out_ringbuf_handle[CDC_INTERFACE_NUM_MAX];  /*!< if interface is ready */
     usbh_cdc_cb_t rx_callback[CDC_INTERFACE_NUM_MAX];           /*!< packet receive callback, should not block */
     void* rx_callback_arg[CDC_INTERFACE_NUM_MAX];               /*!< packet receive callback args */
+    volatile usbh_cdc_rx_direct_cb_t rx_direct_cb[CDC_INTERFACE_NUM_MAX]; /*!< takes payloads in place of the in ringbuffer */
+    void* volatile rx_direct_arg[CDC_INTERFACE_NUM_MAX];        /*!< direct receive callback args */
+    SemaphoreHandle_t out_mutex;                                /*!< guards the out URB lists of all interfaces */
+    _cdc_out_t out[CDC_INTERFACE_NUM_MAX];                      /*!< out URB lists of each interface */
     usbh_cdc_cb_t conn_callback;                                /*!< USB connect callback, set NULL if not use */
     usbh_cdc_cb_t disconn_callback;                             /*!< USB disconnect callback, set NULL if not use */
     void* conn_callback_arg;                                    /*!< USB connect callback arg, set NULL if not use  */
@@ -167,22 +187,51 @@ static bool _cdc_driver_is_ready() {
     return xEventGroupGetBits(s_cdc_instance.event_group_hdl) & CDC_DEVICE_READY_BIT;
 }
 
+/* out URB list helpers, called with out_mutex held */
+static inline iot_usbh_urb_handle_t _out_urb_get(_cdc_out_t* out) {
+    return out->free_num ? out->free[--out->free_num] : NULL;
+}
+
+static inline void _out_urb_put(_cdc_out_t* out, iot_usbh_urb_handle_t urb) {
+    assert(out->free_num < BULK_OUT_URB_NUM);
+    out->free[out->free_num++] = urb;
+}
+
+static inline void _out_fill_detach(_cdc_out_t* out) {
+    if (out->fill_frames > out->stats.max_frames_per_urb) {
+        out->stats.max_frames_per_urb = out->fill_frames;
+    }
+    out->fill = NULL;
+    out->fill_len = 0;
+    out->fill_frames = 0;
+}
+
+static inline void _out_fill_close(_cdc_out_t* out) {
+    assert(out->ready_num < BULK_OUT_URB_NUM);
+    size_t tail = (out->ready_head + out->ready_num) % BULK_OUT_URB_NUM;
+    out->ready[tail] = out->fill;
+    out->ready_len[tail] = out->fill_len;
+    ++out->ready_num;
+    _out_fill_detach(out);
+}
+
 static inline void _processing_out_pipe(int itf_num, usbh_pipe_handle_t pipe_hdl, bool if_dequeue, bool reset) {
-    static size_t pending_urb_num[CDC_INTERFACE_NUM_MAX] = { 0 };
-    static iot_usbh_urb_handle_t pending_urb[CDC_INTERFACE_NUM_MAX][BULK_OUT_URB_NUM] = { NULL };
-    esp_err_t ret = ESP_FAIL;
+    _cdc_out_t* out = &s_cdc_instance.out[itf_num];
 
     if (reset) {
+        /* all out urbs were just enqueued with no data, they come back through URB done events */
+        xSemaphoreTake(s_cdc_instance.out_mutex, portMAX_DELAY);
         for (size_t i = 0; i < CDC_INTERFACE_NUM_MAX; i++) {
-            pending_urb_num[i] = 0;
-            for (size_t j = 0; j < BULK_OUT_URB_NUM; j++) {
-                pending_urb[i][j] = NULL;
-            }
+            out = &s_cdc_instance.out[i];
+            out->free_num = 0;
+            out->ready_head = 0;
+            out->ready_num = 0;
+            out->fill = NULL;
+            out->fill_len = 0;
+            out->fill_frames = 0;
+            out->inflight = BULK_OUT_URB_NUM;
         }
-        return;
-    }
-
-    if (!pending_urb_num[itf_num] && !if_dequeue) {
+        xSemaphoreGive(s_cdc_instance.out_mutex);
         return;
     }
 
@@ -198,45 +247,59 @@ static inline void _processing_out_pipe(int itf_num, usbh_pipe_handle_t pipe_hdl
         }
 
         ESP_LOGV(TAG, "ST actual len = %u", num_bytes);
-        /* add done urb to pending urb list */
-        for (size_t i = 0; i < BULK_OUT_URB_NUM; i++) {
-            if (pending_urb[itf_num][i] == NULL) {
-                pending_urb[itf_num][i] = done_urb;
-                ++pending_urb_num[itf_num];
-                assert(pending_urb_num[itf_num] <= BULK_OUT_URB_NUM);
-                break;
-            }
+        /* return done urb to the free list */
+        xSemaphoreTake(s_cdc_instance.out_mutex, portMAX_DELAY);
+        _out_urb_put(out, done_urb);
+        --out->inflight;
+        xSemaphoreGive(s_cdc_instance.out_mutex);
+        xSemaphoreGive(out->free_sem);
+    }
+
+    /* submit in write order: full urbs, the urb being packed, then bytes buffered in ringbuffer */
+    while (1) {
+        iot_usbh_urb_handle_t next_urb = NULL;
+        size_t num_bytes_to_send = 0;
+        bool from_ringbuf = _get_usb_out_ringbuf_len(itf_num) > 0;
+
+        xSemaphoreTake(s_cdc_instance.out_mutex, portMAX_DELAY);
+        if (out->ready_num) {
+            next_urb = out->ready[out->ready_head];
+            num_bytes_to_send = out->ready_len[out->ready_head];
+            out->ready_head = (out->ready_head + 1) % BULK_OUT_URB_NUM;
+            --out->ready_num;
+            from_ringbuf = false;
+        } else if (out->fill && (out->inflight == 0 || from_ringbuf)) {
+            /* keep packing while an urb is in flight, the pipe is busy anyway */
+            next_urb = out->fill;
+            num_bytes_to_send = out->fill_len;
+            _out_fill_detach(out);
+            from_ringbuf = false;
+        } else if (from_ringbuf) {
+            next_urb = _out_urb_get(out);
         }
-    }
-
-    /* check if we have buffered data need to send */
-    if (_get_usb_out_ringbuf_len(itf_num) == 0) {
-        return;
-    }
+        xSemaphoreGive(s_cdc_instance.out_mutex);
 
-    /* fetch a pending urb from list */
-    iot_usbh_urb_handle_t next_urb = NULL;
-    size_t next_index = 0;
-    for (; next_index < BULK_OUT_URB_NUM; next_index++) {
-        if (pending_urb[itf_num][next_index] != NULL) {
-            next_urb = pending_urb[itf_num][next_index];
-            break;
+        if (next_urb == NULL) {
+            return;
         }
+        size_t buffer_size = 0;
+        uint8_t* buffer = iot_usbh_urb_buffer_claim(next_urb, &buffer_size, NULL);
+        if (from_ringbuf && _usb_out_ringbuf_pop(itf_num, buffer, buffer_size, &num_bytes_to_send, 0) != ESP_OK) {
+            num_bytes_to_send = 0;
+        }
+        esp_err_t ret = num_bytes_to_send ? iot_usbh_urb_enqueue(pipe_hdl, next_urb, num_bytes_to_send) : ESP_FAIL;
+        xSemaphoreTake(s_cdc_instance.out_mutex, portMAX_DELAY);
+        if (ret != ESP_OK) {
+            _out_urb_put(out, next_urb);
+            xSemaphoreGive(s_cdc_instance.out_mutex);
+            return;
+        }
+        ++out->inflight;
+        ++out->stats.urbs;
+        out->stats.bytes += num_bytes_to_send;
+        xSemaphoreGive(s_cdc_instance.out_mutex);
+        ESP_LOGV(TAG, "ITF%d ST %d: %.*s", itf_num, num_bytes_to_send, num_bytes_to_send, buffer);
     }
-    assert(next_urb != NULL);
-
-    size_t num_bytes_to_send = 0;
-    size_t buffer_size = 0;
-    uint8_t* buffer = iot_usbh_urb_buffer_claim(next_urb, &buffer_size, NULL);
-    ret = _usb_out_ringbuf_pop(itf_num, buffer, buffer_size, &num_bytes_to_send, 0);
-    if (ret != ESP_OK || num_bytes_to_send == 0) {
-        return;
-    }
-    iot_usbh_urb_enqueue(pipe_hdl, next_urb, num_bytes_to_send);
-    pending_urb[itf_num][next_index] = NULL;
-    --pending_urb_num[itf_num];
-    assert(pending_urb_num[itf_num] <= BULK_OUT_URB_NUM);
-    ESP_LOGV(TAG, "ITF%d ST %d: %.*s", itf_num, num_bytes_to_send, num_bytes_to_send, buffer);
 }
 
 static void inline _processing_in_pipe(int itf_num, usbh_pipe_handle_t pipe_hdl, usbh_cdc_cb_t rx_cb, void* rx_cb_arg) {
@@ -245,6 +308,12 @@ static void inline _processing_in_pipe(int itf_num, usbh_pipe_handle_t pipe_hdl,
     if (num_bytes > 0) {
         uint8_t* data_buffer = iot_usbh_urb_buffer_claim(done_urb, NULL, NULL);
         ESP_LOGV(TAG, "ITF%d RCV actual %d: %.*s", itf_num, num_bytes, num_bytes, data_buffer);
+        usbh_cdc_rx_direct_cb_t direct_cb = s_cdc_instance.rx_direct_cb[itf_num];
+        if (direct_cb && direct_cb(data_buffer, num_bytes, s_cdc_instance.rx_direct_arg[itf_num])) {
+            /* consumed in place, the URB goes back to the pipe below */
+            iot_usbh_urb_enqueue(pipe_hdl, done_urb, -1);
+            return;
+        }
         esp_err_t ret = _usb_in_ringbuf_push(itf_num, data_buffer, num_bytes, pdMS_TO_TICKS(TIMEOUT_USB_RINGBUF_MS));
 
         if (ret != ESP_OK) {
@@ -516,10 +585,18 @@ esp_err_t usbh_cdc_driver_install(const usbh_cdc_config_t* config) {
             /* using user's ep_desc */
             s_cdc_instance.bulk_out_ep_desc[i] = *config->bulk_out_eps[i];
         }
+        s_cdc_instance.rx_callback[i] = config->rx_callbacks[i];
+        s_cdc_instance.rx_callback_arg[i] = config->rx_callback_args[i];
     }
     s_cdc_instance.itf_num = itf_num;
     s_cdc_instance.event_group_hdl = xEventGroupCreate();
     ERR_CHECK(s_cdc_instance.event_group_hdl != NULL, "Create event group failed", ESP_FAIL);
+    s_cdc_instance.out_mutex = xSemaphoreCreateMutex();
+    ERR_CHECK_GOTO(s_cdc_instance.out_mutex != NULL, "Create out mutex failed", delete_resource_);
+    for (size_t i = 0; i < itf_num; i++) {
+        s_cdc_instance.out[i].free_sem = xSemaphoreCreateBinary();
+        ERR_CHECK_GOTO(s_cdc_instance.out[i].free_sem != NULL, "Create out semaphore failed", delete_resource_);
+    }
 
     for (size_t i = 0; i < itf_num; i++) {
         s_cdc_instance.in_ringbuf_handle[i] = xRingbufferCreate(config->rx_buffer_sizes[i], RINGBUF_TYPE_BYTEBUF);
@@ -558,8 +635,16 @@ delete_resource_:
         if (s_cdc_instance.in_ringbuf_handle[i]) {
             vRingbufferDelete(s_cdc_instance.in_ringbuf_handle[i]);
         }
+        if (s_cdc_instance.out[i].free_sem) {
+            vSemaphoreDelete(s_cdc_instance.out[i].free_sem);
+        }
         s_cdc_instance.in_ringbuf_handle[i] = NULL;
         s_cdc_instance.out_ringbuf_handle[i] = NULL;
+        s_cdc_instance.out[i].free_sem = NULL;
+    }
+    if (s_cdc_instance.out_mutex) {
+        vSemaphoreDelete(s_cdc_instance.out_mutex);
+        s_cdc_instance.out_mutex = NULL;
     }
     if (s_cdc_instance.event_group_hdl) {
         vEventGroupDelete(s_cdc_instance.event_group_hdl);
@@ -598,8 +683,10 @@ esp_err_t usbh_cdc_driver_delete(void) {
         if (s_cdc_instance.in_ringbuf_handle[i]) {
             vRingbufferDelete(s_cdc_instance.in_ringbuf_handle[i]);
         }
+        vSemaphoreDelete(s_cdc_instance.out[i].free_sem);
     }
 
+    vSemaphoreDelete(s_cdc_instance.out_mutex);
     vEventGroupDelete(s_cdc_instance.event_group_hdl);
     memset(&s_cdc_instance, 0, sizeof(_class_cdc_t));;
     ESP_LOGI(TAG, "CDC Driver Deleted!");
@@ -621,6 +708,16 @@ esp_err_t usbh_cdc_wait_connect(TickType_t ticks_to_wait) {
     return ESP_OK;
 }
 
+esp_err_t usbh_cdc_itf_set_rx_direct(uint8_t itf, usbh_cdc_rx_direct_cb_t cb, void* arg) {
+    ERR_CHECK(itf < CDC_INTERFACE_NUM_MAX, "interface index out of range", ESP_ERR_INVALID_ARG);
+    ERR_CHECK(_cdc_driver_is_init(), "cdc not installed", ESP_ERR_INVALID_STATE);
+    /* argument first, the CDC task reads the callback before its argument */
+    s_cdc_instance.rx_direct_cb[itf] = NULL;
+    s_cdc_instance.rx_direct_arg[itf] = arg;
+    s_cdc_instance.rx_direct_cb[itf] = cb;
+    return ESP_OK;
+}
+
 esp_err_t usbh_cdc_itf_get_buffered_data_len(uint8_t itf, size_t* size) {
     ERR_CHECK(size != NULL && itf < CDC_INTERFACE_NUM_MAX, "arg can't be NULL", ESP_ERR_INVALID_ARG);
 
@@ -697,6 +794,63 @@ int usbh_cdc_write_bytes(const uint8_t* buf, size_t length) {
     return usbh_cdc_itf_write_bytes(0, buf, length);
 }
 
+int usbh_cdc_itf_write_frame(uint8_t itf, const uint8_t* buf, size_t length) {
+    ERR_CHECK(buf != NULL && itf < CDC_INTERFACE_NUM_MAX, "invalid args", -1);
+
+    if (usbh_cdc_get_itf_state(itf) == false) {
+        ESP_LOGV(TAG, "%s: Device not connected or itf%u not ready", __func__, itf);
+        return 0;
+    }
+
+    _cdc_out_t* out = &s_cdc_instance.out[itf];
+    size_t packed = 0;
+    xSemaphoreTake(s_cdc_instance.out_mutex, portMAX_DELAY);
+    /* bytes in the ringbuffer are older, the frame goes after them */
+    while (packed < length && _get_usb_out_ringbuf_len(itf) == 0) {
+        if (out->fill == NULL && (out->fill = _out_urb_get(out)) == NULL) {
+            /* all urbs are queued or in flight, wait for the CDC task to return one */
+            xSemaphoreGive(s_cdc_instance.out_mutex);
+            BaseType_t got = xSemaphoreTake(out->free_sem, pdMS_TO_TICKS(TIMEOUT_USB_RINGBUF_MS));
+            xSemaphoreTake(s_cdc_instance.out_mutex, portMAX_DELAY);
+            if (got != pdTRUE) {
+                break;
+            }
+            continue;
+        }
+        /* byte stream, a frame not fitting in the rest of the urb continues in the next one */
+        size_t n = MIN(length - packed, BUFFER_SIZE_BULK_OUT - out->fill_len);
+        uint8_t* buffer = iot_usbh_urb_buffer_claim(out->fill, NULL, NULL);
+        memcpy(buffer + out->fill_len, buf + packed, n);
+        out->fill_len += n;
+        ++out->fill_frames;
+        packed += n;
+        if (out->fill_len == BUFFER_SIZE_BULK_OUT) {
+            _out_fill_close(out);
+        }
+    }
+    if (packed == length) {
+        ++out->stats.frames;
+    } else {
+        ++out->stats.fallbacks;
+    }
+    xSemaphoreGive(s_cdc_instance.out_mutex);
+
+    if (packed < length) {
+        return packed + usbh_cdc_itf_write_bytes(itf, buf + packed, length - packed);
+    }
+    return length;
+}
+
+esp_err_t usbh_cdc_itf_get_tx_stats(uint8_t itf, usbh_cdc_tx_stats_t* stats) {
+    ERR_CHECK(stats != NULL && itf < CDC_INTERFACE_NUM_MAX, "invalid args", ESP_ERR_INVALID_ARG);
+    ERR_CHECK(_cdc_driver_is_init(), "cdc not installed", ESP_ERR_INVALID_STATE);
+    xSemaphoreTake(s_cdc_instance.out_mutex, portMAX_DELAY);
+    *stats = s_cdc_instance.out[itf].stats;
+    xSemaphoreGive(s_cdc_instance.out_mutex);
+    stats->buffer_size = BUFFER_SIZE_BULK_OUT;
+    return ESP_OK;
+}
+
 int usbh_cdc_get_itf_state(uint8_t itf) {
     ERR_CHECK(itf < CDC_INTERFACE_NUM_MAX, "invalid args: itf", 0);
     if (_cdc_driver_is_ready() && s_cdc_instance.itf_ready[itf]) {
@@ -735,6 +889,20 @@ esp_err_t usbh_cdc_flush_tx_buffer(uint8_t itf) {
     if (buf_rcv) {
         vRingbufferReturnItem(s_cdc_instance.out_ringbuf_handle[itf], (void*)(buf_rcv));
     }
+    /* drop frames packed but not submitted yet */
+    _cdc_out_t* out = &s_cdc_instance.out[itf];
+    xSemaphoreTake(s_cdc_instance.out_mutex, portMAX_DELAY);
+    for (; out->ready_num; --out->ready_num) {
+        read_bytes += out->ready_len[out->ready_head];
+        _out_urb_put(out, out->ready[out->ready_head]);
+        out->ready_head = (out->ready_head + 1) % BULK_OUT_URB_NUM;
+    }
+    if (out->fill) {
+        read_bytes += out->fill_len;
+        _out_urb_put(out, out->fill);
+        _out_fill_detach(out);
+    }
+    xSemaphoreGive(s_cdc_instance.out_mutex);
     ESP_LOGI(TAG, "tx%u flush -%u = %u", itf, read_bytes, uxItemsWaiting);
     return ESP_OK;
 }
@@ -5,6 +5,8 @@
  */
 #pragma once
 
+#include <stdatomic.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -13,6 +15,7 @@ extern "C" {
 #include "esp_modem.h"
 #include "esp_modem_dte.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/event_groups.h"
 
 /**
@@ -42,6 +45,12 @@ typedef struct {
     esp_modem_on_receive receive_cb;        /*!< ptr to data reception */
     void *receive_cb_ctx;                   /*!< ptr to rx fn context data */
     int line_buffer_size;                   /*!< line buffer size in command mode */
+    size_t line_len;                        /*!< length of the partial line kept at the start of buffer */
+    uint8_t line_itf;                       /*!< CDC interface the partial line was read from */
+    uint32_t line_seq;                      /*!< cmd_seq seen after the partial line was last read */
+    TickType_t line_tick;                   /*!< tick when the partial line was last read */
+    atomic_uint cmd_seq;                    /*!< bumped by send_cmd before each command is written */
+    atomic_int rx_draining;                 /*!< PPP data is being read from the rx ringbuffer */
     int data_buffer_size;                   /*!< data buffer size in data mode */
     int pattern_queue_size;                 /*!< UART pattern queue size */
     int conn_state;                         /*!< DTE connection state, 0 if disconnect, 1 if connect */
@@ -49,6 +58,21 @@ typedef struct {
     usbh_cdc_cb_t disconn_callback;         /*!< DTE disconnect callback */
 } esp_modem_dte_internal_t;
 
+/**
+ * @brief Post an event to the DTE event loop and wake the receive task that runs it
+ *
+ * The receive task blocks until notified, so every post must notify it.
+ */
+static inline esp_err_t esp_modem_dte_post_event(esp_modem_dte_internal_t *esp_dte, int32_t event_id,
+                                                 const void *event_data, size_t event_data_size, TickType_t ticks_to_wait)
+{
+    esp_err_t err = esp_event_post_to(esp_dte->event_loop_hdl, ESP_MODEM_EVENT, event_id, event_data, event_data_size, ticks_to_wait);
+    if (esp_dte->uart_event_task_hdl) {
+        xTaskNotifyGive(esp_dte->uart_event_task_hdl);
+    }
+    return err;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,7 +33,7 @@ esp_err_t esp_modem_remove_event_handler(esp_modem_dte_t *dte, esp_event_handler
 esp_err_t esp_modem_post_event(esp_modem_dte_t *dte, int32_t event_id, void* event_data, size_t event_data_size, TickType_t ticks_to_wait)
 {
     esp_modem_dte_internal_t *esp_dte = __containerof(dte, esp_modem_dte_internal_t, parent);
-    return esp_event_post_to(esp_dte->event_loop_hdl, ESP_MODEM_EVENT, event_id, event_data, event_data_size, ticks_to_wait);
+    return esp_modem_dte_post_event(esp_dte, event_id, event_data, event_data_size, ticks_to_wait);
 }
 
 esp_err_t esp_modem_start_ppp(esp_modem_dte_t *dte)
@@ -46,7 +46,7 @@ esp_err_t esp_modem_start_ppp(esp_modem_dte_t *dte)
     ESP_MODEM_ERR_CHECK(dte->change_mode(dte, ESP_MODEM_PPP_MODE) == ESP_OK, "enter ppp mode failed", err);
 
     /* post PPP mode started event */
-    esp_event_post_to(esp_dte->event_loop_hdl, ESP_MODEM_EVENT, ESP_MODEM_EVENT_PPP_START, NULL, 0, 0);
+    esp_modem_dte_post_event(esp_dte, ESP_MODEM_EVENT_PPP_START, NULL, 0, 0);
     return ESP_OK;
 err:
     return ESP_FAIL;
@@ -59,7 +59,7 @@ esp_err_t esp_modem_stop_ppp(esp_modem_dte_t *dte)
     esp_modem_dte_internal_t *esp_dte = __containerof(dte, esp_modem_dte_internal_t, parent);
 
     /* post PPP mode stopped event */
-    esp_event_post_to(esp_dte->event_loop_hdl, ESP_MODEM_EVENT, ESP_MODEM_EVENT_PPP_STOP, NULL, 0, 0);
+    esp_modem_dte_post_event(esp_dte, ESP_MODEM_EVENT_PPP_STOP, NULL, 0, 0);
 
     /* wait for the PPP mode to exit gracefully */
     ESP_LOGW(TAG, "Waiting exit the PPP mode gracefully");
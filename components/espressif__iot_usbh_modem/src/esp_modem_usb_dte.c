@@ -23,6 +23,9 @@
 #define MIN_POST_IDLE (0)
 #define MIN_PRE_IDLE (0)
 
+/* A partial line not extended for this long is a lost fragment, not a line still arriving */
+#define ESP_MODEM_LINE_TIMEOUT_MS (1000)
+
  /**
   * @brief Macro defined for error checking
   *
@@ -55,16 +58,16 @@ esp_err_t esp_modem_set_rx_cb(esp_modem_dte_t* dte, esp_modem_on_receive receive
  * @brief Handle one line in DTE
  *
  * @param esp_dte ESP modem DTE object
+ * @param line NUL terminated line, including the trailing "\r\n"
+ * @param len length of line
  * @return esp_err_t
  *      - ESP_OK on success
  *      - ESP_FAIL on error
  */
-static esp_err_t esp_dte_handle_line(esp_modem_dte_internal_t* esp_dte) {
+static esp_err_t esp_dte_handle_line(esp_modem_dte_internal_t* esp_dte, const char* line, size_t len) {
     esp_err_t err = ESP_FAIL;
     esp_modem_dce_t* dce = esp_dte->parent.dce;
     ESP_MODEM_ERR_CHECK(dce, "DTE has not yet bind with DCE", err);
-    const char* line = (const char*)(esp_dte->buffer);
-    size_t len = strlen(line);
     /* Skip pure "\r\n" lines */
     if (len > 2 && !is_only_cr_lf(line, len)) {
         if (dce->handle_line == NULL) {
@@ -78,43 +81,97 @@ static esp_err_t esp_dte_handle_line(esp_modem_dte_internal_t* esp_dte) {
     return ESP_OK;
 post_event_unknown:
     /* Send ESP_MODEM_EVENT_UNKNOWN signal to event loop */
-    esp_event_post_to(esp_dte->event_loop_hdl, ESP_MODEM_EVENT, ESP_MODEM_EVENT_UNKNOWN,
-        (void*)line, strlen(line) + 1, pdMS_TO_TICKS(100));
+    esp_modem_dte_post_event(esp_dte, ESP_MODEM_EVENT_UNKNOWN, line, len + 1, pdMS_TO_TICKS(100));
 err:
     return err;
 }
 
+/**
+ * @brief Dispatch buffer[start, end) as one line, NUL terminated in place
+ */
+static void esp_dte_dispatch_line(esp_modem_dte_internal_t* esp_dte, size_t start, size_t end) {
+    uint8_t saved = esp_dte->buffer[end];
+    esp_dte->buffer[end] = '\0';
+    if (esp_dte->parent.dce->handle_line) {
+        /* Send new line to handle if handler registered */
+        esp_dte_handle_line(esp_dte, (const char*)esp_dte->buffer + start, end - start);
+    }
+    esp_dte->buffer[end] = saved;
+}
+
+/**
+ * @brief Assemble lines from a CDC interface in command mode
+ *
+ * Appends whatever is buffered to the partial line kept from the previous call, then dispatches every
+ * complete line in one pass over the new bytes. A trailing partial line stays at the start of the buffer
+ * until its "\n" arrives, so the receive task never blocks waiting for the rest of a line.
+ *
+ * A kept partial line is dropped as stale once a new command has been sent after it was read, or when
+ * nothing extended it for ESP_MODEM_LINE_TIMEOUT_MS, so a fragment never prefixes the next response.
+ *
+ * @param esp_dte ESP modem DTE object
+ * @param itf CDC interface
+ * @param length buffered data length of the interface
+ */
+static void esp_dte_assemble_lines(esp_modem_dte_internal_t* esp_dte, uint8_t itf, size_t length) {
+    if (esp_dte->line_itf != itf) {
+        /* Partial line from the other interface belongs to the previous mode */
+        esp_dte->line_len = 0;
+        esp_dte->line_itf = itf;
+    }
+    uint8_t* buffer = esp_dte->buffer;
+    size_t max = esp_dte->line_buffer_size - 1;
+    size_t fill = esp_dte->line_len;
+    length = MIN(max - fill, length);
+    int bytes = usbh_cdc_itf_read_bytes(itf, buffer + fill, length, pdMS_TO_TICKS(10));
+    if (bytes <= 0) {
+        return;
+    }
+    ESP_LOG_BUFFER_HEXDUMP(itf ? "esp-modem: debug_data2" : "esp-modem: debug_data", buffer + fill, bytes, ESP_LOG_DEBUG);
+    /* Loaded after the read: a command bumped later was written after these bytes arrived */
+    uint32_t seq = atomic_load(&esp_dte->cmd_seq);
+    TickType_t now = xTaskGetTickCount();
+    if (fill && (seq != esp_dte->line_seq || now - esp_dte->line_tick > pdMS_TO_TICKS(ESP_MODEM_LINE_TIMEOUT_MS))) {
+        ESP_LOGD(TAG, "Drop stale partial line: %.*s", (int)fill, (const char*)buffer);
+        memmove(buffer, buffer + fill, bytes);
+        fill = 0;
+    }
+    esp_dte->line_seq = seq;
+    esp_dte->line_tick = now;
+    size_t end = fill + bytes;
+    size_t start = 0;
+    /* The kept partial line has no "\n", only the new bytes need scanning */
+    const uint8_t* nl;
+    while ((nl = memchr(buffer + fill, '\n', end - fill)) != NULL) {
+        fill = nl - buffer + 1;
+        esp_dte_dispatch_line(esp_dte, start, fill);
+        start = fill;
+    }
+    if (start == 0 && end == max) {
+        /* Line longer than the buffer, hand it over as is */
+        esp_dte_dispatch_line(esp_dte, 0, end);
+        start = end;
+    }
+    if (start > 0) {
+        memmove(buffer, buffer + start, end - start);
+    }
+    esp_dte->line_len = end - start;
+}
+
 static void esp_handle_usb_data(esp_modem_dte_internal_t* esp_dte) {
     size_t length = 0;
     usbh_cdc_get_buffered_data_len(&length);
 
     if (esp_dte->parent.dce->mode != ESP_MODEM_PPP_MODE && length) {
-
-        // Read the data and process it using `handle_line` logic
-        // to avoid reading two line at the same time
-        length = MIN(esp_dte->line_buffer_size - 1, length);
-        length = usbh_cdc_read_bytes(esp_dte->buffer, length, pdMS_TO_TICKS(10));
-        esp_dte->buffer[length] = '\0';
-        if (strchr((char*)esp_dte->buffer, '\n') == NULL) {
-            size_t max = esp_dte->line_buffer_size - 1;
-            size_t bytes;
-            // if pattern not found in the data,
-            // continue reading as long as the modem is in MODEM_STATE_PROCESSING, checking for the pattern
-            while (length < max && esp_dte->buffer[length - 1] != '\n' &&
-                esp_dte->parent.dce->state == ESP_MODEM_STATE_PROCESSING) {
-                bytes = usbh_cdc_read_bytes(esp_dte->buffer + length, 1, pdMS_TO_TICKS(10));
-                length += bytes;
-                ESP_LOGV("esp-modem: debug_data", "Continuous read in non-data mode: length: %d char: %x", length, esp_dte->buffer[length - 1]);
-            }
-            esp_dte->buffer[length] = '\0';
-        }
-        ESP_LOG_BUFFER_HEXDUMP("esp-modem: debug_data", esp_dte->buffer, length, ESP_LOG_DEBUG);
-        if (esp_dte->parent.dce->handle_line) {
-            /* Send new line to handle if handler registered */
-            esp_dte_handle_line(esp_dte);
-        }
+        esp_dte_assemble_lines(esp_dte, 0, length);
         return;
     }
+    if (esp_dte->line_itf == 0) {
+        /* Drop the partial command line left when entering data mode */
+        esp_dte->line_len = 0;
+    }
+    /* Set before reading, so the direct path waits until these bytes are delivered */
+    atomic_store(&esp_dte->rx_draining, 1);
     length = MIN(esp_dte->data_buffer_size, length);
     length = usbh_cdc_read_bytes(esp_dte->data_buffer, length, pdMS_TO_TICKS(10));
     /* pass the input data to configured callback */
@@ -122,38 +179,40 @@ static void esp_handle_usb_data(esp_modem_dte_internal_t* esp_dte) {
         ESP_LOG_BUFFER_HEXDUMP("esp-modem-dte: ppp_input", esp_dte->data_buffer, length, ESP_LOG_VERBOSE);
         esp_dte->receive_cb(esp_dte->data_buffer, length, esp_dte->receive_cb_ctx);
     }
+    atomic_store(&esp_dte->rx_draining, 0);
 }
 
+#ifdef CONFIG_MODEM_USB_RX_ZERO_COPY
+/**
+ * @brief Pass PPP input straight from the URB buffer, called in the CDC task
+ *
+ * Only in PPP mode, and only when nothing older is left in the rx ringbuffer or being delivered by the
+ * receive task, so bytes reach the PPP input in order. Otherwise the payload goes to the ringbuffer.
+ */
+static bool _usb_recv_direct_cb(const uint8_t* data, size_t len, void* arg) {
+    esp_modem_dte_internal_t* esp_dte = (esp_modem_dte_internal_t*)arg;
+    if (esp_dte->parent.dce == NULL || esp_dte->parent.dce->mode != ESP_MODEM_PPP_MODE || esp_dte->receive_cb == NULL) {
+        return false;
+    }
+    /* Ringbuffer first: once it is empty, a reader that took the last bytes has already set rx_draining */
+    size_t buffered = 0;
+    usbh_cdc_itf_get_buffered_data_len(0, &buffered);
+    if (buffered || atomic_load(&esp_dte->rx_draining)) {
+        return false;
+    }
+    ESP_LOG_BUFFER_HEXDUMP("esp-modem-dte: ppp_input", data, len, ESP_LOG_VERBOSE);
+    esp_dte->receive_cb((void*)data, len, esp_dte->receive_cb_ctx);
+    return true;
+}
+#endif
+
 static void esp_handle_usb2_data(esp_modem_dte_internal_t* esp_dte) {
     size_t length = 0;
     usbh_cdc_itf_get_buffered_data_len(1, &length);
 
     // Only handle interface1 data during interface0 in ppp mode
     if (esp_dte->parent.dce->mode == ESP_MODEM_PPP_MODE && length) {
-
-        // Read the data and process it using `handle_line` logic
-        // to avoid reading two line at the same time
-        length = MIN(esp_dte->line_buffer_size - 1, length);
-        length = usbh_cdc_itf_read_bytes(1, esp_dte->buffer, length, pdMS_TO_TICKS(10));
-        esp_dte->buffer[length] = '\0';
-        if (strchr((char*)esp_dte->buffer, '\n') == NULL) {
-            size_t max = esp_dte->line_buffer_size - 1;
-            size_t bytes;
-            // if pattern not found in the data,
-            // continue reading as long as the modem is in MODEM_STATE_PROCESSING, checking for the pattern
-            while (length < max && esp_dte->buffer[length - 1] != '\n' &&
-                esp_dte->parent.dce->state == ESP_MODEM_STATE_PROCESSING) {
-                bytes = usbh_cdc_itf_read_bytes(1, esp_dte->buffer + length, 1, pdMS_TO_TICKS(10));
-                length += bytes;
-                ESP_LOGV("esp-modem: debug_data2", "Continuous read in non-data mode: length: %d char: %x", length, esp_dte->buffer[length - 1]);
-            }
-            esp_dte->buffer[length] = '\0';
-        }
-        ESP_LOG_BUFFER_HEXDUMP("esp-modem: debug_data2", esp_dte->buffer, length, ESP_LOG_DEBUG);
-        if (esp_dte->parent.dce->handle_line) {
-            /* Send new line to handle if handler registered */
-            esp_dte_handle_line(esp_dte);
-        }
+        esp_dte_assemble_lines(esp_dte, 1, length);
         return;
     }
     length = MIN(esp_dte->data_buffer_size, length);
@@ -192,6 +251,10 @@ static void _usb_disconn_callback(void* arg) {
 /**
  * @brief USB Event Task Entry
  *
+ * Blocks until notified by the CDC RX callbacks or by a post to the DTE event loop, so an idle link
+ * costs no wakeups. Buffered data is drained before blocking again; a notification given while
+ * draining is kept by the task and makes the next wait return at once.
+ *
  * @param param task parameter
  */
 static void _usb_data_recv_task(void* param) {
@@ -215,7 +278,7 @@ static void _usb_data_recv_task(void* param) {
             if (length2 > 0) esp_handle_usb2_data(esp_dte);
         }
         if (!(length || length2)) {
-            ulTaskNotifyTake(true, 1);//yield to other task, but unblock as soon as possiable
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
         }
     }
     vTaskDelete(NULL);
@@ -240,6 +303,8 @@ static esp_err_t esp_modem_dte_send_cmd(esp_modem_dte_t* dte, const char* comman
     /* Calculate timeout clock tick */
     /* Reset runtime information */
     dce->state = ESP_MODEM_STATE_PROCESSING;
+    /* Partial line read before this point is not part of the response, the receive task drops it */
+    atomic_fetch_add(&esp_dte->cmd_seq, 1);
     /* Send command via UART */
     if (dce->mode == ESP_MODEM_PPP_MODE && usbh_cdc_get_itf_state(1) && strcmp(command, "+++")) {
         /* if interface 0 in ppp mode while interface 1 exist, and command not ppp exist "+++"
@@ -279,6 +344,11 @@ static int esp_modem_dte_send_data(esp_modem_dte_t* dte, const char* data, uint3
     }
     ESP_LOG_BUFFER_HEXDUMP("esp-modem-dte: ppp_output", data, length, ESP_LOG_VERBOSE);
 
+#ifdef CONFIG_MODEM_USB_TX_DIRECT
+    if (esp_dte->parent.dce->mode == ESP_MODEM_PPP_MODE) {
+        return usbh_cdc_itf_write_frame(0, (const uint8_t*)data, length);
+    }
+#endif
     return usbh_cdc_write_bytes((const uint8_t*)data, length);
 err:
     return -1;
@@ -443,11 +513,16 @@ esp_modem_dte_t* esp_modem_dte_new(const esp_modem_dte_config_t* config) {
     cdc_config.bulk_out_ep_addrs[1] = CONFIG_MODEM_USB_OUT2_EP_ADDR;
     cdc_config.rx_buffer_sizes[1] = config->rx_buffer_size;
     cdc_config.tx_buffer_sizes[1] = config->tx_buffer_size;
+    cdc_config.rx_callbacks[1] = _usb_recv_date_cb;
+    cdc_config.rx_callback_args[1] = &esp_dte->uart_event_task_hdl;
     ESP_LOGI(TAG, "Enable second AT port");
 #endif
 
     ret = usbh_cdc_driver_install(&cdc_config);
     ESP_MODEM_ERR_CHECK(ret == ESP_OK, "usb driver install failed", err_usb_config);
+#ifdef CONFIG_MODEM_USB_RX_ZERO_COPY
+    usbh_cdc_itf_set_rx_direct(0, _usb_recv_direct_cb, esp_dte);
+#endif
     ret = usbh_cdc_wait_connect(portMAX_DELAY);
     ESP_MODEM_ERR_CHECK(ret == ESP_OK, "usb connect timeout", err_usb_config);
     /* Create USB Event task */
@@ -0,0 +1,349 @@
+/**
+ * @brief   SD 卡存储性能测试，按 app_sd.c 的实际用法测量：顺序追加吞吐量，fsync() 延迟分布，
+ *          fopen()、rename()、remove() 耗时，目录遍历耗时。结果输出 JSON，方便比较不同批次的 SD 卡。
+ *
+ *          主循环和 60 秒的守护超时都依赖 SD 卡的写入耗时，这里给出实际的数据。
+ *          追加写入的记录长度和缓存日志的一条 JSON 相同，每 4 KB fsync() 一次，和组提交相同。
+ *          同样的记录再写入预分配的段文件（app_seg.c，缓存日志的写法），和追加写入比较，然后逐条读出。
+ *
+ *          本文件只用标准 C 文件接口、esp_timer_get_time() 和 cJSON，不依赖 SD 卡驱动，主机上用同一套测试测量
+ *          挂载的 FAT 镜像，输出相同的 JSON，见 test/host/bench_host.c。SD 卡路径和卡信息在 app_bench_sd.c 中。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/unistd.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "app_bench.h"
+#include "app_seg.h"
+
+ /**
+ * @brief 临时目录中的文件名。
+ */
+#define APP_BENCH_APPEND_BIN        "APPEND.BIN"
+#define APP_BENCH_RENAME_BIN        "RENAME.BIN"
+#define APP_BENCH_SEG_BIN           "SEG.BIN"
+
+ /**
+ * @brief 路径长度。
+ */
+#define APP_BENCH_PATH_SIZE         128
+
+ /**
+ * @brief 追加写入的记录长度和 fsync() 间隔。
+ */
+#define APP_BENCH_RECORD_SIZE       200
+#define APP_BENCH_SYNC_BYTES        4096
+
+ /**
+ * @brief fopen()、rename()、remove() 的次数，目录遍历的次数。
+ */
+#define APP_BENCH_OPS               20
+#define APP_BENCH_SCANS             3
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_bench";
+
+/**
+ * @brief 记录一次耗时。
+ */
+static void app_bench_add(app_bench_hist_t* hist, int64_t start) {
+    uint32_t us = esp_timer_get_time() - start;
+    int i = 0;
+    while (i < APP_BENCH_BUCKETS - 1 && us >= (1UL << (i + 6))) {
+        i++;
+    }
+    hist->buckets[i]++;
+    hist->count++;
+    hist->sum_us += us;
+    if (us > hist->max_us) {
+        hist->max_us = us;
+    }
+}
+
+/**
+ * @brief 百分位数，取所在桶的上限，不超过最大值。
+ */
+static uint32_t app_bench_percentile(const app_bench_hist_t* hist, uint32_t percent) {
+    uint32_t want = (hist->count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < APP_BENCH_BUCKETS - 1; i++) {
+        seen += hist->buckets[i];
+        if (seen >= want) {
+            uint32_t upper = 1UL << (i + 6);
+            return upper < hist->max_us ? upper : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+/**
+ * @brief 临时目录中的文件路径。
+ */
+static const char* app_bench_path(char* path, const char* dir, const char* name) {
+    snprintf(path, APP_BENCH_PATH_SIZE, "%s/%s", dir, name);
+    return path;
+}
+
+/**
+ * @brief 顺序追加写入，每 4 KB fsync() 一次。
+ */
+static esp_err_t app_bench_append(const char* append_bin, uint32_t kb, app_bench_result_t* result) {
+    FILE* file = fopen(append_bin, "a");
+    if (file == NULL) {
+        return ESP_FAIL;
+    }
+    char record[APP_BENCH_RECORD_SIZE];
+    memset(record, 'x', sizeof(record));
+    record[sizeof(record) - 1] = '\n';
+    uint32_t total = kb * 1024;
+    uint32_t written = 0;
+    uint32_t unsynced = 0;
+    esp_err_t ret = ESP_OK;
+    int64_t begin = esp_timer_get_time();
+    while (written < total) {
+        int64_t start = esp_timer_get_time();
+        if (fwrite(record, 1, sizeof(record), file) != sizeof(record)) {
+            ret = ESP_FAIL;
+            break;
+        }
+        app_bench_add(&result->append, start);
+        written += sizeof(record);
+        unsynced += sizeof(record);
+        if (unsynced >= APP_BENCH_SYNC_BYTES || written >= total) {
+            start = esp_timer_get_time();
+            fflush(file);
+            fsync(fileno(file));
+            app_bench_add(&result->fsync, start);
+            unsynced = 0;
+        }
+    }
+    uint32_t elapsed_ms = (esp_timer_get_time() - begin) / 1000;
+    fclose(file);
+    result->kbps = elapsed_ms > 0 ? (uint64_t)written * 1000 / 1024 / elapsed_ms : 0;
+    return ret;
+}
+
+/**
+ * @brief 同样的字节数写入预分配的段文件，每 4 KB app_seg_sync() 一次，然后逐条读出。
+ */
+static esp_err_t app_bench_seg(const char* seg_bin, uint32_t kb, app_bench_result_t* result) {
+    char record[APP_BENCH_RECORD_SIZE - APP_SEG_REC_HDR_SIZE];// 加上记录头和追加写入的记录一样长。
+    memset(record, 'x', sizeof(record));
+    app_seg_writer_t writer;
+    int64_t begin = esp_timer_get_time();
+    if (app_seg_open(&writer, seg_bin, 0, APP_SEG_HDR_SIZE + kb * 1024, NULL, 0) != 0) {
+        return ESP_FAIL;
+    }
+    result->seg_create_ms = (esp_timer_get_time() - begin) / 1000;
+    uint32_t written = 0;
+    uint32_t unsynced = 0;
+    esp_err_t ret = ESP_OK;
+    begin = esp_timer_get_time();
+    while (app_seg_room(&writer) >= APP_BENCH_RECORD_SIZE) {
+        if (app_seg_append(&writer, record, sizeof(record), 0) != 0) {
+            ret = ESP_FAIL;
+            break;
+        }
+        written += APP_BENCH_RECORD_SIZE;
+        unsynced += APP_BENCH_RECORD_SIZE;
+        if (unsynced >= APP_BENCH_SYNC_BYTES) {
+            int64_t start = esp_timer_get_time();
+            app_seg_sync(&writer);
+            app_bench_add(&result->seg_sync, start);
+            unsynced = 0;
+        }
+    }
+    int64_t start = esp_timer_get_time();
+    app_seg_close(&writer, true);// 和追加写入最后一次 fsync() 相同，剩余的记录在这里写入。
+    app_bench_add(&result->seg_sync, start);
+    uint32_t elapsed_ms = (esp_timer_get_time() - begin) / 1000;
+    result->seg_kbps = elapsed_ms > 0 ? (uint64_t)written * 1000 / 1024 / elapsed_ms : 0;
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    FILE* file = fopen(seg_bin, "rb");
+    if (file == NULL) {
+        return ESP_FAIL;
+    }
+    begin = esp_timer_get_time();
+    uint32_t data_start;
+    uint32_t fill;
+    uint32_t read = 0;
+    char buf[APP_BENCH_RECORD_SIZE];
+    if (app_seg_range(file, &data_start, &fill) == 0) {
+        uint32_t off = data_start;
+        uint32_t next = off;
+        while (app_seg_read(file, off, fill, buf, sizeof(buf), &next) > 0) {
+            read += next - off;
+            off = next;
+        }
+    }
+    elapsed_ms = (esp_timer_get_time() - begin) / 1000;
+    fclose(file);
+    result->seg_read_kbps = elapsed_ms > 0 ? (uint64_t)read * 1000 / 1024 / elapsed_ms : 0;
+    return read == written ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief fopen("a") + fclose()，rename()，创建小文件以后 remove()。
+ */
+static void app_bench_file_ops(const char* dir, app_bench_result_t* result) {
+    char append_bin[APP_BENCH_PATH_SIZE];
+    char rename_bin[APP_BENCH_PATH_SIZE];
+    app_bench_path(append_bin, dir, APP_BENCH_APPEND_BIN);
+    app_bench_path(rename_bin, dir, APP_BENCH_RENAME_BIN);
+    for (int i = 0; i < APP_BENCH_OPS; i++) {
+        int64_t start = esp_timer_get_time();
+        FILE* file = fopen(append_bin, "a");
+        if (file != NULL) {
+            fclose(file);
+            app_bench_add(&result->open, start);
+        }
+    }
+    for (int i = 0; i < APP_BENCH_OPS; i++) {
+        int64_t start = esp_timer_get_time();
+        int ret = (i & 1) == 0 ? rename(append_bin, rename_bin) : rename(rename_bin, append_bin);
+        if (ret == 0) {
+            app_bench_add(&result->rename, start);
+        }
+    }
+    char path[APP_BENCH_PATH_SIZE];
+    for (int i = 0; i < APP_BENCH_OPS; i++) {
+        snprintf(path, sizeof(path), "%s/R%07d.BIN", dir, i);
+        FILE* file = fopen(path, "w");
+        if (file != NULL) {
+            fputs("x\n", file);
+            fclose(file);
+        }
+    }
+    for (int i = 0; i < APP_BENCH_OPS; i++) {
+        snprintf(path, sizeof(path), "%s/R%07d.BIN", dir, i);
+        int64_t start = esp_timer_get_time();
+        if (remove(path) == 0) {
+            app_bench_add(&result->remove, start);
+        }
+    }
+}
+
+/**
+ * @brief 遍历日志目录，和启动时的目录遍历相同。
+ */
+static void app_bench_scan(const char* scan_dir, app_bench_result_t* result) {
+    for (int i = 0; i < APP_BENCH_SCANS; i++) {
+        int64_t start = esp_timer_get_time();
+        DIR* dp = opendir(scan_dir);
+        if (dp == NULL) {
+            return;
+        }
+        uint32_t files = 0;
+        while (readdir(dp) != NULL) {
+            files++;
+        }
+        closedir(dp);
+        app_bench_add(&result->scan, start);
+        result->scan_files = files;
+    }
+}
+
+/**
+ * @brief 在指定的临时目录中执行测试，测试完删除目录。
+ * @param dir 临时目录，不存在时创建。
+ * @param scan_dir 遍历的目录。
+ * @param kb 追加写入的字节数，KB。
+ * @param result
+ * @return
+ */
+esp_err_t app_bench_run_dir(const char* dir, const char* scan_dir, uint32_t kb, app_bench_result_t* result) {
+    memset(result, 0, sizeof(app_bench_result_t));
+    result->kb = kb;
+    if (strlen(dir) + 16 > APP_BENCH_PATH_SIZE) {
+        ESP_LOGE(TAG, "------ SD 卡性能测试：失败！目录太长：%s", dir);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (access(dir, F_OK) == -1 && mkdir(dir, 0700) == -1) {
+        ESP_LOGE(TAG, "------ SD 卡性能测试：失败！创建目录失败：%s", dir);
+        return ESP_FAIL;
+    }
+    char append_bin[APP_BENCH_PATH_SIZE];
+    char rename_bin[APP_BENCH_PATH_SIZE];
+    char seg_bin[APP_BENCH_PATH_SIZE];
+    app_bench_path(append_bin, dir, APP_BENCH_APPEND_BIN);
+    app_bench_path(rename_bin, dir, APP_BENCH_RENAME_BIN);
+    app_bench_path(seg_bin, dir, APP_BENCH_SEG_BIN);
+    remove(append_bin);
+    remove(rename_bin);
+    remove(seg_bin);
+    ESP_LOGI(TAG, "------ SD 卡性能测试：开始。追加写入：%lu KB", kb);
+    esp_err_t ret = app_bench_append(append_bin, kb, result);
+    if (ret == ESP_OK) {
+        app_bench_file_ops(dir, result);
+        app_bench_scan(scan_dir, result);
+        ret = app_bench_seg(seg_bin, kb, result);
+    }
+    remove(append_bin);
+    remove(rename_bin);
+    remove(seg_bin);
+    rmdir(dir);
+    ESP_LOGI(TAG, "------ SD 卡性能测试：%s。吞吐量：%lu KB/s，fsync：p50 %lu p99 %lu 最大 %lu 微秒",
+        ret == ESP_OK ? "完成" : "失败", result->kbps,
+        app_bench_percentile(&result->fsync, 50), app_bench_percentile(&result->fsync, 99), result->fsync.max_us);
+    ESP_LOGI(TAG, "------ SD 卡性能测试：段文件预分配 %lu 毫秒，写入 %lu KB/s，sync：p50 %lu p99 %lu 微秒，读取 %lu KB/s",
+        result->seg_create_ms, result->seg_kbps, app_bench_percentile(&result->seg_sync, 50),
+        app_bench_percentile(&result->seg_sync, 99), result->seg_read_kbps);
+    return ret;
+}
+
+/**
+ * @brief 延迟分布添加到 JSON 对象。
+ */
+static void app_bench_add_hist(cJSON* obj, const char* name, const app_bench_hist_t* hist) {
+    cJSON* item = cJSON_AddObjectToObject(obj, name);
+    if (item == NULL) {
+        return;
+    }
+    cJSON_AddNumberToObject(item, "n", hist->count);
+    cJSON_AddNumberToObject(item, "avg", hist->count > 0 ? (double)(hist->sum_us / hist->count) : 0);
+    cJSON_AddNumberToObject(item, "p50", app_bench_percentile(hist, 50));
+    cJSON_AddNumberToObject(item, "p90", app_bench_percentile(hist, 90));
+    cJSON_AddNumberToObject(item, "p99", app_bench_percentile(hist, 99));
+    cJSON_AddNumberToObject(item, "max", hist->max_us);
+    int buckets[APP_BENCH_BUCKETS];
+    for (int i = 0; i < APP_BENCH_BUCKETS; i++) {
+        buckets[i] = hist->buckets[i];
+    }
+    cJSON_AddItemToObject(item, "h", cJSON_CreateIntArray(buckets, APP_BENCH_BUCKETS));
+}
+
+/**
+ * @brief 测试结果添加到 JSON 对象，延迟单位：微秒。
+ * @param obj
+ * @param result
+ */
+void app_bench_add_result_json(cJSON* obj, const app_bench_result_t* result) {
+    cJSON_AddNumberToObject(obj, "kb", result->kb);
+    cJSON_AddNumberToObject(obj, "kbps", result->kbps);
+    app_bench_add_hist(obj, "append", &result->append);
+    app_bench_add_hist(obj, "fsync", &result->fsync);
+    app_bench_add_hist(obj, "open", &result->open);
+    app_bench_add_hist(obj, "rename", &result->rename);
+    app_bench_add_hist(obj, "remove", &result->remove);
+    app_bench_add_hist(obj, "scan", &result->scan);
+    cJSON_AddNumberToObject(obj, "files", result->scan_files);
+    cJSON* seg = cJSON_AddObjectToObject(obj, "seg");
+    if (seg != NULL) {
+        cJSON_AddNumberToObject(seg, "create_ms", result->seg_create_ms);
+        cJSON_AddNumberToObject(seg, "kbps", result->seg_kbps);
+        cJSON_AddNumberToObject(seg, "read_kbps", result->seg_read_kbps);
+        app_bench_add_hist(seg, "sync", &result->seg_sync);
+    }
+}
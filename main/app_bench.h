@@ -0,0 +1,78 @@
+/**
+ * @brief   SD 卡存储性能测试，按 app_sd.c 的实际用法测量：顺序追加吞吐量，fsync() 延迟分布，
+ *          fopen()、rename()、remove() 耗时，目录遍历耗时。结果输出 JSON，方便比较不同批次的 SD 卡。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "cJSON.h"
+
+ /**
+  * @brief 延迟分布的桶数。第 i 个桶是小于 2^(i + 6) 微秒，从 64 微秒到 2 秒，最后一个桶是更长的。
+  */
+#define APP_BENCH_BUCKETS           16
+
+ /**
+  * @brief 延迟分布，微秒。
+  */
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[APP_BENCH_BUCKETS];
+} app_bench_hist_t;
+
+ /**
+  * @brief 测试结果。
+  */
+typedef struct {
+    uint32_t kb;                // 追加写入的字节数，KB。
+    uint32_t kbps;              // 顺序追加吞吐量，包括 fsync()，KB/s。
+    uint32_t scan_files;        // 遍历的目录项数。
+    app_bench_hist_t append;    // 每条记录 fwrite()。
+    app_bench_hist_t fsync;     // 每 4 KB fflush() + fsync()。
+    app_bench_hist_t open;      // fopen("a") + fclose()。
+    app_bench_hist_t rename;
+    app_bench_hist_t remove;
+    app_bench_hist_t scan;      // opendir() + readdir() 遍历日志目录。
+    uint32_t seg_create_ms;     // 段文件预分配耗时，毫秒。
+    uint32_t seg_kbps;          // 预分配的段文件内覆盖写入的吞吐量，包括 fsync()，KB/s。和缓存日志相同。
+    uint32_t seg_read_kbps;     // 逐条读取段文件记录并校验 CRC 的吞吐量，KB/s。
+    app_bench_hist_t seg_sync;  // 段文件每 4 KB app_seg_sync()，最后一次是封闭段文件。
+} app_bench_result_t;
+
+/**
+ * @brief 在指定的临时目录中执行测试，测试完删除目录。不依赖 SD 卡驱动，主机上用来测量挂载的 FAT 镜像。
+ * @param dir 临时目录，不存在时创建。
+ * @param scan_dir 遍历的目录。
+ * @param kb 追加写入的字节数，KB。
+ * @param result
+ * @return
+ */
+esp_err_t app_bench_run_dir(const char* dir, const char* scan_dir, uint32_t kb, app_bench_result_t* result);
+
+/**
+ * @brief 测试结果添加到 JSON 对象，延迟单位：微秒。
+ * @param obj
+ * @param result
+ */
+void app_bench_add_result_json(cJSON* obj, const app_bench_result_t* result);
+
+/**
+ * @brief 执行测试，在 SD 卡上创建临时目录，测试完删除。耗时几秒，不能在 MQTT 事件回调中调用。
+ * @param kb 追加写入的字节数，KB。
+ * @param result
+ * @return
+ */
+esp_err_t app_bench_run(uint32_t kb, app_bench_result_t* result);
+
+/**
+ * @brief 测试结果和 SD 卡信息添加到 JSON 对象，延迟单位：微秒。
+ * @param obj
+ * @param result
+ */
+void app_bench_add_json(cJSON* obj, const app_bench_result_t* result);
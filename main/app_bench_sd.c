@@ -0,0 +1,50 @@
+/**
+ * @brief   SD 卡存储性能测试的设备部分：测试目录在 SD 卡上，结果带 SD 卡信息。测试本身见 app_bench.c。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "app_sd.h"
+#include "app_bench.h"
+
+ /**
+ * @brief 临时目录。
+ */
+#define APP_BENCH_DIR               SDMMC_MOUNT_POINT"/BENCH"
+
+/**
+ * @brief 执行测试，在 SD 卡上创建临时目录，测试完删除。耗时几秒，不能在 MQTT 事件回调中调用。
+ * @param kb 追加写入的字节数，KB。
+ * @param result
+ * @return
+ */
+esp_err_t app_bench_run(uint32_t kb, app_bench_result_t* result) {
+    return app_bench_run_dir(APP_BENCH_DIR, APP_SD_LOG_DIR, kb, result);
+}
+
+/**
+ * @brief 测试结果和 SD 卡信息添加到 JSON 对象，延迟单位：微秒。
+ * @param obj
+ * @param result
+ */
+void app_bench_add_json(cJSON* obj, const app_bench_result_t* result) {
+    const sdmmc_card_t* card = app_sd_get_card();
+    if (card != NULL) {
+        cJSON* item = cJSON_AddObjectToObject(obj, "card");
+        if (item != NULL) {
+            char name[sizeof(card->cid.name) + 1] = { 0 };
+            memcpy(name, card->cid.name, sizeof(card->cid.name));
+            cJSON_AddStringToObject(item, "name", name);
+            cJSON_AddNumberToObject(item, "mid", card->cid.mfg_id);
+            cJSON_AddNumberToObject(item, "oid", card->cid.oem_id);
+            cJSON_AddNumberToObject(item, "rev", card->cid.revision);
+            cJSON_AddNumberToObject(item, "date", card->cid.date);
+            cJSON_AddNumberToObject(item, "mb", (uint64_t)card->csd.capacity * card->csd.sector_size / (1024 * 1024));
+            cJSON_AddNumberToObject(item, "khz", card->max_freq_khz);
+        }
+    }
+    app_bench_add_result_json(obj, result);
+}
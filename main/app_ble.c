@@ -22,6 +22,7 @@
 #include "driver/gpio.h"
 
 #include "app_gpio.h"
+#include "app_ctrl.h"
 #include "app_config.h"
 
  /**
@@ -92,7 +93,9 @@ static void app_ble_leave_task(void* param) {
     while (1) {
         int cur_ts = esp_log_timestamp() / 1000;// 系统启动以后的秒数。
         int ble_ts = atomic_load(&app_ble_disc_ts) / 1000;// 最后一次扫描到蓝牙开关的秒数。
-        if (cur_ts - ble_ts > APP_BLE_LEAVE_TIMEOUT) {// 如果蓝牙开关离开 1 分钟，则关闭。
+        app_ctrl_params_t params;
+        app_ctrl_get_params(&params);// 离开超时可以远程修改，默认 APP_BLE_LEAVE_TIMEOUT。
+        if (cur_ts - ble_ts > (int)params.ble_timeout) {// 如果蓝牙开关离开 1 分钟，则关闭。
             int ret = app_gpio_set_level(APP_GPIO_NUM_BLE, 0);
             if (ret) {
                 ESP_LOGI(TAG, "------ 蓝牙接近开关: 关闭。");
@@ -0,0 +1,401 @@
+/**
+ * @brief   MQTT 服务器列表，按连接耗时和往返延迟选择备用服务器，连续连接失败时切换，主服务器恢复以后切回。
+ *
+ *          esp-mqtt 每次连接之前发出 MQTT_EVENT_BEFORE_CONNECT，上一次连接没有收到 CONNACK 就是一次失败。
+ *          连续失败达到次数以后，从其它服务器中选延迟最小的，冷却期内切走过的服务器不选。
+ *          使用备用服务器时，主服务器冷却期过后定期做 TCP 连接探测，可达时用主服务器重连试连，收到 CONNACK 才算切回；
+ *          试连没有收到 CONNACK 则退回原来的备用服务器，主服务器重新开始冷却。
+ *          outbox 和 SD 卡缓存与服务器无关，切换以后在新连接上继续重发和推送。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+
+#include "app_broker.h"
+#include "app_ctrl.h"
+#include "app_rtt.h"
+#include "app_config.h"
+
+ /**
+ * @brief 未测量的服务器按这个延迟参与排序，毫秒。测量过的慢服务器排在未测量的后面。
+ */
+#define APP_BROKER_UNKNOWN_MS       3000
+
+ /**
+ * @brief 切走以后的冷却时间，毫秒。冷却期内不再选择，除非没有其它服务器可选。
+ */
+#define APP_BROKER_COOLDOWN         (10 * 60 * 1000)
+
+ /**
+ * @brief 主服务器 TCP 探测超时，毫秒。
+ */
+#define APP_BROKER_PROBE_TIMEOUT    3000
+
+ /**
+ * @brief 任务周期，秒。每个周期记录一次当前服务器的往返延迟。
+ */
+#define APP_BROKER_TASK_PERIOD      60
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_broker";
+
+/**
+ * @brief 服务器地址，按优先级排列。
+ */
+static const char* app_broker_uris[] = APP_MQTT_URI_LIST;
+
+#define APP_BROKER_COUNT            ((int)(sizeof(app_broker_uris) / sizeof(app_broker_uris[0])))
+
+/**
+ * @brief 服务器状态。
+ */
+typedef struct {
+    uint32_t connect_ms;        // 连接耗时，平滑值，0 = 未测量。
+    uint32_t rtt_ms;            // PUBACK 往返时间中位数，0 = 未测量。
+    uint32_t fails;             // 连续连接失败次数。
+    uint32_t connects;          // 连接成功次数。
+    uint32_t leave_ts;          // 因为连接失败切走的时间戳，0 = 没有切走过。
+} app_broker_t;
+
+static app_broker_t app_brokers[APP_BROKER_COUNT] = { 0 };
+
+/**
+ * @brief 当前服务器序号，上次连接成功的服务器序号。
+ */
+static int app_broker_active = 0;
+static int app_broker_last = -1;
+
+/**
+ * @brief 正在连接，还没有收到 CONNACK，以及开始连接的时间戳。
+ */
+static int app_broker_pending = 0;
+static uint32_t app_broker_begin_ts = 0;
+
+/**
+ * @brief 正在试连主服务器时，试连失败要退回的备用服务器序号，-1 = 没有试连。
+ */
+static int app_broker_trial_from = -1;
+
+/**
+ * @brief 互斥锁。MQTT 事件回调持有客户端锁时会获取这个锁，持有这个锁时不能调用 MQTT 客户端函数。
+ */
+static pthread_mutex_t app_broker_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static esp_mqtt_client_handle_t app_broker_client = NULL;
+
+/**
+ * @brief 排序用的延迟，连接耗时加往返延迟。
+ */
+static uint32_t app_broker_score(const app_broker_t* broker) {
+    if (broker->connect_ms == 0) {
+        return APP_BROKER_UNKNOWN_MS;
+    }
+    return broker->connect_ms + broker->rtt_ms;
+}
+
+/**
+ * @brief 选择下一个服务器，延迟最小的优先，相同时按列表顺序。
+ * @param from 当前服务器序号，不参与选择。
+ */
+static int app_broker_select(int from) {
+    uint32_t now = esp_log_timestamp();
+    int best = -1;
+    uint32_t best_score = UINT32_MAX;
+    for (int i = 0; i < APP_BROKER_COUNT; i++) {
+        const app_broker_t* broker = &app_brokers[i];
+        if (i == from || (broker->leave_ts != 0 && now - broker->leave_ts < APP_BROKER_COOLDOWN)) {
+            continue;
+        }
+        uint32_t score = app_broker_score(broker);
+        if (score < best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+    if (best < 0) {// 都在冷却期内，按顺序轮换。
+        best = (from + 1) % APP_BROKER_COUNT;
+    }
+    return best;
+}
+
+/**
+ * @brief 当前使用的服务器地址，MQTT 初始化时调用。
+ * @return
+ */
+const char* app_broker_get_uri(void) {
+    pthread_mutex_lock(&app_broker_mutex);
+    const char* uri = app_broker_uris[app_broker_active];
+    pthread_mutex_unlock(&app_broker_mutex);
+    return uri;
+}
+
+/**
+ * @brief 开始连接，在 MQTT_EVENT_BEFORE_CONNECT 中调用。
+ *        上次连接没有成功则记一次失败，达到次数以后切换服务器，本次连接就使用新地址。
+ * @param client
+ */
+void app_broker_on_before_connect(esp_mqtt_client_handle_t client) {
+    app_ctrl_params_t params;
+    app_ctrl_get_params(&params);
+    uint32_t now = esp_log_timestamp();
+    int from = -1;
+    int next = -1;
+    uint32_t fails = 0;
+    int trial_failed = 0;
+    pthread_mutex_lock(&app_broker_mutex);
+    app_broker_t* broker = &app_brokers[app_broker_active];
+    if (app_broker_trial_from >= 0) {
+        if (app_broker_pending) {// 试连主服务器没有收到 CONNACK，退回备用服务器，不计入主服务器的失败次数。
+            trial_failed = 1;
+            from = app_broker_active;
+            next = app_broker_trial_from;
+            broker->leave_ts = now | 1;
+            app_broker_active = next;
+            app_broker_trial_from = -1;
+        }
+    } else if (app_broker_pending) {
+        fails = ++broker->fails;
+        if (fails >= params.broker_fails && APP_BROKER_COUNT > 1) {
+            from = app_broker_active;
+            next = app_broker_select(from);
+            broker->fails = 0;
+            broker->leave_ts = now | 1;// 0 表示没有切走过。
+            app_broker_active = next;
+        }
+    }
+    app_broker_pending = 1;
+    app_broker_begin_ts = now;
+    pthread_mutex_unlock(&app_broker_mutex);
+    if (trial_failed) {
+        ESP_LOGW(TAG, "------ 主服务器试连失败，没有收到 CONNACK。退回：%s", app_broker_uris[next]);
+        esp_mqtt_client_set_uri(client, app_broker_uris[next]);
+    } else if (next >= 0) {
+        ESP_LOGW(TAG, "------ MQTT 服务器连续连接失败 %lu 次，切换：%s -> %s", fails, app_broker_uris[from], app_broker_uris[next]);
+        esp_mqtt_client_set_uri(client, app_broker_uris[next]);
+    } else if (fails > 0) {
+        ESP_LOGW(TAG, "------ MQTT 服务器连接失败 %lu 次：%s", fails, app_broker_uris[app_broker_active]);
+    }
+}
+
+/**
+ * @brief 连接成功，在 MQTT_EVENT_CONNECTED 中调用，记录连接耗时。正在试连主服务器时，切回完成。
+ */
+void app_broker_on_connected(void) {
+    uint32_t ms = esp_log_timestamp() - app_broker_begin_ts;
+    pthread_mutex_lock(&app_broker_mutex);
+    int index = app_broker_active;
+    app_broker_t* broker = &app_brokers[index];
+    broker->connect_ms = broker->connect_ms == 0 ? ms : (broker->connect_ms * 3 + ms) / 4;
+    broker->fails = 0;
+    broker->connects++;
+    app_broker_pending = 0;
+    int failback = app_broker_trial_from >= 0;
+    if (failback) {
+        broker->leave_ts = 0;
+        app_broker_trial_from = -1;
+    }
+    int changed = app_broker_last != index;
+    app_broker_last = index;
+    pthread_mutex_unlock(&app_broker_mutex);
+    if (changed) {
+        app_rtt_reset();// 往返延迟按服务器统计。
+    }
+    if (failback) {
+        ESP_LOGW(TAG, "------ 主服务器试连成功，已切回：%s", app_broker_uris[index]);
+    }
+    ESP_LOGI(TAG, "------ MQTT 服务器已连接：%s，连接耗时：%lu 毫秒", app_broker_uris[index], ms);
+}
+
+/**
+ * @brief 获取统计数据。
+ * @param index 服务器序号，0 是主服务器。
+ * @param stats
+ * @return 当前使用的服务器序号，index 超出范围返回 -1。
+ */
+int app_broker_get_stats(int index, app_broker_stats_t* stats) {
+    if (index < 0 || index >= APP_BROKER_COUNT) {
+        return -1;
+    }
+    pthread_mutex_lock(&app_broker_mutex);
+    const app_broker_t* broker = &app_brokers[index];
+    stats->uri = app_broker_uris[index];
+    stats->connect_ms = broker->connect_ms;
+    stats->rtt_ms = broker->rtt_ms;
+    stats->fails = broker->fails;
+    stats->connects = broker->connects;
+    int active = app_broker_active;
+    pthread_mutex_unlock(&app_broker_mutex);
+    return active;
+}
+
+/**
+ * @brief 从地址中解析主机和端口，只支持 mqtt:// 和 mqtts://。
+ * @return 0 成功，-1 失败。
+ */
+static int app_broker_parse_uri(const char* uri, char* host, size_t host_size, char* port, size_t port_size) {
+    const char* p = strstr(uri, "://");
+    if (p == NULL) {
+        return -1;
+    }
+    snprintf(port, port_size, "%s", strncmp(uri, "mqtts", 5) == 0 ? "8883" : "1883");
+    p += 3;
+    size_t len = strcspn(p, ":/");
+    if (len == 0 || len >= host_size) {
+        return -1;
+    }
+    memcpy(host, p, len);
+    host[len] = '\0';
+    if (p[len] == ':') {
+        size_t port_len = strcspn(p + len + 1, "/");
+        if (port_len == 0 || port_len >= port_size) {
+            return -1;
+        }
+        memcpy(port, p + len + 1, port_len);
+        port[port_len] = '\0';
+    }
+    return 0;
+}
+
+/**
+ * @brief TCP 连接探测，包括域名解析。只建立连接，不发送 MQTT 报文。
+ * @return 连接耗时，毫秒，-1 失败。
+ */
+static int app_broker_probe(const char* uri) {
+    char host[64];
+    char port[8];
+    if (app_broker_parse_uri(uri, host, sizeof(host), port, sizeof(port)) != 0) {
+        ESP_LOGE(TAG, "------ MQTT 服务器地址错误：%s", uri);
+        return -1;
+    }
+    uint32_t start = esp_log_timestamp();
+    struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo* res = NULL;
+    if (getaddrinfo(host, port, &hints, &res) != 0 || res == NULL) {
+        return -1;
+    }
+    int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (sock < 0) {
+        freeaddrinfo(res);
+        return -1;
+    }
+    fcntl(sock, F_SETFL, O_NONBLOCK);
+    int ret = connect(sock, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (ret != 0 && errno == EINPROGRESS) {
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        FD_SET(sock, &wfds);
+        struct timeval tv = {
+            .tv_sec = APP_BROKER_PROBE_TIMEOUT / 1000,
+            .tv_usec = (APP_BROKER_PROBE_TIMEOUT % 1000) * 1000,
+        };
+        ret = -1;
+        if (select(sock + 1, NULL, &wfds, NULL, &tv) > 0) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+                ret = 0;
+            }
+        }
+    }
+    close(sock);
+    return ret == 0 ? (int)(esp_log_timestamp() - start) : -1;
+}
+
+/**
+ * @brief 试连主服务器。断开当前连接，自动重连时使用主服务器地址。
+ *        收到 CONNACK 才算切回，见 app_broker_on_connected()；冷却时间戳保留到那时，试连失败时重新开始冷却。
+ * @param from 当前的备用服务器序号，试连失败时退回。
+ */
+static void app_broker_failback(int from) {
+    pthread_mutex_lock(&app_broker_mutex);
+    app_broker_active = 0;
+    app_broker_pending = 0;// 主动断开，不算失败。
+    app_brokers[0].fails = 0;
+    app_broker_trial_from = from;
+    pthread_mutex_unlock(&app_broker_mutex);
+    esp_mqtt_client_set_uri(app_broker_client, app_broker_uris[0]);
+    esp_mqtt_client_disconnect(app_broker_client);// 没有连接时返回失败，不影响。
+    esp_mqtt_client_reconnect(app_broker_client);
+}
+
+/**
+ * @brief 使用备用服务器时检查主服务器，冷却期内不探测，TCP 可达时开始试连。
+ * @param active 当前的备用服务器序号。
+ */
+static void app_broker_check_primary(int active) {
+    pthread_mutex_lock(&app_broker_mutex);
+    uint32_t leave_ts = app_brokers[0].leave_ts;
+    pthread_mutex_unlock(&app_broker_mutex);
+    uint32_t elapsed = esp_log_timestamp() - leave_ts;
+    if (leave_ts != 0 && elapsed < APP_BROKER_COOLDOWN) {
+        ESP_LOGI(TAG, "------ 主服务器冷却中，剩余：%lu 秒。继续使用：%s", (APP_BROKER_COOLDOWN - elapsed) / 1000, app_broker_uris[active]);
+        return;
+    }
+    int ms = app_broker_probe(app_broker_uris[0]);
+    if (ms < 0) {
+        ESP_LOGI(TAG, "------ 主服务器探测：不可达。继续使用：%s", app_broker_uris[active]);
+        return;
+    }
+    ESP_LOGW(TAG, "------ 主服务器探测：TCP 连接耗时：%d 毫秒。试连：%s", ms, app_broker_uris[0]);
+    app_broker_failback(active);
+}
+
+/**
+ * @brief 服务器任务，记录当前服务器的往返延迟，使用备用服务器时探测主服务器。
+ * @param param
+ */
+static void app_broker_task(void* param) {
+    uint32_t failback_elapsed = 0;
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(APP_BROKER_TASK_PERIOD * 1000));
+
+        app_rtt_stats_t rtt;
+        app_rtt_get_stats(&rtt);
+        pthread_mutex_lock(&app_broker_mutex);
+        int active = app_broker_active;
+        if (rtt.count > 0 && app_broker_last == active) {
+            app_brokers[active].rtt_ms = rtt.p50;
+        }
+        pthread_mutex_unlock(&app_broker_mutex);
+
+        if (active == 0) {
+            failback_elapsed = 0;
+            continue;
+        }
+        failback_elapsed += APP_BROKER_TASK_PERIOD;
+        if (failback_elapsed < APP_BROKER_FAILBACK_PERIOD) {
+            continue;
+        }
+        failback_elapsed = 0;
+        app_broker_check_primary(active);
+    }
+}
+
+/**
+ * @brief 初始化函数，MQTT 客户端创建以后调用，启动主服务器探测任务。
+ * @param client
+ * @return
+ */
+esp_err_t app_broker_init(esp_mqtt_client_handle_t client) {
+    app_broker_client = client;
+    if (APP_BROKER_COUNT < 2) {// 只有一个服务器，不需要探测。
+        return ESP_OK;
+    }
+    BaseType_t ret = xTaskCreate(app_broker_task, "app_broker_task", 4096, NULL, 2, NULL);
+    return ret == pdPASS ? ESP_OK : ESP_FAIL;
+}
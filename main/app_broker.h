@@ -0,0 +1,55 @@
+/**
+ * @brief   MQTT 服务器列表，按连接耗时和往返延迟选择备用服务器，连续连接失败时切换，主服务器恢复以后切回。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "mqtt_client.h"
+
+ /**
+  * @brief 服务器统计数据。
+  */
+typedef struct {
+    const char* uri;
+    uint32_t connect_ms;        // 连接耗时，平滑值，0 = 未测量。
+    uint32_t rtt_ms;            // PUBACK 往返时间中位数，0 = 未测量。
+    uint32_t fails;             // 连续连接失败次数。
+    uint32_t connects;          // 启动以后连接成功次数。
+} app_broker_stats_t;
+
+/**
+ * @brief 当前使用的服务器地址，MQTT 初始化时调用。
+ * @return
+ */
+const char* app_broker_get_uri(void);
+
+/**
+ * @brief 开始连接，在 MQTT_EVENT_BEFORE_CONNECT 中调用。
+ *        上次连接没有成功则记一次失败，达到次数以后切换服务器，本次连接就使用新地址。
+ * @param client
+ */
+void app_broker_on_before_connect(esp_mqtt_client_handle_t client);
+
+/**
+ * @brief 连接成功，在 MQTT_EVENT_CONNECTED 中调用，记录连接耗时。
+ */
+void app_broker_on_connected(void);
+
+/**
+ * @brief 获取统计数据。
+ * @param index 服务器序号，0 是主服务器。
+ * @param stats
+ * @return 当前使用的服务器序号，index 超出范围返回 -1。
+ */
+int app_broker_get_stats(int index, app_broker_stats_t* stats);
+
+/**
+ * @brief 初始化函数，MQTT 客户端创建以后调用，启动主服务器探测任务。
+ * @param client
+ * @return
+ */
+esp_err_t app_broker_init(esp_mqtt_client_handle_t client);
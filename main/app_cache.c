@@ -0,0 +1,700 @@
+/**
+ * @brief   SD 卡缓存日志，分段追加写入，持久化提交位置。
+ *          段文件预分配，见 app_seg.c，写入不再修改 FAT 表。
+ *          记录带 CRC32，掉电时写了一半的记录在恢复时丢弃，所以不再每条记录 fsync()。
+ *          记录先在 PSRAM 写缓冲区中累积，字节数、记录数达到阈值，或者最早一条记录等待超过期限时一起写入并 fsync()，
+ *          期限由后台任务保证，不依赖下一条记录。读取之前、关机重启之前也会 fsync()。
+ *          已推送的段文件交给归档索引按保留策略删除，段头中的稀疏时间索引用于服务器请求补传时按时间查询。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+
+#include "app_sd.h"
+#include "app_meta.h"
+#include "app_cache.h"
+#include "app_seg.h"
+#include "app_retain.h"
+#include "app_json.h"
+
+ /**
+ * @brief 段文件大小，包括段头，写满后切换到下一个段。
+ */
+#define APP_CACHE_SEG_SIZE          (256 * 1024)
+
+ /**
+ * @brief 提交位置文件名。
+ */
+#define APP_CACHE_COMMIT_DAT        APP_SD_CACHE_DIR"/COMMIT.DAT"
+
+ /**
+ * @brief 最早一条没有 fsync 的记录等待 N 毫秒，或者没有 fsync 的数据超过 N 字节、N 条记录时 fsync()。
+ *        期限就是掉电时最多丢失的时间范围，不包括 fsync() 本身的耗时。
+ */
+#define APP_CACHE_SYNC_PERIOD       5000
+#define APP_CACHE_SYNC_BYTES        (8 * 1024)
+#define APP_CACHE_SYNC_RECORDS      32
+
+ /**
+ * @brief 写缓冲区大小，多留一条最长记录，达到字节数阈值之前不会写入 SD 卡。
+ */
+#define APP_CACHE_WBUF_SIZE         (APP_CACHE_SYNC_BYTES + APP_SEG_REC_HDR_SIZE + APP_SEG_REC_MAX)
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_cache";
+
+/**
+ * @brief 持久化的状态。
+ */
+typedef struct {
+    app_cache_pos_t commit; // 已提交位置。
+    uint32_t head_seg;      // 正在写入的段号，只在切换段时保存。
+} app_cache_state_t;
+
+/**
+ * @brief 缓存日志初始化状态。
+ */
+static int app_cache_init_status = 0;
+
+/**
+ * @brief 互斥锁，主循环写入，MQTT 推送读取。
+ */
+static pthread_mutex_t app_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 持久化的状态。
+ */
+static app_cache_state_t app_cache_state = { 0 };
+
+/**
+ * @brief 元数据文件。
+ */
+static app_meta_t app_cache_meta = {
+    .path = APP_CACHE_COMMIT_DAT,
+    .size = sizeof(app_cache_state_t),
+};
+
+/**
+ * @brief 写入位置，已经 fsync 的数据末尾。
+ */
+static app_cache_pos_t app_cache_head = { 0 };
+
+/**
+ * @brief 正在写入的段文件。
+ */
+static app_seg_writer_t app_cache_writer = { 0 };
+
+/**
+ * @brief 正在读取的段文件，以及它的段号。
+ */
+static FILE* app_cache_read_file = NULL;
+static uint32_t app_cache_read_seg = 0;
+
+/**
+ * @brief 正在读取的段文件的数据范围。
+ */
+static uint32_t app_cache_read_start = 0;
+static uint32_t app_cache_read_fill = 0;
+
+/**
+ * @brief 写缓冲区，PSRAM。
+ */
+static char* app_cache_wbuf = NULL;
+
+/**
+ * @brief 没有 fsync 的记录：条数、字节数、最早一条的写入时间。
+ */
+static uint32_t app_cache_pending_records = 0;
+static uint32_t app_cache_pending_bytes = 0;
+static uint32_t app_cache_pending_ts = 0;
+
+/**
+ * @brief 统计数据，调用者持有锁。
+ */
+static uint32_t app_cache_init_ts = 0;
+static uint32_t app_cache_syncs = 0;
+static uint32_t app_cache_risk_max_ms = 0;
+static uint32_t app_cache_risk_max_bytes = 0;
+static uint32_t app_cache_sync_max_ms = 0;
+
+/**
+ * @brief 后台任务，按期限 fsync。
+ */
+static TaskHandle_t app_cache_task_handle = NULL;
+
+/**
+ * @brief 最近一次查询的封闭段的数据结束偏移，计算剩余字节数时使用。
+ */
+static uint32_t app_cache_sealed_seg = UINT32_MAX;
+static uint32_t app_cache_sealed_fill = 0;
+
+/**
+ * @brief 段文件名。
+ */
+static void app_cache_seg_path(uint32_t seg, char* buf, size_t size) {
+    snprintf(buf, size, APP_SD_CACHE_DIR"/%08" PRIX32 ".SEG", seg);
+}
+
+/**
+ * @brief 打开写入段，不存在时创建并预分配。
+ * @return 0 成功，-1 失败，APP_SEG_INVALID 没有有效的段头。
+ */
+static int app_cache_open_write_seg(uint32_t seg) {
+    char path[64];
+    app_cache_seg_path(seg, path, sizeof(path));
+    int ret = app_seg_open(&app_cache_writer, path, seg, APP_CACHE_SEG_SIZE, app_cache_wbuf, APP_CACHE_WBUF_SIZE);
+    if (ret == -1) {
+        ESP_LOGE(TAG, "------ 缓存日志打开段文件：失败！文件名：%s", path);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+    app_cache_head.seg = seg;
+    app_cache_head.off = app_cache_writer.fill;
+    return 0;
+}
+
+/**
+ * @brief 打开 head_seg 对应的写入段。段头损坏的段文件不能继续写入，从下一个段开始写入。
+ */
+static int app_cache_open_head_seg(void) {
+    int ret = app_cache_open_write_seg(app_cache_state.head_seg);
+    if (ret == APP_SEG_INVALID) {
+        ESP_LOGE(TAG, "------ 缓存日志段文件没有有效的段头：%08lX，从下一个段开始写入。", app_cache_state.head_seg);
+        app_cache_state.head_seg++;
+        app_meta_save(&app_cache_meta, &app_cache_state);
+        ret = app_cache_open_write_seg(app_cache_state.head_seg);
+    }
+    return ret;
+}
+
+/**
+ * @brief 没有 fsync 的记录已经写入 SD 卡，更新统计数据，调用者持有锁。
+ * @param start fsync 开始时间。
+ */
+static void app_cache_synced(uint32_t start) {
+    if (app_cache_pending_records == 0) {
+        return;
+    }
+    uint32_t now = esp_log_timestamp();
+    uint32_t risk_ms = now - app_cache_pending_ts;// 最早一条记录从写入到 fsync 完成，这段时间内掉电会丢失。
+    app_cache_syncs++;
+    app_cache_risk_max_ms = risk_ms > app_cache_risk_max_ms ? risk_ms : app_cache_risk_max_ms;
+    app_cache_risk_max_bytes = app_cache_pending_bytes > app_cache_risk_max_bytes ? app_cache_pending_bytes : app_cache_risk_max_bytes;
+    app_cache_sync_max_ms = now - start > app_cache_sync_max_ms ? now - start : app_cache_sync_max_ms;
+    app_cache_pending_records = 0;
+    app_cache_pending_bytes = 0;
+}
+
+/**
+ * @brief 写入一条记录，调用者持有锁。
+ */
+static int app_cache_write(const char* data, size_t len, uint32_t ts) {
+    if (app_cache_writer.file == NULL && app_cache_open_head_seg() != 0) {// 上次切换段失败，重试。
+        return -1;
+    }
+    if (app_seg_room(&app_cache_writer) < APP_SEG_REC_HDR_SIZE + len) {// 段写满，封闭，切换到下一个段。
+        uint32_t start = esp_log_timestamp();
+        app_seg_close(&app_cache_writer, true);
+        app_cache_synced(start);
+        if (app_cache_read_file != NULL && app_cache_read_seg == app_cache_head.seg) {
+            // 读取时按写入位置读取写入段，数据范围是打开时的，封闭以后重新打开读取准确的范围，否则跳过段末尾的记录。
+            fclose(app_cache_read_file);
+            app_cache_read_file = NULL;
+        }
+        app_cache_state.head_seg = app_cache_head.seg + 1;
+        app_meta_save(&app_cache_meta, &app_cache_state);
+        if (app_cache_open_write_seg(app_cache_state.head_seg) != 0) {
+            return -1;
+        }
+        ESP_LOGI(TAG, "------ 缓存日志切换段：%08lX", app_cache_head.seg);
+    }
+    if (app_seg_append(&app_cache_writer, data, len, ts) != 0) {
+        ESP_LOGE(TAG, "------ 缓存日志写入：失败！长度：%u", len);
+        return -1;
+    }
+    if (app_cache_pending_records++ == 0) {
+        app_cache_pending_ts = esp_log_timestamp();
+        if (app_cache_task_handle != NULL) {// 后台任务开始计算期限。
+            xTaskNotifyGive(app_cache_task_handle);
+        }
+    }
+    app_cache_pending_bytes += APP_SEG_REC_HDR_SIZE + len;
+    return 0;
+}
+
+/**
+ * @brief 写入文件，更新写入位置，调用者持有锁。
+ */
+static void app_cache_sync(void) {
+    if (app_cache_writer.file == NULL) {
+        return;
+    }
+    uint32_t start = esp_log_timestamp();
+    app_seg_sync(&app_cache_writer);
+    app_cache_head.off = app_cache_writer.fill;
+    app_cache_synced(start);
+}
+
+/**
+ * @brief 是否有没有 fsync 的数据，调用者持有锁。
+ */
+static bool app_cache_dirty(void) {
+    return app_cache_writer.file != NULL
+        && (app_cache_head.seg != app_cache_writer.seg || app_cache_head.off != app_cache_writer.fill);
+}
+
+/**
+ * @brief 没有 fsync 的记录是否达到阈值或者期限，调用者持有锁。
+ */
+static bool app_cache_due(void) {
+    return app_cache_pending_records > 0
+        && (app_cache_pending_bytes >= APP_CACHE_SYNC_BYTES
+            || app_cache_pending_records >= APP_CACHE_SYNC_RECORDS
+            || esp_log_timestamp() - app_cache_pending_ts >= APP_CACHE_SYNC_PERIOD);
+}
+
+/**
+ * @brief 追加一条记录到缓存日志。记录先写入缓冲区，达到阈值或者期限时一起 fsync，
+ *        掉电时丢失最近几秒的记录，不会写入半条记录。
+ * @param data 记录内容，不含换行符。
+ * @param len
+ * @param ts 记录时间，UTC 秒，写入时间索引，0 = 未知。
+ * @return 0 成功，-1 失败。
+ */
+int app_cache_append(const char* data, size_t len, uint32_t ts) {
+    if (app_cache_init_status == 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&app_cache_mutex);
+    int ret = app_cache_write(data, len, ts);
+    if (ret == 0 && app_cache_due()) {
+        app_cache_sync();
+    }
+    pthread_mutex_unlock(&app_cache_mutex);
+    return ret;
+}
+
+/**
+ * @brief 立即 fsync 还没有 fsync 的记录。关机、重启、断电之前调用。
+ */
+void app_cache_flush(void) {
+    if (app_cache_init_status == 0) {
+        return;
+    }
+    pthread_mutex_lock(&app_cache_mutex);
+    if (app_cache_dirty()) {
+        app_cache_sync();
+    }
+    pthread_mutex_unlock(&app_cache_mutex);
+}
+
+/**
+ * @brief esp_restart() 之前调用。调用 esp_restart() 的任务可能正持有锁（例如主循环超时），不能等待。
+ */
+static void app_cache_shutdown(void) {
+    if (app_cache_init_status == 0 || pthread_mutex_trylock(&app_cache_mutex) != 0) {
+        return;
+    }
+    if (app_cache_dirty()) {
+        app_cache_sync();
+    }
+    pthread_mutex_unlock(&app_cache_mutex);
+}
+
+/**
+ * @brief 后台任务，最早一条没有 fsync 的记录到期时 fsync，没有新记录写入时也能保证期限。
+ * @param param
+ */
+static void app_cache_task(void* param) {
+    while (1) {
+        TickType_t wait = portMAX_DELAY;// 没有 fsync 的记录，等待写入第一条记录时通知。
+        pthread_mutex_lock(&app_cache_mutex);
+        if (app_cache_due()) {
+            app_cache_sync();
+        } else if (app_cache_pending_records > 0) {
+            wait = pdMS_TO_TICKS(APP_CACHE_SYNC_PERIOD - (esp_log_timestamp() - app_cache_pending_ts)) + 1;
+        }
+        pthread_mutex_unlock(&app_cache_mutex);
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_cache_get_stats(app_cache_stats_t* stats) {
+    pthread_mutex_lock(&app_cache_mutex);
+    uint32_t now = esp_log_timestamp();
+    uint32_t elapsed = now - app_cache_init_ts;
+    stats->syncs = app_cache_syncs;
+    stats->syncs_per_hour = elapsed == 0 ? 0 : (uint32_t)((uint64_t)app_cache_syncs * 3600000 / elapsed);
+    stats->pending_records = app_cache_pending_records;
+    stats->pending_ms = app_cache_pending_records == 0 ? 0 : now - app_cache_pending_ts;
+    stats->risk_max_ms = app_cache_risk_max_ms;
+    stats->risk_max_bytes = app_cache_risk_max_bytes;
+    stats->sync_max_ms = app_cache_sync_max_ms;
+    pthread_mutex_unlock(&app_cache_mutex);
+}
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_cache_log(void) {
+    if (app_cache_init_status == 0) {
+        return;
+    }
+    app_cache_stats_t stats;
+    app_cache_get_stats(&stats);
+    ESP_LOGI(TAG, "------ 缓存日志 fsync：%lu 次，每小时 %lu 次，等待中：%lu 条 %lu 毫秒，最长风险窗口：%lu 毫秒，最多 %lu 字节，fsync 最长耗时：%lu 毫秒",
+        stats.syncs, stats.syncs_per_hour, stats.pending_records, stats.pending_ms, stats.risk_max_ms, stats.risk_max_bytes, stats.sync_max_ms);
+}
+
+/**
+ * @brief 从指定位置读取一条记录，并把位置移动到下一条记录。
+ *        直接 fseek 到位置，不需要从头跳过已推送的行。
+ * @param pos
+ * @param buf
+ * @param size
+ * @return 记录长度，0 没有更多记录，-1 失败。
+ */
+int app_cache_read(app_cache_pos_t* pos, char* buf, size_t size) {
+    if (app_cache_init_status == 0) {
+        return -1;
+    }
+    int ret = 0;
+    pthread_mutex_lock(&app_cache_mutex);
+    if (app_cache_dirty()) {// 读取之前 fsync，推送的记录不会因为掉电丢失。
+        app_cache_sync();
+    }
+    while (1) {
+        if (pos->seg > app_cache_head.seg || (pos->seg == app_cache_head.seg && pos->off >= app_cache_head.off)) {
+            ret = 0;// 已经读到写入位置。
+            break;
+        }
+        if (app_cache_read_file == NULL || app_cache_read_seg != pos->seg) {
+            if (app_cache_read_file != NULL) {
+                fclose(app_cache_read_file);
+            }
+            char path[64];
+            app_cache_seg_path(pos->seg, path, sizeof(path));
+            app_cache_read_file = fopen(path, "rb");
+            if (app_cache_read_file == NULL) {
+                ESP_LOGW(TAG, "------ 缓存日志段文件不存在，跳过。文件名：%s", path);
+                pos->seg++;
+                pos->off = 0;
+                continue;
+            }
+            if (app_seg_range(app_cache_read_file, &app_cache_read_start, &app_cache_read_fill) != 0) {
+                fclose(app_cache_read_file);
+                app_cache_read_file = NULL;
+                ESP_LOGE(TAG, "------ 缓存日志段文件没有有效的段头，跳过。文件名：%s", path);
+                pos->seg++;
+                pos->off = 0;
+                continue;
+            }
+            app_cache_read_seg = pos->seg;
+        }
+        if (pos->off < app_cache_read_start) {// 跳过段头。
+            pos->off = app_cache_read_start;
+            continue;
+        }
+        if (pos->seg < app_cache_head.seg && pos->off >= app_cache_read_fill) {// 段文件读完，进入下一个段。
+            pos->seg++;
+            pos->off = 0;
+            continue;
+        }
+        if (pos->seg == app_cache_head.seg) {// 写入段在文件内部覆盖写入，丢弃读缓冲区中旧的 0。
+            fflush(app_cache_read_file);
+        }
+        uint32_t fill = pos->seg == app_cache_head.seg ? app_cache_head.off : app_cache_read_fill;
+        uint32_t next = pos->off;
+        int len = app_seg_read(app_cache_read_file, pos->off, fill, buf, size, &next);
+        if (len == APP_SEG_TOO_LONG) {
+            ESP_LOGW(TAG, "------ 缓存日志记录超长，丢弃。段：%08lX，偏移：%lu", pos->seg, pos->off);
+            pos->off = next;
+            continue;
+        }
+        if (len > 0) {
+            pos->off = next;
+            ret = len;
+            break;
+        }
+        if (len == -1) {// fsync 以后的记录都经过校验，不应该出现。跳过这个段剩余的记录。
+            ESP_LOGE(TAG, "------ 缓存日志记录校验失败！段：%08lX，偏移：%lu", pos->seg, pos->off);
+        }
+        if (pos->seg < app_cache_head.seg) {
+            pos->seg++;
+            pos->off = 0;
+            continue;
+        }
+        if (len == -1) {
+            pos->off = app_cache_head.off;
+        }
+        ret = 0;
+        break;
+    }
+    pthread_mutex_unlock(&app_cache_mutex);
+    return ret;
+}
+
+/**
+ * @brief 获取已提交的位置，即下一条需要推送的记录。
+ * @param pos
+ */
+void app_cache_get_commit(app_cache_pos_t* pos) {
+    pthread_mutex_lock(&app_cache_mutex);
+    *pos = app_cache_state.commit;
+    pthread_mutex_unlock(&app_cache_mutex);
+}
+
+/**
+ * @brief 提交位置，之前的记录视为已推送，持久化到 COMMIT.DAT，重启后从这里继续。
+ *        已经全部推送的段文件加入归档索引，按保留策略删除，之前仍然可以按时间查询。
+ * @param pos
+ * @return
+ */
+esp_err_t app_cache_commit(const app_cache_pos_t* pos) {
+    if (app_cache_init_status == 0) {
+        return ESP_FAIL;
+    }
+    pthread_mutex_lock(&app_cache_mutex);
+    uint32_t old_seg = app_cache_state.commit.seg;
+    app_cache_state.commit = *pos;
+    esp_err_t ret = app_meta_save(&app_cache_meta, &app_cache_state);
+    if (ret == ESP_OK) {
+        for (uint32_t seg = old_seg; seg < pos->seg; seg++) {// 已推送完的段交给归档索引。
+            if (app_cache_read_file != NULL && app_cache_read_seg == seg) {
+                fclose(app_cache_read_file);
+                app_cache_read_file = NULL;
+            }
+            char path[64];
+            app_cache_seg_path(seg, path, sizeof(path));
+            app_retain_add(path, 0, true);
+        }
+    }
+    pthread_mutex_unlock(&app_cache_mutex);
+    return ret;
+}
+
+/**
+ * @brief 按时间查询缓存日志，包括已推送、还没删除的段文件。按时间索引只读取时间范围重叠的数据，
+ *        索引按数据块记录时间范围，回调函数再按记录时间精确过滤。回调函数调用时不持有锁，可以发布 MQTT 消息。
+ * @param t1 开始时间，UTC 秒。
+ * @param t2 结束时间，UTC 秒。
+ * @param cb
+ * @param arg
+ * @return 读取的记录数，-1 失败。
+ */
+int app_cache_query(uint32_t t1, uint32_t t2, app_cache_query_cb_t cb, void* arg) {
+    if (app_cache_init_status == 0 || t2 < t1) {
+        return -1;
+    }
+    char* buf = malloc(APP_SEG_REC_MAX + 1);
+    app_seg_span_t* spans = malloc((APP_SEG_IDX_MAX + 1) * sizeof(app_seg_span_t));
+    if (buf == NULL || spans == NULL) {
+        free(buf);
+        free(spans);
+        return -1;
+    }
+    uint32_t start = esp_log_timestamp();
+    char path[64];
+    pthread_mutex_lock(&app_cache_mutex);
+    if (app_cache_dirty()) {
+        app_cache_sync();
+    }
+    uint32_t head = app_cache_head.seg;
+    uint32_t seg = head;
+    while (seg > 0) {// 段号连续，保留策略从最旧的开始删除，向前找到第一个不存在的段。
+        app_cache_seg_path(seg - 1, path, sizeof(path));
+        if (access(path, F_OK) == -1) {
+            break;
+        }
+        seg--;
+    }
+    pthread_mutex_unlock(&app_cache_mutex);
+    uint32_t first = seg;
+    uint32_t bytes = 0;
+    int count = 0;
+    bool stop = false;
+    for (; seg <= head && !stop; seg++) {
+        app_cache_seg_path(seg, path, sizeof(path));
+        FILE* file = fopen(path, "rb");
+        if (file == NULL) {
+            continue;
+        }
+        pthread_mutex_lock(&app_cache_mutex);
+        uint32_t limit = seg == app_cache_head.seg ? app_cache_head.off : UINT32_MAX;// 写入段只读取已经 fsync 的记录。
+        pthread_mutex_unlock(&app_cache_mutex);
+        int n = app_seg_spans(file, t1, t2, spans);
+        for (int i = 0; i < n && !stop; i++) {
+            uint32_t off = spans[i].off;
+            uint32_t end = spans[i].end < limit ? spans[i].end : limit;
+            bytes += end > off ? end - off : 0;
+            while (off < end) {
+                uint32_t next = off;
+                int len = app_seg_read(file, off, end, buf, APP_SEG_REC_MAX + 1, &next);
+                if (len == APP_SEG_TOO_LONG) {
+                    off = next;
+                    continue;
+                }
+                if (len <= 0) {
+                    break;
+                }
+                off = next;
+                count++;
+                if (!cb(buf, len, arg)) {
+                    stop = true;
+                    break;
+                }
+            }
+        }
+        fclose(file);
+    }
+    free(buf);
+    free(spans);
+    ESP_LOGI(TAG, "------ 缓存日志按时间查询：%lu - %lu，段：%08lX - %08lX，读取字节：%lu，记录数：%d，耗时：%lu 毫秒",
+        t1, t2, first, head, bytes, count, esp_log_timestamp() - start);
+    return count;
+}
+
+/**
+ * @brief 段文件是否已经全部推送，重建归档索引时调用。只在启动时调用。
+ * @param path
+ * @return
+ */
+bool app_cache_seg_committed(const char* path) {
+    const char* name = strrchr(path, '/');
+    uint32_t seg;
+    char ext[4];
+    if (name == NULL || sscanf(name, "/%8" SCNx32 ".%3s", &seg, ext) != 2 || strcmp(ext, "SEG") != 0) {
+        return false;
+    }
+    return seg < app_cache_state.commit.seg;
+}
+
+/**
+ * @brief 封闭段的数据结束偏移，缓存一个段，提交位置换段时才读取段头。段文件不存在或者损坏时返回 0。调用者持有锁。
+ */
+static uint32_t app_cache_seg_fill(uint32_t seg) {
+    if (seg == app_cache_sealed_seg) {
+        return app_cache_sealed_fill;
+    }
+    char path[64];
+    app_cache_seg_path(seg, path, sizeof(path));
+    FILE* file = fopen(path, "rb");
+    uint32_t start = 0;
+    uint32_t fill = 0;
+    if (file != NULL) {
+        if (app_seg_range(file, &start, &fill) != 0) {
+            fill = 0;
+        }
+        fclose(file);
+    }
+    app_cache_sealed_seg = seg;
+    app_cache_sealed_fill = fill;
+    return fill;
+}
+
+/**
+ * @brief 剩余未推送的字节数，约数：提交位置和写入位置之间每个完整的段按数据区大小计算。
+ *        提交位置先规范化：段头以内按数据开始位置计算，封闭段的末尾按下一个段的数据开始位置计算，
+ *        推送完时为 0。
+ * @return
+ */
+uint32_t app_cache_remaining(void) {
+    pthread_mutex_lock(&app_cache_mutex);
+    app_cache_pos_t commit = app_cache_state.commit;
+    if (commit.off < APP_SEG_HDR_SIZE) {
+        commit.off = APP_SEG_HDR_SIZE;
+    }
+    if (commit.seg < app_cache_head.seg && commit.off >= app_cache_seg_fill(commit.seg)) {
+        commit.seg++;
+        commit.off = APP_SEG_HDR_SIZE;
+    }
+    uint32_t remaining = 0;
+    if (commit.seg < app_cache_head.seg || (commit.seg == app_cache_head.seg && commit.off < app_cache_head.off)) {
+        remaining = (app_cache_head.seg - commit.seg) * (APP_CACHE_SEG_SIZE - APP_SEG_HDR_SIZE)
+            + app_cache_head.off - commit.off;
+    }
+    pthread_mutex_unlock(&app_cache_mutex);
+    return remaining;
+}
+
+/**
+ * @brief 导入旧版本的文本缓存文件，逐行追加，全部写完再 fsync 一次。
+ * @param path
+ * @return 导入行数，-1 失败。
+ */
+int app_cache_import_file(const char* path) {
+    if (app_cache_init_status == 0) {
+        return -1;
+    }
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    int line_count = 0;
+    char line[1024];
+    pthread_mutex_lock(&app_cache_mutex);
+    while (fgets(line, sizeof(line), file) != NULL) {
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] == '\n') {
+            line[--len] = '\0';
+        }
+        if (len == 0) {
+            continue;
+        }
+        if (app_cache_write(line, len, app_json_get_time(line)) != 0) {
+            break;
+        }
+        line_count++;
+    }
+    app_cache_sync();
+    pthread_mutex_unlock(&app_cache_mutex);
+    fclose(file);
+    ESP_LOGI(TAG, "------ 缓存日志导入旧文件：完成。文件名：%s，行数：%d", path, line_count);
+    return line_count;
+}
+
+/**
+ * @brief 初始化函数，SD 卡挂载并创建 CACHE 目录以后调用。
+ * @return
+ */
+esp_err_t app_cache_init(void) {
+    esp_err_t load_ret = app_meta_load(&app_cache_meta, &app_cache_state);
+    if (load_ret != ESP_OK) {
+        ESP_LOGW(TAG, "------ 缓存日志没有提交记录，从头开始。");
+        memset(&app_cache_state, 0, sizeof(app_cache_state));
+    }
+    app_cache_wbuf = heap_caps_malloc(APP_CACHE_WBUF_SIZE, MALLOC_CAP_SPIRAM);// 分配失败时使用默认缓冲区。
+    if (app_cache_open_head_seg() != 0) {
+        return ESP_FAIL;
+    }
+    app_cache_init_ts = esp_log_timestamp();
+    if (xTaskCreate(app_cache_task, "app_cache_task", 3072, NULL, 1, &app_cache_task_handle) != pdPASS) {
+        ESP_LOGW(TAG, "------ 缓存日志后台任务创建：失败！只在写入记录时检查期限。");
+        app_cache_task_handle = NULL;
+    }
+    esp_register_shutdown_handler(app_cache_shutdown);
+    app_cache_init_status = 1;
+    ESP_LOGI(TAG, "------ 缓存日志初始化：完成。提交位置：%08lX/%lu，写入位置：%08lX/%lu，剩余字节：%lu",
+        app_cache_state.commit.seg, app_cache_state.commit.off, app_cache_head.seg, app_cache_head.off, app_cache_remaining());
+    return ESP_OK;
+}
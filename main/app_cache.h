@@ -0,0 +1,128 @@
+/**
+ * @brief   SD 卡缓存日志，分段追加写入，持久化提交位置。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+ /**
+  * @brief 缓存记录位置：段号 + 段内偏移。
+  */
+typedef struct {
+    uint32_t seg;           // 段号，对应文件 CACHE/%08X.SEG
+    uint32_t off;           // 段内字节偏移。
+} app_cache_pos_t;
+
+/**
+ * @brief fsync 统计数据。
+ */
+typedef struct {
+    uint32_t syncs;             // fsync 次数。
+    uint32_t syncs_per_hour;    // 启动以后平均每小时 fsync 次数。
+    uint32_t pending_records;   // 当前没有 fsync 的记录数。
+    uint32_t pending_ms;        // 当前最早一条没有 fsync 的记录已经等待的时间，毫秒。
+    uint32_t risk_max_ms;       // 最长数据风险窗口：记录写入到 fsync 完成的最长时间，毫秒。掉电时丢失的最长时间范围。
+    uint32_t risk_max_bytes;    // 一次 fsync 最多提交的字节数。
+    uint32_t sync_max_ms;       // fsync 最长耗时，毫秒。
+} app_cache_stats_t;
+
+/**
+ * @brief 追加一条记录到缓存日志。记录先写入缓冲区，达到阈值或者期限时一起 fsync，
+ *        掉电时丢失最近几秒的记录，不会写入半条记录。
+ * @param data 记录内容，不含换行符。
+ * @param len 不超过 APP_SEG_REC_MAX。
+ * @param ts 记录时间，UTC 秒，写入时间索引，0 = 未知。
+ * @return 0 成功，-1 失败。
+ */
+int app_cache_append(const char* data, size_t len, uint32_t ts);
+
+/**
+ * @brief 立即 fsync 还没有 fsync 的记录。关机、重启、断电之前调用。
+ */
+void app_cache_flush(void);
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_cache_get_stats(app_cache_stats_t* stats);
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_cache_log(void);
+
+/**
+ * @brief 从指定位置读取一条记录，并把位置移动到下一条记录。
+ *        直接 fseek 到位置，不需要从头跳过已推送的行。
+ * @param pos
+ * @param buf
+ * @param size
+ * @return 记录长度，0 没有更多记录，-1 失败。
+ */
+int app_cache_read(app_cache_pos_t* pos, char* buf, size_t size);
+
+/**
+ * @brief 获取已提交的位置，即下一条需要推送的记录。
+ * @param pos
+ */
+void app_cache_get_commit(app_cache_pos_t* pos);
+
+/**
+ * @brief 提交位置，之前的记录视为已推送，持久化到 COMMIT.DAT，重启后从这里继续。
+ *        已经全部推送的段文件加入归档索引，按保留策略删除，之前仍然可以按时间查询。
+ * @param pos
+ * @return
+ */
+esp_err_t app_cache_commit(const app_cache_pos_t* pos);
+
+/**
+ * @brief 按时间查询的回调函数。
+ * @param data 记录内容，以 '\0' 结尾，回调函数可以修改。
+ * @param len
+ * @param arg
+ * @return false 停止查询。
+ */
+typedef bool (*app_cache_query_cb_t)(char* data, int len, void* arg);
+
+/**
+ * @brief 按时间查询缓存日志，包括已推送、还没删除的段文件。按时间索引只读取时间范围重叠的数据，
+ *        索引按数据块记录时间范围，回调函数再按记录时间精确过滤。回调函数调用时不持有锁，可以发布 MQTT 消息。
+ * @param t1 开始时间，UTC 秒。
+ * @param t2 结束时间，UTC 秒。
+ * @param cb
+ * @param arg
+ * @return 读取的记录数，-1 失败。
+ */
+int app_cache_query(uint32_t t1, uint32_t t2, app_cache_query_cb_t cb, void* arg);
+
+/**
+ * @brief 段文件是否已经全部推送，重建归档索引时调用。只在启动时调用。
+ * @param path
+ * @return
+ */
+bool app_cache_seg_committed(const char* path);
+
+/**
+ * @brief 剩余未推送的字节数，约数。
+ * @return
+ */
+uint32_t app_cache_remaining(void);
+
+/**
+ * @brief 导入旧版本的文本缓存文件，逐行追加，全部写完再 fsync 一次。
+ * @param path
+ * @return 导入行数，-1 失败。
+ */
+int app_cache_import_file(const char* path);
+
+/**
+ * @brief 初始化函数，SD 卡挂载并创建 CACHE 目录以后调用。
+ * @return
+ */
+esp_err_t app_cache_init(void);
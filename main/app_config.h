@@ -35,14 +35,75 @@
   /*
    * MQTT 服务器配置。
    */
-#define APP_MQTT_URI                    "mqtt://www.abc.com"
+#define APP_MQTT_TLS                    0                   // 1 = mqtts，使用 app_tls 传输层。app_tls.c 还没有在真实服务器上验证，不参与编译，设置为 1 时编译失败。0 = 明文 mqtt。
+#define APP_MQTT_URI                    "mqtt://www.abc.com:1883"
+#define APP_MQTT_URI_LIST               { APP_MQTT_URI, "mqtt://www2.abc.com:1883" }  // 按优先级排列，第一个是主服务器，后面是区域备用服务器。
+#define APP_BROKER_FAIL_MAX             3                   // 连续连接失败 N 次以后切换服务器。可以远程修改。
+#define APP_BROKER_FAILBACK_PERIOD      300                 // 使用备用服务器时，每 N 秒探测一次主服务器，恢复以后切回。
+#define APP_TLS_SESSION_NVS             1                   // TLS 会话同时保存到 NVS，重启以后也能恢复会话。会话变化时写入：完整握手，或者简化握手收到新的会话票据。
 #define APP_MQTT_USERNAME               "mqtt_username"
 #define APP_MQTT_PASSWORD               "mqtt_password"
 #define APP_MQTT_PUB_MGS_TOPIC          "topic/iotmsg"
 #define APP_MQTT_PUB_LOG_TOPIC          "topic/iotlog"
 #define APP_MQTT_WILL_TOPIC             "topic/will"
+#define APP_MQTT_DEV_TOPIC              "topic/iotdev"      // 设备控制主题，订阅 topic/iotdev/<MAC>/cmd，应答 topic/iotdev/<MAC>/ack。
 #define APP_MQTT_WILL_MSG               "MQTT 离开消息"
-#define APP_MQTT_QOS                    0                   // 实际测试连续发送 1000 条 200 个字符，QOS = 0 耗时 2.5 秒，QOS = 1 耗时 9 秒左右。
+#define APP_MQTT_QOS                    1                   // 实际测试连续发送 1000 条 200 个字符，QOS = 0 耗时 2.5 秒，QOS = 1 逐条等待耗时 9 秒左右，所以 QOS = 1 使用在途窗口，不等待 PUBACK 连续发送，主机测试 test_mqtt 对比三种方式。
+#define APP_MQTT_ACK_QOS                0                   // 控制命令应答丢了就丢了，不占用在途窗口。日志块使用 APP_MQTT_QOS，断点续传。
+#define APP_MQTT_BACKFILL_QOS           0                   // 补传记录服务器可以重新查询，不占用在途窗口，不影响缓存推送的提交位置。
+#define APP_MQTT_INFLIGHT_WINDOW        16                  // 缓存推送的在途窗口，最多 N 条未收到 PUBACK。
+#define APP_MQTT_LIVE_WINDOW            8                   // 跟踪 N 条未收到 PUBACK 的实时消息，有在途实时消息时缓存推送让路。
+#define APP_PING_FALLBACK               1                   // MQTT 链路探测失败以后，再用 ICMP PING 区分服务器不可达和 4G 断网。0 = 不 PING，按断网处理。
+#define APP_MQTT_OUTBOX_BUDGET          (64 * 1024)         // outbox 在 PSRAM 中最多占用的字节数，超出则最早的消息转存到 SD 卡缓存。
+#define APP_MQTT_SPILL_QUEUE            (16 * 1024)         // outbox 转存的实时消息先放入 PSRAM 队列，由缓存推送任务写入 SD 卡。
+
+  /*
+   * 缓存推送任务，令牌桶限速，避免缓存占满 4G 上行，影响实时消息。
+   */
+#define APP_DRAIN_RATE                  20                  // 每秒推送缓存条数。
+#define APP_DRAIN_BURST                 32                  // 令牌桶容量，最多连续推送条数。
+
+  /*
+   * 上报策略默认参数，可以通过控制主题修改，保存在 NVS。
+   */
+#define APP_CTRL_PERIOD_INVALID         5000                // 定位无效时的上报周期，毫秒。
+#define APP_CTRL_PERIOD_STOP            5000                // 停止未移动时的上报周期，毫秒。
+#define APP_CTRL_PERIOD_SLOW            2000                // 低速移动时的上报周期，毫秒。
+#define APP_CTRL_PERIOD_FAST            1000                // 高速移动时的上报周期，毫秒。
+#define APP_CTRL_SPEED_STOP             5                   // 小于这个速度视为停止，单位：节，9.26 公里。
+#define APP_CTRL_SPEED_SLOW             30                  // 小于这个速度视为低速，单位：节，55.56 公里。
+#define APP_CTRL_LIVE_PERIOD            1000                // 实时跟踪模式的默认上报周期，毫秒。
+#define APP_CTRL_LIVE_DURATION          600                 // 实时跟踪模式的默认持续时间，秒。
+
+  /*
+   * SD 卡日志，日志先写入内存环形缓冲区，由后台任务批量写入 SD 卡。
+   */
+#define APP_LOG_RING_SIZE               (32 * 1024)         // 环形缓冲区字节数，必须是 2 的幂。缓冲区满时丢弃日志，UART 照常输出。
+#define APP_LOG_FSYNC_PERIOD            5000                // 最多 N 毫秒执行一次 fsync()。
+#define APP_LOG_FSYNC_BYTES             (16 * 1024)         // 写入 N 字节以后立即执行 fsync()。
+#define APP_LOG_BINARY                  0                   // 1 = SD 卡和 MQTT 只保存格式 ID 和二进制参数，用 tools/logdecode.py 还原，UART 照常输出文本。见 app_logbin.h。
+
+  /*
+   * SD 卡归档文件保留策略，超出时先删除已上传的最旧文件。
+   */
+#define APP_RETAIN_MAX_BYTES            (256UL * 1024 * 1024)   // 归档文件总字节数上限。
+#define APP_RETAIN_MAX_AGE              (90 * 86400)        // 归档文件最长保留时间，秒。时间同步以后才检查。
+#define APP_RETAIN_MAX_FILES            128                 // 索引最多记录的文件数，超出时删除最旧的文件。
+
+  /*
+   * 最近定位记录的 PSRAM 环形缓冲区，本地读取不访问 SD 卡，后台任务按大块顺序写入 SD 卡。
+   */
+#define APP_FIX_RING_SLOTS              (6 * 3600)          // 记录条数，最快 1 秒一条，保存最近 6 小时。每条 24 字节，占用 PSRAM 约 506 KB。
+#define APP_FIX_FLUSH_RECORDS           256                 // 攒够 N 条写入一次 SD 卡，一次写入 5 KB。
+#define APP_FIX_FLUSH_PERIOD            300000              // 最多 N 毫秒写入一次 SD 卡，断电最多丢失 SD 卡上这段时间的记录。
+#define APP_FIX_FILE_MAX                (4UL * 1024 * 1024) // 定位记录文件超过 N 字节时归档，按保留策略删除。
+
+  /*
+   * WIFI 热点上的 HTTP 轨迹导出，GET /track?fmt=gpx|csv&t1=&t2=
+   */
+#define APP_HTTP_PORT                   80
+#define APP_HTTP_CHUNK_SIZE             2048                // 发送缓冲区，攒满 N 字节发送一个 HTTP 分块。
+#define APP_HTTP_EXPORT_RANGE           86400               // 省略时间范围时导出最近 N 秒。
 
 
    /*
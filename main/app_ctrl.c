@@ -0,0 +1,486 @@
+/**
+ * @brief   远程控制，订阅 MQTT 控制主题，修改上报策略参数并保存到 NVS。
+ *
+ *          命令格式，JSON，id 原样返回到应答主题：
+ *          {"id":1,"cmd":"set","p_inv":5000,"p_stop":5000,"p_slow":2000,"p_fast":1000,"s_stop":5,"s_slow":30,"ble":60,"rate":20,"fails":3}
+ *          {"id":2,"cmd":"get"}                            应答带参数和当前服务器序号 "broker"。
+ *          {"id":3,"cmd":"live","period":1000,"dur":600}   dur = 0 退出实时跟踪模式。
+ *          {"id":4,"cmd":"log"}                            上传当前日志。
+ *          {"id":5,"cmd":"flush"}                          不限速推送缓存，直到推送完。
+ *          {"id":6,"cmd":"bench","kb":256}                 SD 卡性能测试，kb 是追加写入的字节数，应答带测试结果 "bench"，见 app_bench.h。
+ *          {"id":7,"cmd":"query","t1":1760000000,"t2":1760003600}
+ *                                                          补传 t1 到 t2 的缓存记录（UTC 秒），标记字段 "f":2，
+ *                                                          完成后再发送一次应答，带发送条数 "n" 和耗时 "ms"。
+ *          {"id":8,"cmd":"track","t1":1760000000,"n":30}   从 PSRAM 读取最近的轨迹，不访问 SD 卡。没有 t1 时返回最新的 n 条。
+ *                                                          应答带 "track":[[ts,lat,lon,alt,spd,trk,sat,flags],...]，见 app_fix.h，
+ *                                                          以及查找和读取耗时 "us"。
+ *          应答：{"id":1,"ret":0,"msg":"ok"}
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "cJSON.h"
+
+#include "app_ctrl.h"
+#include "app_mqtt.h"
+#include "app_drain.h"
+#include "app_broker.h"
+#include "app_bench.h"
+#include "app_fix.h"
+#include "app_config.h"
+
+ /**
+ * @brief NVS 命名空间和键名。
+ */
+#define APP_CTRL_NVS_NAMESPACE      "app_ctrl"
+#define APP_CTRL_NVS_KEY            "params"
+
+ /**
+ * @brief 参数版本，结构体改变时加 1，旧版本的参数不再加载。
+ */
+#define APP_CTRL_PARAMS_VERSION     2
+
+ /**
+ * @brief 命令最大长度。
+ */
+#define APP_CTRL_CMD_SIZE           256
+
+ /**
+ * @brief 命令队列长度。
+ */
+#define APP_CTRL_QUEUE_LEN          4
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_ctrl";
+
+/**
+ * @brief 保存到 NVS 的数据。
+ */
+typedef struct {
+    uint32_t version;
+    app_ctrl_params_t params;
+} app_ctrl_blob_t;
+
+/**
+ * @brief 命令。
+ */
+typedef struct {
+    int len;
+    char data[APP_CTRL_CMD_SIZE];
+} app_ctrl_cmd_t;
+
+/**
+ * @brief 可以修改的参数，名称、位置和取值范围。
+ */
+typedef struct {
+    const char* name;
+    size_t offset;
+    uint32_t min;
+    uint32_t max;
+} app_ctrl_field_t;
+
+static const app_ctrl_field_t app_ctrl_fields[] = {
+    { "p_inv",  offsetof(app_ctrl_params_t, period_invalid),    200,    30000 },// 主循环守护任务 60 秒超时，周期不能太长。
+    { "p_stop", offsetof(app_ctrl_params_t, period_stop),       200,    30000 },
+    { "p_slow", offsetof(app_ctrl_params_t, period_slow),       200,    30000 },
+    { "p_fast", offsetof(app_ctrl_params_t, period_fast),       200,    30000 },
+    { "s_stop", offsetof(app_ctrl_params_t, speed_stop),        0,      200 },
+    { "s_slow", offsetof(app_ctrl_params_t, speed_slow),        0,      200 },
+    { "ble",    offsetof(app_ctrl_params_t, ble_timeout),       5,      3600 },
+    { "rate",   offsetof(app_ctrl_params_t, drain_rate),        1,      100 },
+    { "fails",  offsetof(app_ctrl_params_t, broker_fails),      1,      20 },
+};
+
+/**
+ * @brief 运行参数，默认值来自 app_config.h。
+ */
+static app_ctrl_params_t app_ctrl_params = {
+    .period_invalid = APP_CTRL_PERIOD_INVALID,
+    .period_stop = APP_CTRL_PERIOD_STOP,
+    .period_slow = APP_CTRL_PERIOD_SLOW,
+    .period_fast = APP_CTRL_PERIOD_FAST,
+    .speed_stop = APP_CTRL_SPEED_STOP,
+    .speed_slow = APP_CTRL_SPEED_SLOW,
+    .ble_timeout = APP_BLE_LEAVE_TIMEOUT,
+    .drain_rate = APP_DRAIN_RATE,
+    .broker_fails = APP_BROKER_FAIL_MAX,
+};
+
+/**
+ * @brief 参数互斥锁。
+ */
+static pthread_mutex_t app_ctrl_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 实时跟踪模式，上报周期和结束时间戳，结束时间戳为 0 表示没有进入。
+ */
+static _Atomic uint32_t app_ctrl_live_period = ATOMIC_VAR_INIT(APP_CTRL_LIVE_PERIOD);
+static _Atomic uint32_t app_ctrl_live_until = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 命令队列。
+ */
+static QueueHandle_t app_ctrl_queue = NULL;
+
+/**
+ * @brief 获取运行参数。
+ * @param params
+ */
+void app_ctrl_get_params(app_ctrl_params_t* params) {
+    pthread_mutex_lock(&app_ctrl_mutex);
+    *params = app_ctrl_params;
+    pthread_mutex_unlock(&app_ctrl_mutex);
+}
+
+/**
+ * @brief 根据定位状态和速度计算上报周期，实时跟踪模式优先。
+ * @param gnss_valid
+ * @param spd 速度，节。
+ * @return 上报周期，毫秒。
+ */
+uint32_t app_ctrl_report_period(bool gnss_valid, double spd) {
+    uint32_t live_until = atomic_load(&app_ctrl_live_until);
+    if (live_until != 0) {
+        if ((int32_t)(live_until - esp_log_timestamp()) > 0) {
+            return atomic_load(&app_ctrl_live_period);
+        }
+        atomic_store(&app_ctrl_live_until, 0);
+        ESP_LOGI(TAG, "------ 实时跟踪模式：结束。");
+    }
+    app_ctrl_params_t params;
+    app_ctrl_get_params(&params);
+    if (gnss_valid == false) {
+        return params.period_invalid;
+    } else if (spd < params.speed_stop) {
+        return params.period_stop;
+    } else if (spd < params.speed_slow) {
+        return params.period_slow;
+    }
+    return params.period_fast;
+}
+
+/**
+ * @brief 保存参数到 NVS。
+ */
+static esp_err_t app_ctrl_save(const app_ctrl_params_t* params) {
+    app_ctrl_blob_t blob = {
+        .version = APP_CTRL_PARAMS_VERSION,
+        .params = *params,
+    };
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(APP_CTRL_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_set_blob(handle, APP_CTRL_NVS_KEY, &blob, sizeof(blob));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return ret;
+}
+
+/**
+ * @brief 从 NVS 加载参数，没有或者版本不同时使用默认值。
+ */
+static void app_ctrl_load(void) {
+    nvs_handle_t handle;
+    if (nvs_open(APP_CTRL_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        ESP_LOGI(TAG, "------ 远程控制参数：使用默认值。");
+        return;
+    }
+    app_ctrl_blob_t blob;
+    size_t size = sizeof(blob);
+    esp_err_t ret = nvs_get_blob(handle, APP_CTRL_NVS_KEY, &blob, &size);
+    nvs_close(handle);
+    if (ret != ESP_OK || size != sizeof(blob) || blob.version != APP_CTRL_PARAMS_VERSION) {
+        ESP_LOGW(TAG, "------ 远程控制参数：NVS 中没有可用的参数，使用默认值。");
+        return;
+    }
+    pthread_mutex_lock(&app_ctrl_mutex);
+    app_ctrl_params = blob.params;
+    pthread_mutex_unlock(&app_ctrl_mutex);
+    ESP_LOGI(TAG, "------ 远程控制参数：从 NVS 加载完成。");
+}
+
+/**
+ * @brief 参数序列化为 JSON 字段，追加到应答。
+ */
+static void app_ctrl_add_params(cJSON* root, const app_ctrl_params_t* params) {
+    for (int i = 0; i < sizeof(app_ctrl_fields) / sizeof(app_ctrl_fields[0]); i++) {
+        const app_ctrl_field_t* field = &app_ctrl_fields[i];
+        cJSON_AddNumberToObject(root, field->name, *(const uint32_t*)((const char*)params + field->offset));
+    }
+}
+
+/**
+ * @brief 修改参数。先全部检查，全部有效时先保存到 NVS，保存成功才整体替换运行参数，
+ *        失败时运行参数不变，重启以后加载的也是原参数。
+ * @return 错误信息，NULL 成功。
+ */
+static const char* app_ctrl_cmd_set(const cJSON* root) {
+    app_ctrl_params_t params;
+    app_ctrl_get_params(&params);
+    int count = 0;
+    for (int i = 0; i < sizeof(app_ctrl_fields) / sizeof(app_ctrl_fields[0]); i++) {
+        const app_ctrl_field_t* field = &app_ctrl_fields[i];
+        const cJSON* item = cJSON_GetObjectItemCaseSensitive(root, field->name);
+        if (item == NULL) {
+            continue;
+        }
+        if (!cJSON_IsNumber(item) || item->valuedouble < field->min || item->valuedouble > field->max) {
+            return field->name;
+        }
+        *(uint32_t*)((char*)&params + field->offset) = (uint32_t)item->valuedouble;
+        count++;
+    }
+    if (count == 0) {
+        return "no param";
+    }
+    if (params.speed_stop > params.speed_slow) {
+        return "s_stop > s_slow";
+    }
+    esp_err_t ret = app_ctrl_save(&params);
+    if (ret != ESP_OK) {
+        // nvs_set_blob() 成功、nvs_commit() 失败时新参数可能已经写入，写回原参数，保持 NVS 和运行参数一致。
+        app_ctrl_params_t old;
+        app_ctrl_get_params(&old);
+        esp_err_t rollback = app_ctrl_save(&old);
+        ESP_LOGE(TAG, "------ 远程控制参数保存到 NVS：失败！%s，参数没有修改，恢复原参数：%s", esp_err_to_name(ret), esp_err_to_name(rollback));
+        return "nvs";
+    }
+    pthread_mutex_lock(&app_ctrl_mutex);
+    app_ctrl_params = params;
+    pthread_mutex_unlock(&app_ctrl_mutex);
+    ESP_LOGI(TAG, "------ 远程控制参数修改：完成。修改个数：%d", count);
+    return NULL;
+}
+
+/**
+ * @brief 进入或者退出实时跟踪模式。
+ * @return 错误信息，NULL 成功。
+ */
+static const char* app_ctrl_cmd_live(const cJSON* root) {
+    uint32_t period = APP_CTRL_LIVE_PERIOD;
+    uint32_t duration = APP_CTRL_LIVE_DURATION;
+    const cJSON* item = cJSON_GetObjectItemCaseSensitive(root, "period");
+    if (item != NULL) {
+        if (!cJSON_IsNumber(item) || item->valuedouble < 200 || item->valuedouble > 30000) {
+            return "period";
+        }
+        period = item->valuedouble;
+    }
+    item = cJSON_GetObjectItemCaseSensitive(root, "dur");
+    if (item != NULL) {
+        if (!cJSON_IsNumber(item) || item->valuedouble < 0 || item->valuedouble > 86400) {
+            return "dur";
+        }
+        duration = item->valuedouble;
+    }
+    if (duration == 0) {
+        atomic_store(&app_ctrl_live_until, 0);
+        ESP_LOGI(TAG, "------ 实时跟踪模式：退出。");
+        return NULL;
+    }
+    atomic_store(&app_ctrl_live_period, period);
+    atomic_store(&app_ctrl_live_until, (esp_log_timestamp() + duration * 1000) | 1);// 0 表示没有进入。
+    ESP_LOGI(TAG, "------ 实时跟踪模式：开始。周期：%lu 毫秒，持续：%lu 秒", period, duration);
+    return NULL;
+}
+
+/**
+ * @brief SD 卡性能测试，在控制任务中执行，测试期间不处理其它命令。
+ * @return 错误信息，NULL 成功。
+ */
+static const char* app_ctrl_cmd_bench(const cJSON* root, cJSON* ack) {
+    uint32_t kb = 256;
+    const cJSON* item = cJSON_GetObjectItemCaseSensitive(root, "kb");
+    if (item != NULL) {
+        if (!cJSON_IsNumber(item) || item->valuedouble < 16 || item->valuedouble > 4096) {
+            return "kb";
+        }
+        kb = item->valuedouble;
+    }
+    app_bench_result_t* result = malloc(sizeof(app_bench_result_t));
+    if (result == NULL) {
+        return "no mem";
+    }
+    esp_err_t ret = app_bench_run(kb, result);
+    cJSON* bench = cJSON_AddObjectToObject(ack, "bench");
+    if (bench != NULL) {
+        app_bench_add_json(bench, result);
+    }
+    free(result);
+    return ret == ESP_OK ? NULL : "sd";
+}
+
+/**
+ * @brief 请求补传缓存记录，由推送任务执行。
+ * @return 错误信息，NULL 成功。
+ */
+static const char* app_ctrl_cmd_query(const cJSON* root, const cJSON* id) {
+    const cJSON* t1 = cJSON_GetObjectItemCaseSensitive(root, "t1");
+    const cJSON* t2 = cJSON_GetObjectItemCaseSensitive(root, "t2");
+    if (!cJSON_IsNumber(t1) || t1->valuedouble < 0 || t1->valuedouble > UINT32_MAX) {
+        return "t1";
+    }
+    if (!cJSON_IsNumber(t2) || t2->valuedouble < t1->valuedouble || t2->valuedouble > UINT32_MAX) {
+        return "t2";
+    }
+    app_drain_request_query(cJSON_IsNumber(id) ? id->valueint : 0, t1->valuedouble, t2->valuedouble);
+    return NULL;
+}
+
+/**
+ * @brief 从 PSRAM 读取最近的轨迹。
+ * @return 错误信息，NULL 成功。
+ */
+static const char* app_ctrl_cmd_track(const cJSON* root, cJSON* ack) {
+    int n = 30;
+    const cJSON* item = cJSON_GetObjectItemCaseSensitive(root, "n");
+    if (item != NULL) {
+        if (!cJSON_IsNumber(item) || item->valuedouble < 1 || item->valuedouble > 100) {
+            return "n";
+        }
+        n = item->valuedouble;
+    }
+    const cJSON* t1 = cJSON_GetObjectItemCaseSensitive(root, "t1");
+    if (t1 != NULL && (!cJSON_IsNumber(t1) || t1->valuedouble < 0 || t1->valuedouble > UINT32_MAX)) {
+        return "t1";
+    }
+    app_fix_t* fixes = malloc(n * sizeof(app_fix_t));
+    if (fixes == NULL) {
+        return "no mem";
+    }
+    int64_t start = esp_timer_get_time();
+    uint32_t head = app_fix_head();
+    uint32_t pos = t1 != NULL ? app_fix_find(t1->valuedouble) : head > (uint32_t)n ? head - n : 0;
+    int count = app_fix_read(&pos, fixes, n);
+    cJSON_AddNumberToObject(ack, "us", esp_timer_get_time() - start);
+    cJSON* track = cJSON_AddArrayToObject(ack, "track");
+    for (int i = 0; i < count && track != NULL; i++) {
+        const app_fix_t* fix = &fixes[i];
+        const double values[] = { fix->ts, fix->lat, fix->lon, fix->alt, fix->spd, fix->trk, fix->sat, fix->flags };
+        cJSON_AddItemToArray(track, cJSON_CreateDoubleArray(values, sizeof(values) / sizeof(values[0])));
+    }
+    free(fixes);
+    return NULL;
+}
+
+/**
+ * @brief 处理一条命令，发送应答。
+ */
+static void app_ctrl_handle(const app_ctrl_cmd_t* cmd) {
+    ESP_LOGI(TAG, "------ 收到控制命令：%.*s", cmd->len, cmd->data);
+    cJSON* root = cJSON_ParseWithLength(cmd->data, cmd->len);
+    cJSON* ack = cJSON_CreateObject();
+    if (ack == NULL) {
+        cJSON_Delete(root);
+        return;
+    }
+    const char* err = NULL;
+    const cJSON* id = root != NULL ? cJSON_GetObjectItemCaseSensitive(root, "id") : NULL;
+    const cJSON* name = root != NULL ? cJSON_GetObjectItemCaseSensitive(root, "cmd") : NULL;
+    if (cJSON_IsNumber(id)) {
+        cJSON_AddNumberToObject(ack, "id", id->valuedouble);
+    }
+    if (!cJSON_IsString(name)) {
+        err = "bad cmd";
+    } else if (strcmp(name->valuestring, "set") == 0) {
+        err = app_ctrl_cmd_set(root);
+    } else if (strcmp(name->valuestring, "get") == 0) {
+        app_ctrl_params_t params;
+        app_ctrl_get_params(&params);
+        app_ctrl_add_params(ack, &params);
+        app_broker_stats_t broker;
+        cJSON_AddNumberToObject(ack, "broker", app_broker_get_stats(0, &broker));// 当前服务器序号，0 是主服务器。
+    } else if (strcmp(name->valuestring, "live") == 0) {
+        err = app_ctrl_cmd_live(root);
+    } else if (strcmp(name->valuestring, "log") == 0) {
+        app_drain_request_log();
+    } else if (strcmp(name->valuestring, "flush") == 0) {
+        app_drain_flush();
+    } else if (strcmp(name->valuestring, "bench") == 0) {
+        err = app_ctrl_cmd_bench(root, ack);
+    } else if (strcmp(name->valuestring, "query") == 0) {
+        err = app_ctrl_cmd_query(root, id);
+    } else if (strcmp(name->valuestring, "track") == 0) {
+        err = app_ctrl_cmd_track(root, ack);
+    } else {
+        err = "unknown cmd";
+    }
+    cJSON_AddNumberToObject(ack, "ret", err == NULL ? 0 : -1);
+    cJSON_AddStringToObject(ack, "msg", err == NULL ? "ok" : err);
+    char* ack_str = cJSON_PrintUnformatted(ack);
+    if (ack_str != NULL) {
+        app_mqtt_publish_ack(ack_str);
+        cJSON_free(ack_str);
+    }
+    if (err != NULL) {
+        ESP_LOGW(TAG, "------ 控制命令执行：失败！原因：%s", err);
+    }
+    cJSON_Delete(ack);
+    cJSON_Delete(root);
+}
+
+/**
+ * @brief 收到控制命令，复制到队列，由控制任务处理。
+ *        在 MQTT 事件回调中调用，不能阻塞。
+ * @param data
+ * @param len
+ */
+void app_ctrl_on_cmd(const char* data, int len) {
+    if (app_ctrl_queue == NULL) {
+        return;
+    }
+    if (len <= 0 || len >= APP_CTRL_CMD_SIZE) {
+        ESP_LOGW(TAG, "------ 控制命令长度错误，丢弃。长度：%d", len);
+        return;
+    }
+    app_ctrl_cmd_t cmd = { .len = len };
+    memcpy(cmd.data, data, len);
+    if (xQueueSend(app_ctrl_queue, &cmd, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "------ 控制命令队列已满，丢弃。");
+    }
+}
+
+/**
+ * @brief 控制任务。命令处理需要写 NVS 和发送应答，不在 MQTT 事件回调中执行。
+ * @param param
+ */
+static void app_ctrl_task(void* param) {
+    app_ctrl_cmd_t cmd;
+    while (1) {
+        if (xQueueReceive(app_ctrl_queue, &cmd, portMAX_DELAY) == pdTRUE) {
+            app_ctrl_handle(&cmd);
+        }
+    }
+}
+
+/**
+ * @brief 初始化函数，NVS 初始化以后、MQTT 初始化之前调用。
+ * @return
+ */
+esp_err_t app_ctrl_init(void) {
+    app_ctrl_load();
+    app_ctrl_queue = xQueueCreate(APP_CTRL_QUEUE_LEN, sizeof(app_ctrl_cmd_t));
+    if (app_ctrl_queue == NULL) {
+        return ESP_FAIL;
+    }
+    BaseType_t ret = xTaskCreate(app_ctrl_task, "app_ctrl_task", 4096, NULL, 2, NULL);
+    return ret == pdPASS ? ESP_OK : ESP_FAIL;
+}
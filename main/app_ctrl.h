@@ -0,0 +1,54 @@
+/**
+ * @brief   远程控制，订阅 MQTT 控制主题，修改上报策略参数并保存到 NVS。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+ /**
+  * @brief 运行参数，整体替换，读取时复制一份。
+  */
+typedef struct {
+    uint32_t period_invalid;    // 定位无效时的上报周期，毫秒。
+    uint32_t period_stop;       // 停止未移动时的上报周期，毫秒。
+    uint32_t period_slow;       // 低速移动时的上报周期，毫秒。
+    uint32_t period_fast;       // 高速移动时的上报周期，毫秒。
+    uint32_t speed_stop;        // 停止速度阈值，节。
+    uint32_t speed_slow;        // 低速速度阈值，节。
+    uint32_t ble_timeout;       // 蓝牙接近开关离开超时，秒。
+    uint32_t drain_rate;        // 缓存推送速度，条/秒。
+    uint32_t broker_fails;      // 连续连接失败次数，达到以后切换服务器。
+} app_ctrl_params_t;
+
+/**
+ * @brief 获取运行参数。
+ * @param params
+ */
+void app_ctrl_get_params(app_ctrl_params_t* params);
+
+/**
+ * @brief 根据定位状态和速度计算上报周期，实时跟踪模式优先。
+ * @param gnss_valid
+ * @param spd 速度，节。
+ * @return 上报周期，毫秒。
+ */
+uint32_t app_ctrl_report_period(bool gnss_valid, double spd);
+
+/**
+ * @brief 收到控制命令，复制到队列，由控制任务处理。
+ *        在 MQTT 事件回调中调用，不能阻塞。
+ * @param data
+ * @param len
+ */
+void app_ctrl_on_cmd(const char* data, int len);
+
+/**
+ * @brief 初始化函数，NVS 初始化以后、MQTT 初始化之前调用。
+ * @return
+ */
+esp_err_t app_ctrl_init(void);
@@ -24,6 +24,17 @@
 #include "app_gnss.h"
 #include "app_main.h"
 #include "app_modem.h"
+#include "app_rtt.h"
+#include "app_tls.h"
+#include "app_logbuf.h"
+#include "app_retain.h"
+#include "app_fix.h"
+#include "app_cache.h"
+
+ /**
+ * @brief MQTT 链路探测等待 PUBACK 的超时，毫秒。
+ */
+#define APP_DEAMON_PROBE_TIMEOUT    5000
 
  /**
  * @brief 日志 TAG。
@@ -104,8 +115,54 @@ static void app_deamon_check_signal_and_restart_ppp(void) {
     }
 }
 
+/**
+ * @brief 链路探测，发送一条 QOS = 1 的空消息，等待 PUBACK。
+ * @return 1 服务器可达，-1 没有连接或者超时。
+ */
+static int app_deamon_probe_mqtt(void) {
+    int msg_id = app_mqtt_probe();
+    if (msg_id < 0) {
+        return -1;
+    }
+    for (int i = 0; i < APP_DEAMON_PROBE_TIMEOUT / 100; i++) {
+        vTaskDelay(pdMS_TO_TICKS(100));// 每个循环等待 100 毫秒。
+        int probe_ret = app_mqtt_probe_state(msg_id);
+        if (probe_ret != 0) {
+            return probe_ret;
+        }
+    }
+    return -1;
+}
+
+#if APP_PING_FALLBACK
+/**
+ * @brief ICMP PING，MQTT 没有连接或者探测失败时，区分是服务器不可达还是 4G 断网。
+ * @return PING 返回 time，-1 超时。
+ */
+static int app_deamon_ping(void) {
+    esp_err_t ping_start_ret = app_ping_start();
+    if (ping_start_ret != ESP_OK) {
+        ESP_LOGE(TAG, "------ PING 函数执行结果：失败！立即执行：esp_restart()");
+        esp_restart();
+    }
+    int ping_ret = 0;
+    for (int i = 0; i < 11; i++) {
+        vTaskDelay(pdMS_TO_TICKS(100));// 每个循环等待 100 毫秒。
+        ping_ret = atomic_load(&app_ping_ret);
+        if (ping_ret > 0) {// 如果有返回值。
+            break;
+        }
+        if (i == 10) {// 最后一次循环，还没有结果的情况，等同于超时。
+            ping_ret = -1;
+        }
+    }
+    return ping_ret;
+}
+#endif
+
 /**
  * @brief 网络状态的守护任务。
+ *        10 秒没有收到 PUBACK，先用 MQTT 链路探测，失败以后再 PING。
  * @param param
  */
 static void app_deamon_network_task(void* param) {
@@ -114,6 +171,17 @@ static void app_deamon_network_task(void* param) {
         if (count % 30 == 0) {
             ESP_LOGI(TAG, "------ app_deamon_network_task() 守护任务，执行次数：%lu，APP 状态：%d", count, app_status);
         }
+        if (count % 60 == 0) {
+            app_rtt_log();
+            app_logbuf_log();
+            app_retain_log();
+            app_fix_log();
+            app_cache_log();
+            app_modem_log();
+#if APP_MQTT_TLS
+            app_tls_log();
+#endif
+        }
 
         if (app_status == 1) {
             uint32_t cur_ts = esp_log_timestamp();
@@ -121,28 +189,24 @@ static void app_deamon_network_task(void* param) {
             if (cur_ts - mqtt_last_ts > 10000) {// 大于 10 秒。
 
                 if (app_deamon_ppp_stop_ts == 0) {
-                    esp_err_t ping_start_ret = app_ping_start();
-                    if (ping_start_ret != ESP_OK) {
-                        ESP_LOGE(TAG, "------ PING 函数执行结果：失败！立即执行：esp_restart()");
-                        esp_restart();
-                    }
-                    int ping_ret = 0;
-                    for (int i = 0; i < 11; i++) {
-                        vTaskDelay(pdMS_TO_TICKS(100));// 每个循环等待 100 毫秒。
-                        ping_ret = atomic_load(&app_ping_ret);
-                        if (ping_ret > 0) {// 如果有返回值。
-                            break;
-                        }
-                        if (i == 10) {// 最后一次循环，还没有结果的情况，等同于超时。
-                            ping_ret = -1;
+                    if (app_deamon_probe_mqtt() == 1) {// 服务器可达，PUBACK 已经更新时间戳。
+                        ESP_LOGI(TAG, "------ MQTT 链路探测：成功。");
+#if APP_PING_FALLBACK
+                    } else {
+                        int ping_ret = app_deamon_ping();
+                        if (ping_ret == -1) {// 断网状态，直接检测信号。
+                            app_deamon_check_signal_and_restart_ppp();
+                        } else {
+                            ESP_LOGI(TAG, "------ PING 返回 time 值：%d。等待 MQTT 客户端自动重连......", ping_ret);
+                            vTaskDelay(pdMS_TO_TICKS(10000));// 等待 10 秒，减少 PING 次数。
                         }
                     }
-                    if (ping_ret == -1) {// 断网状态，直接检测信号。
+#else
+                    } else {// 服务器不可达，按断网处理。
+                        ESP_LOGW(TAG, "------ MQTT 链路探测：失败！");
                         app_deamon_check_signal_and_restart_ppp();
-                    } else {
-                        ESP_LOGI(TAG, "------ PING 返回 time 值：%d。等待 MQTT 客户端自动重连......", ping_ret);
-                        vTaskDelay(pdMS_TO_TICKS(10000));// 等待 10 秒，减少 PING 次数。
                     }
+#endif
 
                 } else {// 断网状态，直接检测信号。
                     app_deamon_check_signal_and_restart_ppp();
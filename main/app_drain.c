@@ -0,0 +1,316 @@
+/**
+ * @brief   缓存推送任务，限速推送 SD 卡缓存和日志备份文件。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+
+#include "app_sd.h"
+#include "app_mqtt.h"
+#include "app_cache.h"
+#include "app_ctrl.h"
+#include "app_logup.h"
+#include "app_json.h"
+#include "app_drain.h"
+#include "app_config.h"
+
+ /**
+ * @brief 事件位。
+ */
+#define APP_DRAIN_BIT_CONNECTED     BIT0        // MQTT 已连接。
+#define APP_DRAIN_BIT_KICK          BIT1        // 在途窗口有空位。
+#define APP_DRAIN_BIT_LOG           BIT2        // 请求上传当前日志。
+#define APP_DRAIN_BIT_QUERY         BIT3        // 请求补传缓存记录。
+#define APP_DRAIN_BIT_COMMIT        BIT4        // 收到 PUBACK，提交缓存位置。
+#define APP_DRAIN_BIT_SPILL         BIT5        // outbox 转存了实时消息，写入缓存。
+
+ /**
+ * @brief 补传时每发送 N 条让出一次 CPU，给实时消息和主循环让路。
+ */
+#define APP_DRAIN_QUERY_BATCH       8
+
+ /**
+ * @brief 统计周期，毫秒。
+ */
+#define APP_DRAIN_STATS_PERIOD      60000
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_drain";
+
+/**
+ * @brief 事件组。
+ */
+static EventGroupHandle_t app_drain_event_group = NULL;
+
+/**
+ * @brief 统计数据。
+ */
+static _Atomic uint32_t app_drain_pub_total = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_drain_pub_rate = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 不限速推送，直到缓存推送完。
+ */
+static _Atomic int app_drain_flushing = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 补传请求，控制任务写入，推送任务读取。
+ */
+typedef struct {
+    int id;
+    uint32_t t1;
+    uint32_t t2;
+    uint32_t sent;              // 已发送条数，推送任务使用。
+} app_drain_query_t;
+
+static app_drain_query_t app_drain_query = { 0 };
+static pthread_mutex_t app_drain_query_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief MQTT 已连接，开始推送。
+ */
+void app_drain_notify_connected(void) {
+    if (app_drain_event_group != NULL) {
+        xEventGroupSetBits(app_drain_event_group, APP_DRAIN_BIT_CONNECTED | APP_DRAIN_BIT_KICK);
+    }
+}
+
+/**
+ * @brief MQTT 断开连接，暂停推送。
+ */
+void app_drain_notify_disconnected(void) {
+    if (app_drain_event_group != NULL) {
+        xEventGroupClearBits(app_drain_event_group, APP_DRAIN_BIT_CONNECTED);
+    }
+}
+
+/**
+ * @brief 收到 PUBACK，在途窗口有空位，唤醒推送任务。
+ */
+void app_drain_kick(void) {
+    if (app_drain_event_group != NULL) {
+        xEventGroupSetBits(app_drain_event_group, APP_DRAIN_BIT_KICK);
+    }
+}
+
+/**
+ * @brief 收到 PUBACK，请求提交缓存位置。由 MQTT 事件任务调用，提交写 SD 卡，交给推送任务执行，断开连接时也提交。
+ */
+void app_drain_request_commit(void) {
+    if (app_drain_event_group != NULL) {
+        xEventGroupSetBits(app_drain_event_group, APP_DRAIN_BIT_COMMIT | APP_DRAIN_BIT_KICK);
+    }
+}
+
+/**
+ * @brief outbox 转存了实时消息，请求写入缓存。由持有 MQTT 客户端锁的转存回调调用，写 SD 卡交给推送任务执行，断开连接时也执行。
+ */
+void app_drain_request_spill(void) {
+    if (app_drain_event_group != NULL) {
+        xEventGroupSetBits(app_drain_event_group, APP_DRAIN_BIT_SPILL);
+    }
+}
+
+/**
+ * @brief 等待 PUBACK 或重连事件，由推送任务中的日志上传调用。
+ * @param timeout_ms
+ */
+void app_drain_wait_kick(uint32_t timeout_ms) {
+    xEventGroupWaitBits(app_drain_event_group, APP_DRAIN_BIT_KICK, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeout_ms));
+}
+
+/**
+ * @brief 请求上传当前日志，连接以后由推送任务执行。
+ */
+void app_drain_request_log(void) {
+    if (app_drain_event_group != NULL) {
+        xEventGroupSetBits(app_drain_event_group, APP_DRAIN_BIT_LOG | APP_DRAIN_BIT_KICK);
+    }
+}
+
+/**
+ * @brief 请求补传一段时间内的缓存记录，连接以后由推送任务按时间索引查询并发送，完成后发送应答。
+ *        新的请求覆盖还没开始的请求。
+ * @param id 控制命令 ID，原样返回到应答。
+ * @param t1 开始时间，UTC 秒。
+ * @param t2 结束时间，UTC 秒。
+ */
+void app_drain_request_query(int id, uint32_t t1, uint32_t t2) {
+    pthread_mutex_lock(&app_drain_query_mutex);
+    app_drain_query.id = id;
+    app_drain_query.t1 = t1;
+    app_drain_query.t2 = t2;
+    pthread_mutex_unlock(&app_drain_query_mutex);
+    if (app_drain_event_group != NULL) {
+        xEventGroupSetBits(app_drain_event_group, APP_DRAIN_BIT_QUERY | APP_DRAIN_BIT_KICK);
+    }
+}
+
+/**
+ * @brief 补传一条记录，按记录时间精确过滤，标记字段改为 2，服务器区分补传数据。
+ * @return false 连接断开，停止查询。
+ */
+static bool app_drain_query_cb(char* data, int len, void* arg) {
+    app_drain_query_t* query = arg;
+    uint32_t t = app_json_get_time(data);
+    if (t < query->t1 || t > query->t2) {
+        return true;
+    }
+    if ((xEventGroupGetBits(app_drain_event_group) & APP_DRAIN_BIT_CONNECTED) == 0) {
+        return false;
+    }
+    if (len > 6 && strcmp(data + len - 6, "\"f\":1}") == 0) {
+        data[len - 2] = '2';
+    }
+    if (app_mqtt_publish_backfill(data, len) < 0) {
+        return false;
+    }
+    if (++query->sent % APP_DRAIN_QUERY_BATCH == 0) {
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+/**
+ * @brief 执行补传请求，发送应答：{"id":1,"cmd":"query","n":120,"ms":850,"ret":0,"msg":"ok"}
+ */
+static void app_drain_run_query(void) {
+    app_drain_query_t query;
+    pthread_mutex_lock(&app_drain_query_mutex);
+    query = app_drain_query;
+    pthread_mutex_unlock(&app_drain_query_mutex);
+    query.sent = 0;
+    uint32_t start = esp_log_timestamp();
+    int count = app_cache_query(query.t1, query.t2, app_drain_query_cb, &query);
+    uint32_t elapsed = esp_log_timestamp() - start;
+    bool connected = (xEventGroupGetBits(app_drain_event_group) & APP_DRAIN_BIT_CONNECTED) != 0;
+    ESP_LOGI(TAG, "------ 缓存补传：%s。时间：%lu - %lu，读取条数：%d，发送条数：%lu，耗时：%lu 毫秒",
+        count >= 0 && connected ? "完成" : "中断", query.t1, query.t2, count, query.sent, elapsed);
+    char ack[128];
+    snprintf(ack, sizeof(ack), "{\"id\":%d,\"cmd\":\"query\",\"n\":%lu,\"ms\":%lu,\"ret\":%d,\"msg\":\"%s\"}",
+        query.id, query.sent, elapsed, count >= 0 && connected ? 0 : -1, count < 0 ? "cache" : connected ? "ok" : "disconnected");
+    app_mqtt_publish_ack(ack);
+}
+
+/**
+ * @brief 不限速、不给实时消息让路，推送全部缓存，推送完恢复限速。
+ */
+void app_drain_flush(void) {
+    atomic_store(&app_drain_flushing, 1);
+    app_drain_kick();
+}
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_drain_get_stats(app_drain_stats_t* stats) {
+    stats->pub_total = atomic_load(&app_drain_pub_total);
+    stats->pub_rate = atomic_load(&app_drain_pub_rate);
+    stats->remaining = app_cache_remaining();
+}
+
+/**
+ * @brief 推送任务。
+ *        令牌桶限速，每秒补充 drain_rate 个令牌，最多 APP_DRAIN_BURST 个，每推送一条消耗一个。
+ *        实时消息优先：有实时消息等待 PUBACK 时，不推送缓存。远程控制命令 flush 时不限速。
+ * @param param
+ */
+static void app_drain_task(void* param) {
+    uint32_t tokens = APP_DRAIN_BURST;
+    uint32_t refill_ts = esp_log_timestamp();
+    uint32_t stats_ts = refill_ts;
+    uint32_t stats_count = 0;
+    while (1) {
+        EventBits_t bits = xEventGroupWaitBits(app_drain_event_group, APP_DRAIN_BIT_CONNECTED | APP_DRAIN_BIT_COMMIT | APP_DRAIN_BIT_SPILL,
+            pdFALSE, pdFALSE, portMAX_DELAY);
+        if (xEventGroupClearBits(app_drain_event_group, APP_DRAIN_BIT_COMMIT) & APP_DRAIN_BIT_COMMIT) {// 断开连接之前收到的 PUBACK。
+            app_mqtt_commit_cache();
+        }
+        if (xEventGroupClearBits(app_drain_event_group, APP_DRAIN_BIT_SPILL) & APP_DRAIN_BIT_SPILL) {// 断开连接时超出预算、过期的实时消息。
+            app_mqtt_write_spilled();
+        }
+        if ((bits & APP_DRAIN_BIT_CONNECTED) == 0) {
+            continue;
+        }
+        app_logup_run();// 等待上传的日志文件，每次连接检查一次。
+
+        while (xEventGroupGetBits(app_drain_event_group) & APP_DRAIN_BIT_CONNECTED) {
+            if (xEventGroupClearBits(app_drain_event_group, APP_DRAIN_BIT_COMMIT) & APP_DRAIN_BIT_COMMIT) {
+                app_mqtt_commit_cache();
+            }
+            if (xEventGroupClearBits(app_drain_event_group, APP_DRAIN_BIT_SPILL) & APP_DRAIN_BIT_SPILL) {
+                app_mqtt_write_spilled();
+            }
+            if (xEventGroupClearBits(app_drain_event_group, APP_DRAIN_BIT_LOG) & APP_DRAIN_BIT_LOG) {// 远程控制请求上传日志。
+                app_sd_snap_log_file();
+                app_logup_run();
+            }
+            if (xEventGroupClearBits(app_drain_event_group, APP_DRAIN_BIT_QUERY) & APP_DRAIN_BIT_QUERY) {// 远程控制请求补传。
+                app_drain_run_query();
+            }
+            app_ctrl_params_t params;
+            app_ctrl_get_params(&params);
+            int flushing = atomic_load(&app_drain_flushing);
+            uint32_t cur_ts = esp_log_timestamp();
+            uint32_t refill = (cur_ts - refill_ts) * params.drain_rate / 1000;
+            if (refill > 0) {
+                tokens = tokens + refill > APP_DRAIN_BURST ? APP_DRAIN_BURST : tokens + refill;
+                refill_ts += refill * 1000 / params.drain_rate;
+            }
+            if (flushing) {
+                tokens = APP_DRAIN_BURST;
+            }
+            if (cur_ts - stats_ts >= APP_DRAIN_STATS_PERIOD) {
+                atomic_store(&app_drain_pub_rate, stats_count * 60000 / (cur_ts - stats_ts));
+                if (stats_count > 0) {
+                    ESP_LOGI(TAG, "------ 缓存推送统计，总条数：%lu，速度：%lu 条/分钟，剩余字节：%lu",
+                        atomic_load(&app_drain_pub_total), atomic_load(&app_drain_pub_rate), app_cache_remaining());
+                }
+                stats_ts = cur_ts;
+                stats_count = 0;
+            }
+
+            int pub_count = 0;
+            if (tokens > 0 && (flushing || app_mqtt_live_inflight() == 0)) {// 实时消息优先。
+                pub_count = app_mqtt_pub_cache(tokens);
+                if (flushing && pub_count == 0 && app_mqtt_cache_inflight() == 0) {// 窗口有空位却没有读到记录，在途的也都确认了。
+                    atomic_store(&app_drain_flushing, 0);
+                    ESP_LOGI(TAG, "------ 缓存推送：全部推送完成，恢复限速。");
+                }
+            }
+            if (pub_count > 0) {
+                tokens -= pub_count;
+                stats_count += pub_count;
+                atomic_fetch_add(&app_drain_pub_total, pub_count);
+            }
+            // 等待下一个令牌。没有可推送的记录、窗口已满或者发送失败时，等待 PUBACK 或重连事件唤醒。
+            TickType_t wait_ticks = pub_count > 0 || tokens == 0 ? pdMS_TO_TICKS(flushing ? 1 : 1000 / params.drain_rate + 1) : pdMS_TO_TICKS(1000);
+            xEventGroupWaitBits(app_drain_event_group, APP_DRAIN_BIT_KICK, pdTRUE, pdFALSE, wait_ticks);
+        }
+    }
+}
+
+/**
+ * @brief 初始化函数，必须在 MQTT 初始化之前调用。
+ * @return
+ */
+esp_err_t app_drain_init(void) {
+    app_drain_event_group = xEventGroupCreate();
+    if (app_drain_event_group == NULL) {
+        return ESP_FAIL;
+    }
+    BaseType_t ret = xTaskCreate(app_drain_task, "app_drain_task", 4096, NULL, 1, NULL);// 优先级 1，和主循环相同，实时消息由在途检查优先。
+    return ret == pdPASS ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,81 @@
+/**
+ * @brief   缓存推送任务，限速推送 SD 卡缓存和日志备份文件。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+ /**
+  * @brief 缓存推送统计数据。
+  */
+typedef struct {
+    uint32_t pub_total;         // 启动以后推送的缓存条数。
+    uint32_t pub_rate;          // 最近一个统计周期的推送速度，条/分钟。
+    uint32_t remaining;         // 剩余未推送的缓存字节数。
+} app_drain_stats_t;
+
+/**
+ * @brief MQTT 已连接，开始推送。
+ */
+void app_drain_notify_connected(void);
+
+/**
+ * @brief MQTT 断开连接，暂停推送。
+ */
+void app_drain_notify_disconnected(void);
+
+/**
+ * @brief 收到 PUBACK，在途窗口有空位，唤醒推送任务。
+ */
+void app_drain_kick(void);
+
+/**
+ * @brief 收到 PUBACK，请求提交缓存位置。由 MQTT 事件任务调用，提交写 SD 卡，交给推送任务执行，断开连接时也提交。
+ */
+void app_drain_request_commit(void);
+
+/**
+ * @brief outbox 转存了实时消息，请求写入缓存。由持有 MQTT 客户端锁的转存回调调用，写 SD 卡交给推送任务执行，断开连接时也执行。
+ */
+void app_drain_request_spill(void);
+
+/**
+ * @brief 等待 PUBACK 或重连事件，由推送任务中的日志上传调用。
+ * @param timeout_ms
+ */
+void app_drain_wait_kick(uint32_t timeout_ms);
+
+/**
+ * @brief 请求上传当前日志，连接以后由推送任务执行。
+ */
+void app_drain_request_log(void);
+
+/**
+ * @brief 请求补传一段时间内的缓存记录，连接以后由推送任务按时间索引查询并发送，完成后发送应答。
+ *        新的请求覆盖还没开始的请求。
+ * @param id 控制命令 ID，原样返回到应答。
+ * @param t1 开始时间，UTC 秒。
+ * @param t2 结束时间，UTC 秒。
+ */
+void app_drain_request_query(int id, uint32_t t1, uint32_t t2);
+
+/**
+ * @brief 不限速、不给实时消息让路，推送全部缓存，推送完恢复限速。
+ */
+void app_drain_flush(void);
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_drain_get_stats(app_drain_stats_t* stats);
+
+/**
+ * @brief 初始化函数，必须在 MQTT 初始化之前调用。
+ * @return
+ */
+esp_err_t app_drain_init(void);
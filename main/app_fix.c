@@ -0,0 +1,376 @@
+/**
+ * @brief   最近定位记录的 PSRAM 环形缓冲区。主循环单线程写入，其它任务无锁读取，不访问 SD 卡。
+ *          后台任务把新记录按大块顺序追加到 SD 卡，定位记录文件写满以后归档，交给保留策略管理。
+ *
+ *          每个槽位带序号，写入者先把序号清零，写完记录再写入序号，最后移动写位置。
+ *          读取者读取前后比较序号，不相同说明读取期间槽位被覆盖，丢弃这条记录。
+ *          写位置一直增加，取模得到槽位，位置 + 1 作为序号，0 表示正在写入。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+#include "app_sd.h"
+#include "app_fix.h"
+#include "app_retain.h"
+#include "app_config.h"
+
+ /**
+ * @brief 定位记录文件，写满以后重命名为 LOG/Fnnnnnnn.BIN，nnnnnnn 是最后一条记录的 UTC 分钟数。
+ */
+#define APP_FIX_BIN                 APP_SD_LOG_DIR"/FIX.BIN"
+#define APP_FIX_ARCHIVE_BIN         APP_SD_LOG_DIR"/F%07lX.BIN"
+
+_Static_assert(sizeof(app_fix_t) == 20, "app_fix_t");
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_fix";
+
+/**
+ * @brief 槽位，序号 = 位置 + 1，0 表示正在写入。
+ */
+typedef struct {
+    _Atomic uint32_t seq;
+    app_fix_t fix;
+} app_fix_slot_t;
+
+/**
+ * @brief 环形缓冲区和写位置。
+ */
+static app_fix_slot_t* app_fix_ring = NULL;
+static _Atomic uint32_t app_fix_pos = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 后台任务使用：定位记录文件、已写入的位置、写入缓冲区、文件中第一条记录的时间。
+ */
+static FILE* app_fix_file = NULL;
+static _Atomic uint32_t app_fix_flushed = ATOMIC_VAR_INIT(0);
+static app_fix_t* app_fix_batch = NULL;
+static uint32_t app_fix_file_t0 = 0;
+
+/**
+ * @brief 已经唤醒后台任务，后台任务处理完清除，避免重复唤醒。
+ */
+static _Atomic int app_fix_kicked = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 同步请求和完成信号。
+ */
+static _Atomic int app_fix_sync_req = ATOMIC_VAR_INIT(0);
+static SemaphoreHandle_t app_fix_sync_sem = NULL;
+static TaskHandle_t app_fix_task_handle = NULL;
+
+/**
+ * @brief 统计数据。
+ */
+static _Atomic uint32_t app_fix_flushed_total = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_fix_dropped = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_fix_flush_ms = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_fix_find_us = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_fix_read_us = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 最旧的还没有被覆盖的位置。
+ */
+static inline uint32_t app_fix_oldest(uint32_t head) {
+    return head > APP_FIX_RING_SLOTS ? head - APP_FIX_RING_SLOTS : 0;
+}
+
+/**
+ * @brief 读取一个槽位。
+ * @return true 成功，false 已经被覆盖或者正在写入。
+ */
+static bool app_fix_load(uint32_t pos, app_fix_t* fix) {
+    app_fix_slot_t* slot = &app_fix_ring[pos % APP_FIX_RING_SLOTS];
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq != pos + 1) {
+        return false;
+    }
+    memcpy(fix, &slot->fix, sizeof(app_fix_t));
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq;
+}
+
+/**
+ * @brief 写入一条记录，只能由主循环调用。
+ * @param fix
+ */
+void app_fix_push(const app_fix_t* fix) {
+    if (app_fix_ring == NULL) {
+        return;
+    }
+    uint32_t pos = atomic_load_explicit(&app_fix_pos, memory_order_relaxed);
+    app_fix_slot_t* slot = &app_fix_ring[pos % APP_FIX_RING_SLOTS];
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&slot->fix, fix, sizeof(app_fix_t));
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    atomic_store_explicit(&app_fix_pos, pos + 1, memory_order_release);
+    if (app_fix_task_handle != NULL && pos + 1 - atomic_load(&app_fix_flushed) >= APP_FIX_FLUSH_RECORDS
+        && atomic_exchange(&app_fix_kicked, 1) == 0) {// 攒够一块，提前唤醒后台任务。
+        xTaskNotifyGive(app_fix_task_handle);
+    }
+}
+
+/**
+ * @brief 写入位置，即启动以后写入的条数。
+ * @return
+ */
+uint32_t app_fix_head(void) {
+    return atomic_load_explicit(&app_fix_pos, memory_order_acquire);
+}
+
+/**
+ * @brief 读取最新的一条记录。
+ * @param fix
+ * @return true 成功，false 没有记录。
+ */
+bool app_fix_latest(app_fix_t* fix) {
+    if (app_fix_ring == NULL) {
+        return false;
+    }
+    uint32_t head = app_fix_head();
+    return head > 0 && app_fix_load(head - 1, fix);
+}
+
+/**
+ * @brief 从指定位置开始顺序读取，位置已经被覆盖时从最旧的记录开始。
+ * @param pos 输入开始位置，输出下一次读取的位置。
+ * @param out
+ * @param max 最多读取条数。
+ * @return 读取条数。
+ */
+int app_fix_read(uint32_t* pos, app_fix_t* out, int max) {
+    if (app_fix_ring == NULL) {
+        return 0;
+    }
+    int64_t start = esp_timer_get_time();
+    uint32_t head = app_fix_head();
+    int count = 0;
+    while (count < max && *pos < head) {
+        uint32_t oldest = app_fix_oldest(app_fix_head());
+        if (*pos < oldest) {// 读取期间被覆盖，跳到最旧的记录。
+            *pos = oldest;
+            continue;
+        }
+        if (app_fix_load(*pos, &out[count])) {
+            count++;
+        }
+        (*pos)++;
+    }
+    atomic_store(&app_fix_read_us, (uint32_t)(esp_timer_get_time() - start));
+    return count;
+}
+
+/**
+ * @brief 二分查找第一条时间不早于 ts 的记录。记录按写入顺序排列，时间同步之前的记录 ts = 0，排在前面。
+ * @param ts UTC 秒。
+ * @return 位置，等于 app_fix_head() 表示没有。
+ */
+uint32_t app_fix_find(uint32_t ts) {
+    if (app_fix_ring == NULL) {
+        return 0;
+    }
+    int64_t start = esp_timer_get_time();
+    uint32_t hi = app_fix_head();
+    uint32_t lo = app_fix_oldest(hi);
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        app_fix_t fix;
+        if (!app_fix_load(mid, &fix) || fix.ts < ts) {// 已经被覆盖的记录比剩下的都旧。
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    atomic_store(&app_fix_find_us, (uint32_t)(esp_timer_get_time() - start));
+    return lo;
+}
+
+/**
+ * @brief 定位记录文件写满，重命名归档，打开新文件。
+ */
+static void app_fix_rotate(uint32_t ts) {
+    fclose(app_fix_file);
+    app_fix_file = NULL;
+    char path[32];
+    uint32_t n = ts / 60;
+    do {// 同一分钟重复归档时顺延。
+        snprintf(path, sizeof(path), APP_FIX_ARCHIVE_BIN, n++ & 0x0FFFFFFFUL);
+    } while (access(path, F_OK) == 0);
+    if (rename(APP_FIX_BIN, path) == 0) {
+        ESP_LOGI(TAG, "------ 定位记录文件归档：%s", path);
+        app_retain_add(path, app_fix_file_t0, true);// 只保存在本地，没有上传，按保留策略删除。
+    } else {
+        ESP_LOGE(TAG, "------ 定位记录文件归档：失败！文件名：%s", path);
+    }
+    app_fix_file_t0 = 0;
+    app_fix_file = fopen(APP_FIX_BIN, "ab");
+}
+
+/**
+ * @brief 把新记录按块写入文件。
+ * @return 写入条数。
+ */
+static uint32_t app_fix_drain(void) {
+    uint32_t oldest = app_fix_oldest(app_fix_head());
+    uint32_t pos = atomic_load(&app_fix_flushed);
+    if (pos < oldest) {// SD 卡太慢，没来得及写入的记录已经被覆盖。
+        atomic_fetch_add(&app_fix_dropped, oldest - pos);
+        pos = oldest;
+    }
+    uint32_t total = 0;
+    uint32_t last_ts = 0;
+    while (1) {
+        int n = app_fix_read(&pos, app_fix_batch, APP_FIX_FLUSH_RECORDS);
+        if (n > 0 && fwrite(app_fix_batch, sizeof(app_fix_t), n, app_fix_file) != (size_t)n) {
+            ESP_LOGE(TAG, "------ 定位记录写入 SD 卡：失败！");
+            break;
+        }
+        for (int i = 0; i < n && app_fix_file_t0 == 0; i++) {
+            app_fix_file_t0 = app_fix_batch[i].ts;
+        }
+        if (n > 0) {
+            last_ts = app_fix_batch[n - 1].ts;
+        }
+        total += n;
+        atomic_store(&app_fix_flushed, pos);
+        if (n < APP_FIX_FLUSH_RECORDS) {
+            break;
+        }
+    }
+    if (total > 0) {
+        fflush(app_fix_file);
+        fsync(fileno(app_fix_file));
+        if (ftell(app_fix_file) >= APP_FIX_FILE_MAX) {
+            app_fix_rotate(last_ts);
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief 后台任务，定时或者攒够一块时写入 SD 卡。
+ * @param param
+ */
+static void app_fix_task(void* param) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(APP_FIX_FLUSH_PERIOD));
+        atomic_store(&app_fix_kicked, 0);
+        bool sync = atomic_exchange(&app_fix_sync_req, 0) != 0;
+        if (app_fix_file != NULL) {
+            uint32_t start = esp_log_timestamp();
+            uint32_t n = app_fix_drain();
+            if (n > 0) {
+                atomic_fetch_add(&app_fix_flushed_total, n);
+                atomic_store(&app_fix_flush_ms, esp_log_timestamp() - start);
+            }
+        }
+        if (sync) {
+            xSemaphoreGive(app_fix_sync_sem);
+        }
+    }
+}
+
+/**
+ * @brief 把缓冲区中的记录写入 SD 卡并执行 fsync()，等待完成。断电之前调用，不能在后台任务中调用。
+ * @param timeout_ms
+ */
+void app_fix_sync(uint32_t timeout_ms) {
+    if (app_fix_task_handle == NULL) {
+        return;
+    }
+    xSemaphoreTake(app_fix_sync_sem, 0);// 清除上次超时以后才到的信号。
+    atomic_store(&app_fix_sync_req, 1);
+    xTaskNotifyGive(app_fix_task_handle);
+    if (xSemaphoreTake(app_fix_sync_sem, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        ESP_LOGW(TAG, "------ 定位记录写入 SD 卡：超时！");
+    }
+}
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_fix_get_stats(app_fix_stats_t* stats) {
+    stats->slots = APP_FIX_RING_SLOTS;
+    stats->bytes = app_fix_ring == NULL ? 0 : APP_FIX_RING_SLOTS * sizeof(app_fix_slot_t);
+    stats->head = app_fix_head();
+    stats->flushed = atomic_load(&app_fix_flushed_total);
+    stats->dropped = atomic_load(&app_fix_dropped);
+    stats->flush_ms = atomic_load(&app_fix_flush_ms);
+    stats->find_us = atomic_load(&app_fix_find_us);
+    stats->read_us = atomic_load(&app_fix_read_us);
+}
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_fix_log(void) {
+    if (app_fix_ring == NULL) {
+        return;
+    }
+    app_fix_stats_t stats;
+    app_fix_get_stats(&stats);
+    ESP_LOGI(TAG, "------ 定位记录缓冲区，容量：%lu 条，占用 PSRAM：%lu 字节，写入：%lu 条，写入 SD 卡：%lu 条，丢弃：%lu 条，耗时：写入 %lu 毫秒，查找 %lu 微秒，读取 %lu 微秒",
+        stats.slots, stats.bytes, stats.head, stats.flushed, stats.dropped, stats.flush_ms, stats.find_us, stats.read_us);
+}
+
+/**
+ * @brief 打开定位记录文件，截断掉电时写了一半的记录。
+ */
+static FILE* app_fix_open_file(void) {
+    struct stat st;
+    if (stat(APP_FIX_BIN, &st) == 0 && st.st_size % sizeof(app_fix_t) != 0) {
+        ESP_LOGW(TAG, "------ 定位记录文件截断不完整的记录，大小：%ld", st.st_size);
+        truncate(APP_FIX_BIN, st.st_size - st.st_size % sizeof(app_fix_t));
+    }
+    return fopen(APP_FIX_BIN, "ab");
+}
+
+/**
+ * @brief 初始化函数，SD 卡初始化以后调用。SD 卡不可用时只保存在内存中。
+ * @param sd SD 卡是否可用。
+ * @return
+ */
+esp_err_t app_fix_init(bool sd) {
+    if (app_fix_ring != NULL) {
+        return ESP_OK;
+    }
+    app_fix_slot_t* ring = heap_caps_calloc(APP_FIX_RING_SLOTS, sizeof(app_fix_slot_t), MALLOC_CAP_SPIRAM);
+    if (ring == NULL) {
+        ESP_LOGE(TAG, "------ 定位记录缓冲区初始化：失败。PSRAM 不足：%u 字节", APP_FIX_RING_SLOTS * sizeof(app_fix_slot_t));
+        return ESP_ERR_NO_MEM;
+    }
+    if (sd) {
+        app_fix_batch = heap_caps_malloc(APP_FIX_FLUSH_RECORDS * sizeof(app_fix_t), MALLOC_CAP_SPIRAM);
+        app_fix_sync_sem = xSemaphoreCreateBinary();
+        app_fix_file = app_fix_open_file();
+        if (app_fix_batch == NULL || app_fix_sync_sem == NULL || app_fix_file == NULL
+            || xTaskCreate(app_fix_task, "app_fix_task", 3072, NULL, 1, &app_fix_task_handle) != pdPASS) {// 优先级 1，SD 卡慢不影响其它任务。
+            ESP_LOGE(TAG, "------ 定位记录写入 SD 卡：失败！只保存在内存中。");
+            if (app_fix_file != NULL) {
+                fclose(app_fix_file);
+                app_fix_file = NULL;
+            }
+        }
+    }
+    app_fix_ring = ring;
+    ESP_LOGI(TAG, "------ 定位记录缓冲区初始化：完成。容量：%lu 条，每条 %u 字节，占用 PSRAM：%u 字节",
+        (uint32_t)APP_FIX_RING_SLOTS, sizeof(app_fix_slot_t), APP_FIX_RING_SLOTS * sizeof(app_fix_slot_t));
+    return ESP_OK;
+}
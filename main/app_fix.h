@@ -0,0 +1,104 @@
+/**
+ * @brief   最近定位记录的 PSRAM 环形缓冲区。主循环单线程写入，其它任务无锁读取，不访问 SD 卡。
+ *          后台任务把新记录按大块顺序追加到 SD 卡，定位记录文件写满以后归档，交给保留策略管理。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+ /**
+  * @brief 记录标志。
+  */
+#define APP_FIX_FLAG_VALID          0x01        // 定位有效。
+
+ /**
+  * @brief 紧凑的定位记录，20 字节，SD 卡文件中按这个格式顺序存放，小端。
+  */
+typedef struct {
+    uint32_t ts;                // 设备时间，UTC 秒，0 = 时间没有同步。
+    int32_t lat;                // 纬度，1e-7 度。
+    int32_t lon;                // 经度，1e-7 度。
+    int16_t alt;                // 高度，米。
+    uint16_t spd;               // 速度，0.01 节。
+    uint16_t trk;               // 航向，0.01 度。
+    uint8_t sat;                // 卫星数。
+    uint8_t flags;              // APP_FIX_FLAG_*
+} app_fix_t;
+
+ /**
+  * @brief 统计数据。
+  */
+typedef struct {
+    uint32_t slots;             // 容量，条。
+    uint32_t bytes;             // PSRAM 占用字节数。
+    uint32_t head;              // 启动以后写入的条数。
+    uint32_t flushed;           // 写入 SD 卡的条数。
+    uint32_t dropped;           // 没来得及写入 SD 卡就被覆盖的条数。
+    uint32_t flush_ms;          // 最近一次写入 SD 卡的耗时，包括 fsync()，毫秒。
+    uint32_t find_us;           // 最近一次按时间查找的耗时，微秒。
+    uint32_t read_us;           // 最近一次顺序读取的耗时，微秒。
+} app_fix_stats_t;
+
+/**
+ * @brief 写入一条记录，只能由主循环调用。
+ * @param fix
+ */
+void app_fix_push(const app_fix_t* fix);
+
+/**
+ * @brief 写入位置，即启动以后写入的条数。
+ * @return
+ */
+uint32_t app_fix_head(void);
+
+/**
+ * @brief 读取最新的一条记录。
+ * @param fix
+ * @return true 成功，false 没有记录。
+ */
+bool app_fix_latest(app_fix_t* fix);
+
+/**
+ * @brief 从指定位置开始顺序读取，位置已经被覆盖时从最旧的记录开始。
+ * @param pos 输入开始位置，输出下一次读取的位置。
+ * @param out
+ * @param max 最多读取条数。
+ * @return 读取条数。
+ */
+int app_fix_read(uint32_t* pos, app_fix_t* out, int max);
+
+/**
+ * @brief 二分查找第一条时间不早于 ts 的记录。记录按写入顺序排列，时间同步之前的记录 ts = 0，排在前面。
+ * @param ts UTC 秒。
+ * @return 位置，等于 app_fix_head() 表示没有。
+ */
+uint32_t app_fix_find(uint32_t ts);
+
+/**
+ * @brief 把缓冲区中的记录写入 SD 卡并执行 fsync()，等待完成。断电之前调用，不能在后台任务中调用。
+ * @param timeout_ms
+ */
+void app_fix_sync(uint32_t timeout_ms);
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_fix_get_stats(app_fix_stats_t* stats);
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_fix_log(void);
+
+/**
+ * @brief 初始化函数，SD 卡初始化以后调用。SD 卡不可用时只保存在内存中。
+ * @param sd SD 卡是否可用。
+ * @return
+ */
+esp_err_t app_fix_init(bool sd);
@@ -9,6 +9,8 @@
 #include "driver/gpio.h"
 
 #include "app_config.h"
+#include "app_cache.h"
+#include "app_fix.h"
 
  /**
  * @brief 日志 TAG。
@@ -40,6 +42,8 @@ int app_gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
  */
 void app_gpio_power_reset(void) {
     ESP_LOGE(TAG, "------ GPIO 重置外部电源。");
+    app_cache_flush();// 缓存日志没有 fsync 的记录。
+    app_fix_sync(1000);// 定位记录缓冲区中还没写入 SD 卡的记录。
     app_gpio_set_level(APP_GPIO_NUM_POWER_RESET, 1);// 继电器控制脚接通，常闭端端断开，开发板断电，常闭端恢复。
     vTaskDelay(pdMS_TO_TICKS(1000));// 理论上来说，以下代码都不会被执行。因为没电了...
     app_gpio_set_level(APP_GPIO_NUM_POWER_RESET, 0);
@@ -0,0 +1,243 @@
+/**
+ * @brief   WIFI 热点上的 HTTP 服务，按时间范围从缓存日志导出轨迹，GPX 或者 CSV 格式。
+ *
+ *          GET /track?fmt=gpx|csv&t1=<UTC 秒>&t2=<UTC 秒>，省略 t1、t2 时导出最近 APP_HTTP_EXPORT_RANGE 秒。
+ *          按段头中的时间索引读取缓存日志，逐条转换，攒满一个固定大小的缓冲区就用分块传输编码发送，
+ *          不缓存整个文件，内存占用和导出的时间范围无关。
+ *          只接受从热点连接的请求，4G 网络上的地址不提供服务。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <time.h>
+#include "lwip/sockets.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_netif.h"
+#include "esp_http_server.h"
+
+#include "app_http.h"
+#include "app_cache.h"
+#include "app_json.h"
+#include "app_fix.h"
+#include "app_config.h"
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_http";
+
+/**
+ * @brief 导出状态。
+ */
+typedef struct {
+    httpd_req_t* req;
+    bool gpx;
+    uint32_t t1;
+    uint32_t t2;
+    char* buf;                  // 发送缓冲区，APP_HTTP_CHUNK_SIZE 字节。
+    int len;
+    bool failed;                // 发送失败，客户端断开。
+    uint32_t records;           // 读取的记录数。
+    uint32_t points;            // 导出的点数。
+    uint32_t bytes;             // 发送的字节数。
+} app_http_export_t;
+
+/**
+ * @brief 发送缓冲区中的数据，一个 HTTP 分块。
+ */
+static bool app_http_flush(app_http_export_t* export) {
+    if (export->failed) {
+        return false;
+    }
+    if (export->len > 0) {
+        if (httpd_resp_send_chunk(export->req, export->buf, export->len) != ESP_OK) {
+            ESP_LOGW(TAG, "------ 导出轨迹发送：失败！客户端断开。");
+            export->failed = true;
+            return false;
+        }
+        export->bytes += export->len;
+        export->len = 0;
+    }
+    return true;
+}
+
+/**
+ * @brief 格式化输出到发送缓冲区，空间不足时先发送。
+ */
+static bool app_http_printf(app_http_export_t* export, const char* fmt, ...) {
+    for (int i = 0; i < 2; i++) {
+        va_list args;
+        va_start(args, fmt);
+        int room = APP_HTTP_CHUNK_SIZE - export->len;
+        int n = vsnprintf(export->buf + export->len, room, fmt, args);
+        va_end(args);
+        if (n < room) {
+            export->len += n;
+            return true;
+        }
+        if (!app_http_flush(export)) {
+            return false;
+        }
+    }
+    return false;// 一行超过缓冲区大小，不会出现。
+}
+
+/**
+ * @brief 缓存日志查询回调函数，转换一条记录。索引按数据块过滤，这里按记录时间精确过滤。
+ */
+static bool app_http_export_cb(char* data, int len, void* arg) {
+    app_http_export_t* export = arg;
+    export->records++;
+    app_fix_t fix;
+    if (!app_json_get_fix(data, &fix) || fix.ts == 0 || fix.ts < export->t1 || fix.ts > export->t2) {
+        return true;
+    }
+    if (export->gpx && (fix.flags & APP_FIX_FLAG_VALID) == 0) {// GPX 只导出有效定位。
+        return true;
+    }
+    char time_str[24];
+    time_t t = fix.ts;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    export->points++;
+    if (export->gpx) {
+        return app_http_printf(export, "<trkpt lat=\"%.7f\" lon=\"%.7f\"><ele>%d</ele><time>%s</time><sat>%u</sat></trkpt>\n",
+            fix.lat / 1e7, fix.lon / 1e7, fix.alt, time_str, fix.sat);
+    }
+    return app_http_printf(export, "%s,%.7f,%.7f,%d,%.2f,%.2f,%u,%d\n",
+        time_str, fix.lat / 1e7, fix.lon / 1e7, fix.alt, fix.spd / 100.0, fix.trk / 100.0, fix.sat, (fix.flags & APP_FIX_FLAG_VALID) != 0);
+}
+
+/**
+ * @brief 请求是否来自热点，比较连接的本地地址和热点地址。
+ */
+static bool app_http_from_ap(httpd_req_t* req) {
+    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
+    esp_netif_ip_info_t ip_info;
+    if (netif == NULL || esp_netif_get_ip_info(netif, &ip_info) != ESP_OK) {
+        return false;
+    }
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    if (getsockname(httpd_req_to_sockfd(req), (struct sockaddr*)&addr, &addr_len) != 0) {
+        return false;
+    }
+    uint32_t local;
+    if (addr.ss_family == AF_INET) {
+        local = ((struct sockaddr_in*)&addr)->sin_addr.s_addr;
+    } else if (addr.ss_family == AF_INET6) {// IPv4 映射地址，后 4 字节是 IPv4 地址。
+        memcpy(&local, &((struct sockaddr_in6*)&addr)->sin6_addr.s6_addr[12], sizeof(local));
+    } else {
+        return false;
+    }
+    return local == ip_info.ip.addr;
+}
+
+/**
+ * @brief GET /track 请求处理函数。
+ */
+static esp_err_t app_http_track_handler(httpd_req_t* req) {
+    if (!app_http_from_ap(req)) {
+        httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "hotspot only");
+        return ESP_FAIL;
+    }
+    app_http_export_t export = {
+        .req = req,
+        .gpx = true,
+        .t2 = time(NULL),
+    };
+    export.t1 = export.t2 > APP_HTTP_EXPORT_RANGE ? export.t2 - APP_HTTP_EXPORT_RANGE : 0;
+    char query[96];
+    char value[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "fmt", value, sizeof(value)) == ESP_OK) {
+            if (strcmp(value, "csv") == 0) {
+                export.gpx = false;
+            } else if (strcmp(value, "gpx") != 0) {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "fmt: gpx or csv");
+                return ESP_FAIL;
+            }
+        }
+        if (httpd_query_key_value(query, "t1", value, sizeof(value)) == ESP_OK) {
+            export.t1 = strtoul(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "t2", value, sizeof(value)) == ESP_OK) {
+            export.t2 = strtoul(value, NULL, 10);
+        }
+    }
+    if (export.t2 < export.t1) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "t2 < t1");
+        return ESP_FAIL;
+    }
+    export.buf = malloc(APP_HTTP_CHUNK_SIZE);
+    if (export.buf == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "no memory");
+        return ESP_FAIL;
+    }
+    char disposition[64];
+    snprintf(disposition, sizeof(disposition), "attachment; filename=\"track_%lu_%lu.%s\"",
+        export.t1, export.t2, export.gpx ? "gpx" : "csv");
+    httpd_resp_set_type(req, export.gpx ? "application/gpx+xml" : "text/csv");
+    httpd_resp_set_hdr(req, "Content-Disposition", disposition);
+    int64_t start = esp_timer_get_time();
+    if (export.gpx) {
+        app_http_printf(&export, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<gpx version=\"1.1\" creator=\"esp32s3_4g_iot\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n"
+            "<trk><name>%lu-%lu</name><trkseg>\n", export.t1, export.t2);
+    } else {
+        app_http_printf(&export, "time,lat,lon,alt,spd,trk,sat,valid\n");
+    }
+    int ret = app_cache_query(export.t1, export.t2, app_http_export_cb, &export);
+    if (ret == -1 && export.bytes == 0) {// 还没有发送，可以返回错误状态。
+        free(export.buf);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "cache query failed");
+        return ESP_FAIL;
+    }
+    if (export.gpx) {
+        app_http_printf(&export, "</trkseg></trk>\n</gpx>\n");
+    }
+    app_http_flush(&export);
+    if (!export.failed) {
+        httpd_resp_send_chunk(req, NULL, 0);// 最后一个空分块，结束响应。
+    }
+    free(export.buf);
+    uint32_t us = esp_timer_get_time() - start;
+    ESP_LOGI(TAG, "------ 导出轨迹：%s，时间：%lu - %lu，记录数：%lu，点数：%lu，字节数：%lu，耗时：%lu 毫秒，吞吐量：%.3f MB/s%s",
+        export.gpx ? "GPX" : "CSV", export.t1, export.t2, export.records, export.points, export.bytes, us / 1000,
+        us == 0 ? 0.0 : (double)export.bytes / us, export.failed ? "，客户端断开" : "");
+    return export.failed ? ESP_FAIL : ESP_OK;
+}
+
+/**
+ * @brief 初始化函数，WIFI 热点初始化以后调用。
+ * @return
+ */
+esp_err_t app_http_init(void) {
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = APP_HTTP_PORT;
+    config.stack_size = 6144;
+    config.task_priority = 2;// 低于主循环和 MQTT，导出读取 SD 卡不影响上报。
+    config.max_open_sockets = 2;
+    config.lru_purge_enable = true;
+    httpd_handle_t server = NULL;
+    esp_err_t ret = httpd_start(&server, &config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "------ HTTP 服务启动：失败！%s", esp_err_to_name(ret));
+        return ret;
+    }
+    httpd_uri_t track_uri = {
+        .uri = "/track",
+        .method = HTTP_GET,
+        .handler = app_http_track_handler,
+    };
+    httpd_register_uri_handler(server, &track_uri);
+    ESP_LOGI(TAG, "------ HTTP 服务启动：完成。端口：%d，导出轨迹：GET /track?fmt=gpx|csv&t1=&t2=", APP_HTTP_PORT);
+    return ESP_OK;
+}
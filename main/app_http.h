@@ -0,0 +1,15 @@
+/**
+ * @brief   WIFI 热点上的 HTTP 服务，按时间范围从缓存日志导出轨迹，GPX 或者 CSV 格式。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include "esp_err.h"
+
+/**
+ * @brief 初始化函数，WIFI 热点初始化以后调用。
+ * @return
+ */
+esp_err_t app_http_init(void);
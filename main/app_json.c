@@ -5,9 +5,14 @@
  * @date    2024-07-12
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
 
 #include "app_main.h"
+#include "app_fix.h"
 
 void app_json_serialize(char* buffer, size_t buffer_size, const app_main_data_t* data) {
 
@@ -29,4 +34,95 @@ void app_json_serialize(char* buffer, size_t buffer_size, const app_main_data_t*
         data->trk,
         data->mag
     );
-}
\ No newline at end of file
+}
+
+ /**
+ * @brief 早于这个时间视为没有同步，2024-01-01。
+ */
+#define APP_JSON_TIME_VALID         1704067200
+
+/**
+ * @brief 读取时间字段 "YYYYMMDDhhmmssmmm"，转换为 UTC 秒。
+ */
+static uint32_t app_json_parse_time(const char* json, const char* key) {
+    const char* p = strstr(json, key);
+    if (p == NULL) {
+        return 0;
+    }
+    p += strlen(key);
+    int f[6];
+    static const int width[6] = { 4, 2, 2, 2, 2, 2 };
+    for (int i = 0; i < 6; i++) {
+        f[i] = 0;
+        for (int j = 0; j < width[i]; j++, p++) {
+            if (*p < '0' || *p > '9') {
+                return 0;
+            }
+            f[i] = f[i] * 10 + (*p - '0');
+        }
+    }
+    int y = f[0] - (f[1] <= 2);// 按 3 月开始的年份计算天数，闰日在年末。
+    int m = f[1];
+    if (m < 1 || m > 12 || f[2] < 1 || f[2] > 31) {
+        return 0;
+    }
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + f[2] - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+    int64_t t = days * 86400 + f[3] * 3600 + f[4] * 60 + f[5];
+    return t >= APP_JSON_TIME_VALID && t <= UINT32_MAX ? (uint32_t)t : 0;
+}
+
+/**
+ * @brief 读取记录时间 devTime，设备时间没有同步时用 gnssTime。
+ * @param json app_json_serialize() 输出的记录。
+ * @return UTC 秒，0 = 没有有效时间。
+ */
+uint32_t app_json_get_time(const char* json) {
+    uint32_t t = app_json_parse_time(json, "\"devTime\":\"");
+    return t != 0 ? t : app_json_parse_time(json, "\"gnssTime\":\"");
+}
+
+/**
+ * @brief 读取数值字段。
+ */
+static bool app_json_parse_number(const char* json, const char* key, double* value) {
+    const char* p = strstr(json, key);
+    if (p == NULL) {
+        return false;
+    }
+    p += strlen(key);
+    char* end;
+    *value = strtod(p, &end);
+    return end != p;
+}
+
+/**
+ * @brief 读取定位字段，转换为紧凑的定位记录，按时间导出轨迹时使用。
+ * @param json app_json_serialize() 输出的记录。
+ * @param fix
+ * @return false 没有经纬度字段。
+ */
+bool app_json_get_fix(const char* json, app_fix_t* fix) {
+    double lat, lon;
+    double alt = 0, spd = 0, trk = 0, sat = 0, valid = 0;
+    if (!app_json_parse_number(json, "\"lat\":", &lat) || !app_json_parse_number(json, "\"lon\":", &lon)) {
+        return false;
+    }
+    app_json_parse_number(json, "\"alt\":", &alt);
+    app_json_parse_number(json, "\"spd\":", &spd);
+    app_json_parse_number(json, "\"trk\":", &trk);
+    app_json_parse_number(json, "\"sat\":", &sat);
+    app_json_parse_number(json, "\"gnssValid\":", &valid);
+    fix->ts = app_json_get_time(json);
+    fix->lat = lround(lat * 1e7);
+    fix->lon = lround(lon * 1e7);
+    fix->alt = alt < -32768 ? -32768 : alt > 32767 ? 32767 : lround(alt);
+    fix->spd = spd < 0 ? 0 : spd > 655.35 ? 65535 : lround(spd * 100);
+    fix->trk = trk < 0 ? 0 : trk > 655.35 ? 65535 : lround(trk * 100);
+    fix->sat = sat < 0 ? 0 : sat > 255 ? 255 : sat;
+    fix->flags = valid != 0 ? APP_FIX_FLAG_VALID : 0;
+    return true;
+}
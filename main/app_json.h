@@ -6,6 +6,23 @@
  */
 #pragma once
 
+#include <stdbool.h>
 #include "app_main.h"
+#include "app_fix.h"
 
-char* app_json_serialize(char* buffer, size_t buffer_size, const app_main_data_t* data);
\ No newline at end of file
+char* app_json_serialize(char* buffer, size_t buffer_size, const app_main_data_t* data);
+
+/**
+ * @brief 读取记录时间 devTime，设备时间没有同步时用 gnssTime。
+ * @param json app_json_serialize() 输出的记录。
+ * @return UTC 秒，0 = 没有有效时间。
+ */
+uint32_t app_json_get_time(const char* json);
+
+/**
+ * @brief 读取定位字段，转换为紧凑的定位记录，按时间导出轨迹时使用。
+ * @param json app_json_serialize() 输出的记录。
+ * @param fix
+ * @return false 没有经纬度字段。
+ */
+bool app_json_get_fix(const char* json, app_fix_t* fix);
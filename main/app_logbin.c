@@ -0,0 +1,155 @@
+/**
+ * @brief   二进制日志记录。ESP_LOGx() 的格式字符串是 flash 中的常量，地址就是格式 ID，
+ *          SD 卡和 MQTT 只保存格式 ID 和二进制参数，主机上用 tools/logdecode.py 按 ELF 文件还原文本。
+ *
+ *          按格式字符串的转换说明读取参数，和 vprintf() 的读取顺序、类型相同，解码工具用同样的规则。
+ *          ESP32-S3 上 int、long、size_t、指针都是 4 字节。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <string.h>
+#include <stdbool.h>
+#include "esp_memory_utils.h"
+#include "esp_app_desc.h"
+
+#include "app_logbin.h"
+
+ /**
+ * @brief 文件头标识。
+ */
+#define APP_LOGBIN_MAGIC            "LBIN"
+
+/**
+ * @brief 写入参数，buf 为 NULL 时只计算长度。
+ */
+static inline void app_logbin_put(uint8_t* buf, int* off, const void* data, size_t len) {
+    if (buf != NULL) {
+        memcpy(buf + *off, data, len);
+    }
+    *off += len;
+}
+
+/**
+ * @brief 编码一条日志，包括记录头。
+ * @param buf NULL 只计算长度。
+ * @param fmt 格式字符串，必须在 flash 中。
+ * @param args 会被读取，调用者传入副本。
+ * @return 记录字节数，-1 格式字符串不在 flash 中，不能编码。
+ */
+int app_logbin_encode(uint8_t* buf, const char* fmt, va_list args) {
+    if (!esp_ptr_in_drom(fmt)) {
+        return -1;
+    }
+    int off = APP_LOGBIN_HDR_SIZE;
+    uint32_t id = (uintptr_t)fmt;
+    app_logbin_put(buf, &off, &id, sizeof(id));
+    for (const char* p = fmt; *p != '\0'; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            continue;
+        }
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+            p++;
+        }
+        if (*p == '*') {
+            int width = va_arg(args, int);
+            app_logbin_put(buf, &off, &width, sizeof(width));
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+        int precision = -1;
+        if (*p == '.') {
+            p++;
+            precision = 0;
+            if (*p == '*') {
+                precision = va_arg(args, int);
+                app_logbin_put(buf, &off, &precision, sizeof(precision));
+                p++;
+            }
+            while (*p >= '0' && *p <= '9') {
+                precision = precision * 10 + (*p - '0');
+                p++;
+            }
+        }
+        bool wide = false;// long long、intmax_t 8 字节，其它整数 4 字节。
+        while (*p == 'h' || *p == 'l' || *p == 'z' || *p == 'j' || *p == 't' || *p == 'L') {
+            wide |= (*p == 'l' && p[1] == 'l') || *p == 'j';
+            p += (*p == 'l' && p[1] == 'l') || (*p == 'h' && p[1] == 'h') ? 2 : 1;
+        }
+        switch (*p) {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+            if (wide) {
+                long long value = va_arg(args, long long);
+                app_logbin_put(buf, &off, &value, sizeof(value));
+            } else {
+                int value = va_arg(args, int);
+                app_logbin_put(buf, &off, &value, sizeof(value));
+            }
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+            double value = va_arg(args, double);
+            app_logbin_put(buf, &off, &value, sizeof(value));
+            break;
+        }
+        case 'p': {
+            uint32_t value = (uintptr_t)va_arg(args, void*);
+            app_logbin_put(buf, &off, &value, sizeof(value));
+            break;
+        }
+        case 's': {
+            const char* str = va_arg(args, const char*);
+            if (str == NULL) {
+                str = "(null)";
+            }
+            size_t max = precision >= 0 && precision < APP_LOGBIN_STR_MAX ? precision : APP_LOGBIN_STR_MAX;
+            uint16_t len = strnlen(str, max);
+            app_logbin_put(buf, &off, &len, sizeof(len));
+            app_logbin_put(buf, &off, str, len);
+            break;
+        }
+        case 'n':
+            va_arg(args, void*);
+            break;
+        case '\0':
+            p--;// 格式字符串以 '%' 结尾。
+            break;
+        default:
+            break;
+        }
+    }
+    if (buf != NULL) {
+        app_logbin_put_hdr(buf, APP_LOGBIN_RECORD, off - APP_LOGBIN_HDR_SIZE);
+    }
+    return off;
+}
+
+/**
+ * @brief 写入记录头。
+ * @param buf
+ * @param type
+ * @param len 数据字节数，不包括记录头。
+ */
+void app_logbin_put_hdr(uint8_t* buf, uint8_t type, uint16_t len) {
+    buf[0] = type;
+    buf[1] = len & 0xFF;
+    buf[2] = len >> 8;
+}
+
+/**
+ * @brief 编码文件头记录。
+ * @param buf 至少 APP_LOGBIN_HDR_SIZE + 36 字节。
+ * @return 记录字节数。
+ */
+int app_logbin_file_header(uint8_t* buf) {
+    const esp_app_desc_t* desc = esp_app_get_description();
+    memcpy(buf + APP_LOGBIN_HDR_SIZE, APP_LOGBIN_MAGIC, 4);
+    memcpy(buf + APP_LOGBIN_HDR_SIZE + 4, desc->app_elf_sha256, sizeof(desc->app_elf_sha256));
+    app_logbin_put_hdr(buf, APP_LOGBIN_HEADER, 4 + sizeof(desc->app_elf_sha256));
+    return APP_LOGBIN_HDR_SIZE + 4 + sizeof(desc->app_elf_sha256);
+}
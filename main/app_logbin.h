@@ -0,0 +1,59 @@
+/**
+ * @brief   二进制日志记录。ESP_LOGx() 的格式字符串是 flash 中的常量，地址就是格式 ID，
+ *          SD 卡和 MQTT 只保存格式 ID 和二进制参数，主机上用 tools/logdecode.py 按 ELF 文件还原文本。
+ *
+ *          记录格式，小端：类型 1 字节 + 长度 2 字节 + 数据。
+ *          APP_LOGBIN_HEADER   每个日志文件开头一条，数据是 "LBIN" + ELF 文件的 SHA256，用来核对解码用的 ELF 文件。
+ *          APP_LOGBIN_RECORD   格式字符串地址 4 字节 + 参数。整数、指针、'*' 宽度 4 字节，long long 8 字节，
+ *                              浮点数 8 字节 double，字符串是长度 2 字节 + 内容，不带 '\0'。
+ *          APP_LOGBIN_TEXT     格式字符串不在 flash 中或者参数太长，数据是格式化以后的文本。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+ /**
+  * @brief 记录类型。
+  */
+#define APP_LOGBIN_HEADER           0x1D
+#define APP_LOGBIN_RECORD           0x1E
+#define APP_LOGBIN_TEXT             0x1F
+
+ /**
+  * @brief 记录头字节数：类型 + 长度。
+  */
+#define APP_LOGBIN_HDR_SIZE         3
+
+ /**
+  * @brief 字符串参数最多保存的字节数，超出截断。
+  */
+#define APP_LOGBIN_STR_MAX          256
+
+/**
+ * @brief 编码一条日志，包括记录头。
+ * @param buf NULL 只计算长度。
+ * @param fmt 格式字符串，必须在 flash 中。
+ * @param args 会被读取，调用者传入副本。
+ * @return 记录字节数，-1 格式字符串不在 flash 中，不能编码。
+ */
+int app_logbin_encode(uint8_t* buf, const char* fmt, va_list args);
+
+/**
+ * @brief 写入记录头。
+ * @param buf
+ * @param type
+ * @param len 数据字节数，不包括记录头。
+ */
+void app_logbin_put_hdr(uint8_t* buf, uint8_t type, uint16_t len);
+
+/**
+ * @brief 编码文件头记录。
+ * @param buf 至少 APP_LOGBIN_HDR_SIZE + 36 字节。
+ * @return 记录字节数。
+ */
+int app_logbin_file_header(uint8_t* buf);
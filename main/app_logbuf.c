@@ -0,0 +1,399 @@
+/**
+ * @brief   日志环形缓冲区，多生产者无锁写入，后台任务批量写入 SD 卡，定时或者按字节数执行 fsync()。
+ *
+ *          每条日志是一条记录：4 字节头 + 文本 + '\0'，按 4 字节对齐。头的最高位是提交标志，次高位是填充标志，低位是长度。
+ *          生产者用 CAS 移动写位置预留空间，尾部放不下时先预留一条填充记录，所以记录总是连续的。
+ *          格式化以后输出到 UART，最后写入提交标志。消费者按顺序读取，遇到没有提交的记录就停下。
+ *          消费者读完一条记录，把整条记录清零再移动读位置，生产者预留的空间里不会有旧的提交标志。
+ *          二进制模式下记录内容是 app_logbin.h 的二进制记录，UART 照常输出文本。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+#include "app_logbuf.h"
+#include "app_logbin.h"
+#include "app_config.h"
+
+ /**
+ * @brief 记录头标志。
+ */
+#define APP_LOGBUF_COMMIT           0x80000000UL
+#define APP_LOGBUF_PAD              0x40000000UL
+#define APP_LOGBUF_LEN_MASK         0x0000FFFFUL
+
+ /**
+ * @brief 一行日志的最大长度，超出截断。
+ */
+#define APP_LOGBUF_LINE_MAX         512
+
+ /**
+ * @brief 后台任务周期，毫秒。缓冲区过半时生产者提前唤醒。
+ */
+#define APP_LOGBUF_FLUSH_PERIOD     1000
+
+ /**
+ * @brief 批量写入的缓冲区字节数。
+ */
+#define APP_LOGBUF_BATCH_SIZE       4096
+
+#define APP_LOGBUF_MASK             (APP_LOG_RING_SIZE - 1)
+#define APP_LOGBUF_ALIGN(n)         (((n) + 3) & ~3UL)
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_logbuf";
+
+/**
+ * @brief 环形缓冲区，写位置和读位置一直增加，取模得到偏移。
+ */
+static uint8_t* app_logbuf_ring = NULL;
+static _Atomic uint32_t app_logbuf_head = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_tail = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 已经唤醒后台任务，后台任务处理完清除，避免重复唤醒。
+ */
+static _Atomic int app_logbuf_kicked = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 同步请求和完成信号。
+ */
+static _Atomic int app_logbuf_sync_req = ATOMIC_VAR_INIT(0);
+static SemaphoreHandle_t app_logbuf_sync_sem = NULL;
+
+static FILE* app_logbuf_file = NULL;
+static TaskHandle_t app_logbuf_task_handle = NULL;
+
+/**
+ * @brief 统计数据，生产者和后台任务更新。
+ */
+static _Atomic uint32_t app_logbuf_lines = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_dropped = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_peak = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_bytes = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_flushes = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_fsyncs = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_last_ms = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_max_ms = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_text = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_enc_lines = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_enc_us = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logbuf_enc_max_us = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 记录头。
+ */
+static inline _Atomic uint32_t* app_logbuf_header(uint32_t pos) {
+    return (_Atomic uint32_t*)(app_logbuf_ring + (pos & APP_LOGBUF_MASK));
+}
+
+/**
+ * @brief 更新最大值。
+ */
+static void app_logbuf_update_max(_Atomic uint32_t* max, uint32_t value) {
+    uint32_t old = atomic_load(max);
+    while (value > old && !atomic_compare_exchange_weak(max, &old, value)) {
+    }
+}
+
+/**
+ * @brief 预留一条记录的空间。
+ * @param len 记录内容字节数。
+ * @param pos 输出记录位置。
+ * @param used 输出预留以后的占用字节数。
+ * @return 记录内容的地址，NULL 缓冲区满。
+ */
+static uint8_t* app_logbuf_reserve(uint32_t len, uint32_t* pos, uint32_t* used) {
+    uint32_t size = APP_LOGBUF_ALIGN(4 + len + 1);
+    uint32_t head = atomic_load(&app_logbuf_head);
+    uint32_t pad;
+    do {
+        uint32_t room = APP_LOG_RING_SIZE - (head & APP_LOGBUF_MASK);
+        pad = room < size ? room : 0;// 尾部放不下，填充到开头。
+        *used = head + pad + size - atomic_load(&app_logbuf_tail);
+        if (*used > APP_LOG_RING_SIZE) {
+            atomic_fetch_add(&app_logbuf_dropped, 1);
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak(&app_logbuf_head, &head, head + pad + size));
+    if (pad > 0) {
+        atomic_store_explicit(app_logbuf_header(head), APP_LOGBUF_COMMIT | APP_LOGBUF_PAD | pad, memory_order_release);
+    }
+    *pos = head + pad;
+    return app_logbuf_ring + (*pos & APP_LOGBUF_MASK) + 4;
+}
+
+/**
+ * @brief 提交记录，缓冲区过半时唤醒后台任务。
+ */
+static void app_logbuf_commit(uint32_t pos, uint32_t len, uint32_t used) {
+    atomic_store_explicit(app_logbuf_header(pos), APP_LOGBUF_COMMIT | len, memory_order_release);
+    atomic_fetch_add(&app_logbuf_lines, 1);
+    app_logbuf_update_max(&app_logbuf_peak, used);
+    if (used >= APP_LOG_RING_SIZE / 2 && atomic_exchange(&app_logbuf_kicked, 1) == 0) {
+        xTaskNotifyGive(app_logbuf_task_handle);
+    }
+}
+
+/**
+ * @brief 格式化为文本写入缓冲区并输出到 UART。
+ * @param prefix 二进制模式下的文本记录，前面加记录头。
+ */
+static int app_logbuf_vprintf_text(const char* fmt, va_list args, uint32_t prefix) {
+    va_list copy;
+    va_copy(copy, args);// 先计算长度，args 留给格式化，va_list 只能使用一次。
+    int len = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+    if (len < 0) {
+        return len;
+    }
+    if (len > APP_LOGBUF_LINE_MAX) {
+        len = APP_LOGBUF_LINE_MAX;
+    }
+    uint32_t pos;
+    uint32_t used;
+    uint8_t* data = app_logbuf_reserve(prefix + len, &pos, &used);
+    if (data == NULL) {
+        return vprintf(fmt, args);
+    }
+    if (prefix > 0) {
+        app_logbin_put_hdr(data, APP_LOGBIN_TEXT, len);
+    }
+    char* text = (char*)data + prefix;
+    vsnprintf(text, len + 1, fmt, args);
+    fwrite(text, 1, len, stdout);// 提交之前输出到 UART，提交以后记录可能已经被读走。
+    app_logbuf_commit(pos, prefix + len, used);
+    if (prefix > 0) {
+        atomic_fetch_add(&app_logbuf_text, len);
+    }
+    return len;
+}
+
+#if APP_LOG_BINARY
+/**
+ * @brief 二进制模式：格式 ID 和参数写入缓冲区，UART 照常输出文本。
+ *        格式字符串不在 flash 中或者记录太长时按文本记录写入。
+ */
+static int app_logbuf_vprintf_bin(const char* fmt, va_list args) {
+    int64_t start = esp_timer_get_time();
+    va_list copy;
+    va_copy(copy, args);
+    int len = app_logbin_encode(NULL, fmt, copy);
+    va_end(copy);
+    if (len < 0 || len > APP_LOGBUF_LINE_MAX) {
+        return app_logbuf_vprintf_text(fmt, args, APP_LOGBIN_HDR_SIZE);
+    }
+    uint32_t pos;
+    uint32_t used;
+    uint8_t* data = app_logbuf_reserve(len, &pos, &used);
+    if (data != NULL) {
+        va_copy(copy, args);
+        app_logbin_encode(data, fmt, copy);
+        va_end(copy);
+        app_logbuf_commit(pos, len, used);
+        uint32_t us = esp_timer_get_time() - start;
+        atomic_fetch_add(&app_logbuf_enc_lines, 1);
+        atomic_fetch_add(&app_logbuf_enc_us, us);
+        app_logbuf_update_max(&app_logbuf_enc_max_us, us);
+    }
+    int text_len = vprintf(fmt, args);
+    if (data != NULL && text_len > 0) {
+        atomic_fetch_add(&app_logbuf_text, text_len);
+    }
+    return text_len;
+}
+#endif
+
+/**
+ * @brief 日志输出函数，通过 esp_log_set_vprintf() 安装。
+ *        格式化到缓冲区并输出到 UART，不等待 SD 卡。缓冲区满时只输出到 UART。
+ * @param fmt
+ * @param args
+ * @return
+ */
+int app_logbuf_vprintf(const char* fmt, va_list args) {
+    if (app_logbuf_ring == NULL) {
+        return vprintf(fmt, args);
+    }
+#if APP_LOG_BINARY
+    return app_logbuf_vprintf_bin(fmt, args);
+#else
+    return app_logbuf_vprintf_text(fmt, args, 0);
+#endif
+}
+
+/**
+ * @brief 读取缓冲区中已经提交的记录，批量写入文件。
+ * @return 写入字节数。
+ */
+static uint32_t app_logbuf_drain(void) {
+    static char batch[APP_LOGBUF_BATCH_SIZE];
+    size_t batch_len = 0;
+    uint32_t bytes = 0;
+    uint32_t tail = atomic_load(&app_logbuf_tail);
+    while (tail != atomic_load(&app_logbuf_head)) {
+        uint32_t header = atomic_load_explicit(app_logbuf_header(tail), memory_order_acquire);
+        if ((header & APP_LOGBUF_COMMIT) == 0) {// 生产者还在格式化，下次再读。
+            break;
+        }
+        uint32_t size;
+        if (header & APP_LOGBUF_PAD) {
+            size = header & APP_LOGBUF_LEN_MASK;
+        } else {
+            uint32_t len = header & APP_LOGBUF_LEN_MASK;
+            if (batch_len + len > sizeof(batch)) {
+                fwrite(batch, 1, batch_len, app_logbuf_file);
+                batch_len = 0;
+            }
+            memcpy(batch + batch_len, app_logbuf_ring + (tail & APP_LOGBUF_MASK) + 4, len);
+            batch_len += len;
+            bytes += len;
+            size = APP_LOGBUF_ALIGN(4 + len + 1);
+        }
+        memset(app_logbuf_ring + (tail & APP_LOGBUF_MASK), 0, size);
+        tail += size;
+        atomic_store_explicit(&app_logbuf_tail, tail, memory_order_release);
+    }
+    if (batch_len > 0) {
+        fwrite(batch, 1, batch_len, app_logbuf_file);
+    }
+    if (bytes > 0) {
+        fflush(app_logbuf_file);
+    }
+    return bytes;
+}
+
+/**
+ * @brief 后台任务，定时或者被唤醒时写入文件，写入字节数或者时间达到阈值时执行 fsync()。
+ * @param param
+ */
+static void app_logbuf_task(void* param) {
+    uint32_t unsynced = 0;
+    uint32_t fsync_ts = esp_log_timestamp();
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(APP_LOGBUF_FLUSH_PERIOD));
+        atomic_store(&app_logbuf_kicked, 0);
+        bool sync = atomic_exchange(&app_logbuf_sync_req, 0) != 0;
+        uint32_t start = esp_log_timestamp();
+        uint32_t bytes = app_logbuf_drain();
+        unsynced += bytes;
+        bool do_fsync = unsynced > 0 && (sync || unsynced >= APP_LOG_FSYNC_BYTES || start - fsync_ts >= APP_LOG_FSYNC_PERIOD);
+        if (do_fsync) {
+            fsync(fileno(app_logbuf_file));
+            unsynced = 0;
+            fsync_ts = esp_log_timestamp();
+            atomic_fetch_add(&app_logbuf_fsyncs, 1);
+        }
+        if (bytes > 0 || do_fsync) {
+            uint32_t ms = esp_log_timestamp() - start;
+            atomic_fetch_add(&app_logbuf_bytes, bytes);
+            atomic_fetch_add(&app_logbuf_flushes, 1);
+            atomic_store(&app_logbuf_last_ms, ms);
+            app_logbuf_update_max(&app_logbuf_max_ms, ms);
+        }
+        if (sync) {
+            xSemaphoreGive(app_logbuf_sync_sem);
+        }
+    }
+}
+
+/**
+ * @brief 把缓冲区中的日志写入文件并执行 fsync()，等待完成。
+ *        复制日志文件之前调用，不能在后台任务中调用。
+ * @param timeout_ms
+ */
+void app_logbuf_sync(uint32_t timeout_ms) {
+    if (app_logbuf_task_handle == NULL) {
+        return;
+    }
+    xSemaphoreTake(app_logbuf_sync_sem, 0);// 清除上次超时以后才到的信号。
+    atomic_store(&app_logbuf_sync_req, 1);
+    xTaskNotifyGive(app_logbuf_task_handle);
+    if (xSemaphoreTake(app_logbuf_sync_sem, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        ESP_LOGW(TAG, "------ 日志写入 SD 卡：超时！");
+    }
+}
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_logbuf_get_stats(app_logbuf_stats_t* stats) {
+    stats->lines = atomic_load(&app_logbuf_lines);
+    stats->dropped = atomic_load(&app_logbuf_dropped);
+    stats->bytes = atomic_load(&app_logbuf_bytes);
+    stats->peak = atomic_load(&app_logbuf_peak);
+    stats->flushes = atomic_load(&app_logbuf_flushes);
+    stats->fsyncs = atomic_load(&app_logbuf_fsyncs);
+    stats->last_ms = atomic_load(&app_logbuf_last_ms);
+    stats->max_ms = atomic_load(&app_logbuf_max_ms);
+    stats->text = atomic_load(&app_logbuf_text);
+    uint32_t enc_lines = atomic_load(&app_logbuf_enc_lines);
+    stats->enc_avg_us = enc_lines > 0 ? atomic_load(&app_logbuf_enc_us) / enc_lines : 0;
+    stats->enc_max_us = atomic_load(&app_logbuf_enc_max_us);
+}
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_logbuf_log(void) {
+    if (app_logbuf_ring == NULL) {
+        return;
+    }
+    app_logbuf_stats_t stats;
+    app_logbuf_get_stats(&stats);
+    ESP_LOGI(TAG, "------ SD 卡日志，行数：%lu，丢弃：%lu，写入：%lu 字节，最大占用：%lu 字节，写入次数：%lu，fsync：%lu 次，耗时：最近 %lu 最大 %lu 毫秒",
+        stats.lines, stats.dropped, stats.bytes, stats.peak, stats.flushes, stats.fsyncs, stats.last_ms, stats.max_ms);
+#if APP_LOG_BINARY
+    ESP_LOGI(TAG, "------ SD 卡二进制日志，文本：%lu 字节，二进制：%lu 字节，减少：%lu%%，编码耗时：平均 %lu 最大 %lu 微秒",
+        stats.text, stats.bytes, stats.text > stats.bytes ? (uint32_t)((uint64_t)(stats.text - stats.bytes) * 100 / stats.text) : 0,
+        stats.enc_avg_us, stats.enc_max_us);
+#endif
+}
+
+/**
+ * @brief 初始化函数，日志文件打开以后、安装日志输出函数之前调用。
+ * @param file 日志文件，由后台任务独占写入。
+ * @return
+ */
+esp_err_t app_logbuf_init(FILE* file) {
+    if (app_logbuf_ring != NULL) {
+        return ESP_OK;
+    }
+    uint8_t* ring = heap_caps_calloc(1, APP_LOG_RING_SIZE, MALLOC_CAP_SPIRAM);
+    if (ring == NULL) {
+        ring = calloc(1, APP_LOG_RING_SIZE);
+    }
+    app_logbuf_sync_sem = xSemaphoreCreateBinary();
+    if (ring == NULL || app_logbuf_sync_sem == NULL) {
+        free(ring);
+        return ESP_ERR_NO_MEM;
+    }
+    app_logbuf_file = file;
+#if APP_LOG_BINARY
+    uint8_t header[APP_LOGBIN_HDR_SIZE + 36];
+    fwrite(header, 1, app_logbin_file_header(header), file);// 每次启动一条，解码时核对 ELF 文件。
+    fflush(file);
+#endif
+    BaseType_t ret = xTaskCreate(app_logbuf_task, "app_logbuf_task", 3072, NULL, 1, &app_logbuf_task_handle);// 优先级 1，SD 卡慢不影响其它任务。
+    if (ret != pdPASS) {
+        free(ring);
+        return ESP_FAIL;
+    }
+    app_logbuf_ring = ring;// 最后设置，生产者看到缓冲区时后台任务已经在运行。
+    return ESP_OK;
+}
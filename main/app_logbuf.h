@@ -0,0 +1,63 @@
+/**
+ * @brief   日志环形缓冲区，多生产者无锁写入，后台任务批量写入 SD 卡，定时或者按字节数执行 fsync()。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+ /**
+  * @brief 统计数据。
+  */
+typedef struct {
+    uint32_t lines;             // 写入缓冲区的行数。
+    uint32_t dropped;           // 缓冲区满丢弃的行数。
+    uint32_t bytes;             // 写入文件的字节数。
+    uint32_t peak;              // 缓冲区最大占用字节数。
+    uint32_t flushes;           // 批量写入次数。
+    uint32_t fsyncs;            // fsync() 次数。
+    uint32_t last_ms;           // 最近一次写入耗时，包括 fsync()，毫秒。
+    uint32_t max_ms;            // 最大写入耗时，毫秒。
+    uint32_t text;              // 二进制模式：同样的日志按文本写入的字节数，和 bytes 比较。
+    uint32_t enc_avg_us;        // 二进制模式：每行编码的平均耗时，微秒。
+    uint32_t enc_max_us;        // 二进制模式：每行编码的最大耗时，微秒。
+} app_logbuf_stats_t;
+
+/**
+ * @brief 日志输出函数，通过 esp_log_set_vprintf() 安装。
+ *        格式化到缓冲区并输出到 UART，不等待 SD 卡。缓冲区满时只输出到 UART。
+ * @param fmt
+ * @param args
+ * @return
+ */
+int app_logbuf_vprintf(const char* fmt, va_list args);
+
+/**
+ * @brief 把缓冲区中的日志写入文件并执行 fsync()，等待完成。
+ *        复制日志文件之前调用，不能在后台任务中调用。
+ * @param timeout_ms
+ */
+void app_logbuf_sync(uint32_t timeout_ms);
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_logbuf_get_stats(app_logbuf_stats_t* stats);
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_logbuf_log(void);
+
+/**
+ * @brief 初始化函数，日志文件打开以后、安装日志输出函数之前调用。
+ * @param file 日志文件，由后台任务独占写入。
+ * @return
+ */
+esp_err_t app_logbuf_init(FILE* file);
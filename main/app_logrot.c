@@ -0,0 +1,278 @@
+/**
+ * @brief   日志文件轮转清单。每次启动写入新的日志文件 LOG/Lnnnnnnn.TXT，旧文件只重命名或者按序号引用，不再复制。
+ *          上传位置、时间记录保存在清单 LOG/LOGS.DAT 中，双槽原子更新。
+ *
+ *          以前每次启动把 LOG.TXT 复制到 MQTT.TXT，时间同步以后再把 FILE.TXT 复制为按时间命名的备份，
+ *          几 MB 的日志要几秒，写入量翻倍。现在启动时只分配新的序号，上传按序号和偏移读取原文件。
+ *          关闭的日志文件加入归档索引，由 app_retain.c 按保留策略删除。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/unistd.h>
+#include "esp_log.h"
+#include "esp_random.h"
+
+#include "app_sd.h"
+#include "app_meta.h"
+#include "app_logrot.h"
+#include "app_retain.h"
+
+ /**
+ * @brief 清单文件名。
+ */
+#define APP_LOGROT_DAT              APP_SD_LOG_DIR"/LOGS.DAT"
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_logrot";
+
+/**
+ * @brief 持久化的清单。
+ */
+typedef struct {
+    uint32_t cur;           // 正在写入的日志文件序号，每次启动加 1。
+    uint32_t cur_time;      // 正在写入的日志文件的开始时间，时间同步以后按运行时间推算，UTC 秒，0 = 未同步。
+    uint32_t snap_end;      // 正在写入的日志文件上传到这个偏移为止，远程控制请求上传日志时更新。
+    uint32_t up_gen;        // 上传位置：文件序号，之前的文件都已上传或者不需要上传。
+    uint32_t up_off;        // 上传位置：已确认的文件偏移。
+    uint32_t up_id;         // 正在上传的文件 ID，0 = 还没开始。
+    uint32_t up_seq;        // 下一块的序号。
+} app_logrot_state_t;
+
+/**
+ * @brief 互斥锁，启动、时间同步、缓存推送任务都会修改清单。
+ */
+static pthread_mutex_t app_logrot_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 持久化的清单。
+ */
+static app_logrot_state_t app_logrot_state = { 0 };
+
+/**
+ * @brief 清单文件。
+ */
+static app_meta_t app_logrot_meta = {
+    .path = APP_LOGROT_DAT,
+    .size = sizeof(app_logrot_state_t),
+};
+
+/**
+ * @brief 日志文件名。
+ * @param gen
+ * @param buf
+ * @param size
+ */
+void app_logrot_path(uint32_t gen, char* buf, size_t size) {
+    snprintf(buf, size, APP_SD_LOG_DIR"/L%07" PRIX32 ".TXT", gen & 0x0FFFFFFF);
+}
+
+/**
+ * @brief 分配下一个序号，跳过已经存在的文件，调用者持有锁。
+ *        只有清单丢失时才会有已经存在的文件，不覆盖。
+ */
+static uint32_t app_logrot_alloc(char* path, size_t size) {
+    uint32_t gen = app_logrot_state.cur + 1;
+    app_logrot_path(gen, path, size);
+    while (access(path, F_OK) != -1) {
+        app_logrot_path(++gen, path, size);
+    }
+    return gen;
+}
+
+/**
+ * @brief 关闭当前日志文件，加入归档索引，调用者持有锁。
+ */
+static void app_logrot_close_cur(void) {
+    if (app_logrot_state.cur == 0) {
+        return;
+    }
+    char path[32];
+    app_logrot_path(app_logrot_state.cur, path, sizeof(path));
+    app_retain_add(path, app_logrot_state.cur_time, app_logrot_state.cur < app_logrot_state.up_gen);
+    app_logrot_state.cur_time = 0;
+}
+
+/**
+ * @brief 上传位置进入下一个文件，调用者持有锁。
+ */
+static void app_logrot_next_gen(void) {
+    char path[32];
+    app_logrot_path(app_logrot_state.up_gen, path, sizeof(path));
+    app_retain_uploaded(path);
+    app_logrot_state.up_gen++;
+    app_logrot_state.up_off = 0;
+    app_logrot_state.up_id = 0;
+    app_logrot_state.up_seq = 0;
+}
+
+/**
+ * @brief 收编旧版本的日志文件，重命名为下一个序号，不复制。
+ *        只在启动时、开始新的日志文件之前调用。
+ * @param path 旧文件名。
+ * @param upload 是否需要上传。
+ * @return 0 成功，-1 失败。
+ */
+int app_logrot_adopt(const char* path, bool upload) {
+    char new_path[32];
+    pthread_mutex_lock(&app_logrot_mutex);
+    uint32_t gen = app_logrot_alloc(new_path, sizeof(new_path));
+    int ret = rename(path, new_path);
+    if (ret == 0) {
+        app_logrot_close_cur();
+        app_logrot_state.cur = gen;
+        if (!upload && app_logrot_state.up_gen <= gen) {
+            app_logrot_state.up_gen = gen;
+            app_logrot_next_gen();
+        }
+        app_meta_save(&app_logrot_meta, &app_logrot_state);
+        ESP_LOGI(TAG, "------ 日志轮转收编旧文件：%s -> %s，上传：%d", path, new_path, upload);
+    } else {
+        ESP_LOGE(TAG, "------ 日志轮转收编旧文件：失败！文件名：%s", path);
+    }
+    pthread_mutex_unlock(&app_logrot_mutex);
+    return ret == 0 ? 0 : -1;
+}
+
+/**
+ * @brief 开始新的日志文件，序号加 1。
+ * @param path 输出新的日志文件名。
+ * @param size
+ * @return
+ */
+esp_err_t app_logrot_start(char* path, size_t size) {
+    pthread_mutex_lock(&app_logrot_mutex);
+    app_logrot_close_cur();
+    app_logrot_state.cur = app_logrot_alloc(path, size);
+    app_logrot_state.snap_end = 0;
+    esp_err_t ret = app_meta_save(&app_logrot_meta, &app_logrot_state);// 先保存，断电以后不会重用这个序号。
+    ESP_LOGI(TAG, "------ 日志轮转开始新文件：%s，待上传：%08lX/%lu", path, app_logrot_state.up_gen, app_logrot_state.up_off);
+    pthread_mutex_unlock(&app_logrot_mutex);
+    return ret;
+}
+
+/**
+ * @brief 时间同步以后，记录当前日志文件的开始时间，并按最长保留时间清理归档文件。
+ * @param now
+ */
+void app_logrot_stamp(time_t now) {
+    pthread_mutex_lock(&app_logrot_mutex);
+    if (app_logrot_state.cur_time == 0) {
+        app_logrot_state.cur_time = now - esp_log_timestamp() / 1000;
+        app_meta_save(&app_logrot_meta, &app_logrot_state);
+        ESP_LOGI(TAG, "------ 日志轮转记录时间：%08lX -> %lu", app_logrot_state.cur, app_logrot_state.cur_time);
+    }
+    pthread_mutex_unlock(&app_logrot_mutex);
+    app_retain_enforce();
+}
+
+/**
+ * @brief 请求上传当前日志文件，上传到当前的文件末尾。调用者先把日志缓冲区写入文件。
+ */
+void app_logrot_snap(void) {
+    char path[32];
+    struct stat st;
+    pthread_mutex_lock(&app_logrot_mutex);
+    app_logrot_path(app_logrot_state.cur, path, sizeof(path));
+    if (stat(path, &st) == 0 && st.st_size > app_logrot_state.snap_end) {
+        app_logrot_state.snap_end = st.st_size;
+        app_meta_save(&app_logrot_meta, &app_logrot_state);
+        ESP_LOGI(TAG, "------ 日志轮转请求上传当前文件：%s，到偏移：%lu", path, app_logrot_state.snap_end);
+    }
+    pthread_mutex_unlock(&app_logrot_mutex);
+}
+
+/**
+ * @brief 获取下一段需要上传的日志，跳过不存在的文件。
+ * @param up
+ * @return true 有需要上传的日志。
+ */
+bool app_logrot_next_upload(app_logrot_upload_t* up) {
+    bool ret = false;
+    pthread_mutex_lock(&app_logrot_mutex);
+    while (app_logrot_state.up_gen <= app_logrot_state.cur) {
+        app_logrot_path(app_logrot_state.up_gen, up->path, sizeof(up->path));
+        uint32_t end = app_logrot_state.snap_end;
+        if (app_logrot_state.up_gen < app_logrot_state.cur) {// 旧文件，上传整个文件。
+            struct stat st;
+            end = stat(up->path, &st) == 0 ? st.st_size : 0;
+        }
+        if (app_logrot_state.up_off >= end) {
+            if (app_logrot_state.up_gen == app_logrot_state.cur) {
+                break;// 当前文件已经上传到请求的位置。
+            }
+            app_logrot_next_gen();// 已上传完，或者文件已被删除。
+            app_meta_save(&app_logrot_meta, &app_logrot_state);
+            continue;
+        }
+        if (app_logrot_state.up_id == 0) {// 新文件。
+            app_logrot_state.up_id = esp_random() | 1;
+            app_meta_save(&app_logrot_meta, &app_logrot_state);
+        }
+        up->gen = app_logrot_state.up_gen;
+        up->off = app_logrot_state.up_off;
+        up->end = end;
+        up->id = app_logrot_state.up_id;
+        up->seq = app_logrot_state.up_seq;
+        ret = true;
+        break;
+    }
+    pthread_mutex_unlock(&app_logrot_mutex);
+    return ret;
+}
+
+/**
+ * @brief 保存上传位置，每块确认以后调用。到达 end 时，旧文件进入下一个序号。
+ * @param up
+ */
+void app_logrot_upload_ack(const app_logrot_upload_t* up) {
+    pthread_mutex_lock(&app_logrot_mutex);
+    if (up->gen == app_logrot_state.up_gen && up->id == app_logrot_state.up_id) {
+        app_logrot_state.up_off = up->off;
+        app_logrot_state.up_seq = up->seq;
+        if (up->gen < app_logrot_state.cur && up->off >= up->end) {
+            app_logrot_next_gen();
+        }
+        app_meta_save(&app_logrot_meta, &app_logrot_state);// 断电或断线以后从这里继续。
+    }
+    pthread_mutex_unlock(&app_logrot_mutex);
+}
+
+/**
+ * @brief 日志文件是否还需要上传，重建归档索引时调用。只在启动时调用，不加锁，避免和归档索引的锁顺序相反。
+ * @param path
+ * @return
+ */
+bool app_logrot_pending(const char* path) {
+    const char* name = strrchr(path, '/');
+    uint32_t gen;
+    char ext[4];
+    if (name == NULL || sscanf(name, "/L%7" SCNx32 ".%3s", &gen, ext) != 2 || strcmp(ext, "TXT") != 0) {
+        return false;
+    }
+    return gen >= app_logrot_state.up_gen;
+}
+
+/**
+ * @brief 初始化函数，SD 卡挂载并创建 LOG 目录以后调用。
+ * @return
+ */
+esp_err_t app_logrot_init(void) {
+    if (app_meta_load(&app_logrot_meta, &app_logrot_state) != ESP_OK) {
+        memset(&app_logrot_state, 0, sizeof(app_logrot_state));
+        char path[32];
+        app_logrot_state.cur = app_logrot_alloc(path, sizeof(path)) - 1;// 清单丢失，已有的日志文件不再上传。
+        app_logrot_state.up_gen = app_logrot_state.cur + 1;
+        ESP_LOGW(TAG, "------ 日志轮转没有清单，从序号 %08lX 开始。", app_logrot_state.up_gen);
+    }
+    ESP_LOGI(TAG, "------ 日志轮转初始化：完成。当前文件：%08lX，上传位置：%08lX/%lu",
+        app_logrot_state.cur, app_logrot_state.up_gen, app_logrot_state.up_off);
+    return ESP_OK;
+}
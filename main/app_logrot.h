@@ -0,0 +1,87 @@
+/**
+ * @brief   日志文件轮转清单。每次启动写入新的日志文件 LOG/Lnnnnnnn.TXT，旧文件只重命名或者按序号引用，不再复制。
+ *          上传位置、时间记录保存在清单 LOG/LOGS.DAT 中，双槽原子更新。关闭的日志文件加入归档索引，见 app_retain.h。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "esp_err.h"
+
+ /**
+  * @brief 下一段需要上传的日志。
+  */
+typedef struct {
+    uint32_t gen;               // 日志文件序号。
+    uint32_t off;               // 已确认的文件偏移，从这里继续。
+    uint32_t end;               // 上传到这个偏移为止。
+    uint32_t id;                // 文件 ID，服务器按文件 ID 拼接。
+    uint32_t seq;               // 下一块的序号。
+    char path[32];              // 文件名。
+} app_logrot_upload_t;
+
+/**
+ * @brief 日志文件名。
+ * @param gen
+ * @param buf
+ * @param size
+ */
+void app_logrot_path(uint32_t gen, char* buf, size_t size);
+
+/**
+ * @brief 收编旧版本的日志文件，重命名为下一个序号，不复制。
+ * @param path 旧文件名。
+ * @param upload 是否需要上传。
+ * @return 0 成功，-1 失败。
+ */
+int app_logrot_adopt(const char* path, bool upload);
+
+/**
+ * @brief 开始新的日志文件，序号加 1。
+ * @param path 输出新的日志文件名。
+ * @param size
+ * @return
+ */
+esp_err_t app_logrot_start(char* path, size_t size);
+
+/**
+ * @brief 时间同步以后，记录当前日志文件的开始时间，并按最长保留时间清理归档文件。
+ * @param now
+ */
+void app_logrot_stamp(time_t now);
+
+/**
+ * @brief 请求上传当前日志文件，上传到当前的文件末尾。调用者先把日志缓冲区写入文件。
+ */
+void app_logrot_snap(void);
+
+/**
+ * @brief 获取下一段需要上传的日志，跳过不存在的文件。
+ * @param up
+ * @return true 有需要上传的日志。
+ */
+bool app_logrot_next_upload(app_logrot_upload_t* up);
+
+/**
+ * @brief 保存上传位置，每块确认以后调用。到达 end 时，旧文件进入下一个序号。
+ * @param up
+ */
+void app_logrot_upload_ack(const app_logrot_upload_t* up);
+
+/**
+ * @brief 日志文件是否还需要上传，重建归档索引时调用。只在启动时调用。
+ * @param path
+ * @return
+ */
+bool app_logrot_pending(const char* path);
+
+/**
+ * @brief 初始化函数，SD 卡挂载并创建 LOG 目录以后调用。
+ * @return
+ */
+esp_err_t app_logrot_init(void);
@@ -0,0 +1,187 @@
+/**
+ * @brief   日志上传，分块压缩，断点续传，全部确认以后删除。
+ *
+ *          每块是一条 MQTT 消息，主题 topic/iotlog/<MAC>，QOS = 1，块头 18 字节，大端：
+ *          0  'L' 'G'      标识
+ *          2  版本         1
+ *          3  标记         bit0 = LZSS 压缩，见 app_lzss.h；bit1 = 最后一块
+ *          4  文件 ID      每个日志文件随机生成，服务器按文件 ID 拼接
+ *          8  块序号       从 0 开始
+ *          12 文件偏移     这一块原始数据在文件中的位置
+ *          16 原始长度     解压以后的字节数
+ *          重发的块序号和偏移不变，服务器按偏移去重。
+ *          日志文件和上传位置见 app_logrot.h。当前日志文件按请求分几次上传，每次到达请求的位置都带最后一块标记，
+ *          文件 ID 不变，偏移接着上一次。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+
+#include "app_lzss.h"
+#include "app_logrot.h"
+#include "app_mqtt.h"
+#include "app_drain.h"
+#include "app_logup.h"
+
+ /**
+ * @brief 每块原始数据的大小，不超过压缩窗口。
+ */
+#define APP_LOGUP_CHUNK_SIZE        APP_LZSS_WINDOW_SIZE
+
+ /**
+ * @brief 块头。
+ */
+#define APP_LOGUP_HEAD_SIZE         18
+#define APP_LOGUP_VERSION           1
+#define APP_LOGUP_FLAG_LZSS         0x01
+#define APP_LOGUP_FLAG_LAST         0x02
+
+ /**
+ * @brief 一块被 outbox 转存以后，重发的次数。
+ */
+#define APP_LOGUP_RETRY             3
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_logup";
+
+/**
+ * @brief 统计数据。
+ */
+static _Atomic uint32_t app_logup_raw_bytes = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logup_sent_bytes = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_logup_chunks = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 大端写入。
+ */
+static void app_logup_put32(uint8_t* p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+/**
+ * @brief 等待日志块的 PUBACK。
+ * @return 1 收到 PUBACK，-1 被 outbox 转存，0 断开连接。
+ */
+static int app_logup_wait_ack(int msg_id) {
+    int ret;
+    while ((ret = app_mqtt_log_chunk_state(msg_id)) == 0 && atomic_load(&app_mqtt_connected)) {
+        app_drain_wait_kick(100);// PUBACK 和转存都会唤醒。
+    }
+    return ret;
+}
+
+/**
+ * @brief 上传一个日志文件，从上次确认的位置到 up->end。
+ * @return true 上传完成，false 中断。
+ */
+static bool app_logup_file(app_logrot_upload_t* up, uint8_t* raw, uint8_t* out, uint16_t* hash) {
+    FILE* file = fopen(up->path, "rb");
+    if (file == NULL) {
+        ESP_LOGE(TAG, "------ 日志上传：失败。打开文件失败，文件名：%s", up->path);
+        return false;
+    }
+    ESP_LOGI(TAG, "------ 日志上传：开始。文件名：%s，文件 ID：%08lX，位置：%lu，结束位置：%lu", up->path, up->id, up->off, up->end);
+    uint32_t raw_bytes = 0;
+    uint32_t sent_bytes = 0;
+    int retry = 0;
+    while (up->off < up->end && atomic_load(&app_mqtt_connected)) {
+        fseek(file, up->off, SEEK_SET);
+        uint32_t want = up->end - up->off < APP_LOGUP_CHUNK_SIZE ? up->end - up->off : APP_LOGUP_CHUNK_SIZE;
+        int raw_len = fread(raw, 1, want, file);
+        if (raw_len <= 0) {
+            ESP_LOGE(TAG, "------ 日志上传：失败。读取文件失败，位置：%lu", up->off);
+            break;
+        }
+        uint8_t flags = up->off + raw_len >= up->end ? APP_LOGUP_FLAG_LAST : 0;
+        int data_len = app_lzss_compress(raw, raw_len, out + APP_LOGUP_HEAD_SIZE, raw_len - 1, hash);
+        if (data_len > 0) {
+            flags |= APP_LOGUP_FLAG_LZSS;
+        } else {// 压缩以后没有变小，原样发送。
+            memcpy(out + APP_LOGUP_HEAD_SIZE, raw, raw_len);
+            data_len = raw_len;
+        }
+        out[0] = 'L';
+        out[1] = 'G';
+        out[2] = APP_LOGUP_VERSION;
+        out[3] = flags;
+        app_logup_put32(out + 4, up->id);
+        app_logup_put32(out + 8, up->seq);
+        app_logup_put32(out + 12, up->off);
+        out[16] = raw_len >> 8;
+        out[17] = raw_len;
+
+        int msg_id = app_mqtt_publish_log_chunk((const char*)out, APP_LOGUP_HEAD_SIZE + data_len);
+        if (msg_id < 0) {
+            break;
+        }
+        int ack = app_logup_wait_ack(msg_id);
+        if (ack == -1 && ++retry <= APP_LOGUP_RETRY) {// 被 outbox 转存，重发这一块。
+            continue;
+        }
+        if (ack != 1) {
+            break;
+        }
+        retry = 0;
+        up->off += raw_len;
+        up->seq++;
+        app_logrot_upload_ack(up);// 每块确认以后保存位置，断电或断线以后从这里继续。
+        raw_bytes += raw_len;
+        sent_bytes += APP_LOGUP_HEAD_SIZE + data_len;
+        atomic_fetch_add(&app_logup_raw_bytes, raw_len);
+        atomic_fetch_add(&app_logup_sent_bytes, APP_LOGUP_HEAD_SIZE + data_len);
+        atomic_fetch_add(&app_logup_chunks, 1);
+    }
+    fclose(file);
+
+    if (up->off < up->end) {
+        ESP_LOGW(TAG, "------ 日志上传：中断。位置：%lu，结束位置：%lu，本次原始字节：%lu，上传字节：%lu",
+            up->off, up->end, raw_bytes, sent_bytes);
+        return false;
+    }
+    ESP_LOGI(TAG, "------ 日志上传：完成。文件名：%s，本次原始字节：%lu，上传字节：%lu，累计原始字节：%lu，累计上传字节：%lu",
+        up->path, raw_bytes, sent_bytes, atomic_load(&app_logup_raw_bytes), atomic_load(&app_logup_sent_bytes));
+    return true;
+}
+
+/**
+ * @brief 上传等待上传的日志文件，从上次确认的位置继续。
+ *        由缓存推送任务在连接以后调用，中断时保留位置，下次连接继续。日志文件上传以后保留，由备份清理删除。
+ */
+void app_logup_run(void) {
+    app_logrot_upload_t up;
+    if (!app_logrot_next_upload(&up)) {
+        return;
+    }
+    uint8_t* raw = malloc(APP_LOGUP_CHUNK_SIZE);
+    uint8_t* out = malloc(APP_LOGUP_HEAD_SIZE + APP_LOGUP_CHUNK_SIZE);
+    uint16_t* hash = malloc(APP_LZSS_HASH_SIZE * sizeof(uint16_t));
+    if (raw == NULL || out == NULL || hash == NULL) {
+        ESP_LOGE(TAG, "------ 日志上传：失败。内存不足。");
+    } else {
+        while (app_logup_file(&up, raw, out, hash) && app_logrot_next_upload(&up)) {
+        }
+    }
+    free(raw);
+    free(out);
+    free(hash);
+}
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_logup_get_stats(app_logup_stats_t* stats) {
+    stats->raw_bytes = atomic_load(&app_logup_raw_bytes);
+    stats->sent_bytes = atomic_load(&app_logup_sent_bytes);
+    stats->chunks = atomic_load(&app_logup_chunks);
+}
@@ -0,0 +1,30 @@
+/**
+ * @brief   日志上传，分块压缩，断点续传，全部确认以后删除。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+
+ /**
+  * @brief 日志上传统计数据，启动以后累计。
+  */
+typedef struct {
+    uint32_t raw_bytes;         // 已确认的原始日志字节数。
+    uint32_t sent_bytes;        // 已确认的上传字节数，包括块头。
+    uint32_t chunks;            // 已确认的块数。
+} app_logup_stats_t;
+
+/**
+ * @brief 上传等待上传的日志文件，从上次确认的位置继续。
+ *        由缓存推送任务在连接以后调用，中断时保留位置，下次连接继续。日志文件上传以后保留，由备份清理删除。
+ */
+void app_logup_run(void);
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_logup_get_stats(app_logup_stats_t* stats);
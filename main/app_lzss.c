@@ -0,0 +1,127 @@
+/**
+ * @brief   LZSS 压缩，用于日志上传。每块独立压缩，窗口不超过一块，不需要额外的解压状态。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <string.h>
+
+#include "app_lzss.h"
+
+ /**
+ * @brief 匹配长度范围。
+ */
+#define APP_LZSS_MIN_MATCH          3
+#define APP_LZSS_MAX_MATCH          18
+
+/**
+ * @brief 3 字节哈希。
+ */
+static uint32_t app_lzss_hash(const uint8_t* p) {
+    return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & (APP_LZSS_HASH_SIZE - 1);
+}
+
+/**
+ * @brief 压缩一块数据。
+ *        只保留每个哈希值最近的位置，不做哈希链，日志文本重复多，效果已经够用，内存只要 8K。
+ * @param in
+ * @param in_len 不能超过 APP_LZSS_WINDOW_SIZE。
+ * @param out
+ * @param out_size
+ * @param hash 工作区，uint16_t[APP_LZSS_HASH_SIZE]。
+ * @return 压缩后的字节数，-1 输出缓冲区不够，调用者改为不压缩发送。
+ */
+int app_lzss_compress(const uint8_t* in, int in_len, uint8_t* out, int out_size, uint16_t* hash) {
+    if (in_len > APP_LZSS_WINDOW_SIZE) {
+        return -1;
+    }
+    memset(hash, 0, APP_LZSS_HASH_SIZE * sizeof(uint16_t));// 位置 + 1，0 = 空。
+    int in_pos = 0;
+    int out_pos = 0;
+    int flag_pos = 0;
+    int flag_bit = 8;
+    while (in_pos < in_len) {
+        if (flag_bit == 8) {// 新的标记字节。
+            if (out_pos >= out_size) {
+                return -1;
+            }
+            flag_pos = out_pos++;
+            out[flag_pos] = 0;
+            flag_bit = 0;
+        }
+        int match_len = 0;
+        int match_dist = 0;
+        if (in_pos + APP_LZSS_MIN_MATCH <= in_len) {
+            uint32_t h = app_lzss_hash(in + in_pos);
+            int cand = hash[h] - 1;
+            hash[h] = in_pos + 1;
+            if (cand >= 0) {
+                int max_len = in_len - in_pos < APP_LZSS_MAX_MATCH ? in_len - in_pos : APP_LZSS_MAX_MATCH;
+                while (match_len < max_len && in[cand + match_len] == in[in_pos + match_len]) {
+                    match_len++;
+                }
+                match_dist = in_pos - cand;
+            }
+        }
+        if (match_len >= APP_LZSS_MIN_MATCH) {
+            if (out_pos + 2 > out_size) {
+                return -1;
+            }
+            out[out_pos++] = (((match_dist - 1) >> 4) & 0xF0) | (match_len - APP_LZSS_MIN_MATCH);
+            out[out_pos++] = (match_dist - 1) & 0xFF;
+            for (int i = 1; i < match_len; i++) {// 匹配内部的位置也加入哈希表。
+                if (in_pos + i + APP_LZSS_MIN_MATCH <= in_len) {
+                    hash[app_lzss_hash(in + in_pos + i)] = in_pos + i + 1;
+                }
+            }
+            in_pos += match_len;
+        } else {
+            if (out_pos >= out_size) {
+                return -1;
+            }
+            out[flag_pos] |= 1 << flag_bit;
+            out[out_pos++] = in[in_pos++];
+        }
+        flag_bit++;
+    }
+    return out_pos;
+}
+
+/**
+ * @brief 解压一块数据，格式的参考实现，服务器按同样的规则解压。设备上不调用。
+ * @param in
+ * @param in_len
+ * @param out
+ * @param out_size 原始长度，块头中的字段。
+ * @return 解压后的字节数，-1 数据损坏：距离超出已解压的数据，或者超出 out_size。
+ */
+int app_lzss_decompress(const uint8_t* in, int in_len, uint8_t* out, int out_size) {
+    int in_pos = 0;
+    int out_pos = 0;
+    while (in_pos < in_len) {
+        uint8_t flags = in[in_pos++];
+        for (int bit = 0; bit < 8 && in_pos < in_len; bit++) {
+            if (flags & (1 << bit)) {
+                if (out_pos >= out_size) {
+                    return -1;
+                }
+                out[out_pos++] = in[in_pos++];
+                continue;
+            }
+            if (in_pos + 2 > in_len) {
+                return -1;
+            }
+            int dist = (((in[in_pos] & 0xF0) << 4) | in[in_pos + 1]) + 1;
+            int len = (in[in_pos] & 0x0F) + APP_LZSS_MIN_MATCH;
+            in_pos += 2;
+            if (dist > out_pos || out_pos + len > out_size) {
+                return -1;
+            }
+            for (int i = 0; i < len; i++) {// 距离可以小于长度，逐字节复制。
+                out[out_pos] = out[out_pos - dist];
+                out_pos++;
+            }
+        }
+    }
+    return out_pos;
+}
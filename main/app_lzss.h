@@ -0,0 +1,43 @@
+/**
+ * @brief   LZSS 压缩，用于日志上传。每块独立压缩，窗口不超过一块，不需要额外的解压状态。
+ *
+ *          压缩格式：每 8 个单元前面有 1 个标记字节，从低位开始，1 = 原始字节，0 = 匹配。
+ *          匹配占 2 字节：b0 高 4 位 + b1 是距离 - 1（1 ~ 4096），b0 低 4 位是长度 - 3（3 ~ 18）。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+
+ /**
+  * @brief 压缩窗口，块不能超过这个大小。
+  */
+#define APP_LZSS_WINDOW_SIZE        4096
+
+ /**
+  * @brief 哈希表大小，调用者提供 uint16_t[APP_LZSS_HASH_SIZE] 的工作区。
+  */
+#define APP_LZSS_HASH_SIZE          4096
+
+/**
+ * @brief 压缩一块数据。
+ * @param in
+ * @param in_len 不能超过 APP_LZSS_WINDOW_SIZE。
+ * @param out
+ * @param out_size
+ * @param hash 工作区，uint16_t[APP_LZSS_HASH_SIZE]。
+ * @return 压缩后的字节数，-1 输出缓冲区不够，调用者改为不压缩发送。
+ */
+int app_lzss_compress(const uint8_t* in, int in_len, uint8_t* out, int out_size, uint16_t* hash);
+
+/**
+ * @brief 解压一块数据，格式的参考实现，服务器按同样的规则解压。设备上不调用。
+ * @param in
+ * @param in_len
+ * @param out
+ * @param out_size 原始长度，块头中的字段。
+ * @return 解压后的字节数，-1 数据损坏：距离超出已解压的数据，或者超出 out_size。
+ */
+int app_lzss_decompress(const uint8_t* in, int in_len, uint8_t* out, int out_size);
@@ -7,6 +7,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <math.h>
 #include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
@@ -26,6 +28,7 @@
 #include "app_deamon.h"
 #include "app_sd.h"
 #include "app_wifi_ap.h"
+#include "app_http.h"
 #include "app_modem.h"
 #include "app_sntp.h"
 #include "app_mqtt.h"
@@ -34,6 +37,9 @@
 #include "app_gnss.h"
 #include "app_json.h"
 #include "app_ping.h"
+#include "app_drain.h"
+#include "app_ctrl.h"
+#include "app_fix.h"
 #include "app_main.h"
 #include "app_config.h"
 
@@ -91,6 +97,24 @@ void get_gnss_utc_time(char* buffer, size_t buffer_size) {
     strftime(buffer, buffer_size, "%Y%m%d%H%M%S000", &timeinfo);// GNSS 时间没有毫秒数。
 }
 
+/**
+ * @brief 当前数据转换为紧凑的定位记录，写入 PSRAM 环形缓冲区。
+ */
+static void app_main_push_fix(void) {
+    time_t now = time(NULL);
+    app_fix_t fix = {
+        .ts = now >= 1704067200 ? now : 0,// 早于 2024-01-01 视为没有同步。
+        .lat = lround(app_main_data.lat * 1e7),
+        .lon = lround(app_main_data.lon * 1e7),
+        .alt = app_main_data.alt < -32768 ? -32768 : app_main_data.alt > 32767 ? 32767 : lround(app_main_data.alt),
+        .spd = app_main_data.spd < 0 ? 0 : app_main_data.spd > 655.35 ? 65535 : lround(app_main_data.spd * 100),
+        .trk = app_main_data.trk < 0 ? 0 : app_main_data.trk > 655.35 ? 65535 : lround(app_main_data.trk * 100),
+        .sat = app_main_data.sat < 0 ? 0 : app_main_data.sat > 255 ? 255 : app_main_data.sat,
+        .flags = app_main_data.gnss_valid ? APP_FIX_FLAG_VALID : 0,
+    };
+    app_fix_push(&fix);
+}
+
 /**
  * @brief 循环任务。
  * @param
@@ -115,6 +139,7 @@ void app_main_loop_task(void) {
     app_main_data.trk = app_gnss_data.trk;// 航向角度。
     app_main_data.mag = app_gnss_data.mag;// 磁偏角度。
     pthread_mutex_unlock(&app_gnss_data.mutex);
+    app_main_push_fix();// 本地读取最近的轨迹，不访问 SD 卡。
 
     char json[512];
     app_json_serialize(json, sizeof(json), &app_main_data);
@@ -122,11 +147,14 @@ void app_main_loop_task(void) {
     // 如果有 MQTT，则 MQTT 推送到服务器。
     if (app_mqtt_5_client != NULL) {
 
-        int pub_ret = app_mqtt_publish_msg(json);
-        if (pub_ret >= 0) {// 推送成功。
+        int pub_ret = app_mqtt_publish_msg(json);// 断开连接时由 outbox 保存，超出预算转存到缓存。
+        if (pub_ret >= 0 && atomic_load(&app_mqtt_connected)) {// 推送成功。
             app_led_set_value(0, 1, 0, 0, 1, 0, app_main_data.gnss_valid);// 只闪绿色。
 
-        } else {// 推送失败，写入缓存。
+        } else if (pub_ret >= 0) {// 断开连接，等待重发。
+            app_led_set_value(2, 0, 0, 0, 1, 0, app_main_data.gnss_valid);// 红绿交替闪烁。
+
+        } else {// outbox 不能保存，写入缓存。
             app_sd_write_cache_file(json);
             app_led_set_value(2, 0, 0, 0, 1, 0, app_main_data.gnss_valid);// 红绿交替闪烁。
         }
@@ -135,8 +163,6 @@ void app_main_loop_task(void) {
         app_sd_write_cache_file(json);
         app_led_set_value(2, 1, 0, 2, 1, 0, app_main_data.gnss_valid);// 只闪黄色。
     }
-
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
 }
 
 /**
@@ -161,7 +187,13 @@ void app_main(void) {
         ESP_LOGI(TAG, "------ 初始化 SD 卡：OK。");
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
+    // 初始化定位记录缓冲区，SD 卡不可用时只保存在 PSRAM 中。
+    esp_err_t fix_ret = app_fix_init(sd_ret == ESP_OK);
+    if (fix_ret != ESP_OK) {
+        ESP_LOGE(TAG, "------ 初始化定位记录缓冲区：失败！");
+    } else {
+        ESP_LOGI(TAG, "------ 初始化定位记录缓冲区：OK。");
+    }
 
     // 初始化守护任务。
     esp_err_t deamon_ret = app_deamon_init();
@@ -172,8 +204,6 @@ void app_main(void) {
         ESP_LOGI(TAG, "------ 初始化守护任务：OK。");
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
-
     // 初始化 GPIO 执行模块。
     esp_err_t gpio_ret = app_gpio_init();
     if (gpio_ret != ESP_OK) {
@@ -183,8 +213,6 @@ void app_main(void) {
         ESP_LOGI(TAG, "------ 初始化 GPIO：OK。");
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
-
     // 初始化 AT 命令执行模块。
     esp_err_t at_ret = app_at_init();
     if (at_ret != ESP_OK) {
@@ -194,8 +222,6 @@ void app_main(void) {
         ESP_LOGI(TAG, "------ 初始化 AT：OK。");
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
-
     // 初始化 NVS，失败则终止运行。因为其它功能依赖于 NVS。
     esp_err_t nvs_ret = nvs_flash_init();
     if (nvs_ret == ESP_ERR_NVS_NO_FREE_PAGES || nvs_ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {// 如果 NVS 分区空间不足或者发现新版本，需要擦除 NVS 分区并重试初始化。
@@ -215,7 +241,13 @@ void app_main(void) {
         ESP_LOGI(TAG, "------ 初始化 NVS：OK。");
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
+    // 初始化远程控制，从 NVS 加载运行参数，失败使用默认参数。
+    esp_err_t ctrl_ret = app_ctrl_init();
+    if (ctrl_ret != ESP_OK) {
+        ESP_LOGE(TAG, "------ 初始化远程控制：失败！");
+    } else {
+        ESP_LOGI(TAG, "------ 初始化远程控制：OK。");
+    }
 
     // 初始化事件循环，主要用于网络接口。
     esp_err_t event_loop_ret = esp_event_loop_create_default();
@@ -226,8 +258,6 @@ void app_main(void) {
         ESP_LOGI(TAG, "------ 初始化 EVENT_LOOP：OK。");
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
-
     // 初始化 NETIF 网络接口。
     esp_err_t netif_ret = ESP_FAIL;
     if (event_loop_ret == ESP_OK) {
@@ -240,8 +270,6 @@ void app_main(void) {
         }
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
-
     // 初始化 4G MODEM。
     esp_err_t modem_ret = ESP_FAIL;
     if (netif_ret == ESP_OK) {
@@ -254,8 +282,6 @@ void app_main(void) {
         }
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
-
     // 初始化 WIFI 热点。没有热点还能凑合着跑，热点是为了其它功能提供上网服务，不影响本系统运行。
     if (netif_ret == ESP_OK) {
         esp_err_t wifi_ret = app_wifi_ap_init(app_main_data.dev_addr);
@@ -264,11 +290,12 @@ void app_main(void) {
             ESP_LOGE(TAG, "------ 初始化 WIFI 热点：失败！");
         } else {
             ESP_LOGI(TAG, "------ 初始化 WIFI 热点：OK。");
+            if (sd_ret == ESP_OK) {// 从热点导出 SD 卡缓存日志中的轨迹，失败不影响运行。
+                app_http_init();
+            }
         }
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
-
     // 初始化 BLE，失败不终止运行。
     if (gpio_ret == ESP_OK) {
         esp_err_t ble_ret = app_ble_init();
@@ -280,8 +307,6 @@ void app_main(void) {
         }
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
-
     // 初始化 SNTP。
     esp_err_t sntp_ret = ESP_FAIL;
     if (modem_ret == ESP_OK) {
@@ -294,7 +319,16 @@ void app_main(void) {
         }
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
+    // 初始化缓存推送任务，MQTT 连接事件会唤醒它，所以放在 MQTT 之前。
+    if (modem_ret == ESP_OK) {
+        esp_err_t drain_ret = app_drain_init();
+        if (drain_ret != ESP_OK) {
+            app_led_set_value(10, 10, 0, 10, 0, 0, 0);// 黄红交替闪烁。
+            ESP_LOGE(TAG, "------ 初始化缓存推送任务：失败！");
+        } else {
+            ESP_LOGI(TAG, "------ 初始化缓存推送任务：OK。");
+        }
+    }
 
     // 初始化 MQTT，失败不终止运行。可以写数据到本地。
     esp_err_t mqtt_ret = ESP_FAIL;
@@ -308,9 +342,8 @@ void app_main(void) {
         }
     }
 
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
-
-    // 初始化 PING 功能。
+    // 初始化 PING 功能，MQTT 链路探测失败以后使用。
+#if APP_PING_FALLBACK
     if (modem_ret == ESP_OK) {
         esp_err_t ping_ret = app_ping_init();
         if (ping_ret != ESP_OK) {
@@ -320,8 +353,7 @@ void app_main(void) {
             ESP_LOGI(TAG, "------ 初始化 PING：OK。");
         }
     }
-
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
+#endif
 
     // GNSS 上电需要时间，所以放到最后执行。
     // 初始化 GNSS，失败不终止运行。没有定位数据也能凑合着跑。
@@ -334,12 +366,9 @@ void app_main(void) {
             ESP_LOGI(TAG, "------ 初始化 GNSS：OK。");
         }
     }
-
-    app_sd_fsync_log_file();// 把日志写入 SD 卡。
     app_status = 1;
 
     ESP_LOGI(TAG, "------ APP MAIN 启动主任务循环......");
-    const TickType_t task_period = pdMS_TO_TICKS(1000);
     while (1) {
         TickType_t start_tick = xTaskGetTickCount();// 开始时间。
 
@@ -349,6 +378,8 @@ void app_main(void) {
         // vTaskGetRunTimeStats(buffer);
         // printf("---------------------------------------------\n%s", buffer);
 
+        // 上报周期由定位状态和速度决定，参数可以远程修改，实时跟踪模式优先。
+        const TickType_t task_period = pdMS_TO_TICKS(app_ctrl_report_period(app_main_data.gnss_valid, app_main_data.spd));
         TickType_t end_tick = xTaskGetTickCount();// 结束时间。
         TickType_t task_duration = end_tick - start_tick;
         if (task_duration > task_period) {// 是否需要延时至下一个周期。
@@ -356,12 +387,5 @@ void app_main(void) {
         } else {
             vTaskDelay(task_period - task_duration);
         }
-        if (app_main_data.gnss_valid == false) {// 如果数据无效，延迟 4 秒，5 秒一次。
-            vTaskDelay(pdMS_TO_TICKS(4000));
-        } else if (app_main_data.spd < 5) {// 停止未移动，速度小于 9.26 公里，5 秒一次。
-            vTaskDelay(pdMS_TO_TICKS(4000));
-        } else if (app_main_data.spd < 30) {// 低速移动，速度小于 55.56 公里，2 秒一次。
-            vTaskDelay(pdMS_TO_TICKS(1000));
-        }
     }
 }
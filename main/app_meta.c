@@ -0,0 +1,136 @@
+/**
+ * @brief   SD 卡元数据文件，双槽原子更新。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/unistd.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+#include "app_meta.h"
+
+ /**
+ * @brief 槽头魔数。
+ */
+#define APP_META_MAGIC      0x4154454D      // "META"
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_meta";
+
+/**
+ * @brief 槽头。
+ */
+typedef struct {
+    uint32_t magic;         // 魔数。
+    uint32_t seq;           // 序号，越大越新。
+    uint32_t len;           // 数据长度。
+    uint32_t crc;           // 槽头（不含 crc）和数据的 CRC32。
+} app_meta_head_t;
+
+/**
+ * @brief 计算槽的 CRC32。
+ */
+static uint32_t app_meta_crc(const app_meta_head_t* head, const void* data, size_t size) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)head, offsetof(app_meta_head_t, crc));
+    return esp_rom_crc32_le(crc, data, size);
+}
+
+/**
+ * @brief 打开文件，不存在则创建。
+ */
+static FILE* app_meta_open(app_meta_t* meta) {
+    if (meta->file == NULL) {
+        meta->file = fopen(meta->path, "r+b");
+    }
+    if (meta->file == NULL) {
+        meta->file = fopen(meta->path, "w+b");
+    }
+    return meta->file;
+}
+
+/**
+ * @brief 读取元数据，选择序号最大的有效槽。
+ * @param meta
+ * @param data
+ * @return ESP_OK 读取成功，ESP_ERR_NOT_FOUND 文件不存在或两个槽都无效。
+ */
+esp_err_t app_meta_load(app_meta_t* meta, void* data) {
+    meta->seq = 0;
+    if (access(meta->path, F_OK) == -1) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    FILE* file = app_meta_open(meta);
+    if (file == NULL) {
+        ESP_LOGE(TAG, "------ 元数据文件打开：失败！文件名：%s", meta->path);
+        return ESP_FAIL;
+    }
+    uint8_t* buf = malloc(meta->size);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    for (int slot = 0; slot < 2; slot++) {
+        app_meta_head_t head;
+        fseek(file, slot * (sizeof(head) + meta->size), SEEK_SET);
+        if (fread(&head, sizeof(head), 1, file) != 1 || fread(buf, meta->size, 1, file) != 1) {
+            continue;
+        }
+        if (head.magic != APP_META_MAGIC || head.len != meta->size || head.crc != app_meta_crc(&head, buf, meta->size)) {
+            continue;// 断电时正在写的槽，丢弃。
+        }
+        if (ret == ESP_ERR_NOT_FOUND || head.seq > meta->seq) {
+            memcpy(data, buf, meta->size);
+            meta->seq = head.seq;
+            ret = ESP_OK;
+        }
+    }
+    free(buf);
+    return ret;
+}
+
+/**
+ * @brief 保存元数据，写入较旧的槽，并且 fsync。
+ * @param meta
+ * @param data
+ * @return
+ */
+esp_err_t app_meta_save(app_meta_t* meta, const void* data) {
+    FILE* file = app_meta_open(meta);
+    if (file == NULL) {
+        ESP_LOGE(TAG, "------ 元数据文件打开：失败！文件名：%s", meta->path);
+        return ESP_FAIL;
+    }
+    app_meta_head_t head = {
+        .magic = APP_META_MAGIC,
+        .seq = meta->seq + 1,
+        .len = meta->size,
+    };
+    head.crc = app_meta_crc(&head, data, meta->size);
+    fseek(file, (head.seq & 1) * (sizeof(head) + meta->size), SEEK_SET);// 奇偶序号交替写两个槽。
+    if (fwrite(&head, sizeof(head), 1, file) != 1 || fwrite(data, meta->size, 1, file) != 1) {
+        ESP_LOGE(TAG, "------ 元数据文件写入：失败！文件名：%s", meta->path);
+        return ESP_FAIL;
+    }
+    fflush(file);
+    fsync(fileno(file));
+    meta->seq = head.seq;
+    return ESP_OK;
+}
+
+/**
+ * @brief 关闭元数据文件。
+ * @param meta
+ */
+void app_meta_close(app_meta_t* meta) {
+    if (meta->file != NULL) {
+        fclose(meta->file);
+        meta->file = NULL;
+    }
+}
@@ -0,0 +1,44 @@
+/**
+ * @brief   SD 卡元数据文件，双槽原子更新。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+ /**
+  * @brief 元数据文件句柄。
+  *        文件内有 A/B 两个槽，每次保存写入较旧的槽，断电只会损坏正在写的槽，另一个槽仍然有效。
+  */
+typedef struct {
+    const char* path;       // 文件名。
+    size_t size;            // 数据长度。
+    uint32_t seq;           // 最近一次保存的序号。
+    FILE* file;             // 文件句柄，保持打开，避免每次 fopen。
+} app_meta_t;
+
+/**
+ * @brief 读取元数据，选择序号最大的有效槽。
+ * @param meta
+ * @param data
+ * @return ESP_OK 读取成功，ESP_ERR_NOT_FOUND 文件不存在或两个槽都无效。
+ */
+esp_err_t app_meta_load(app_meta_t* meta, void* data);
+
+/**
+ * @brief 保存元数据，写入较旧的槽，并且 fsync。
+ * @param meta
+ * @param data
+ * @return
+ */
+esp_err_t app_meta_save(app_meta_t* meta, const void* data);
+
+/**
+ * @brief 关闭元数据文件。
+ * @param meta
+ */
+void app_meta_close(app_meta_t* meta);
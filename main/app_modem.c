@@ -10,6 +10,7 @@
 #include "esp_event.h"
 #include "usbh_modem_board.h"
 #include "usbh_modem_wifi.h"
+#include "iot_usbh_cdc.h"
 
 #include "app_at.h"
 #include "app_gpio.h"
@@ -106,4 +107,24 @@ esp_err_t app_modem_init(void) {
         board_ret = modem_board_ppp_start(30000);
     }
     return board_ret;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 输出统计数据到日志：PPP 上行帧打包进 USB URB 的情况，URB 利用率，两次输出之间的平均上行速率。
+ */
+void app_modem_log(void) {
+    static uint64_t last_bytes = 0;
+    static uint32_t last_ts = 0;
+    usbh_cdc_tx_stats_t stats;
+    if (usbh_cdc_itf_get_tx_stats(0, &stats) != ESP_OK) {
+        return;
+    }
+    uint32_t cur_ts = esp_log_timestamp();
+    uint32_t ms = cur_ts - last_ts;
+    ESP_LOGI(TAG, "------ USB 上行：帧 %lu，走缓冲区 %lu，URB %lu，字节 %llu，每个 URB 最多 %lu 帧，URB 利用率：%.1f%%，平均速率：%.1f KB/s",
+        stats.frames, stats.fallbacks, stats.urbs, stats.bytes, stats.max_frames_per_urb,
+        stats.urbs == 0 ? 0.0 : 100.0 * stats.bytes / ((double)stats.urbs * stats.buffer_size),
+        last_ts == 0 || ms == 0 ? 0.0 : (double)(stats.bytes - last_bytes) / ms);
+    last_bytes = stats.bytes;
+    last_ts = cur_ts;
+}
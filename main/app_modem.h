@@ -16,3 +16,8 @@ extern _Atomic int app_modem_net_conn;
  * @return
  */
 esp_err_t app_modem_init(void);
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_modem_log(void);
@@ -11,25 +11,101 @@
 #include <pthread.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/ringbuf.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "mqtt_client.h"
 
 #include "app_sd.h"
+#include "app_main.h"
+#include "app_cache.h"
+#include "app_ctrl.h"
+#include "app_rtt.h"
+#include "app_broker.h"
+#include "app_tls.h"
+#include "app_drain.h"
+#include "app_outbox.h"
 #include "app_modem.h"
 #include "app_config.h"
 
+ /**
+  * @brief 每收到 N 条连续的 PUBACK 提交一次缓存位置，窗口清空时也提交。
+  */
+#define APP_MQTT_COMMIT_BATCH   8
+
+ /**
+  * @brief 主题别名属性的字节数：属性标识 1 字节 + 别名 2 字节。
+  */
+#define APP_MQTT_ALIAS_PROP_LEN 3
+
  /**
   * @brief 日志 TAG。
   */
 static const char* TAG = "app_mqtt";
 
+/**
+ * @brief MQTT 5 主题别名。每次连接以后，第一条消息发送完整主题和别名，以后只发送别名。
+ */
+typedef struct {
+    char topic[64];         // 完整主题，启动时生成一次。
+    uint16_t alias;         // 别名，固定分配。
+    uint32_t sent_conn;     // 发送完整主题时的连接序号，等于当前连接序号时只发送别名。
+} app_mqtt_topic_t;
+
+/**
+ * @brief 消息主题。
+ */
+static app_mqtt_topic_t app_mqtt_topic_msg = { .topic = APP_MQTT_PUB_MGS_TOPIC, .alias = 1 };
+
+/**
+ * @brief 日志主题，topic/iotlog/<MAC>。
+ */
+static app_mqtt_topic_t app_mqtt_topic_log = { .alias = 2 };
+
+/**
+ * @brief 控制命令应答主题，topic/iotdev/<MAC>/ack。
+ */
+static app_mqtt_topic_t app_mqtt_topic_ack = { .alias = 3 };
+
+/**
+ * @brief 链路探测主题，topic/iotdev/<MAC>/ping。
+ */
+static app_mqtt_topic_t app_mqtt_topic_probe = { .alias = 4 };
+
+/**
+ * @brief 控制命令主题，topic/iotdev/<MAC>/cmd，每次连接以后订阅。
+ */
+static char app_mqtt_cmd_topic[64] = { 0 };
+
+/**
+ * @brief 连接序号，每次连接加 1，别名只在一次连接内有效。
+ *        事件回调持有客户端的锁，不能再获取发送互斥锁，所以用原子变量。
+ */
+static _Atomic uint32_t app_mqtt_conn_seq = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 关闭主题别名的连接序号，服务器不支持时本次连接关闭别名。
+ */
+static _Atomic uint32_t app_mqtt_alias_off_seq = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 主题别名节省的字节数，启动以后累计。
+ */
+static _Atomic uint32_t app_mqtt_alias_saved = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 发送互斥锁。
+ *        esp_mqtt5_client_set_publish_property() 设置的属性，由下一次发送使用，两个调用之间不能被其它任务插入。
+ */
+static pthread_mutex_t app_mqtt_pub_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /**
  * @brief MQTT 初始化状态。
  */
 static int app_mqtt_init_status = 0;
 
 /**
- * @brief 最近一次发送 MQTT 的时间戳。
+ * @brief 最近一次收到 PUBACK 或者连接成功的时间戳，守护任务据此判断服务器是否可达。
  */
 _Atomic uint32_t app_mqtt_last_ts = ATOMIC_VAR_INIT(0);
 
@@ -39,9 +115,356 @@ _Atomic uint32_t app_mqtt_last_ts = ATOMIC_VAR_INIT(0);
 esp_mqtt_client_handle_t app_mqtt_5_client;
 
 /**
- * @brief 是否推送日志备份文件。
+ * @brief MQTT 是否已连接。
+ */
+_Atomic int app_mqtt_connected = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 缓存消息，等待 PUBACK，按发送顺序排列。
+ */
+typedef struct {
+    int msg_id;
+    int acked;              // 是否已收到 PUBACK。
+    app_cache_pos_t end;    // 这条记录之后的缓存位置，收到 PUBACK 后提交。
+} app_mqtt_backlog_t;
+
+/**
+ * @brief 在途消息的互斥锁。
+ *        不能在持有此锁时调用 esp_mqtt_client_publish()，事件回调持有客户端的锁再获取此锁，会死锁。
+ */
+static pthread_mutex_t app_mqtt_inflight_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 实时消息在途表，只记录消息 ID，0 = 空闲。
+ *        消息内容保存在 outbox，没有收到 PUBACK 的由 outbox 转存到缓存。
+ */
+static int app_mqtt_live[APP_MQTT_LIVE_WINDOW] = { 0 };
+
+/**
+ * @brief 缓存消息在途窗口，环形队列。
+ */
+static app_mqtt_backlog_t app_mqtt_backlog[APP_MQTT_INFLIGHT_WINDOW] = { 0 };
+static int app_mqtt_backlog_head = 0;
+static int app_mqtt_backlog_count = 0;
+
+/**
+ * @brief 缓存读取位置，窗口中最后一条记录之后。
+ */
+static app_cache_pos_t app_mqtt_backlog_pos = { 0 };
+
+/**
+ * @brief 窗口代数，窗口重置后加 1，正在发送的旧记录不再入队。
+ */
+static uint32_t app_mqtt_backlog_gen = 0;
+
+/**
+ * @brief 已提交以后又收到的 PUBACK 条数。
+ */
+static int app_mqtt_backlog_acked = 0;
+
+/**
+ * @brief 窗口前端已收到 PUBACK 的位置，之前的记录都已确认，重置窗口时从这里重新读取。
+ *        提交由缓存推送任务执行，pending = 1 表示还没有提交。
+ */
+static app_cache_pos_t app_mqtt_backlog_acked_pos = { 0 };
+static int app_mqtt_commit_pending = 0;
+
+/**
+ * @brief 转存队列，outbox 转存的实时消息以 '\0' 结尾放入队列，由缓存推送任务写入缓存。
+ *        转存回调持有客户端的锁，不能等待 SD 卡。
+ */
+static RingbufHandle_t app_mqtt_spill_queue = NULL;
+
+/**
+ * @brief 单独跟踪的消息，同一时间只有一条等待 PUBACK。
+ */
+typedef struct {
+    int msg_id;
+    int ret;                // 1 收到 PUBACK，0 等待中，-1 被 outbox 转存。
+} app_mqtt_track_t;
+
+/**
+ * @brief 日志块和链路探测。
+ */
+static app_mqtt_track_t app_mqtt_track_log = { 0 };
+static app_mqtt_track_t app_mqtt_track_probe = { 0 };
+
+/**
+ * @brief 延迟采样，同一时间只有一条消息在采样。
+ */
+static int app_mqtt_rtt_id = 0;
+static uint32_t app_mqtt_rtt_ts = 0;
+
+/**
+ * @brief 发送返回之前就收到的 PUBACK，消息 ID 暂存在这里。
+ */
+static int app_mqtt_early_ack[4] = { 0 };
+static int app_mqtt_early_ack_idx = 0;
+
+/**
+ * @brief 检查并清除提前收到的 PUBACK，调用者持有锁。
+ */
+static int app_mqtt_take_early_ack(int msg_id) {
+    for (int i = 0; i < sizeof(app_mqtt_early_ack) / sizeof(app_mqtt_early_ack[0]); i++) {
+        if (app_mqtt_early_ack[i] == msg_id) {
+            app_mqtt_early_ack[i] = 0;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 开始跟踪一条消息，调用者持有锁。
+ */
+static void app_mqtt_track_set(app_mqtt_track_t* track, int msg_id) {
+    track->msg_id = msg_id;
+    track->ret = app_mqtt_take_early_ack(msg_id);
+}
+
+/**
+ * @brief 设置跟踪消息的结果，调用者持有锁。
+ * @return 1 是这条消息。
+ */
+static int app_mqtt_track_done(app_mqtt_track_t* track, int msg_id, int ret) {
+    if (track->msg_id == msg_id && track->ret == 0) {
+        track->ret = ret;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 查询跟踪消息的结果。
+ */
+static int app_mqtt_track_state(app_mqtt_track_t* track, int msg_id) {
+    pthread_mutex_lock(&app_mqtt_inflight_mutex);
+    int ret = track->msg_id == msg_id ? track->ret : -1;
+    pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+    return ret;
+}
+
+/**
+ * @brief 重置缓存窗口，从已确认的位置重新读取，调用者持有锁。
+ *        不读取缓存的提交位置，缓存正在 fsync 时不等待 SD 卡。
+ */
+static void app_mqtt_backlog_reset(void) {
+    app_mqtt_backlog_head = 0;
+    app_mqtt_backlog_count = 0;
+    app_mqtt_backlog_acked = 0;
+    app_mqtt_backlog_gen++;
+    app_mqtt_backlog_pos = app_mqtt_backlog_acked_pos;
+}
+
+/**
+ * @brief 弹出窗口前端已收到 PUBACK 的记录，必要时请求提交缓存位置，调用者持有锁。
+ *        不在这里写 SD 卡：调用者是 MQTT 事件任务，并且持有在途消息的锁，实时消息发送也在等这个锁。
+ * @return 1 需要提交，调用者释放锁以后通知缓存推送任务。
+ */
+static int app_mqtt_backlog_advance(void) {
+    int popped = 0;
+    while (app_mqtt_backlog_count > 0 && app_mqtt_backlog[app_mqtt_backlog_head].acked) {
+        app_mqtt_backlog_acked_pos = app_mqtt_backlog[app_mqtt_backlog_head].end;
+        app_mqtt_backlog_head = (app_mqtt_backlog_head + 1) % APP_MQTT_INFLIGHT_WINDOW;
+        app_mqtt_backlog_count--;
+        popped++;
+    }
+    app_mqtt_backlog_acked += popped;
+    if (popped > 0 && (app_mqtt_backlog_acked >= APP_MQTT_COMMIT_BATCH || app_mqtt_backlog_count == 0)) {
+        app_mqtt_commit_pending = 1;// 只有收到 PUBACK 才提交，断电重启后重发未确认的记录。
+        app_mqtt_backlog_acked = 0;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 提交已收到 PUBACK 的缓存位置，由缓存推送任务调用，写 SD 卡时不持有在途消息的锁。
+ */
+void app_mqtt_commit_cache(void) {
+    pthread_mutex_lock(&app_mqtt_inflight_mutex);
+    int pending = app_mqtt_commit_pending;
+    app_cache_pos_t pos = app_mqtt_backlog_acked_pos;
+    app_mqtt_commit_pending = 0;
+    pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+    if (pending && app_cache_commit(&pos) != ESP_OK) {
+        ESP_LOGW(TAG, "------ MQTT 提交缓存位置：失败！下次通知时重试。");
+        pthread_mutex_lock(&app_mqtt_inflight_mutex);
+        app_mqtt_commit_pending = 1;
+        pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+    }
+}
+
+/**
+ * @brief 收到 PUBACK。
+ */
+static void app_mqtt_on_published(int msg_id) {
+    int commit = 0;
+    uint32_t cur_ts = esp_log_timestamp();
+    atomic_store(&app_mqtt_last_ts, cur_ts);// 服务器可达。
+    pthread_mutex_lock(&app_mqtt_inflight_mutex);
+    if (app_mqtt_rtt_id == msg_id) {
+        app_rtt_add(cur_ts - app_mqtt_rtt_ts);
+        app_mqtt_rtt_id = 0;
+    }
+    int found = app_mqtt_track_done(&app_mqtt_track_log, msg_id, 1) || app_mqtt_track_done(&app_mqtt_track_probe, msg_id, 1);
+    for (int i = 0; i < APP_MQTT_LIVE_WINDOW && !found; i++) {
+        if (app_mqtt_live[i] == msg_id) {
+            app_mqtt_live[i] = 0;
+            found = 1;
+        }
+    }
+    for (int i = 0; i < app_mqtt_backlog_count && !found; i++) {
+        app_mqtt_backlog_t* item = &app_mqtt_backlog[(app_mqtt_backlog_head + i) % APP_MQTT_INFLIGHT_WINDOW];
+        if (item->msg_id == msg_id) {
+            item->acked = 1;
+            commit = app_mqtt_backlog_advance();
+            found = 1;
+        }
+    }
+    if (!found) {// 发送函数还没返回，先记下来。
+        app_mqtt_early_ack[app_mqtt_early_ack_idx] = msg_id;
+        app_mqtt_early_ack_idx = (app_mqtt_early_ack_idx + 1) % (sizeof(app_mqtt_early_ack) / sizeof(app_mqtt_early_ack[0]));
+    }
+    pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+    if (commit) {
+        app_drain_request_commit();
+    }
+}
+
+/**
+ * @brief outbox 转存回调，消息超出预算、过期或者只有主题别名，没有收到 PUBACK 就被删除。
+ *        实时消息放入转存队列，由缓存推送任务写入缓存；缓存消息从已确认位置重新发送，日志块从上传位置重新发送。
+ *        缓存消息按标记字段 "f":1 识别，包括窗口重置以前发送的，不会再次写入缓存。
+ *        由 outbox 在持有客户端锁时调用，不能调用 esp_mqtt_client_xxx()，不能写 SD 卡。
+ * @param msg_id
+ * @param payload 不以 '\0' 结尾。
+ * @param len
+ */
+static void app_mqtt_outbox_spill(int msg_id, const char* payload, int len) {
+    int backlog = len > 6 && memcmp(payload + len - 6, "\"f\":1}", 6) == 0;
+    pthread_mutex_lock(&app_mqtt_inflight_mutex);
+    if (app_mqtt_track_done(&app_mqtt_track_log, msg_id, -1) || app_mqtt_track_done(&app_mqtt_track_probe, msg_id, -1)) {// 日志块从上传位置重发，链路探测判为失败，都不写入缓存。
+        pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+        ESP_LOGW(TAG, "------ MQTT 日志块或链路探测没有确认。消息 ID：%d", msg_id);
+        return;
+    }
+    for (int i = 0; i < app_mqtt_backlog_count; i++) {
+        if (app_mqtt_backlog[(app_mqtt_backlog_head + i) % APP_MQTT_INFLIGHT_WINDOW].msg_id == msg_id) {
+            app_mqtt_backlog_reset();// 记录还在缓存中，没有提交。
+            backlog = 1;
+            break;
+        }
+    }
+    for (int i = 0; i < APP_MQTT_LIVE_WINDOW && !backlog; i++) {
+        if (app_mqtt_live[i] == msg_id) {
+            app_mqtt_live[i] = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+    if (backlog) {
+        ESP_LOGW(TAG, "------ MQTT 缓存消息没有确认，从已确认位置重新发送。消息 ID：%d", msg_id);
+        return;
+    }
+    char json[512];
+    if (len <= 0 || len >= sizeof(json)) {
+        ESP_LOGE(TAG, "------ MQTT 实时消息长度错误，不能写入缓存。消息 ID：%d，长度：%d", msg_id, len);
+        return;
+    }
+    memcpy(json, payload, len);
+    json[len] = '\0';
+    if (app_mqtt_spill_queue != NULL && xRingbufferSend(app_mqtt_spill_queue, json, len + 1, 0) == pdTRUE) {
+        ESP_LOGW(TAG, "------ MQTT 实时消息没有确认，等待写入缓存。消息 ID：%d", msg_id);
+        app_drain_request_spill();
+        return;
+    }
+    ESP_LOGE(TAG, "------ MQTT 转存队列已满，直接写入缓存。消息 ID：%d", msg_id);// 缓存推送任务长时间没有运行。
+    app_sd_write_cache_file(json);
+}
+
+/**
+ * @brief 转存队列中的实时消息写入缓存，由缓存推送任务调用。
  */
-static int app_mqtt_pub_bak_count = 0;
+void app_mqtt_write_spilled(void) {
+    if (app_mqtt_spill_queue == NULL) {
+        return;
+    }
+    size_t len = 0;
+    char* item;
+    while ((item = xRingbufferReceive(app_mqtt_spill_queue, &len, 0)) != NULL) {
+        char json[512];
+        memcpy(json, item, len);
+        vRingbufferReturnItem(app_mqtt_spill_queue, item);
+        app_sd_write_cache_file(json);
+    }
+}
+
+/**
+ * @brief 发送消息，已连接时使用主题别名，断开连接时发送完整主题，由 outbox 保存。
+ *        只有别名的消息如果断线，重新连接以后由 outbox 转存到缓存，不会原样重发。
+ * @param topic
+ * @param data
+ * @param len
+ * @param qos
+ * @return 同 esp_mqtt_client_publish()。
+ */
+static int app_mqtt_publish_topic(app_mqtt_topic_t* topic, const char* data, int len, int qos) {
+    pthread_mutex_lock(&app_mqtt_pub_mutex);
+    uint32_t pub_ts = esp_log_timestamp();
+    uint32_t conn_seq = atomic_load(&app_mqtt_conn_seq);
+    int use_alias = atomic_load(&app_mqtt_connected) && atomic_load(&app_mqtt_alias_off_seq) != conn_seq;
+    if (use_alias) {
+        esp_mqtt5_publish_property_config_t property = {
+            .topic_alias = topic->alias,
+        };
+        if (esp_mqtt5_client_set_publish_property(app_mqtt_5_client, &property) != ESP_OK) {
+            ESP_LOGW(TAG, "------ MQTT 服务器不支持主题别名，本次连接关闭别名。");
+            atomic_store(&app_mqtt_alias_off_seq, conn_seq);
+            use_alias = 0;
+        }
+    }
+    int alias_only = use_alias && topic->sent_conn == conn_seq;
+    int ret = esp_mqtt_client_publish(app_mqtt_5_client, alias_only ? "" : topic->topic, data, len, qos, 0);
+    if (ret >= 0 && use_alias) {
+        if (alias_only) {
+            atomic_fetch_add(&app_mqtt_alias_saved, strlen(topic->topic) - APP_MQTT_ALIAS_PROP_LEN);
+        } else {
+            topic->sent_conn = conn_seq;// 服务器已经记住别名。
+        }
+    }
+    if (ret > 0 && atomic_load(&app_mqtt_connected)) {// 已连接时发送的 QOS = 1 消息，采样 PUBACK 往返时间。
+        pthread_mutex_lock(&app_mqtt_inflight_mutex);
+        if (app_mqtt_rtt_id == 0 || pub_ts - app_mqtt_rtt_ts > 30000) {// 提前收到 PUBACK 的采样不会完成，超时放弃。
+            app_mqtt_rtt_id = ret;
+            app_mqtt_rtt_ts = pub_ts;
+        }
+        pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+    }
+    pthread_mutex_unlock(&app_mqtt_pub_mutex);
+    return ret;
+}
+
+/**
+ * @brief 连接以后重置别名，别名只在一次连接内有效。
+ *        上次连接只有别名的消息，在 outbox 重发之前转存到缓存。
+ */
+static void app_mqtt_reset_alias(void) {
+    app_outbox_spill_alias_only();
+    atomic_fetch_add(&app_mqtt_conn_seq, 1);
+    ESP_LOGI(TAG, "------ MQTT 主题别名，每条消息节省字节：%s = %d，%s = %d，累计节省字节：%lu",
+        app_mqtt_topic_msg.topic, strlen(app_mqtt_topic_msg.topic) - APP_MQTT_ALIAS_PROP_LEN,
+        app_mqtt_topic_log.topic, strlen(app_mqtt_topic_log.topic) - APP_MQTT_ALIAS_PROP_LEN,
+        atomic_load(&app_mqtt_alias_saved));
+}
+
+/**
+ * @brief 主题别名节省的字节数，启动以后累计。
+ * @return
+ */
+uint32_t app_mqtt_get_alias_saved(void) {
+    return atomic_load(&app_mqtt_alias_saved);
+}
 
 /**
  * @brief MQTT 发消息给服务器。
@@ -54,28 +477,185 @@ int app_mqtt_publish_msg(char* msg) {
         ESP_LOGE(TAG, "------ MQTT 初始化失败，MQTT 客户端状态：不可用！");
         return -1;
     }
-    int ret = esp_mqtt_client_publish(app_mqtt_5_client, APP_MQTT_PUB_MGS_TOPIC, msg, strlen(msg), APP_MQTT_QOS, 0);
-    if (ret >= 0) {
-        atomic_store(&app_mqtt_last_ts, esp_log_timestamp());
+    int ret = app_mqtt_publish_topic(&app_mqtt_topic_msg, msg, strlen(msg), APP_MQTT_QOS);// 断开连接时保存在 outbox，重新连接以后发送。
+
+    pthread_mutex_lock(&app_mqtt_inflight_mutex);
+    if (ret > 0 && !app_mqtt_take_early_ack(ret)) {
+        for (int i = 0; i < APP_MQTT_LIVE_WINDOW; i++) {// 在途表满了不跟踪，只影响缓存推送让路。
+            if (app_mqtt_live[i] == 0) {
+                app_mqtt_live[i] = ret;// 等待 PUBACK。
+                break;
+            }
+        }
     }
+    pthread_mutex_unlock(&app_mqtt_inflight_mutex);
     return ret;
 }
 
 /**
- * @brief MQTT 发日志给服务器。
- * @param topic
- * @param msg
- * @return
+ * @brief MQTT 发日志块给服务器，主题是 topic/iotlog/<MAC>，QOS = 1。
+ *        同一时间只有一个日志块等待 PUBACK，用 app_mqtt_log_chunk_state() 查询结果。
+ * @param data
+ * @param len
+ * @return 消息 ID，-1 失败。
  */
-int app_mqtt_publish_log(char* topic, char* log) {
+int app_mqtt_publish_log_chunk(const char* data, int len) {
     if (app_mqtt_init_status == 0) {
         ESP_LOGE(TAG, "------ MQTT 初始化失败，MQTT 客户端状态：不可用！");
         return -1;
     }
-    int ret = esp_mqtt_client_publish(app_mqtt_5_client, topic, log, strlen(log), APP_MQTT_QOS, 0);
+    int ret = app_mqtt_publish_topic(&app_mqtt_topic_log, data, len, APP_MQTT_QOS);
+    if (ret <= 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&app_mqtt_inflight_mutex);
+    app_mqtt_track_set(&app_mqtt_track_log, ret);
+    pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+    return ret;
+}
+
+/**
+ * @brief 查询日志块的发送结果。
+ * @param msg_id
+ * @return 1 收到 PUBACK，0 等待中，-1 被 outbox 转存或者已经发送了新的日志块，需要从上传位置重发。
+ */
+int app_mqtt_log_chunk_state(int msg_id) {
+    return app_mqtt_track_state(&app_mqtt_track_log, msg_id);
+}
+
+/**
+ * @brief 链路探测，发送一条空的 QOS = 1 消息，主题是 topic/iotdev/<MAC>/ping，用 PUBACK 确认服务器可达。
+ *        使用主题别名以后每次只有十几个字节，和 PINGREQ 差不多，往返时间计入延迟统计。
+ * @return 消息 ID，-1 失败或者没有连接。
+ */
+int app_mqtt_probe(void) {
+    if (app_mqtt_init_status == 0 || !atomic_load(&app_mqtt_connected)) {
+        return -1;
+    }
+    int ret = app_mqtt_publish_topic(&app_mqtt_topic_probe, "", 0, APP_MQTT_QOS);
+    if (ret <= 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&app_mqtt_inflight_mutex);
+    app_mqtt_track_set(&app_mqtt_track_probe, ret);
+    pthread_mutex_unlock(&app_mqtt_inflight_mutex);
     return ret;
 }
 
+/**
+ * @brief 查询链路探测的结果。
+ * @param msg_id
+ * @return 1 收到 PUBACK，0 等待中，-1 失败：被 outbox 转存，或者已经发送了新的探测消息。
+ */
+int app_mqtt_probe_state(int msg_id) {
+    return app_mqtt_track_state(&app_mqtt_track_probe, msg_id);
+}
+
+/**
+ * @brief MQTT 发控制命令应答给服务器，主题是 topic/iotdev/<MAC>/ack，QOS = APP_MQTT_ACK_QOS。
+ * @param ack 以 0 结尾的应答字符串。
+ * @return 同 esp_mqtt_client_publish()，没有初始化时返回 -1。
+ */
+int app_mqtt_publish_ack(char* ack) {
+    if (app_mqtt_init_status == 0) {
+        ESP_LOGE(TAG, "------ MQTT 初始化失败，MQTT 客户端状态：不可用！");
+        return -1;
+    }
+    return app_mqtt_publish_topic(&app_mqtt_topic_ack, ack, strlen(ack), APP_MQTT_ACK_QOS);
+}
+
+/**
+ * @brief MQTT 发补传记录给服务器，主题和实时消息相同，QOS = 0，不占用在途窗口，不进入 outbox。
+ * @param data
+ * @param len
+ * @return 同 esp_mqtt_client_publish()。
+ */
+int app_mqtt_publish_backfill(const char* data, int len) {
+    if (app_mqtt_init_status == 0) {
+        return -1;
+    }
+    return app_mqtt_publish_topic(&app_mqtt_topic_msg, data, len, APP_MQTT_BACKFILL_QOS);
+}
+
+/**
+ * @brief 等待 PUBACK 的实时消息条数。
+ * @return
+ */
+int app_mqtt_live_inflight(void) {
+    int count = 0;
+    pthread_mutex_lock(&app_mqtt_inflight_mutex);
+    for (int i = 0; i < APP_MQTT_LIVE_WINDOW; i++) {
+        if (app_mqtt_live[i] != 0) {
+            count++;
+        }
+    }
+    pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+    return count;
+}
+
+/**
+ * @brief 等待 PUBACK 的缓存消息条数。
+ * @return
+ */
+int app_mqtt_cache_inflight(void) {
+    pthread_mutex_lock(&app_mqtt_inflight_mutex);
+    int count = app_mqtt_backlog_count;
+    pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+    return count;
+}
+
+/**
+ * @brief 推送缓存，填满在途窗口或者达到条数后返回，不等待 PUBACK。
+ *        由缓存推送任务调用，同一时间只能有一个调用者。
+ * @param max_count 最多发送条数。
+ * @return 本次发送条数，-1 发送失败。
+ */
+int app_mqtt_pub_cache(int max_count) {
+    if (app_mqtt_init_status == 0) {
+        return -1;
+    }
+    int pub_count = 0;
+    char line[1024];
+    while (pub_count < max_count) {
+        pthread_mutex_lock(&app_mqtt_inflight_mutex);
+        if (app_mqtt_backlog_count >= APP_MQTT_INFLIGHT_WINDOW) {
+            pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+            break;
+        }
+        app_cache_pos_t pos = app_mqtt_backlog_pos;
+        uint32_t gen = app_mqtt_backlog_gen;
+        pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+
+        int len = app_cache_read(&pos, line, sizeof(line));
+        if (len <= 0) {
+            break;
+        }
+        int msg_id = app_mqtt_publish_topic(&app_mqtt_topic_msg, line, len, APP_MQTT_QOS);
+        if (msg_id < 0) {// 发送失败，读取位置不变，下次重试。
+            ESP_LOGW(TAG, "------ MQTT 推送缓存：中断。本次推送条数：%d，剩余字节：%lu", pub_count, app_cache_remaining());
+            return -1;
+        }
+
+        int commit = 0;
+        pthread_mutex_lock(&app_mqtt_inflight_mutex);
+        if (gen == app_mqtt_backlog_gen) {// 窗口重置过，丢弃这条记录的跟踪，稍后从确认位置重发。
+            app_mqtt_backlog_t* item = &app_mqtt_backlog[(app_mqtt_backlog_head + app_mqtt_backlog_count) % APP_MQTT_INFLIGHT_WINDOW];
+            item->msg_id = msg_id;
+            item->acked = msg_id == 0 || app_mqtt_take_early_ack(msg_id);// QOS = 0 时没有 PUBACK。
+            item->end = pos;
+            app_mqtt_backlog_count++;
+            app_mqtt_backlog_pos = pos;
+            commit = app_mqtt_backlog_advance();
+        }
+        pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+        if (commit) {// 调用者就是缓存推送任务，直接提交。
+            app_mqtt_commit_cache();
+        }
+        pub_count++;
+    }
+    return pub_count;
+}
+
 /**
  * @brief MQTT 事件回调函数。
  * @param handler_args
@@ -85,23 +665,45 @@ int app_mqtt_publish_log(char* topic, char* log) {
  * @return
  */
 static void app_mqtt_event_handler(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data) {
+    esp_mqtt_event_handle_t event = event_data;
     switch ((esp_mqtt_event_id_t)event_id) {
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "------ MQTT 事件：已连接。");
-            if (app_mqtt_pub_bak_count == 0) {
-                app_sd_pub_log_bak_file();
-                app_sd_pub_cache_bak_file();
-                app_mqtt_pub_bak_count = 1;
-            }
+            app_broker_on_connected();
+            app_mqtt_reset_alias();// 先更新连接序号，再设置已连接，发送时不会用到上次连接的别名。
+            atomic_store(&app_mqtt_connected, 1);
+            atomic_store(&app_mqtt_last_ts, esp_log_timestamp());
+            esp_mqtt_client_subscribe(app_mqtt_5_client, app_mqtt_cmd_topic, 1);// 不保留会话，每次连接都要订阅。
+            app_drain_notify_connected();// 每次连接都继续推送缓存，未确认的记录由 outbox 重发。
             break;
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGI(TAG, "------ MQTT 事件：断开连接！");
+            atomic_store(&app_mqtt_connected, 0);
+            pthread_mutex_lock(&app_mqtt_inflight_mutex);
+            app_mqtt_rtt_id = 0;// 重连以后重发的消息不采样。
+            pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+            app_drain_notify_disconnected();
             break;
         case MQTT_EVENT_PUBLISHED:
-            ESP_LOGI(TAG, "------ MQTT 事件：发布完成！");
+            app_mqtt_on_published(event->msg_id);
+            app_drain_kick();// 窗口有空位，继续推送。
+            break;
+        case MQTT_EVENT_DELETED:
+            ESP_LOGI(TAG, "------ MQTT 事件：消息过期，已由 outbox 转存。消息 ID：%d", event->msg_id);
+            app_drain_kick();// 日志上传在等待这条消息。
+            break;
+        case MQTT_EVENT_SUBSCRIBED:
+            ESP_LOGI(TAG, "------ MQTT 事件：已订阅。主题：%s", app_mqtt_cmd_topic);
+            break;
+        case MQTT_EVENT_DATA:
+            if (event->topic_len == strlen(app_mqtt_cmd_topic) && strncmp(event->topic, app_mqtt_cmd_topic, event->topic_len) == 0
+                && event->data_len == event->total_data_len) {// 控制命令很短，不处理分段的消息。
+                app_ctrl_on_cmd(event->data, event->data_len);
+            }
             break;
         case MQTT_EVENT_BEFORE_CONNECT:
             ESP_LOGI(TAG, "------ MQTT 事件：连接之前！");
+            app_broker_on_before_connect(app_mqtt_5_client);// 连续失败时切换服务器。
             break;
         default:
             ESP_LOGI(TAG, "------ MQTT 其它事件。EVENT ID：%ld", event_id);
@@ -125,15 +727,25 @@ esp_err_t app_mqtt_init(char* will_msg, size_t will_msg_len) {
         }
     }
 
+#if APP_MQTT_TLS
+    if (app_tls_init() != ESP_OK) {// 没有有效的 CA 证书不连接，不退回明文。
+        ESP_LOGE(TAG, "------ 初始化 MQTT TLS：失败！");
+        return ESP_FAIL;
+    }
+#endif
+
     esp_mqtt_client_config_t mqtt5_cfg = {
         .session.protocol_ver = MQTT_PROTOCOL_V_5,
-        .broker.address.uri = APP_MQTT_URI,
+        .broker.address.uri = app_broker_get_uri(),
         .credentials.username = APP_MQTT_USERNAME,
         .credentials.authentication.password = APP_MQTT_PASSWORD,
 
         .network.timeout_ms = 2000,// 网络操作超时为 2 秒。MQTT_NETWORK_TIMEOUT_MS 默认 10 秒。
         .network.reconnect_timeout_ms = 2000,// 设置重连间隔为 2 秒。MQTT_RECON_DEFAULT_MS 默认 10 秒。
         .network.disable_auto_reconnect = false,    // 自动连接！
+#if APP_MQTT_TLS
+        .network.transport = app_tls_get_transport(),// 自定义传输层，缓存 TLS 会话，重连时恢复会话。
+#endif
 
         .session.last_will.topic = APP_MQTT_WILL_TOPIC,
         .session.last_will.msg = will_msg,
@@ -142,11 +754,33 @@ esp_err_t app_mqtt_init(char* will_msg, size_t will_msg_len) {
         .session.last_will.retain = true,
     };
 
+    snprintf(app_mqtt_topic_log.topic, sizeof(app_mqtt_topic_log.topic), "%s/%s", APP_MQTT_PUB_LOG_TOPIC, app_main_data.dev_addr);// 只生成一次。
+    snprintf(app_mqtt_topic_ack.topic, sizeof(app_mqtt_topic_ack.topic), "%s/%s/ack", APP_MQTT_DEV_TOPIC, app_main_data.dev_addr);
+    snprintf(app_mqtt_topic_probe.topic, sizeof(app_mqtt_topic_probe.topic), "%s/%s/ping", APP_MQTT_DEV_TOPIC, app_main_data.dev_addr);
+    snprintf(app_mqtt_cmd_topic, sizeof(app_mqtt_cmd_topic), "%s/%s/cmd", APP_MQTT_DEV_TOPIC, app_main_data.dev_addr);
+
+    app_cache_pos_t commit_pos;
+    app_cache_get_commit(&commit_pos);
+    pthread_mutex_lock(&app_mqtt_inflight_mutex);
+    app_mqtt_backlog_acked_pos = commit_pos;
+    app_mqtt_backlog_reset();// 从已提交位置开始推送缓存。
+    pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+
+    static StaticRingbuffer_t spill_queue_struct;
+    uint8_t* spill_queue_buf = heap_caps_malloc(APP_MQTT_SPILL_QUEUE, MALLOC_CAP_SPIRAM);
+    if (spill_queue_buf != NULL) {// 分配失败时转存回调直接写入缓存。
+        app_mqtt_spill_queue = xRingbufferCreateStatic(APP_MQTT_SPILL_QUEUE, RINGBUF_TYPE_NOSPLIT, spill_queue_buf, &spill_queue_struct);
+    }
+    app_outbox_set_spill_cb(app_mqtt_outbox_spill);
+
     app_mqtt_5_client = esp_mqtt_client_init(&mqtt5_cfg);
     esp_mqtt_client_register_event(app_mqtt_5_client, ESP_EVENT_ANY_ID, app_mqtt_event_handler, NULL);
     esp_err_t mqtt_ret = esp_mqtt_client_start(app_mqtt_5_client);
     if (mqtt_ret == ESP_OK) {
         app_mqtt_init_status = 1;
+        if (app_broker_init(app_mqtt_5_client) != ESP_OK) {// 不影响使用当前服务器。
+            ESP_LOGE(TAG, "------ 初始化 MQTT 服务器探测：失败！");
+        }
     }
     return mqtt_ret;
-}
\ No newline at end of file
+}
@@ -9,10 +9,15 @@
 #include "mqtt_client.h"
 
  /**
-  * @brief 最近一次发送 MQTT 的时间戳。
+  * @brief 最近一次收到 PUBACK 或者连接成功的时间戳。
   */
 extern _Atomic uint32_t app_mqtt_last_ts;
 
+/**
+ * @brief MQTT 是否已连接。
+ */
+extern _Atomic int app_mqtt_connected;
+
 /**
  * @brief MQTT 5 客户端。
  */
@@ -27,12 +32,85 @@ extern esp_mqtt_client_handle_t app_mqtt_5_client;
 int app_mqtt_publish_msg(char* msg);
 
 /**
- * @brief MQTT 发日志给服务器。
- * @param topic
- * @param msg
+ * @brief MQTT 发日志块给服务器，主题是 topic/iotlog/<MAC>，QOS = 1。
+ *        同一时间只有一个日志块等待 PUBACK，用 app_mqtt_log_chunk_state() 查询结果。
+ * @param data 日志块，块头加压缩数据。
+ * @param len
+ * @return 消息 ID，-1 失败。
+ */
+int app_mqtt_publish_log_chunk(const char* data, int len);
+
+/**
+ * @brief 查询日志块的发送结果。
+ * @param msg_id app_mqtt_publish_log_chunk() 返回的消息 ID。
+ * @return 1 收到 PUBACK，0 等待中，-1 被 outbox 转存或者已经发送了新的日志块，需要从上传位置重发。
+ */
+int app_mqtt_log_chunk_state(int msg_id);
+
+/**
+ * @brief 链路探测，发送一条空的 QOS = 1 消息，主题是 topic/iotdev/<MAC>/ping，用 PUBACK 确认服务器可达。
+ *        同一时间只跟踪一条探测消息，用 app_mqtt_probe_state() 查询结果。
+ * @return 消息 ID，-1 失败或者没有连接。
+ */
+int app_mqtt_probe(void);
+
+/**
+ * @brief 查询链路探测的结果。
+ * @param msg_id app_mqtt_probe() 返回的消息 ID。
+ * @return 1 收到 PUBACK，0 等待中，-1 失败：被 outbox 转存，或者已经发送了新的探测消息。
+ */
+int app_mqtt_probe_state(int msg_id);
+
+/**
+ * @brief 主题别名节省的字节数，启动以后累计。
  * @return
  */
-int app_mqtt_publish_log(char* topic, char* log);
+uint32_t app_mqtt_get_alias_saved(void);
+
+/**
+ * @brief MQTT 发控制命令应答给服务器，主题是 topic/iotdev/<MAC>/ack，QOS = APP_MQTT_ACK_QOS。
+ * @param ack 以 0 结尾的应答字符串。
+ * @return 同 esp_mqtt_client_publish()，没有初始化时返回 -1。
+ */
+int app_mqtt_publish_ack(char* ack);
+
+/**
+ * @brief MQTT 发补传记录给服务器，主题和实时消息相同，QOS = 0，不占用在途窗口，不进入 outbox。
+ * @param data
+ * @param len
+ * @return 同 esp_mqtt_client_publish()。
+ */
+int app_mqtt_publish_backfill(const char* data, int len);
+
+/**
+ * @brief 等待 PUBACK 的实时消息条数。
+ * @return
+ */
+int app_mqtt_live_inflight(void);
+
+/**
+ * @brief 等待 PUBACK 的缓存消息条数。
+ * @return
+ */
+int app_mqtt_cache_inflight(void);
+
+/**
+ * @brief 推送缓存，填满在途窗口或者达到条数后返回，不等待 PUBACK。
+ *        由缓存推送任务调用，同一时间只能有一个调用者。
+ * @param max_count 最多发送条数。
+ * @return 本次发送条数，-1 发送失败。
+ */
+int app_mqtt_pub_cache(int max_count);
+
+/**
+ * @brief 提交已收到 PUBACK 的缓存位置，由缓存推送任务调用，写 SD 卡时不持有在途消息的锁。
+ */
+void app_mqtt_commit_cache(void);
+
+/**
+ * @brief outbox 转存的实时消息写入缓存，由缓存推送任务调用。
+ */
+void app_mqtt_write_spilled(void);
 
 /**
  * @brief 初始化函数。
@@ -0,0 +1,45 @@
+/**
+ * @brief   MQTT 自定义 outbox，消息保存在 PSRAM，固定内存预算，超出预算或过期的消息转存到 SD 卡缓存。
+ *          实现在 outbox/app_outbox.c，编译进 mqtt 组件，见项目 CMakeLists.txt。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+
+ /**
+  * @brief 转存回调，outbox 删除一条未确认的 PUBLISH 之前调用。
+  *        payload 不以 '\0' 结尾，回调返回以后失效。
+  */
+typedef void (*app_outbox_spill_cb_t)(int msg_id, const char* payload, int len);
+
+/**
+ * @brief outbox 统计数据。
+ */
+typedef struct {
+    uint32_t count;             // 当前消息条数。
+    uint32_t size;              // 当前占用字节数。
+    uint32_t peak;              // 最大占用字节数。
+    uint32_t spilled;           // 启动以后转存到 SD 卡的条数。
+} app_outbox_stats_t;
+
+/**
+ * @brief 设置转存回调，MQTT 初始化之前调用。
+ * @param cb
+ */
+void app_outbox_set_spill_cb(app_outbox_spill_cb_t cb);
+
+/**
+ * @brief 转存只有主题别名、没有完整主题的 PUBLISH。
+ *        别名只在一次连接内有效，新连接上重发会被服务器拒绝，连接成功以后、重发之前调用。
+ * @return 转存条数。
+ */
+int app_outbox_spill_alias_only(void);
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_outbox_get_stats(app_outbox_stats_t* stats);
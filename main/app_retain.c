@@ -0,0 +1,356 @@
+/**
+ * @brief   SD 卡归档文件保留策略。索引文件记录归档的日志文件（文件名、时间范围、字节数、是否已上传），
+ *          按总字节数和最长保留时间删除，先删除已上传的最旧文件。启动时只读取索引，不遍历目录。
+ *
+ *          以前每次启动遍历 LOG 和 CACHE 目录两次，每个文件比较 6 次文件名，而且拿完整路径和 d_name 比较，
+ *          排除的文件名从来不会匹配；超过 100 个文件时一次删除全部备份。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "app_sd.h"
+#include "app_meta.h"
+#include "app_retain.h"
+#include "app_config.h"
+
+ /**
+ * @brief 索引文件名。
+ */
+#define APP_RETAIN_DAT              APP_SD_LOG_DIR"/INDEX.DAT"
+
+ /**
+ * @brief 早于这个时间视为没有同步，2024-01-01。
+ */
+#define APP_RETAIN_TIME_VALID       1704067200
+
+ /**
+ * @brief 索引项标记。
+ */
+#define APP_RETAIN_FLAG_UPLOADED    0x01
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_retain";
+
+/**
+ * @brief 索引项，按归档顺序排列，最旧的在前面。
+ */
+typedef struct {
+    char name[20];          // 相对挂载点的文件名，例如 LOG/L0000001.TXT。
+    uint32_t t0;            // 开始时间，UTC 秒，0 = 未知。
+    uint32_t t1;            // 结束时间，文件的修改时间，0 = 未知。
+    uint32_t size;          // 字节数。
+    uint32_t flags;         // APP_RETAIN_FLAG_*
+} app_retain_entry_t;
+
+/**
+ * @brief 持久化的索引。
+ */
+typedef struct {
+    uint32_t count;
+    app_retain_entry_t entries[APP_RETAIN_MAX_FILES];
+} app_retain_index_t;
+
+/**
+ * @brief 互斥锁，启动、时间同步、缓存推送任务都会修改索引。
+ */
+static pthread_mutex_t app_retain_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 索引，放在 PSRAM 中。
+ */
+static app_retain_index_t* app_retain_index = NULL;
+
+/**
+ * @brief 索引文件。
+ */
+static app_meta_t app_retain_meta = {
+    .path = APP_RETAIN_DAT,
+    .size = sizeof(app_retain_index_t),
+};
+
+/**
+ * @brief 总字节数和启动以后删除的文件数。
+ */
+static uint32_t app_retain_bytes = 0;
+static uint32_t app_retain_evicted = 0;
+
+/**
+ * @brief 完整路径转换为相对挂载点的文件名。
+ */
+static const char* app_retain_name(const char* path) {
+    size_t len = strlen(SDMMC_MOUNT_POINT"/");
+    return strncmp(path, SDMMC_MOUNT_POINT"/", len) == 0 ? path + len : path;
+}
+
+/**
+ * @brief 查找索引项。
+ * @return 下标，-1 没有找到。
+ */
+static int app_retain_find(const char* name) {
+    for (uint32_t i = 0; i < app_retain_index->count; i++) {
+        if (strncmp(app_retain_index->entries[i].name, name, sizeof(app_retain_index->entries[i].name)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 选择要删除的文件，调用者持有锁。
+ *        先删除超过最长保留时间的文件，再按总字节数删除已上传的最旧文件，没有已上传的文件时删除最旧的文件。
+ * @param force 索引已满，必须删除一个文件。
+ * @return 下标，-1 不需要删除。
+ */
+static int app_retain_pick(time_t now, bool force) {
+    app_retain_index_t* index = app_retain_index;
+    if (now >= APP_RETAIN_TIME_VALID) {
+        for (uint32_t i = 0; i < index->count; i++) {
+            if (index->entries[i].t1 != 0 && index->entries[i].t1 + APP_RETAIN_MAX_AGE < now) {
+                return i;
+            }
+        }
+    }
+    if (!force && app_retain_bytes <= APP_RETAIN_MAX_BYTES) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < index->count; i++) {
+        if (index->entries[i].flags & APP_RETAIN_FLAG_UPLOADED) {
+            return i;
+        }
+    }
+    return index->count > 0 ? 0 : -1;
+}
+
+/**
+ * @brief 删除文件和索引项，调用者持有锁。
+ */
+static void app_retain_evict(int i) {
+    app_retain_index_t* index = app_retain_index;
+    app_retain_entry_t* entry = &index->entries[i];
+    char path[48];
+    snprintf(path, sizeof(path), SDMMC_MOUNT_POINT"/%.*s", (int)sizeof(entry->name), entry->name);
+    remove(path);
+    if (entry->flags & APP_RETAIN_FLAG_UPLOADED) {
+        ESP_LOGI(TAG, "------ 归档文件删除：%s，字节数：%lu", path, entry->size);
+    } else {
+        ESP_LOGW(TAG, "------ 归档文件删除还没上传的文件：%s，字节数：%lu", path, entry->size);
+    }
+    app_retain_bytes -= entry->size;
+    app_retain_evicted++;
+    index->count--;
+    memmove(entry, entry + 1, (index->count - i) * sizeof(app_retain_entry_t));
+}
+
+/**
+ * @brief 执行保留策略，调用者持有锁。
+ * @return 删除的文件数。
+ */
+static int app_retain_enforce_locked(void) {
+    time_t now = time(NULL);
+    int count = 0;
+    int i;
+    while ((i = app_retain_pick(now, false)) >= 0) {
+        app_retain_evict(i);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief 添加索引项，调用者持有锁。
+ */
+static void app_retain_insert(const char* name, const struct stat* st, uint32_t t0, bool uploaded) {
+    app_retain_index_t* index = app_retain_index;
+    int i = app_retain_find(name);
+    if (i >= 0) {// 已经在索引中，更新字节数。
+        app_retain_bytes -= index->entries[i].size;
+    } else {
+        if (index->count >= APP_RETAIN_MAX_FILES) {
+            app_retain_evict(app_retain_pick(time(NULL), true));
+        }
+        i = index->count++;
+    }
+    app_retain_entry_t* entry = &index->entries[i];
+    memset(entry, 0, sizeof(app_retain_entry_t));
+    strncpy(entry->name, name, sizeof(entry->name));
+    entry->t0 = t0;
+    entry->t1 = st->st_mtime >= APP_RETAIN_TIME_VALID ? st->st_mtime : 0;
+    entry->size = st->st_size;
+    entry->flags = uploaded ? APP_RETAIN_FLAG_UPLOADED : 0;
+    app_retain_bytes += entry->size;
+}
+
+/**
+ * @brief 添加归档文件到索引，然后执行保留策略。
+ * @param path 文件名，在 SD 卡挂载点下。
+ * @param t0 开始时间，UTC 秒，0 = 未知。结束时间取文件的修改时间。
+ * @param uploaded 是否已上传。
+ */
+void app_retain_add(const char* path, uint32_t t0, bool uploaded) {
+    struct stat st;
+    if (app_retain_index == NULL || stat(path, &st) != 0) {
+        return;
+    }
+    pthread_mutex_lock(&app_retain_mutex);
+    app_retain_insert(app_retain_name(path), &st, t0, uploaded);
+    app_retain_enforce_locked();
+    app_meta_save(&app_retain_meta, app_retain_index);
+    pthread_mutex_unlock(&app_retain_mutex);
+}
+
+/**
+ * @brief 标记文件已上传。
+ * @param path
+ */
+void app_retain_uploaded(const char* path) {
+    if (app_retain_index == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&app_retain_mutex);
+    int i = app_retain_find(app_retain_name(path));
+    if (i >= 0 && (app_retain_index->entries[i].flags & APP_RETAIN_FLAG_UPLOADED) == 0) {
+        app_retain_index->entries[i].flags |= APP_RETAIN_FLAG_UPLOADED;
+        app_meta_save(&app_retain_meta, app_retain_index);
+    }
+    pthread_mutex_unlock(&app_retain_mutex);
+}
+
+/**
+ * @brief 执行保留策略。时间同步以后调用，检查最长保留时间。
+ */
+void app_retain_enforce(void) {
+    if (app_retain_index == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&app_retain_mutex);
+    if (app_retain_enforce_locked() > 0) {
+        app_meta_save(&app_retain_meta, app_retain_index);
+    }
+    pthread_mutex_unlock(&app_retain_mutex);
+}
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_retain_get_stats(app_retain_stats_t* stats) {
+    memset(stats, 0, sizeof(app_retain_stats_t));
+    if (app_retain_index == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&app_retain_mutex);
+    stats->files = app_retain_index->count;
+    stats->bytes = app_retain_bytes;
+    stats->evicted = app_retain_evicted;
+    for (uint32_t i = 0; i < app_retain_index->count; i++) {
+        stats->pending += (app_retain_index->entries[i].flags & APP_RETAIN_FLAG_UPLOADED) == 0;
+    }
+    pthread_mutex_unlock(&app_retain_mutex);
+}
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_retain_log(void) {
+    if (app_retain_index == NULL) {
+        return;
+    }
+    app_retain_stats_t stats;
+    app_retain_get_stats(&stats);
+    ESP_LOGI(TAG, "------ 归档文件，文件数：%lu，字节数：%lu，未上传：%lu，已删除：%lu",
+        stats.files, stats.bytes, stats.pending, stats.evicted);
+}
+
+/**
+ * @brief 是否需要保留策略管理的文件。元数据文件，正在写入的定位记录文件，以及启动时收编或导入的旧版本文件除外。
+ */
+static bool app_retain_is_archive(const char* name) {
+    static const char* const skip[] = { ".", "..", "LOG.TXT", "FILE.TXT", "MQTT.TXT", "CACHE.TXT", "FIX.BIN" };
+    for (size_t i = 0; i < sizeof(skip) / sizeof(skip[0]); i++) {
+        if (strcmp(name, skip[i]) == 0) {
+            return false;
+        }
+    }
+    size_t len = strlen(name);
+    return !(len > 4 && strcmp(name + len - 4, ".DAT") == 0);
+}
+
+/**
+ * @brief 遍历目录，添加归档文件到索引，按修改时间排序。只在索引不存在时执行一次。
+ */
+static void app_retain_scan(const char* dir, app_retain_classify_t classify) {
+    DIR* dp = opendir(dir);
+    if (dp == NULL) {
+        ESP_LOGE(TAG, "------ SD 卡打开目录：失败！目录：%s", dir);
+        return;
+    }
+    app_retain_index_t* index = app_retain_index;
+    struct dirent* entry;
+    while ((entry = readdir(dp)) != NULL) {
+        if (!app_retain_is_archive(entry->d_name)) {
+            continue;
+        }
+        char path[48];
+        struct stat st;
+        int len = snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (len < 0 || len >= sizeof(path) || stat(path, &st) != 0) {
+            continue;
+        }
+        app_retain_class_t cls = classify == NULL ? APP_RETAIN_UPLOADED : classify(path);
+        if (cls == APP_RETAIN_SKIP) {
+            continue;
+        }
+        app_retain_insert(app_retain_name(path), &st, 0, cls == APP_RETAIN_UPLOADED);
+        for (int i = index->count - 1; i > 0 && index->entries[i].t1 < index->entries[i - 1].t1; i--) {// 插入排序。
+            app_retain_entry_t tmp = index->entries[i];
+            index->entries[i] = index->entries[i - 1];
+            index->entries[i - 1] = tmp;
+        }
+    }
+    closedir(dp);
+}
+
+/**
+ * @brief 初始化函数，SD 卡挂载并创建目录以后调用。读取索引，索引不存在时遍历目录重建一次。
+ * @param classify 重建索引时判断文件是否归档、是否还需要上传。
+ * @return
+ */
+esp_err_t app_retain_init(app_retain_classify_t classify) {
+    app_retain_index = heap_caps_calloc(1, sizeof(app_retain_index_t), MALLOC_CAP_SPIRAM);
+    if (app_retain_index == NULL) {
+        ESP_LOGE(TAG, "------ 归档文件索引初始化：失败。内存不足。");
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t start = esp_log_timestamp();
+    pthread_mutex_lock(&app_retain_mutex);
+    if (app_meta_load(&app_retain_meta, app_retain_index) != ESP_OK || app_retain_index->count > APP_RETAIN_MAX_FILES) {
+        ESP_LOGW(TAG, "------ 归档文件没有索引，遍历目录重建。");
+        memset(app_retain_index, 0, sizeof(app_retain_index_t));
+        app_retain_scan(APP_SD_LOG_DIR, classify);
+        app_retain_scan(APP_SD_CACHE_DIR, classify);
+        app_retain_enforce_locked();
+        app_meta_save(&app_retain_meta, app_retain_index);
+    } else {
+        for (uint32_t i = 0; i < app_retain_index->count; i++) {
+            app_retain_bytes += app_retain_index->entries[i].size;
+        }
+        if (app_retain_enforce_locked() > 0) {
+            app_meta_save(&app_retain_meta, app_retain_index);
+        }
+    }
+    pthread_mutex_unlock(&app_retain_mutex);
+    ESP_LOGI(TAG, "------ 归档文件索引初始化：完成。文件数：%lu，字节数：%lu，耗时：%lu 毫秒",
+        app_retain_index->count, app_retain_bytes, esp_log_timestamp() - start);
+    return ESP_OK;
+}
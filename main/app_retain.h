@@ -0,0 +1,75 @@
+/**
+ * @brief   SD 卡归档文件保留策略。索引文件记录归档的日志文件（文件名、时间范围、字节数、是否已上传），
+ *          按总字节数和最长保留时间删除，先删除已上传的最旧文件。启动时只读取索引，不遍历目录。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+ /**
+  * @brief 统计数据。
+  */
+typedef struct {
+    uint32_t files;             // 索引中的文件数。
+    uint32_t bytes;             // 索引中的总字节数。
+    uint32_t pending;           // 还没上传的文件数。
+    uint32_t evicted;           // 启动以后删除的文件数。
+} app_retain_stats_t;
+
+ /**
+  * @brief 重建索引时的文件分类。
+  */
+typedef enum {
+    APP_RETAIN_SKIP = 0,        // 不归档，例如正在写入或者还没推送的缓存段文件。
+    APP_RETAIN_PENDING,         // 归档，还需要上传。
+    APP_RETAIN_UPLOADED,        // 归档，已上传。
+} app_retain_class_t;
+
+/**
+ * @brief 重建索引时判断文件是否归档、是否还需要上传。
+ * @param path 文件名。
+ * @return
+ */
+typedef app_retain_class_t (*app_retain_classify_t)(const char* path);
+
+/**
+ * @brief 添加归档文件到索引，然后执行保留策略。
+ * @param path 文件名，在 SD 卡挂载点下。
+ * @param t0 开始时间，UTC 秒，0 = 未知。结束时间取文件的修改时间。
+ * @param uploaded 是否已上传。
+ */
+void app_retain_add(const char* path, uint32_t t0, bool uploaded);
+
+/**
+ * @brief 标记文件已上传。
+ * @param path
+ */
+void app_retain_uploaded(const char* path);
+
+/**
+ * @brief 执行保留策略。时间同步以后调用，检查最长保留时间。
+ */
+void app_retain_enforce(void);
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_retain_get_stats(app_retain_stats_t* stats);
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_retain_log(void);
+
+/**
+ * @brief 初始化函数，SD 卡挂载并创建目录以后调用。读取索引，索引不存在时遍历目录重建一次。
+ * @param classify 重建索引时判断文件是否归档、是否还需要上传。
+ * @return
+ */
+esp_err_t app_retain_init(app_retain_classify_t classify);
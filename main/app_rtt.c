@@ -0,0 +1,132 @@
+/**
+ * @brief   MQTT 链路延迟统计，PUBACK 往返时间，滚动窗口和对数直方图。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_log.h"
+
+#include "app_rtt.h"
+
+ /**
+ * @brief 滚动窗口的样本数。
+ */
+#define APP_RTT_WINDOW              64
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_rtt";
+
+/**
+ * @brief 样本环形队列。
+ */
+static uint32_t app_rtt_samples[APP_RTT_WINDOW] = { 0 };
+static int app_rtt_head = 0;
+static int app_rtt_count = 0;
+
+/**
+ * @brief 直方图，和环形队列同步增减。
+ */
+static uint32_t app_rtt_hist[APP_RTT_BUCKETS] = { 0 };
+
+/**
+ * @brief 互斥锁，MQTT 事件回调写入，守护任务读取。
+ */
+static pthread_mutex_t app_rtt_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 样本所在的桶。
+ */
+static int app_rtt_bucket(uint32_t ms) {
+    int bucket = 0;
+    for (uint32_t bound = 32; bucket < APP_RTT_BUCKETS - 1 && ms >= bound; bound <<= 1) {
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * @brief 增加一个样本。
+ * @param ms
+ */
+void app_rtt_add(uint32_t ms) {
+    pthread_mutex_lock(&app_rtt_mutex);
+    if (app_rtt_count == APP_RTT_WINDOW) {// 窗口已满，移除最旧的样本。
+        app_rtt_hist[app_rtt_bucket(app_rtt_samples[app_rtt_head])]--;
+    } else {
+        app_rtt_count++;
+    }
+    app_rtt_samples[app_rtt_head] = ms;
+    app_rtt_head = (app_rtt_head + 1) % APP_RTT_WINDOW;
+    app_rtt_hist[app_rtt_bucket(ms)]++;
+    pthread_mutex_unlock(&app_rtt_mutex);
+}
+
+/**
+ * @brief 清空样本，切换服务器以后调用，不同服务器的延迟不混在一起。
+ */
+void app_rtt_reset(void) {
+    pthread_mutex_lock(&app_rtt_mutex);
+    app_rtt_head = 0;
+    app_rtt_count = 0;
+    memset(app_rtt_hist, 0, sizeof(app_rtt_hist));
+    pthread_mutex_unlock(&app_rtt_mutex);
+}
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_rtt_get_stats(app_rtt_stats_t* stats) {
+    uint32_t sorted[APP_RTT_WINDOW];
+    memset(stats, 0, sizeof(app_rtt_stats_t));
+    pthread_mutex_lock(&app_rtt_mutex);
+    int count = app_rtt_count;
+    for (int i = 0; i < count; i++) {
+        sorted[i] = app_rtt_samples[i];
+    }
+    memcpy(stats->hist, app_rtt_hist, sizeof(app_rtt_hist));
+    if (count > 0) {
+        stats->last = app_rtt_samples[(app_rtt_head + APP_RTT_WINDOW - 1) % APP_RTT_WINDOW];
+    }
+    pthread_mutex_unlock(&app_rtt_mutex);
+    if (count == 0) {
+        return;
+    }
+    for (int i = 1; i < count; i++) {// 样本很少，插入排序。
+        uint32_t v = sorted[i];
+        int j = i - 1;
+        while (j >= 0 && sorted[j] > v) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = v;
+    }
+    stats->count = count;
+    stats->min = sorted[0];
+    stats->max = sorted[count - 1];
+    stats->p50 = sorted[count / 2];
+    stats->p90 = sorted[count * 9 / 10];
+}
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_rtt_log(void) {
+    app_rtt_stats_t stats;
+    app_rtt_get_stats(&stats);
+    if (stats.count == 0) {
+        return;
+    }
+    char hist[APP_RTT_BUCKETS * 6];
+    int len = 0;
+    for (int i = 0; i < APP_RTT_BUCKETS; i++) {
+        len += snprintf(hist + len, sizeof(hist) - len, i == 0 ? "%lu" : ",%lu", stats.hist[i]);
+    }
+    ESP_LOGI(TAG, "------ MQTT 链路延迟，样本：%lu，最近：%lu，最小：%lu，中位：%lu，P90：%lu，最大：%lu 毫秒，直方图：%s",
+        stats.count, stats.last, stats.min, stats.p50, stats.p90, stats.max, hist);
+}
@@ -0,0 +1,49 @@
+/**
+ * @brief   MQTT 链路延迟统计，PUBACK 往返时间，滚动窗口和对数直方图。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+
+ /**
+  * @brief 直方图桶数。第 0 桶 < 32 毫秒，第 i 桶 [2^(i+4), 2^(i+5)) 毫秒，最后一桶 >= 8192 毫秒。
+  */
+#define APP_RTT_BUCKETS             10
+
+ /**
+  * @brief 延迟统计数据，只统计滚动窗口内的样本。
+  */
+typedef struct {
+    uint32_t count;                     // 样本数。
+    uint32_t last;                      // 最近一次，毫秒。
+    uint32_t min;
+    uint32_t max;
+    uint32_t p50;                       // 中位数。
+    uint32_t p90;
+    uint32_t hist[APP_RTT_BUCKETS];     // 直方图。
+} app_rtt_stats_t;
+
+/**
+ * @brief 增加一个样本。
+ * @param ms
+ */
+void app_rtt_add(uint32_t ms);
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_rtt_get_stats(app_rtt_stats_t* stats);
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_rtt_log(void);
+
+/**
+ * @brief 清空样本，切换服务器以后调用，不同服务器的延迟不混在一起。
+ */
+void app_rtt_reset(void);
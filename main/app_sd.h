@@ -6,35 +6,55 @@
  */
 #pragma once
 
+#include "driver/sdmmc_types.h"
+
+ /**
+ * @brief ESP-IDF 的示例代码，挂载点是小写。
+ *        主机测试在编译选项中指定为临时目录，见 test/host。
+ */
+#ifndef SDMMC_MOUNT_POINT
+#define SDMMC_MOUNT_POINT   "/sdcard"
+#endif
+
+ /**
+ * @brief 日志目录。
+ *        必须大写！为啥啊！
+ *        实际测试，传参是小写，建立的文件名还是大写！
+ *        坑死我啊，目录名必须大写，文件名也必须大写，并且不能太长！
+ */
+#define APP_SD_LOG_DIR              SDMMC_MOUNT_POINT"/LOG"
+
+ /**
+ * @brief 缓存目录。
+ */
+#define APP_SD_CACHE_DIR            SDMMC_MOUNT_POINT"/CACHE"
+
  /**
   * @brief 写入缓存文件。
   */
 void app_sd_write_cache_file(char* json);
 
 /**
-* @brief 确保写出日志内容到 SD 卡。
-*        fsync() 执行比较消耗性能，所以由外部调用，隔一段时间执行一次。
+* @brief 确保写出日志内容到 SD 卡，等待日志缓冲区写入文件并执行 fsync()。
+*        平时由日志后台任务定时执行，复制日志文件之前调用。
 */
 void app_sd_fsync_log_file(void);
 /**
-* @brief 备份日志文件。
+* @brief 时间同步以后，在日志轮转清单中记录当前日志文件的时间，不再复制文件。
 */
 void app_sd_bak_log_file(void);
 
 /**
-* @brief 备份缓存文件。
+* @brief 请求上传当前日志文件，从上次上传的位置到当前的文件末尾，不复制文件。
+*        由缓存推送任务调用，和日志上传在同一个任务中。
 */
-void app_sd_bak_cache_file(void);
+void app_sd_snap_log_file(void);
 
 /**
-* @brief 推送日志备份文件。
-*/
-void app_sd_pub_log_bak_file(void);
-
-/**
-* @brief 推送缓存备份文件。
-*/
-void app_sd_pub_cache_bak_file(void);
+ * @brief SD 卡信息。
+ * @return NULL 没有挂载。
+ */
+const sdmmc_card_t* app_sd_get_card(void);
 
 /**
  * @brief 初始化函数。
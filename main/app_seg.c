@@ -0,0 +1,538 @@
+/**
+ * @brief   预分配的定长段文件。创建时一次写满 0，之后在文件内部覆盖写入，不再分配簇，不再修改 FAT 表。
+ *          段头保存写入位置，定期更新，重启时从段头的位置向后逐条校验，截断到最后一条有效记录。
+ *
+ *          FAT 追加写入每跨过一个簇都要修改 FAT 表（两份）和目录项，fsync() 还要写目录项中的文件大小。
+ *          预分配以后文件大小不变，簇链不变，每次写入只有数据扇区和目录项中的修改时间。
+ *
+ *          记录格式：标识 (2) + 长度 (2) + CRC32 (4) + 数据。CRC32 覆盖标识、长度和数据。
+ *          掉电时写了一半的记录 CRC 校验失败，恢复时丢弃，不需要每条记录 fsync()。
+ *          段头也带 CRC32，写了一半的段头不使用其中的写入位置，从数据开始位置扫描。
+ *
+ *          稀疏时间索引放在段头的空白区域，不占用数据区，不改变文件大小。每写入约 1/APP_SEG_IDX_MAX 段的数据记录一项：
+ *          数据范围和其中记录的最早、最晚时间。记录不一定按时间顺序（outbox 转存的旧消息），所以记录时间范围而不是开始时间。
+ *          索引项在数据写入以后才写入，可能比数据先落盘，重启时丢弃超出写入位置的索引项。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <sys/unistd.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+#include "app_seg.h"
+
+ /**
+ * @brief 段头标识 "SEGC" 和版本。
+ */
+#define APP_SEG_MAGIC               0x43474553UL
+#define APP_SEG_VERSION             2
+
+ /**
+ * @brief 记录标识 "CR"。
+ */
+#define APP_SEG_REC_MAGIC           0x5243
+
+ /**
+ * @brief 时间索引在段头中的偏移和校验值。
+ */
+#define APP_SEG_IDX_OFF             32
+#define APP_SEG_IDX_MAGIC           0x58444953UL        // "SIDX"
+
+ /**
+ * @brief 写入位置距离段头保存的位置超过 N 字节时更新段头，限制重启时的扫描长度。
+ */
+#define APP_SEG_HDR_SYNC            (16 * 1024)
+
+ /**
+ * @brief 预分配时每次写入的字节数，和扇区大小相同。
+ */
+#define APP_SEG_ZERO_SIZE           4096
+
+ /**
+ * @brief 扫描时每次读取的字节数。
+ */
+#define APP_SEG_SCAN_SIZE           512
+
+/**
+ * @brief 记录头。
+ */
+typedef struct {
+    uint16_t magic;
+    uint16_t len;               // 数据长度。
+    uint32_t crc;               // 标识、长度和数据的 CRC32。
+} app_seg_rec_t;
+
+_Static_assert(sizeof(app_seg_rec_t) == APP_SEG_REC_HDR_SIZE, "app_seg_rec_t");
+
+/**
+ * @brief 时间索引项。
+ */
+typedef struct {
+    uint32_t off;               // 数据开始位置。
+    uint32_t end;               // 数据结束位置。
+    uint32_t min;               // 最早时间，UTC 秒，0 = 没有时间已知的记录。
+    uint32_t max;               // 最晚时间。
+    uint32_t check;             // 校验值，区分写了一半的索引项。
+} app_seg_idx_t;
+
+_Static_assert(APP_SEG_IDX_OFF + APP_SEG_IDX_MAX * sizeof(app_seg_idx_t) <= APP_SEG_HDR_SIZE, "app_seg_idx_t");
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_seg";
+
+/**
+ * @brief 段头，放在文件开头，后面到 APP_SEG_HDR_SIZE 都是 0。
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seg;
+    uint32_t size;              // 段文件大小。
+    uint32_t fill;              // 写入位置，可能落后，从这里向后扫描。
+    uint32_t sealed;            // 1 = 段已写满，fill 是准确值。
+    uint32_t crc;               // 以上字段的 CRC32，区分写了一半的段头。
+} app_seg_hdr_t;
+
+_Static_assert(sizeof(app_seg_hdr_t) <= APP_SEG_IDX_OFF, "app_seg_hdr_t");
+
+/**
+ * @brief 预分配用的 0，放在 flash 中。
+ */
+static const uint8_t app_seg_zero[APP_SEG_ZERO_SIZE] = { 0 };
+
+/**
+ * @brief 写入 0。
+ */
+static int app_seg_write_zero(FILE* file, uint32_t len) {
+    while (len > 0) {
+        uint32_t n = len < sizeof(app_seg_zero) ? len : sizeof(app_seg_zero);
+        if (fwrite(app_seg_zero, 1, n, file) != n) {
+            return -1;
+        }
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief 段头的 CRC32。
+ */
+static uint32_t app_seg_hdr_crc(const app_seg_hdr_t* hdr) {
+    return esp_rom_crc32_le(0, (const uint8_t*)hdr, offsetof(app_seg_hdr_t, crc));
+}
+
+/**
+ * @brief 读取段头。更新段头时掉电，写入位置可能一半是新的一半是旧的，指向记录中间，
+ *        CRC 校验失败时不使用写入位置，从数据开始位置扫描。
+ * @return 0 成功，-1 没有段头或者版本不对。
+ */
+static int app_seg_read_hdr(FILE* file, app_seg_hdr_t* hdr) {
+    fseek(file, 0, SEEK_SET);
+    if (fread(hdr, 1, sizeof(app_seg_hdr_t), file) != sizeof(app_seg_hdr_t)
+        || hdr->magic != APP_SEG_MAGIC || hdr->version != APP_SEG_VERSION) {
+        return -1;
+    }
+    if (hdr->crc != app_seg_hdr_crc(hdr)) {
+        ESP_LOGW(TAG, "------ 段头校验失败，从头扫描。段：%08lX，写入位置：%lu", hdr->seg, hdr->fill);
+        hdr->fill = APP_SEG_HDR_SIZE;
+        hdr->sealed = 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief 更新段头，然后回到写入位置。
+ */
+static void app_seg_write_hdr(app_seg_writer_t* writer, bool sealed) {
+    app_seg_hdr_t hdr = {
+        .magic = APP_SEG_MAGIC,
+        .version = APP_SEG_VERSION,
+        .seg = writer->seg,
+        .size = writer->size,
+        .fill = writer->fill,
+        .sealed = sealed,
+    };
+    hdr.crc = app_seg_hdr_crc(&hdr);
+    fseek(writer->file, 0, SEEK_SET);
+    if (fwrite(&hdr, 1, sizeof(hdr), writer->file) == sizeof(hdr)) {
+        writer->hdr_fill = writer->fill;
+    }
+    fseek(writer->file, writer->fill, SEEK_SET);
+}
+
+/**
+ * @brief 计算记录的 CRC32。
+ */
+static uint32_t app_seg_rec_crc(const app_seg_rec_t* rec, const void* data, size_t len) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)rec, offsetof(app_seg_rec_t, crc));
+    return esp_rom_crc32_le(crc, data, len);
+}
+
+/**
+ * @brief 时间索引项的校验值。
+ */
+static uint32_t app_seg_idx_check(const app_seg_idx_t* idx) {
+    return idx->off ^ idx->end ^ idx->min ^ idx->max ^ APP_SEG_IDX_MAGIC;
+}
+
+/**
+ * @brief 读取时间索引，到第一个无效的或者超出写入位置的索引项为止。
+ * @return 有效的索引项数。
+ */
+static uint32_t app_seg_read_idx(FILE* file, uint32_t fill, app_seg_idx_t* idx) {
+    fseek(file, APP_SEG_IDX_OFF, SEEK_SET);
+    size_t n = fread(idx, sizeof(app_seg_idx_t), APP_SEG_IDX_MAX, file);
+    uint32_t count = 0;
+    uint32_t prev = APP_SEG_HDR_SIZE;
+    while (count < n) {
+        const app_seg_idx_t* item = &idx[count];
+        if (item->check != app_seg_idx_check(item) || item->off < prev || item->end <= item->off || item->end > fill) {
+            break;
+        }
+        prev = item->end;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief 写入一个时间索引项，覆盖当前未索引的数据，然后回到写入位置。
+ */
+static void app_seg_write_idx(app_seg_writer_t* writer) {
+    if (writer->blk_off == 0 || writer->fill <= writer->blk_off) {
+        return;
+    }
+    if (writer->idx_count < APP_SEG_IDX_MAX) {// 索引项用完以后，剩余数据按时间查询时全部读取。
+        app_seg_idx_t idx = {
+            .off = writer->blk_off,
+            .end = writer->fill,
+            .min = writer->blk_min == UINT32_MAX ? 0 : writer->blk_min,
+            .max = writer->blk_max,
+        };
+        idx.check = app_seg_idx_check(&idx);
+        fseek(writer->file, APP_SEG_IDX_OFF + writer->idx_count * sizeof(idx), SEEK_SET);
+        if (fwrite(&idx, 1, sizeof(idx), writer->file) == sizeof(idx)) {
+            writer->idx_count++;
+        }
+        fseek(writer->file, writer->fill, SEEK_SET);
+    }
+    writer->blk_off = 0;
+}
+
+/**
+ * @brief 读取并检查记录头。
+ * @return 0 成功，-1 没有记录或者记录头无效。
+ */
+static int app_seg_read_rec(FILE* file, uint32_t off, uint32_t end, app_seg_rec_t* rec) {
+    if (off + sizeof(app_seg_rec_t) > end) {
+        return -1;
+    }
+    fseek(file, off, SEEK_SET);
+    if (fread(rec, 1, sizeof(app_seg_rec_t), file) != sizeof(app_seg_rec_t)) {
+        return -1;
+    }
+    if (rec->magic != APP_SEG_REC_MAGIC || rec->len == 0 || rec->len > APP_SEG_REC_MAX
+        || off + sizeof(app_seg_rec_t) + rec->len > end) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 从指定位置向后逐条校验记录，直到第一条无效的记录。
+ * @return 最后一条有效记录的末尾。
+ */
+static uint32_t app_seg_scan(FILE* file, uint32_t from, uint32_t size) {
+    uint8_t buf[APP_SEG_SCAN_SIZE];
+    uint32_t pos = from;
+    app_seg_rec_t rec;
+    while (app_seg_read_rec(file, pos, size, &rec) == 0) {
+        uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&rec, offsetof(app_seg_rec_t, crc));
+        size_t left = rec.len;
+        while (left > 0) {// 记录已经定位，分块计算 CRC，不需要整条记录的缓冲区。
+            size_t n = left < sizeof(buf) ? left : sizeof(buf);
+            if (fread(buf, 1, n, file) != n) {
+                return pos;
+            }
+            crc = esp_rom_crc32_le(crc, buf, n);
+            left -= n;
+        }
+        if (crc != rec.crc) {
+            break;
+        }
+        pos += sizeof(rec) + rec.len;
+    }
+    return pos;
+}
+
+/**
+ * @brief 创建段文件，写入段头，其余写满 0。
+ */
+static int app_seg_create(const char* path, uint32_t seg, uint32_t size) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        ESP_LOGE(TAG, "------ 段文件创建：失败！文件名：%s", path);
+        return -1;
+    }
+    uint32_t start = esp_log_timestamp();
+    app_seg_hdr_t hdr = {
+        .magic = APP_SEG_MAGIC,
+        .version = APP_SEG_VERSION,
+        .seg = seg,
+        .size = size,
+        .fill = APP_SEG_HDR_SIZE,
+    };
+    hdr.crc = app_seg_hdr_crc(&hdr);
+    int ret = fwrite(&hdr, 1, sizeof(hdr), file) == sizeof(hdr) ? 0 : -1;
+    if (ret == 0) {
+        ret = app_seg_write_zero(file, size - sizeof(hdr));
+    }
+    fflush(file);
+    fsync(fileno(file));
+    fclose(file);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "------ 段文件预分配：失败！文件名：%s", path);
+        remove(path);
+        return -1;
+    }
+    ESP_LOGI(TAG, "------ 段文件预分配：完成。文件名：%s，大小：%lu，耗时：%lu 毫秒", path, size, esp_log_timestamp() - start);
+    return 0;
+}
+
+/**
+ * @brief 打开段文件用于写入，文件不存在时创建并预分配。
+ * @param writer
+ * @param path
+ * @param seg
+ * @param size 段文件大小，包括段头。
+ * @param buf 写缓冲区，记录先在缓冲区中累积，app_seg_sync() 时一起写入。NULL 使用默认缓冲区。
+ * @param buf_size
+ * @return 0 成功，-1 失败，APP_SEG_INVALID 没有有效的段头。
+ */
+int app_seg_open(app_seg_writer_t* writer, const char* path, uint32_t seg, uint32_t size, char* buf, size_t buf_size) {
+    memset(writer, 0, sizeof(app_seg_writer_t));
+    if (access(path, F_OK) == -1 && app_seg_create(path, seg, size) != 0) {
+        return -1;
+    }
+    FILE* file = fopen(path, "r+b");
+    if (file == NULL) {
+        ESP_LOGE(TAG, "------ 段文件打开：失败！文件名：%s", path);
+        return -1;
+    }
+    if (buf != NULL) {
+        setvbuf(file, buf, _IOFBF, buf_size);// 在第一次读写之前设置。
+    }
+    app_seg_hdr_t hdr;
+    if (app_seg_read_hdr(file, &hdr) != 0) {
+        fclose(file);
+        return APP_SEG_INVALID;
+    }
+    uint32_t from = hdr.fill < APP_SEG_HDR_SIZE ? APP_SEG_HDR_SIZE : hdr.fill;
+    uint32_t fill = hdr.sealed ? hdr.fill : app_seg_scan(file, from, hdr.size);
+    uint16_t magic = 0;
+    fseek(file, fill, SEEK_SET);
+    if (!hdr.sealed && fread(&magic, 1, sizeof(magic), file) == sizeof(magic) && magic != 0) {
+        // 掉电时没写完的记录，CRC 校验失败，截断到这里，后面的记录覆盖写入。
+        ESP_LOGW(TAG, "------ 段文件丢弃不完整的记录，偏移：%lu，文件名：%s", fill, path);
+    }
+    if (fill != hdr.fill) {
+        ESP_LOGI(TAG, "------ 段文件恢复写入位置：%lu -> %lu，文件名：%s", hdr.fill, fill, path);
+    }
+    app_seg_idx_t idx[APP_SEG_IDX_MAX];
+    uint32_t idx_count = app_seg_read_idx(file, fill, idx);
+    if (idx_count < APP_SEG_IDX_MAX) {// 清除无效的索引项，后面的索引项从这里写入，不会和旧的混在一起。
+        fseek(file, APP_SEG_IDX_OFF + idx_count * sizeof(app_seg_idx_t), SEEK_SET);
+        app_seg_write_zero(file, (APP_SEG_IDX_MAX - idx_count) * sizeof(app_seg_idx_t));
+    }
+    writer->file = file;
+    writer->seg = seg;
+    writer->size = hdr.size;
+    writer->fill = fill;
+    writer->hdr_fill = hdr.fill;
+    writer->idx_count = idx_count;
+    fseek(file, fill, SEEK_SET);
+    return 0;
+}
+
+/**
+ * @brief 剩余可以写入的字节数。
+ * @param writer
+ * @return
+ */
+uint32_t app_seg_room(const app_seg_writer_t* writer) {
+    return writer->file == NULL || writer->fill >= writer->size ? 0 : writer->size - writer->fill;
+}
+
+/**
+ * @brief 在写入位置追加一条记录，调用者先检查剩余空间，需要 APP_SEG_REC_HDR_SIZE + len 字节。
+ *        失败时写入位置不变，下次覆盖。
+ * @param writer
+ * @param data
+ * @param len 不超过 APP_SEG_REC_MAX。
+ * @param ts 记录时间，UTC 秒，写入时间索引，0 = 未知。
+ * @return 0 成功，-1 失败。
+ */
+int app_seg_append(app_seg_writer_t* writer, const void* data, size_t len, uint32_t ts) {
+    if (len == 0 || len > APP_SEG_REC_MAX || sizeof(app_seg_rec_t) + len > app_seg_room(writer)) {
+        return -1;
+    }
+    app_seg_rec_t rec = {
+        .magic = APP_SEG_REC_MAGIC,
+        .len = len,
+    };
+    rec.crc = app_seg_rec_crc(&rec, data, len);
+    if (fwrite(&rec, 1, sizeof(rec), writer->file) != sizeof(rec) || fwrite(data, 1, len, writer->file) != len) {
+        fseek(writer->file, writer->fill, SEEK_SET);// 回到写入位置，下次覆盖。
+        return -1;
+    }
+    if (writer->blk_off == 0) {
+        writer->blk_off = writer->fill;
+        writer->blk_min = UINT32_MAX;
+        writer->blk_max = 0;
+    }
+    writer->fill += sizeof(rec) + len;
+    if (ts != 0) {
+        writer->blk_min = ts < writer->blk_min ? ts : writer->blk_min;
+        writer->blk_max = ts > writer->blk_max ? ts : writer->blk_max;
+    }
+    if (writer->fill - writer->blk_off >= (writer->size - APP_SEG_HDR_SIZE) / APP_SEG_IDX_MAX) {
+        app_seg_write_idx(writer);
+    }
+    return 0;
+}
+
+/**
+ * @brief fflush() 和 fsync()。写入位置距离段头保存的位置较远时先更新段头。
+ * @param writer
+ */
+void app_seg_sync(app_seg_writer_t* writer) {
+    if (writer->file == NULL) {
+        return;
+    }
+    if (writer->fill - writer->hdr_fill >= APP_SEG_HDR_SYNC) {
+        app_seg_write_hdr(writer, false);
+    }
+    fflush(writer->file);
+    fsync(fileno(writer->file));
+}
+
+/**
+ * @brief 关闭段文件。
+ * @param writer
+ * @param seal 段已写满，段头保存准确的写入位置，读取时不需要扫描。
+ */
+void app_seg_close(app_seg_writer_t* writer, bool seal) {
+    if (writer->file == NULL) {
+        return;
+    }
+    app_seg_write_idx(writer);
+    if (seal || writer->fill != writer->hdr_fill) {
+        app_seg_write_hdr(writer, seal);
+    }
+    fflush(writer->file);
+    fsync(fileno(writer->file));
+    fclose(writer->file);
+    writer->file = NULL;
+}
+
+/**
+ * @brief 读取段文件的数据范围。没有封闭的段文件按段头位置向后扫描。
+ * @param file 已经打开的段文件。
+ * @param start 数据开始偏移。
+ * @param fill 数据结束偏移。
+ * @return 0 成功，-1 没有有效的段头。
+ */
+int app_seg_range(FILE* file, uint32_t* start, uint32_t* fill) {
+    app_seg_hdr_t hdr;
+    if (app_seg_read_hdr(file, &hdr) != 0) {
+        return -1;
+    }
+    *start = APP_SEG_HDR_SIZE;
+    if (hdr.sealed) {
+        *fill = hdr.fill;
+    } else {
+        uint32_t from = hdr.fill < APP_SEG_HDR_SIZE ? APP_SEG_HDR_SIZE : hdr.fill;
+        *fill = app_seg_scan(file, from, hdr.size);
+    }
+    return 0;
+}
+
+/**
+ * @brief 添加数据范围，和上一个相邻时合并。
+ */
+static void app_seg_add_span(app_seg_span_t* spans, int* count, uint32_t off, uint32_t end) {
+    if (end <= off) {
+        return;
+    }
+    if (*count > 0 && spans[*count - 1].end == off) {
+        spans[*count - 1].end = end;
+        return;
+    }
+    spans[*count].off = off;
+    spans[*count].end = end;
+    (*count)++;
+}
+
+/**
+ * @brief 按时间索引计算需要读取的数据范围：时间范围重叠的索引项，以及没有索引的数据。
+ * @param file 已经打开的段文件。
+ * @param t1 开始时间，UTC 秒。
+ * @param t2 结束时间，UTC 秒。
+ * @param spans 至少 APP_SEG_IDX_MAX + 1 项。
+ * @return 数据范围个数，-1 失败。
+ */
+int app_seg_spans(FILE* file, uint32_t t1, uint32_t t2, app_seg_span_t* spans) {
+    uint32_t start;
+    uint32_t fill;
+    if (app_seg_range(file, &start, &fill) != 0) {
+        return -1;
+    }
+    app_seg_idx_t idx[APP_SEG_IDX_MAX];
+    uint32_t idx_count = app_seg_read_idx(file, fill, idx);
+    int count = 0;
+    uint32_t covered = start;
+    for (uint32_t i = 0; i < idx_count; i++) {
+        app_seg_add_span(spans, &count, covered, idx[i].off);// 没有索引的数据，重启以后的第一段。
+        if (idx[i].min != 0 && idx[i].min <= t2 && idx[i].max >= t1) {
+            app_seg_add_span(spans, &count, idx[i].off, idx[i].end);
+        }
+        covered = idx[i].end;
+    }
+    app_seg_add_span(spans, &count, covered, fill);// 最后一段没有索引的数据。
+    return count;
+}
+
+/**
+ * @brief 读取一条记录，校验 CRC，以 '\0' 结尾。
+ * @param file
+ * @param off 记录偏移。
+ * @param fill 数据结束偏移。
+ * @param buf
+ * @param size
+ * @param next 下一条记录的偏移。
+ * @return 记录长度，0 没有更多记录，-1 记录损坏，APP_SEG_TOO_LONG 记录超长已跳过。
+ */
+int app_seg_read(FILE* file, uint32_t off, uint32_t fill, char* buf, size_t size, uint32_t* next) {
+    if (off + sizeof(app_seg_rec_t) > fill) {
+        return 0;
+    }
+    app_seg_rec_t rec;
+    if (app_seg_read_rec(file, off, fill, &rec) != 0) {
+        return -1;
+    }
+    *next = off + sizeof(rec) + rec.len;
+    if (rec.len >= size) {
+        return APP_SEG_TOO_LONG;
+    }
+    if (fread(buf, 1, rec.len, file) != rec.len || app_seg_rec_crc(&rec, buf, rec.len) != rec.crc) {
+        return -1;
+    }
+    buf[rec.len] = '\0';
+    return rec.len;
+}
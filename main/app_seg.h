@@ -0,0 +1,136 @@
+/**
+ * @brief   预分配的定长段文件。创建时一次写满 0，之后在文件内部覆盖写入，不再分配簇，不再修改 FAT 表。
+ *          记录带长度和 CRC32，段头保存写入位置，定期更新，重启时从段头的位置向后校验，截断到最后一条有效记录。
+ *          段头后面是稀疏时间索引，每写入一段数据记录一项，按时间查询时只读取时间范围重叠的数据。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+ /**
+  * @brief 段头大小，数据从这里开始。
+  */
+#define APP_SEG_HDR_SIZE            512
+
+ /**
+  * @brief 记录头大小和记录最大长度。
+  */
+#define APP_SEG_REC_HDR_SIZE        8
+#define APP_SEG_REC_MAX             1024
+
+ /**
+  * @brief 打开段文件的返回值：没有有效的段头，不能继续写入。
+  */
+#define APP_SEG_INVALID             (-2)
+
+ /**
+  * @brief 读取记录的返回值：记录超过缓冲区大小，已经跳过。
+  */
+#define APP_SEG_TOO_LONG            (-3)
+
+ /**
+  * @brief 时间索引项数，放在段头中。
+  */
+#define APP_SEG_IDX_MAX             24
+
+ /**
+  * @brief 需要读取的数据范围，按时间查询时使用。
+  */
+typedef struct {
+    uint32_t off;
+    uint32_t end;
+} app_seg_span_t;
+
+ /**
+  * @brief 正在写入的段。
+  */
+typedef struct {
+    FILE* file;
+    uint32_t seg;               // 段号。
+    uint32_t size;              // 段文件大小，包括段头。
+    uint32_t fill;              // 写入位置，文件偏移。
+    uint32_t hdr_fill;          // 段头中保存的写入位置。
+    uint32_t idx_count;         // 已写入的时间索引项数。
+    uint32_t blk_off;           // 还没有索引的数据开始位置，0 = 没有。
+    uint32_t blk_min;           // 还没有索引的数据的最早时间。
+    uint32_t blk_max;           // 还没有索引的数据的最晚时间。
+} app_seg_writer_t;
+
+/**
+ * @brief 打开段文件用于写入，文件不存在时创建并预分配。
+ * @param writer
+ * @param path
+ * @param seg
+ * @param size 段文件大小，包括段头。
+ * @param buf 写缓冲区，记录先在缓冲区中累积，app_seg_sync() 时一起写入。NULL 使用默认缓冲区。
+ * @param buf_size
+ * @return 0 成功，-1 失败，APP_SEG_INVALID 没有有效的段头。
+ */
+int app_seg_open(app_seg_writer_t* writer, const char* path, uint32_t seg, uint32_t size, char* buf, size_t buf_size);
+
+/**
+ * @brief 剩余可以写入的字节数。
+ * @param writer
+ * @return
+ */
+uint32_t app_seg_room(const app_seg_writer_t* writer);
+
+/**
+ * @brief 在写入位置追加一条记录，调用者先检查剩余空间，需要 APP_SEG_REC_HDR_SIZE + len 字节。
+ *        失败时写入位置不变，下次覆盖。
+ * @param writer
+ * @param data
+ * @param len 不超过 APP_SEG_REC_MAX。
+ * @param ts 记录时间，UTC 秒，写入时间索引，0 = 未知。
+ * @return 0 成功，-1 失败。
+ */
+int app_seg_append(app_seg_writer_t* writer, const void* data, size_t len, uint32_t ts);
+
+/**
+ * @brief fflush() 和 fsync()。写入位置距离段头保存的位置较远时先更新段头。
+ * @param writer
+ */
+void app_seg_sync(app_seg_writer_t* writer);
+
+/**
+ * @brief 关闭段文件。
+ * @param writer
+ * @param seal 段已写满，段头保存准确的写入位置，读取时不需要扫描。
+ */
+void app_seg_close(app_seg_writer_t* writer, bool seal);
+
+/**
+ * @brief 读取段文件的数据范围。没有封闭的段文件按段头位置向后扫描。
+ * @param file 已经打开的段文件。
+ * @param start 数据开始偏移。
+ * @param fill 数据结束偏移。
+ * @return 0 成功，-1 没有有效的段头。
+ */
+int app_seg_range(FILE* file, uint32_t* start, uint32_t* fill);
+
+/**
+ * @brief 按时间索引计算需要读取的数据范围：时间范围重叠的索引项，以及没有索引的数据。
+ * @param file 已经打开的段文件。
+ * @param t1 开始时间，UTC 秒。
+ * @param t2 结束时间，UTC 秒。
+ * @param spans 至少 APP_SEG_IDX_MAX + 1 项。
+ * @return 数据范围个数，-1 失败。
+ */
+int app_seg_spans(FILE* file, uint32_t t1, uint32_t t2, app_seg_span_t* spans);
+
+/**
+ * @brief 读取一条记录，校验 CRC，以 '\0' 结尾。
+ * @param file
+ * @param off 记录偏移。
+ * @param fill 数据结束偏移。
+ * @param buf
+ * @param size
+ * @param next 下一条记录的偏移。
+ * @return 记录长度，0 没有更多记录，-1 记录损坏，APP_SEG_TOO_LONG 记录超长已跳过。
+ */
+int app_seg_read(FILE* file, uint32_t off, uint32_t fill, char* buf, size_t size, uint32_t* next);
@@ -42,8 +42,7 @@ static void app_stnp_sync_cb(struct timeval* tv) {
     ESP_LOGI(TAG, "------ SNTP 同步事件，当前时间：%s.%03d", buffer, millis);
 
     if (app_sd_bak_count == 0) {
-        app_sd_bak_log_file();// 时间同步后，按时间备份日志文件。
-        app_sd_bak_cache_file();
+        app_sd_bak_log_file();// 时间同步后，记录日志文件的时间。
         app_sd_bak_count = 1;
     }
 }
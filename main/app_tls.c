@@ -0,0 +1,590 @@
+/**
+ * @brief   MQTT TLS 传输层，固定 CA 证书，缓存 TLS 会话，PPP 重连以后恢复会话，只需要一个往返。
+ *
+ *          esp-mqtt 自带的 SSL 传输层每次连接都是完整握手，4G 下要传输服务器证书链、做签名校验，耗时和流量都很大。
+ *          这里直接使用 mbedtls 实现 esp_transport 接口，握手成功以后保存会话（会话票据或者会话 ID），
+ *          下次连接同一个服务器时带上，服务器接受则是简化握手，不传证书。服务器不接受时自动退回完整握手。
+ *          会话按服务器地址和端口保存，切换备用服务器不会互相覆盖。
+ *          只支持 TLS 1.2，sdkconfig 中没有启用 TLS 1.3。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include "esp_log.h"
+#include "nvs.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/error.h"
+
+#include "app_tls.h"
+#include "app_config.h"
+
+ /**
+ * @brief 会话缓存个数，和服务器列表长度相同即可。
+ */
+#define APP_TLS_SLOTS               2
+
+ /**
+ * @brief 握手时每次读取的超时，毫秒。完整握手有签名校验，比 MQTT 网络超时长。
+ */
+#define APP_TLS_HANDSHAKE_TIMEOUT   10000
+
+ /**
+ * @brief 默认端口。
+ */
+#define APP_TLS_DEFAULT_PORT        8883
+
+ /**
+ * @brief NVS 命名空间，键名为 s0、s1……，对应会话缓存序号。
+ */
+#define APP_TLS_NVS_NAMESPACE       "app_tls"
+
+ /**
+ * @brief 会话序列化以后的最大长度，包括服务器证书。
+ */
+#define APP_TLS_SESSION_MAX         4000
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_tls";
+
+/**
+ * @brief CA 证书，编译时嵌入（EMBED_TXTFILES "certs/mqtt_ca.pem"）。本文件目前不参与固件编译，见 main/CMakeLists.txt。
+ */
+extern const char app_tls_ca_start[] asm("_binary_mqtt_ca_pem_start");
+extern const char app_tls_ca_end[] asm("_binary_mqtt_ca_pem_end");
+
+/**
+ * @brief 会话缓存。
+ */
+typedef struct {
+    char host[64];
+    int32_t port;
+    int valid;
+    mbedtls_ssl_session session;
+} app_tls_slot_t;
+
+/**
+ * @brief 保存到 NVS 的会话头，后面是 mbedtls_ssl_session_save() 的输出。
+ */
+typedef struct {
+    char host[64];
+    int32_t port;
+} app_tls_nvs_head_t;
+
+/**
+ * @brief 连接。MQTT 客户端只有一个连接，静态分配。
+ */
+typedef struct {
+    mbedtls_net_context net;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    int ready;                  // ssl 和 conf 已经初始化。
+    int established;            // 握手完成。
+    int verified;               // 握手时校验过证书链，即完整握手。
+    uint32_t tx;                // 发送字节数。
+    uint32_t rx;                // 接收字节数。
+} app_tls_conn_t;
+
+static app_tls_conn_t app_tls_conn;
+static app_tls_slot_t app_tls_slots[APP_TLS_SLOTS];
+static int app_tls_slot_next = 0;
+
+static mbedtls_x509_crt app_tls_ca;
+static mbedtls_entropy_context app_tls_entropy;
+static mbedtls_ctr_drbg_context app_tls_drbg;
+
+static esp_transport_handle_t app_tls_transport = NULL;
+
+/**
+ * @brief 统计数据，MQTT 任务写入，守护任务读取。
+ */
+static app_tls_stats_t app_tls_stats = { 0 };
+static pthread_mutex_t app_tls_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 平滑值。
+ */
+static uint32_t app_tls_avg(uint32_t avg, uint32_t value) {
+    return avg == 0 ? value : (avg * 3 + value) / 4;
+}
+
+/**
+ * @brief 查找服务器的会话缓存。
+ * @param create 没有找到时分配一个，优先使用空闲的，否则轮换。
+ */
+static app_tls_slot_t* app_tls_find_slot(const char* host, int port, bool create) {
+    for (int i = 0; i < APP_TLS_SLOTS; i++) {
+        app_tls_slot_t* slot = &app_tls_slots[i];
+        if (slot->port == port && strcmp(slot->host, host) == 0) {
+            return slot;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    int index = -1;
+    for (int i = 0; i < APP_TLS_SLOTS; i++) {
+        if (app_tls_slots[i].host[0] == '\0') {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        index = app_tls_slot_next;
+        app_tls_slot_next = (app_tls_slot_next + 1) % APP_TLS_SLOTS;
+    }
+    app_tls_slot_t* slot = &app_tls_slots[index];
+    mbedtls_ssl_session_free(&slot->session);
+    mbedtls_ssl_session_init(&slot->session);
+    snprintf(slot->host, sizeof(slot->host), "%s", host);
+    slot->port = port;
+    slot->valid = 0;
+    return slot;
+}
+
+#if APP_TLS_SESSION_NVS
+/**
+ * @brief 会话保存到 NVS。序列化以后和 NVS 中的相同时不写 flash：简化握手没有收到新的会话票据时会话不变，
+ *        收到新票据时旧票据可能已经被服务器作废，必须保存，否则重启以后只能完整握手。
+ */
+static void app_tls_save_slot(const app_tls_slot_t* slot) {
+    size_t len = 0;
+    mbedtls_ssl_session_save(&slot->session, NULL, 0, &len);// 缓冲区太小，返回需要的长度。
+    if (len == 0 || len > APP_TLS_SESSION_MAX) {
+        ESP_LOGW(TAG, "------ TLS 会话太大，不保存到 NVS。长度：%u", len);
+        return;
+    }
+    size_t size = sizeof(app_tls_nvs_head_t) + len;
+    uint8_t* buf = malloc(size * 2);// 后一半读取 NVS 中的会话，比较。
+    if (buf == NULL) {
+        return;
+    }
+    app_tls_nvs_head_t* head = (app_tls_nvs_head_t*)buf;
+    memcpy(head->host, slot->host, sizeof(head->host));
+    head->port = slot->port;
+    nvs_handle_t handle;
+    if (mbedtls_ssl_session_save(&slot->session, buf + sizeof(app_tls_nvs_head_t), len, &len) == 0
+        && nvs_open(APP_TLS_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK) {
+        char key[8];
+        snprintf(key, sizeof(key), "s%d", (int)(slot - app_tls_slots));
+        size = sizeof(app_tls_nvs_head_t) + len;
+        size_t old_size = size;
+        if (nvs_get_blob(handle, key, buf + size, &old_size) == ESP_OK && old_size == size && memcmp(buf, buf + size, size) == 0) {
+            ESP_LOGD(TAG, "------ TLS 会话没有变化，不写 NVS。");
+        } else if (nvs_set_blob(handle, key, buf, size) == ESP_OK) {
+            nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    free(buf);
+}
+
+/**
+ * @brief 从 NVS 加载会话。固件升级以后 mbedtls 格式可能不同，加载失败就丢弃，重新完整握手。
+ */
+static void app_tls_load_slots(void) {
+    nvs_handle_t handle;
+    if (nvs_open(APP_TLS_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    for (int i = 0; i < APP_TLS_SLOTS; i++) {
+        char key[8];
+        snprintf(key, sizeof(key), "s%d", i);
+        size_t size = 0;
+        if (nvs_get_blob(handle, key, NULL, &size) != ESP_OK || size <= sizeof(app_tls_nvs_head_t)) {
+            continue;
+        }
+        uint8_t* buf = malloc(size);
+        if (buf == NULL) {
+            continue;
+        }
+        app_tls_slot_t* slot = &app_tls_slots[i];
+        const app_tls_nvs_head_t* head = (const app_tls_nvs_head_t*)buf;
+        if (nvs_get_blob(handle, key, buf, &size) == ESP_OK
+            && mbedtls_ssl_session_load(&slot->session, buf + sizeof(app_tls_nvs_head_t), size - sizeof(app_tls_nvs_head_t)) == 0) {
+            snprintf(slot->host, sizeof(slot->host), "%.*s", (int)sizeof(head->host), head->host);
+            slot->port = head->port;
+            slot->valid = 1;
+            ESP_LOGI(TAG, "------ 从 NVS 加载 TLS 会话：%s:%ld", slot->host, slot->port);
+        }
+        free(buf);
+    }
+    nvs_close(handle);
+}
+#endif
+
+/**
+ * @brief 计数发送，握手字节数统计。
+ */
+static int app_tls_send(void* ctx, const unsigned char* buf, size_t len) {
+    app_tls_conn_t* conn = ctx;
+    int ret = mbedtls_net_send(&conn->net, buf, len);
+    if (ret > 0) {
+        conn->tx += ret;
+    }
+    return ret;
+}
+
+/**
+ * @brief 计数接收，握手字节数统计。
+ */
+static int app_tls_recv(void* ctx, unsigned char* buf, size_t len, uint32_t timeout) {
+    app_tls_conn_t* conn = ctx;
+    int ret = mbedtls_net_recv_timeout(&conn->net, buf, len, timeout);
+    if (ret > 0) {
+        conn->rx += ret;
+    }
+    return ret;
+}
+
+/**
+ * @brief 证书链校验回调，只在完整握手时调用，用来区分完整握手和会话恢复。不修改校验结果。
+ */
+static int app_tls_verify(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags) {
+    app_tls_conn_t* conn = ctx;
+    conn->verified = 1;
+    return 0;
+}
+
+/**
+ * @brief 等待套接字可读或者可写。
+ * @return 1 可以，0 超时，-1 错误。
+ */
+static int app_tls_poll(int fd, bool read, int timeout_ms) {
+    if (fd < 0) {
+        return -1;
+    }
+    fd_set fds;
+    fd_set efds;
+    FD_ZERO(&fds);
+    FD_ZERO(&efds);
+    FD_SET(fd, &fds);
+    FD_SET(fd, &efds);
+    struct timeval tv = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    int ret = select(fd + 1, read ? &fds : NULL, read ? NULL : &fds, &efds, timeout_ms < 0 ? NULL : &tv);
+    if (ret > 0 && FD_ISSET(fd, &efds)) {
+        return -1;
+    }
+    return ret > 0 ? 1 : ret;
+}
+
+/**
+ * @brief TCP 连接，带超时。连接以后恢复阻塞模式，读超时由 mbedtls_net_recv_timeout() 控制。
+ */
+static int app_tls_tcp_connect(app_tls_conn_t* conn, const char* host, int port, int timeout_ms) {
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo* res = NULL;
+    if (getaddrinfo(host, port_str, &hints, &res) != 0 || res == NULL) {
+        ESP_LOGE(TAG, "------ 域名解析：失败！%s", host);
+        return -1;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd < 0) {
+        freeaddrinfo(res);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    int ret = connect(fd, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (ret != 0 && errno == EINPROGRESS) {
+        ret = -1;
+        if (app_tls_poll(fd, false, timeout_ms) > 0) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+                ret = 0;
+            }
+        }
+    }
+    if (ret != 0) {
+        ESP_LOGE(TAG, "------ TCP 连接：失败！%s:%d", host, port);
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, 0);
+    conn->net.fd = fd;
+    return 0;
+}
+
+/**
+ * @brief 关闭连接，MQTT 断开或者重连之前调用。
+ */
+static int app_tls_close(esp_transport_handle_t t) {
+    app_tls_conn_t* conn = esp_transport_get_context_data(t);
+    if (conn->ready) {
+        if (conn->established) {
+            mbedtls_ssl_close_notify(&conn->ssl);
+        }
+        mbedtls_ssl_free(&conn->ssl);
+        mbedtls_ssl_config_free(&conn->conf);
+        conn->ready = 0;
+        conn->established = 0;
+    }
+    mbedtls_net_free(&conn->net);
+    return 0;
+}
+
+/**
+ * @brief 建立连接并握手，有缓存的会话时先尝试恢复会话。
+ * @return 0 成功，-1 失败。
+ */
+static int app_tls_connect(esp_transport_handle_t t, const char* host, int port, int timeout_ms) {
+    app_tls_conn_t* conn = esp_transport_get_context_data(t);
+    app_tls_close(t);
+    if (app_tls_tcp_connect(conn, host, port, timeout_ms) != 0) {
+        return -1;
+    }
+
+    mbedtls_ssl_init(&conn->ssl);
+    mbedtls_ssl_config_init(&conn->conf);
+    conn->ready = 1;
+    conn->verified = 0;
+    conn->tx = 0;
+    conn->rx = 0;
+    int ret = mbedtls_ssl_config_defaults(&conn->conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret == 0) {
+        mbedtls_ssl_conf_authmode(&conn->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+        mbedtls_ssl_conf_ca_chain(&conn->conf, &app_tls_ca, NULL);
+        mbedtls_ssl_conf_verify(&conn->conf, app_tls_verify, conn);
+        mbedtls_ssl_conf_rng(&conn->conf, mbedtls_ctr_drbg_random, &app_tls_drbg);
+        mbedtls_ssl_conf_session_tickets(&conn->conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+        mbedtls_ssl_conf_read_timeout(&conn->conf, timeout_ms > APP_TLS_HANDSHAKE_TIMEOUT ? timeout_ms : APP_TLS_HANDSHAKE_TIMEOUT);
+        ret = mbedtls_ssl_setup(&conn->ssl, &conn->conf);
+    }
+    if (ret == 0) {
+        ret = mbedtls_ssl_set_hostname(&conn->ssl, host);
+    }
+    if (ret != 0) {
+        ESP_LOGE(TAG, "------ TLS 初始化：失败！-0x%04X", -ret);
+        app_tls_close(t);
+        return -1;
+    }
+    mbedtls_ssl_set_bio(&conn->ssl, conn, app_tls_send, NULL, app_tls_recv);
+
+    app_tls_slot_t* slot = app_tls_find_slot(host, port, false);
+    if (slot != NULL && slot->valid && mbedtls_ssl_set_session(&conn->ssl, &slot->session) != 0) {
+        slot->valid = 0;// 会话不能使用，完整握手。
+    }
+
+    uint32_t start = esp_log_timestamp();
+    do {
+        ret = mbedtls_ssl_handshake(&conn->ssl);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    uint32_t ms = esp_log_timestamp() - start;
+
+    if (ret != 0) {
+        char err[64];
+        mbedtls_strerror(ret, err, sizeof(err));
+        ESP_LOGE(TAG, "------ TLS 握手：失败！%s:%d，-0x%04X %s，证书校验结果：0x%lX", host, port, -ret, err, mbedtls_ssl_get_verify_result(&conn->ssl));
+        if (slot != NULL) {
+            slot->valid = 0;
+        }
+        pthread_mutex_lock(&app_tls_mutex);
+        app_tls_stats.failed++;
+        pthread_mutex_unlock(&app_tls_mutex);
+        app_tls_close(t);
+        return -1;
+    }
+    conn->established = 1;
+    mbedtls_ssl_conf_read_timeout(&conn->conf, timeout_ms);
+
+    bool resumed = conn->verified == 0;
+    uint32_t bytes = conn->tx + conn->rx;
+    pthread_mutex_lock(&app_tls_mutex);
+    app_tls_stats.last_ms = ms;
+    app_tls_stats.last_tx = conn->tx;
+    app_tls_stats.last_rx = conn->rx;
+    if (resumed) {
+        app_tls_stats.resumed++;
+        app_tls_stats.resumed_ms = app_tls_avg(app_tls_stats.resumed_ms, ms);
+        app_tls_stats.resumed_bytes = app_tls_avg(app_tls_stats.resumed_bytes, bytes);
+    } else {
+        app_tls_stats.full++;
+        app_tls_stats.full_ms = app_tls_avg(app_tls_stats.full_ms, ms);
+        app_tls_stats.full_bytes = app_tls_avg(app_tls_stats.full_bytes, bytes);
+    }
+    pthread_mutex_unlock(&app_tls_mutex);
+    ESP_LOGI(TAG, "------ TLS 握手完成：%s，%s:%d，耗时：%lu 毫秒，发送：%lu 字节，接收：%lu 字节",
+        resumed ? "会话恢复" : "完整握手", host, port, ms, conn->tx, conn->rx);
+
+    slot = app_tls_find_slot(host, port, true);// 服务器可能发了新的会话票据，每次都更新。
+    mbedtls_ssl_session_free(&slot->session);
+    mbedtls_ssl_session_init(&slot->session);
+    slot->valid = mbedtls_ssl_get_session(&conn->ssl, &slot->session) == 0;
+#if APP_TLS_SESSION_NVS
+    if (slot->valid) {
+        app_tls_save_slot(slot);
+    }
+#endif
+    return 0;
+}
+
+/**
+ * @brief 等待可读。mbedtls 已经解密的数据没有读完时直接返回可读。
+ */
+static int app_tls_poll_read(esp_transport_handle_t t, int timeout_ms) {
+    app_tls_conn_t* conn = esp_transport_get_context_data(t);
+    if (!conn->established) {
+        return -1;
+    }
+    if (mbedtls_ssl_get_bytes_avail(&conn->ssl) > 0) {
+        return 1;
+    }
+    return app_tls_poll(conn->net.fd, true, timeout_ms);
+}
+
+/**
+ * @brief 等待可写。
+ */
+static int app_tls_poll_write(esp_transport_handle_t t, int timeout_ms) {
+    app_tls_conn_t* conn = esp_transport_get_context_data(t);
+    if (!conn->established) {
+        return -1;
+    }
+    return app_tls_poll(conn->net.fd, false, timeout_ms);
+}
+
+/**
+ * @brief 读取。返回值和 esp-mqtt 的约定相同：0 超时，-1 对方关闭，其它负数错误。
+ */
+static int app_tls_read(esp_transport_handle_t t, char* buffer, int len, int timeout_ms) {
+    app_tls_conn_t* conn = esp_transport_get_context_data(t);
+    int poll = app_tls_poll_read(t, timeout_ms);
+    if (poll <= 0) {
+        return poll;
+    }
+    mbedtls_ssl_conf_read_timeout(&conn->conf, timeout_ms);// 只收到半个记录时最多再等这么久。
+    int ret = mbedtls_ssl_read(&conn->ssl, (unsigned char*)buffer, len);
+    if (ret > 0) {
+        return ret;
+    }
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE || ret == MBEDTLS_ERR_SSL_TIMEOUT) {
+        return 0;
+    }
+    if (ret == 0 || ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+        ESP_LOGW(TAG, "------ TLS 连接被服务器关闭。");
+        return -1;
+    }
+    ESP_LOGE(TAG, "------ TLS 读取：失败！-0x%04X", -ret);
+    return -2;
+}
+
+/**
+ * @brief 写入。
+ */
+static int app_tls_write(esp_transport_handle_t t, const char* buffer, int len, int timeout_ms) {
+    app_tls_conn_t* conn = esp_transport_get_context_data(t);
+    int poll = app_tls_poll_write(t, timeout_ms);
+    if (poll <= 0) {
+        return poll;
+    }
+    int ret = mbedtls_ssl_write(&conn->ssl, (const unsigned char*)buffer, len);
+    if (ret >= 0) {
+        return ret;
+    }
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return 0;
+    }
+    ESP_LOGE(TAG, "------ TLS 写入：失败！-0x%04X", -ret);
+    return -1;
+}
+
+/**
+ * @brief 销毁。连接是静态分配的，只关闭，会话缓存保留。
+ */
+static int app_tls_destroy(esp_transport_handle_t t) {
+    return app_tls_close(t);
+}
+
+/**
+ * @brief 获取传输层，设置到 MQTT 配置的 network.transport，由 MQTT 客户端销毁。
+ * @return
+ */
+esp_transport_handle_t app_tls_get_transport(void) {
+    return app_tls_transport;
+}
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_tls_get_stats(app_tls_stats_t* stats) {
+    pthread_mutex_lock(&app_tls_mutex);
+    *stats = app_tls_stats;
+    pthread_mutex_unlock(&app_tls_mutex);
+}
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_tls_log(void) {
+    app_tls_stats_t stats;
+    app_tls_get_stats(&stats);
+    if (stats.full + stats.resumed + stats.failed == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "------ TLS 握手统计，完整：%lu 次，平均 %lu 毫秒 %lu 字节；会话恢复：%lu 次，平均 %lu 毫秒 %lu 字节；失败：%lu 次",
+        stats.full, stats.full_ms, stats.full_bytes, stats.resumed, stats.resumed_ms, stats.resumed_bytes, stats.failed);
+}
+
+/**
+ * @brief 初始化函数，NVS 初始化以后、MQTT 初始化时调用。加载 CA 证书和保存的会话，创建传输层。
+ * @return
+ */
+esp_err_t app_tls_init(void) {
+    if (app_tls_transport != NULL) {
+        return ESP_OK;
+    }
+    mbedtls_x509_crt_init(&app_tls_ca);
+    int ret = mbedtls_x509_crt_parse(&app_tls_ca, (const unsigned char*)app_tls_ca_start, app_tls_ca_end - app_tls_ca_start);
+    if (ret < 0 || app_tls_ca.version == 0) {
+        ESP_LOGE(TAG, "------ CA 证书无效！-0x%04X，替换 main/certs/mqtt_ca.pem。", ret < 0 ? -ret : 0);
+        mbedtls_x509_crt_free(&app_tls_ca);
+        return ESP_FAIL;
+    }
+    mbedtls_entropy_init(&app_tls_entropy);
+    mbedtls_ctr_drbg_init(&app_tls_drbg);
+    ret = mbedtls_ctr_drbg_seed(&app_tls_drbg, mbedtls_entropy_func, &app_tls_entropy, (const unsigned char*)TAG, strlen(TAG));
+    if (ret != 0) {
+        ESP_LOGE(TAG, "------ 随机数初始化：失败！-0x%04X", -ret);
+        return ESP_FAIL;
+    }
+    for (int i = 0; i < APP_TLS_SLOTS; i++) {
+        mbedtls_ssl_session_init(&app_tls_slots[i].session);
+    }
+#if APP_TLS_SESSION_NVS
+    app_tls_load_slots();
+#endif
+    mbedtls_net_init(&app_tls_conn.net);
+
+    esp_transport_handle_t t = esp_transport_init();
+    if (t == NULL) {
+        return ESP_FAIL;
+    }
+    esp_transport_set_func(t, app_tls_connect, app_tls_read, app_tls_write, app_tls_close, app_tls_poll_read, app_tls_poll_write, app_tls_destroy);
+    esp_transport_set_context_data(t, &app_tls_conn);
+    esp_transport_set_default_port(t, APP_TLS_DEFAULT_PORT);
+    app_tls_transport = t;
+    return ESP_OK;
+}
@@ -0,0 +1,50 @@
+/**
+ * @brief   MQTT TLS 传输层，固定 CA 证书，缓存 TLS 会话，PPP 重连以后恢复会话，只需要一个往返。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_transport.h"
+
+ /**
+  * @brief 握手统计数据。字节数是 TLS 记录的字节数，不含 TCP/IP 头。
+  */
+typedef struct {
+    uint32_t full;              // 完整握手次数。
+    uint32_t resumed;           // 会话恢复次数。
+    uint32_t failed;            // 握手失败次数。
+    uint32_t last_ms;           // 最近一次握手耗时，毫秒。
+    uint32_t last_tx;           // 最近一次握手发送字节数。
+    uint32_t last_rx;           // 最近一次握手接收字节数。
+    uint32_t full_ms;           // 完整握手耗时，平滑值。
+    uint32_t full_bytes;        // 完整握手收发字节数，平滑值。
+    uint32_t resumed_ms;        // 会话恢复耗时，平滑值。
+    uint32_t resumed_bytes;     // 会话恢复收发字节数，平滑值。
+} app_tls_stats_t;
+
+/**
+ * @brief 获取传输层，设置到 MQTT 配置的 network.transport，由 MQTT 客户端销毁。
+ * @return
+ */
+esp_transport_handle_t app_tls_get_transport(void);
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_tls_get_stats(app_tls_stats_t* stats);
+
+/**
+ * @brief 输出统计数据到日志。
+ */
+void app_tls_log(void);
+
+/**
+ * @brief 初始化函数，NVS 初始化以后、MQTT 初始化时调用。加载 CA 证书和保存的会话，创建传输层。
+ * @return
+ */
+esp_err_t app_tls_init(void);
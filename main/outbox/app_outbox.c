@@ -0,0 +1,458 @@
+/**
+ * @brief   MQTT 自定义 outbox，消息保存在 PSRAM，固定内存预算，超出预算或过期的消息转存到 SD 卡缓存。
+ *          CONFIG_MQTT_CUSTOM_OUTBOX=y 时替换 esp-mqtt 自带的 mqtt_outbox.c，编译进 mqtt 组件，见项目 CMakeLists.txt。
+ *          所有 outbox_xxx() 函数都由 esp-mqtt 在持有客户端锁时调用，MQTT 事件回调也持有这个锁，所以不再加锁。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "mqtt_outbox.h"
+#include "mqtt_msg.h"
+
+#include "../app_outbox.h"
+#include "../app_config.h"
+
+ /**
+ * @brief 消息 ID 哈希表大小，必须是 2 的幂。
+ */
+#define APP_OUTBOX_HASH_SIZE        64
+
+ /**
+ * @brief 消息状态数量，QUEUED、TRANSMITTED、ACKNOWLEDGED、CONFIRMED。
+ */
+#define APP_OUTBOX_STATE_COUNT      (CONFIRMED + 1)
+
+ /**
+ * @brief 日志 TAG。
+ */
+static const char* TAG = "app_outbox";
+
+/**
+ * @brief 一条消息，和数据一起分配在 PSRAM。
+ */
+typedef struct outbox_item {
+    struct outbox_item* next;       // 全部消息链表，按入队顺序，最早的在前面。
+    struct outbox_item* prev;
+    struct outbox_item* state_next; // 同一状态的消息链表。
+    struct outbox_item* state_prev;
+    struct outbox_item* hash_next;  // 消息 ID 哈希链表。
+    int msg_id;
+    int msg_type;
+    int msg_qos;
+    outbox_tick_t tick;
+    pending_state_t pending;
+    int len;
+    uint8_t buffer[];
+} outbox_item_t;
+
+/**
+ * @brief 双向链表头尾。
+ */
+typedef struct {
+    outbox_item_t* head;
+    outbox_item_t* tail;
+} app_outbox_list_t;
+
+/**
+ * @brief outbox。
+ */
+typedef struct outbox_t {
+    outbox_item_t* hash[APP_OUTBOX_HASH_SIZE];
+    app_outbox_list_t all;
+    app_outbox_list_t state[APP_OUTBOX_STATE_COUNT];
+    uint64_t size;                  // 消息数据字节数，outbox_get_size() 返回。
+    uint32_t used;                  // 包括消息头的字节数，和预算比较。
+    uint32_t count;
+} outbox_t;
+
+/**
+ * @brief 当前的 outbox，只有一个 MQTT 客户端。
+ */
+static outbox_t* app_outbox = NULL;
+
+/**
+ * @brief 转存回调。
+ */
+static app_outbox_spill_cb_t app_outbox_spill_cb = NULL;
+
+/**
+ * @brief 统计数据。
+ */
+static _Atomic uint32_t app_outbox_peak = ATOMIC_VAR_INIT(0);
+static _Atomic uint32_t app_outbox_spilled = ATOMIC_VAR_INIT(0);
+
+/**
+ * @brief 哈希桶。
+ */
+static outbox_item_t** app_outbox_bucket(outbox_t* outbox, int msg_id) {
+    return &outbox->hash[msg_id & (APP_OUTBOX_HASH_SIZE - 1)];
+}
+
+/**
+ * @brief 加入状态链表尾部。
+ */
+static void app_outbox_state_link(outbox_t* outbox, outbox_item_t* item) {
+    app_outbox_list_t* list = &outbox->state[item->pending];
+    item->state_next = NULL;
+    item->state_prev = list->tail;
+    if (list->tail != NULL) {
+        list->tail->state_next = item;
+    } else {
+        list->head = item;
+    }
+    list->tail = item;
+}
+
+/**
+ * @brief 从状态链表删除。
+ */
+static void app_outbox_state_unlink(outbox_t* outbox, outbox_item_t* item) {
+    app_outbox_list_t* list = &outbox->state[item->pending];
+    if (item->state_prev != NULL) {
+        item->state_prev->state_next = item->state_next;
+    } else {
+        list->head = item->state_next;
+    }
+    if (item->state_next != NULL) {
+        item->state_next->state_prev = item->state_prev;
+    } else {
+        list->tail = item->state_prev;
+    }
+}
+
+/**
+ * @brief 按消息 ID 查找，有多条时返回最早的一条。
+ */
+static outbox_item_t* app_outbox_find(outbox_t* outbox, int msg_id) {
+    outbox_item_t* found = NULL;
+    for (outbox_item_t* item = *app_outbox_bucket(outbox, msg_id); item != NULL; item = item->hash_next) {
+        if (item->msg_id == msg_id) {
+            found = item;// 新消息插入在桶的前面，继续找更早的。
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief 从所有链表删除并释放。
+ */
+static void app_outbox_remove(outbox_t* outbox, outbox_item_t* item) {
+    outbox_item_t** link = app_outbox_bucket(outbox, item->msg_id);
+    while (*link != item) {
+        link = &(*link)->hash_next;
+    }
+    *link = item->hash_next;
+
+    if (item->prev != NULL) {
+        item->prev->next = item->next;
+    } else {
+        outbox->all.head = item->next;
+    }
+    if (item->next != NULL) {
+        item->next->prev = item->prev;
+    } else {
+        outbox->all.tail = item->prev;
+    }
+    app_outbox_state_unlink(outbox, item);
+
+    outbox->size -= item->len;
+    outbox->used -= sizeof(outbox_item_t) + item->len;
+    outbox->count--;
+    heap_caps_free(item);
+}
+
+/**
+ * @brief 解析 MQTT 5 PUBLISH 报文，取出主题长度和消息内容。
+ * @return 0 成功，-1 报文不完整。
+ */
+static int app_outbox_parse_publish(const outbox_item_t* item, int* topic_len, const uint8_t** payload, int* payload_len) {
+    const uint8_t* buf = item->buffer;
+    int len = item->len;
+    int pos = 1;
+    for (int i = 0; i < 4; i++) {// 剩余长度，变长编码。
+        if (pos >= len) {
+            return -1;
+        }
+        if ((buf[pos++] & 0x80) == 0) {
+            break;
+        }
+    }
+    if (pos + 2 > len) {
+        return -1;
+    }
+    *topic_len = (buf[pos] << 8) | buf[pos + 1];
+    pos += 2 + *topic_len;
+    if (((buf[0] >> 1) & 0x03) > 0) {// 报文 ID。
+        pos += 2;
+    }
+    uint32_t prop_len = 0;
+    for (int i = 0, shift = 0; i < 4; i++, shift += 7) {// 属性长度，变长编码。
+        if (pos >= len) {
+            return -1;
+        }
+        uint8_t b = buf[pos++];
+        prop_len |= (uint32_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            break;
+        }
+    }
+    pos += prop_len;
+    if (pos > len) {
+        return -1;
+    }
+    *payload = buf + pos;
+    *payload_len = len - pos;
+    return 0;
+}
+
+/**
+ * @brief 转存一条消息并删除。
+ *        只转存 QOS > 0 的 PUBLISH，其它报文直接删除，由 esp-mqtt 按原来的逻辑处理。
+ */
+static void app_outbox_spill(outbox_t* outbox, outbox_item_t* item) {
+    if (item->msg_type == MQTT_MSG_TYPE_PUBLISH && item->msg_qos > 0 && app_outbox_spill_cb != NULL) {
+        int topic_len = 0;
+        const uint8_t* payload = NULL;
+        int payload_len = 0;
+        if (app_outbox_parse_publish(item, &topic_len, &payload, &payload_len) == 0) {
+            app_outbox_spill_cb(item->msg_id, (const char*)payload, payload_len);
+            atomic_fetch_add(&app_outbox_spilled, 1);
+        } else {
+            ESP_LOGE(TAG, "------ MQTT outbox 报文解析：失败！消息 ID：%d", item->msg_id);
+        }
+    }
+    app_outbox_remove(outbox, item);
+}
+
+/**
+ * @brief 设置转存回调，MQTT 初始化之前调用。
+ * @param cb
+ */
+void app_outbox_set_spill_cb(app_outbox_spill_cb_t cb) {
+    app_outbox_spill_cb = cb;
+}
+
+/**
+ * @brief 转存只有主题别名、没有完整主题的 PUBLISH。
+ *        别名只在一次连接内有效，新连接上重发会被服务器拒绝，连接成功以后、重发之前调用。
+ * @return 转存条数。
+ */
+int app_outbox_spill_alias_only(void) {
+    outbox_t* outbox = app_outbox;
+    if (outbox == NULL) {
+        return 0;
+    }
+    int count = 0;
+    outbox_item_t* item = outbox->all.head;
+    while (item != NULL) {
+        outbox_item_t* next = item->next;
+        int topic_len = 0;
+        const uint8_t* payload = NULL;
+        int payload_len = 0;
+        if (item->msg_type == MQTT_MSG_TYPE_PUBLISH
+            && app_outbox_parse_publish(item, &topic_len, &payload, &payload_len) == 0 && topic_len == 0) {
+            app_outbox_spill(outbox, item);
+            count++;
+        }
+        item = next;
+    }
+    if (count > 0) {
+        ESP_LOGW(TAG, "------ MQTT outbox 只有主题别名的消息不能在新连接上重发，转存到缓存。条数：%d", count);
+    }
+    return count;
+}
+
+/**
+ * @brief 获取统计数据。
+ * @param stats
+ */
+void app_outbox_get_stats(app_outbox_stats_t* stats) {
+    outbox_t* outbox = app_outbox;
+    stats->count = outbox != NULL ? outbox->count : 0;
+    stats->size = outbox != NULL ? outbox->used : 0;
+    stats->peak = atomic_load(&app_outbox_peak);
+    stats->spilled = atomic_load(&app_outbox_spilled);
+}
+
+outbox_handle_t outbox_init(void) {
+    outbox_t* outbox = heap_caps_calloc(1, sizeof(outbox_t), MALLOC_CAP_SPIRAM);
+    if (outbox == NULL) {
+        ESP_LOGE(TAG, "------ MQTT outbox 初始化：失败！PSRAM 内存不足。");
+        return NULL;
+    }
+    app_outbox = outbox;
+    ESP_LOGI(TAG, "------ MQTT outbox 初始化：完成。预算字节：%d", APP_MQTT_OUTBOX_BUDGET);
+    return outbox;
+}
+
+outbox_item_handle_t outbox_enqueue(outbox_handle_t outbox, outbox_message_handle_t message, outbox_tick_t tick) {
+    int len = message->len + message->remaining_len;
+    uint32_t need = sizeof(outbox_item_t) + len;
+    if (need > APP_MQTT_OUTBOX_BUDGET) {
+        ESP_LOGE(TAG, "------ MQTT outbox 消息超过预算，不能入队。消息 ID：%d，字节：%d", message->msg_id, len);
+        return NULL;
+    }
+    int spill_count = 0;
+    outbox_item_t* victim = outbox->all.head;
+    while (outbox->used + need > APP_MQTT_OUTBOX_BUDGET && victim != NULL) {// 超出预算，从最早的 PUBLISH 开始转存。
+        outbox_item_t* next = victim->next;
+        if (victim->msg_type == MQTT_MSG_TYPE_PUBLISH) {
+            app_outbox_spill(outbox, victim);
+            spill_count++;
+        }
+        victim = next;
+    }
+    if (spill_count > 0) {
+        ESP_LOGW(TAG, "------ MQTT outbox 超出预算，最早的消息转存到缓存。条数：%d", spill_count);
+    }
+    if (outbox->used + need > APP_MQTT_OUTBOX_BUDGET) {
+        return NULL;
+    }
+
+    outbox_item_t* item = heap_caps_malloc(need, MALLOC_CAP_SPIRAM);
+    if (item == NULL) {
+        ESP_LOGE(TAG, "------ MQTT outbox 入队：失败！PSRAM 内存不足。");
+        return NULL;
+    }
+    memset(item, 0, sizeof(outbox_item_t));
+    item->msg_id = message->msg_id;
+    item->msg_type = message->msg_type;
+    item->msg_qos = message->msg_qos;
+    item->tick = tick;
+    item->pending = QUEUED;
+    item->len = len;
+    memcpy(item->buffer, message->data, message->len);
+    if (message->remaining_data != NULL) {
+        memcpy(item->buffer + message->len, message->remaining_data, message->remaining_len);
+    }
+
+    outbox_item_t** bucket = app_outbox_bucket(outbox, item->msg_id);
+    item->hash_next = *bucket;
+    *bucket = item;
+    item->prev = outbox->all.tail;
+    if (outbox->all.tail != NULL) {
+        outbox->all.tail->next = item;
+    } else {
+        outbox->all.head = item;
+    }
+    outbox->all.tail = item;
+    app_outbox_state_link(outbox, item);
+
+    outbox->size += len;
+    outbox->used += need;
+    outbox->count++;
+    if (outbox->used > atomic_load(&app_outbox_peak)) {
+        atomic_store(&app_outbox_peak, outbox->used);
+    }
+    return item;
+}
+
+outbox_item_handle_t outbox_get(outbox_handle_t outbox, int msg_id) {
+    return app_outbox_find(outbox, msg_id);
+}
+
+outbox_item_handle_t outbox_dequeue(outbox_handle_t outbox, pending_state_t pending, outbox_tick_t* tick) {
+    outbox_item_t* item = outbox->state[pending].head;// 每个状态一个链表，不需要遍历。
+    if (item != NULL && tick != NULL) {
+        *tick = item->tick;
+    }
+    return item;
+}
+
+esp_err_t outbox_delete_item(outbox_handle_t outbox, outbox_item_handle_t item) {
+    app_outbox_remove(outbox, item);
+    return ESP_OK;
+}
+
+uint8_t* outbox_item_get_data(outbox_item_handle_t item, size_t* len, uint16_t* msg_id, int* msg_type, int* qos) {
+    if (item == NULL) {
+        return NULL;
+    }
+    *len = item->len;
+    *msg_id = item->msg_id;
+    *msg_type = item->msg_type;
+    *qos = item->msg_qos;
+    return item->buffer;
+}
+
+esp_err_t outbox_delete(outbox_handle_t outbox, int msg_id, int msg_type) {
+    for (outbox_item_t* item = *app_outbox_bucket(outbox, msg_id); item != NULL; item = item->hash_next) {
+        if (item->msg_id == msg_id && item->msg_type == msg_type) {
+            app_outbox_remove(outbox, item);
+            return ESP_OK;
+        }
+    }
+    return ESP_FAIL;
+}
+
+esp_err_t outbox_set_pending(outbox_handle_t outbox, int msg_id, pending_state_t pending) {
+    outbox_item_t* item = app_outbox_find(outbox, msg_id);
+    if (item == NULL) {
+        return ESP_FAIL;
+    }
+    app_outbox_state_unlink(outbox, item);
+    item->pending = pending;
+    app_outbox_state_link(outbox, item);
+    return ESP_OK;
+}
+
+pending_state_t outbox_item_get_pending(outbox_item_handle_t item) {
+    return item->pending;
+}
+
+esp_err_t outbox_set_tick(outbox_handle_t outbox, int msg_id, outbox_tick_t tick) {
+    outbox_item_t* item = app_outbox_find(outbox, msg_id);
+    if (item == NULL) {
+        return ESP_FAIL;
+    }
+    item->tick = tick;
+    return ESP_OK;
+}
+
+int outbox_delete_single_expired(outbox_handle_t outbox, outbox_tick_t current_tick, outbox_tick_t timeout) {
+    for (outbox_item_t* item = outbox->all.head; item != NULL; item = item->next) {
+        if (current_tick - item->tick > timeout) {// 过期的消息转存，不丢弃。
+            int msg_id = item->msg_id;
+            app_outbox_spill(outbox, item);
+            return msg_id;
+        }
+    }
+    return -1;
+}
+
+int outbox_delete_expired(outbox_handle_t outbox, outbox_tick_t current_tick, outbox_tick_t timeout) {
+    int count = 0;
+    outbox_item_t* item = outbox->all.head;
+    while (item != NULL) {
+        outbox_item_t* next = item->next;
+        if (current_tick - item->tick > timeout) {
+            app_outbox_spill(outbox, item);
+            count++;
+        }
+        item = next;
+    }
+    return count;
+}
+
+uint64_t outbox_get_size(outbox_handle_t outbox) {
+    return outbox->size;
+}
+
+void outbox_delete_all_items(outbox_handle_t outbox) {
+    while (outbox->all.head != NULL) {
+        app_outbox_remove(outbox, outbox->all.head);
+    }
+}
+
+void outbox_destroy(outbox_handle_t outbox) {
+    outbox_delete_all_items(outbox);
+    if (app_outbox == outbox) {
+        app_outbox = NULL;
+    }
+    heap_caps_free(outbox);
+}
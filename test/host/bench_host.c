@@ -0,0 +1,35 @@
+/**
+ * @brief   主机上运行 SD 卡性能测试，测试代码和设备相同（main/app_bench.c），输出和控制命令 bench 应答中 "bench" 相同的 JSON，
+ *          没有 "card"。测量 FAT 镜像时先挂载，例如：
+ *              mkfs.fat -C sd.img 65536 && sudo mount -o loop,sync,uid=$(id -u) sd.img /mnt/sd
+ *              bench_host /mnt/sd 256
+ *          用法：bench_host <目录> [kb] [遍历目录]，在 <目录>/BENCH 中测试，遍历目录默认是 <目录>。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "app_bench.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "用法：%s <目录> [kb] [遍历目录]\n", argv[0]);
+        return 2;
+    }
+    uint32_t kb = argc > 2 ? strtoul(argv[2], NULL, 10) : 256;
+    const char* scan_dir = argc > 3 ? argv[3] : argv[1];
+    char dir[128];
+    snprintf(dir, sizeof(dir), "%s/BENCH", argv[1]);
+    app_bench_result_t* result = malloc(sizeof(app_bench_result_t));
+    esp_err_t ret = app_bench_run_dir(dir, scan_dir, kb, result);
+    cJSON* bench = cJSON_CreateObject();
+    app_bench_add_result_json(bench, result);
+    char* str = cJSON_PrintUnformatted(bench);
+    printf("%s\n", str);
+    cJSON_free(str);
+    cJSON_Delete(bench);
+    free(result);
+    return ret == ESP_OK ? 0 : 1;
+}
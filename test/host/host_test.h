@@ -0,0 +1,39 @@
+/**
+ * @brief   主机测试公共宏：断言失败时输出位置并退出，每个测试程序是一个 ctest 用例。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define TEST_ASSERT_MSG(cond, format, ...) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: 断言失败：%s，" format "\n", __FILE__, __LINE__, #cond, ##__VA_ARGS__); \
+            exit(1); \
+        } \
+    } while (0)
+
+#define TEST_ASSERT(cond)               TEST_ASSERT_MSG(cond, "%s", "")
+#define TEST_ASSERT_EQUAL(expected, actual) \
+    TEST_ASSERT_MSG((long long)(expected) == (long long)(actual), "期望 %lld，实际 %lld", \
+        (long long)(expected), (long long)(actual))
+
+#define RUN_TEST(fn) do { \
+        printf("------ %s\n", #fn); \
+        fflush(stdout); \
+        fn(); \
+    } while (0)
+
+/**
+ * @brief 删除并重新创建测试目录。
+ */
+static inline void host_test_reset_dir(const char* path) {
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s' && mkdir -p '%s'", path, path);
+    TEST_ASSERT_MSG(system(cmd) == 0, "%s", path);
+}
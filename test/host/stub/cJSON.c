@@ -0,0 +1,384 @@
+/**
+ * @brief   主机测试：cJSON 替身的实现。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+
+typedef struct {
+    const char* p;
+    const char* end;
+} host_json_in_t;
+
+typedef struct {
+    char* buf;
+    size_t len;
+    size_t size;
+} host_json_out_t;
+
+static cJSON* host_json_new(int type) {
+    cJSON* item = calloc(1, sizeof(cJSON));
+    if (item != NULL) {
+        item->type = type;
+    }
+    return item;
+}
+
+void cJSON_Delete(cJSON* item) {
+    while (item != NULL) {
+        cJSON* next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+void cJSON_free(void* object) {
+    free(object);
+}
+
+static void host_json_skip(host_json_in_t* in) {
+    while (in->p < in->end && (*in->p == ' ' || *in->p == '\t' || *in->p == '\r' || *in->p == '\n')) {
+        in->p++;
+    }
+}
+
+static char* host_json_parse_string(host_json_in_t* in) {
+    if (in->p >= in->end || *in->p != '"') {
+        return NULL;
+    }
+    in->p++;
+    char* out = malloc(in->end - in->p + 1);
+    size_t len = 0;
+    while (in->p < in->end && *in->p != '"') {
+        char c = *in->p++;
+        if (c == '\\') {
+            if (in->p >= in->end) {
+                break;
+            }
+            c = *in->p++;
+            c = c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c;
+        }
+        out[len++] = c;
+    }
+    if (in->p >= in->end) {
+        free(out);
+        return NULL;
+    }
+    in->p++;
+    out[len] = '\0';
+    return out;
+}
+
+static cJSON* host_json_parse_value(host_json_in_t* in, int depth);
+
+static cJSON* host_json_parse_children(host_json_in_t* in, int depth, int type, char close) {
+    cJSON* parent = host_json_new(type);
+    cJSON* last = NULL;
+    in->p++;
+    host_json_skip(in);
+    if (in->p < in->end && *in->p == close) {
+        in->p++;
+        return parent;
+    }
+    while (in->p < in->end) {
+        char* name = NULL;
+        if (type == cJSON_Object) {
+            name = host_json_parse_string(in);
+            host_json_skip(in);
+            if (name == NULL || in->p >= in->end || *in->p != ':') {
+                free(name);
+                break;
+            }
+            in->p++;
+        }
+        cJSON* child = host_json_parse_value(in, depth + 1);
+        if (child == NULL) {
+            free(name);
+            break;
+        }
+        child->string = name;
+        if (last == NULL) {
+            parent->child = child;
+        } else {
+            last->next = child;
+            child->prev = last;
+        }
+        last = child;
+        host_json_skip(in);
+        if (in->p < in->end && *in->p == ',') {
+            in->p++;
+            continue;
+        }
+        if (in->p < in->end && *in->p == close) {
+            in->p++;
+            return parent;
+        }
+        break;
+    }
+    cJSON_Delete(parent);
+    return NULL;
+}
+
+static cJSON* host_json_parse_value(host_json_in_t* in, int depth) {
+    host_json_skip(in);
+    if (in->p >= in->end || depth > 32) {
+        return NULL;
+    }
+    size_t left = in->end - in->p;
+    if (*in->p == '{') {
+        return host_json_parse_children(in, depth, cJSON_Object, '}');
+    } else if (*in->p == '[') {
+        return host_json_parse_children(in, depth, cJSON_Array, ']');
+    } else if (*in->p == '"') {
+        char* s = host_json_parse_string(in);
+        cJSON* item = s != NULL ? host_json_new(cJSON_String) : NULL;
+        if (item != NULL) {
+            item->valuestring = s;
+        }
+        return item;
+    } else if (left >= 4 && strncmp(in->p, "true", 4) == 0) {
+        in->p += 4;
+        return host_json_new(cJSON_True);
+    } else if (left >= 5 && strncmp(in->p, "false", 5) == 0) {
+        in->p += 5;
+        return host_json_new(cJSON_False);
+    } else if (left >= 4 && strncmp(in->p, "null", 4) == 0) {
+        in->p += 4;
+        return host_json_new(cJSON_NULL);
+    }
+    char num[64];
+    size_t len = 0;
+    while (len < left && len < sizeof(num) - 1 && strchr("+-.eE0123456789", in->p[len]) != NULL) {
+        num[len] = in->p[len];
+        len++;
+    }
+    num[len] = '\0';
+    char* endp = NULL;
+    double d = strtod(num, &endp);
+    if (len == 0 || endp != num + len) {
+        return NULL;
+    }
+    in->p += len;
+    return cJSON_CreateNumber(d);
+}
+
+cJSON* cJSON_ParseWithLength(const char* value, size_t length) {
+    if (value == NULL) {
+        return NULL;
+    }
+    host_json_in_t in = { .p = value, .end = value + length };
+    cJSON* item = host_json_parse_value(&in, 0);
+    host_json_skip(&in);
+    if (item != NULL && in.p < in.end && *in.p != '\0') {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    return item;
+}
+
+cJSON* cJSON_Parse(const char* value) {
+    return value != NULL ? cJSON_ParseWithLength(value, strlen(value)) : NULL;
+}
+
+static void host_json_put(host_json_out_t* out, const char* s, size_t len) {
+    if (out->len + len + 1 > out->size) {
+        out->size = (out->len + len + 1) * 2;
+        out->buf = realloc(out->buf, out->size);
+    }
+    memcpy(out->buf + out->len, s, len);
+    out->len += len;
+    out->buf[out->len] = '\0';
+}
+
+static void host_json_put_string(host_json_out_t* out, const char* s) {
+    host_json_put(out, "\"", 1);
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            host_json_put(out, "\\", 1);
+        }
+        host_json_put(out, s, 1);
+    }
+    host_json_put(out, "\"", 1);
+}
+
+static void host_json_print(host_json_out_t* out, const cJSON* item) {
+    char num[32];
+    switch (item->type) {
+    case cJSON_False: host_json_put(out, "false", 5); break;
+    case cJSON_True: host_json_put(out, "true", 4); break;
+    case cJSON_NULL: host_json_put(out, "null", 4); break;
+    case cJSON_Number:
+        if (item->valuedouble == (double)item->valueint) {// 和 cJSON 相同，整数不带小数点。
+            snprintf(num, sizeof(num), "%d", item->valueint);
+        } else {
+            snprintf(num, sizeof(num), "%1.15g", item->valuedouble);
+        }
+        host_json_put(out, num, strlen(num));
+        break;
+    case cJSON_String: host_json_put_string(out, item->valuestring); break;
+    case cJSON_Array:
+    case cJSON_Object:
+        host_json_put(out, item->type == cJSON_Array ? "[" : "{", 1);
+        for (const cJSON* child = item->child; child != NULL; child = child->next) {
+            if (child != item->child) {
+                host_json_put(out, ",", 1);
+            }
+            if (item->type == cJSON_Object) {
+                host_json_put_string(out, child->string);
+                host_json_put(out, ":", 1);
+            }
+            host_json_print(out, child);
+        }
+        host_json_put(out, item->type == cJSON_Array ? "]" : "}", 1);
+        break;
+    }
+}
+
+char* cJSON_PrintUnformatted(const cJSON* item) {
+    host_json_out_t out = { 0 };
+    host_json_put(&out, "", 0);
+    host_json_print(&out, item);
+    return out.buf;
+}
+
+cJSON* cJSON_GetObjectItemCaseSensitive(const cJSON* object, const char* string) {
+    if (object == NULL || string == NULL) {
+        return NULL;
+    }
+    for (cJSON* child = object->child; child != NULL; child = child->next) {
+        if (child->string != NULL && strcmp(child->string, string) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+int cJSON_GetArraySize(const cJSON* array) {
+    int count = 0;
+    for (const cJSON* child = array != NULL ? array->child : NULL; child != NULL; child = child->next) {
+        count++;
+    }
+    return count;
+}
+
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index) {
+    cJSON* child = array != NULL ? array->child : NULL;
+    while (child != NULL && index-- > 0) {
+        child = child->next;
+    }
+    return child;
+}
+
+int cJSON_IsNumber(const cJSON* item) {
+    return item != NULL && item->type == cJSON_Number;
+}
+
+int cJSON_IsString(const cJSON* item) {
+    return item != NULL && item->type == cJSON_String;
+}
+
+int cJSON_IsArray(const cJSON* item) {
+    return item != NULL && item->type == cJSON_Array;
+}
+
+int cJSON_IsObject(const cJSON* item) {
+    return item != NULL && item->type == cJSON_Object;
+}
+
+cJSON* cJSON_CreateObject(void) {
+    return host_json_new(cJSON_Object);
+}
+
+cJSON* cJSON_CreateArray(void) {
+    return host_json_new(cJSON_Array);
+}
+
+cJSON* cJSON_CreateNumber(double num) {
+    cJSON* item = host_json_new(cJSON_Number);
+    if (item != NULL) {
+        item->valuedouble = num;
+        item->valueint = num >= 2147483647.0 ? 2147483647 : num <= -2147483648.0 ? (int)-2147483647 - 1 : (int)num;
+    }
+    return item;
+}
+
+cJSON* cJSON_CreateString(const char* string) {
+    cJSON* item = host_json_new(cJSON_String);
+    if (item != NULL) {
+        item->valuestring = strdup(string);
+    }
+    return item;
+}
+
+cJSON* cJSON_CreateIntArray(const int* numbers, int count) {
+    cJSON* array = cJSON_CreateArray();
+    for (int i = 0; array != NULL && i < count; i++) {
+        cJSON_AddItemToArray(array, cJSON_CreateNumber(numbers[i]));
+    }
+    return array;
+}
+
+cJSON* cJSON_CreateDoubleArray(const double* numbers, int count) {
+    cJSON* array = cJSON_CreateArray();
+    for (int i = 0; array != NULL && i < count; i++) {
+        cJSON_AddItemToArray(array, cJSON_CreateNumber(numbers[i]));
+    }
+    return array;
+}
+
+int cJSON_AddItemToArray(cJSON* array, cJSON* item) {
+    if (array == NULL || item == NULL) {
+        return 0;
+    }
+    if (array->child == NULL) {
+        array->child = item;
+        return 1;
+    }
+    cJSON* last = array->child;
+    while (last->next != NULL) {
+        last = last->next;
+    }
+    last->next = item;
+    item->prev = last;
+    return 1;
+}
+
+int cJSON_AddItemToObject(cJSON* object, const char* string, cJSON* item) {
+    if (object == NULL || string == NULL || item == NULL) {
+        return 0;
+    }
+    free(item->string);
+    item->string = strdup(string);
+    return cJSON_AddItemToArray(object, item);
+}
+
+static cJSON* host_json_add(cJSON* object, const char* name, cJSON* item) {
+    if (cJSON_AddItemToObject(object, name, item)) {
+        return item;
+    }
+    cJSON_Delete(item);
+    return NULL;
+}
+
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number) {
+    return host_json_add(object, name, cJSON_CreateNumber(number));
+}
+
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string) {
+    return host_json_add(object, name, cJSON_CreateString(string));
+}
+
+cJSON* cJSON_AddObjectToObject(cJSON* object, const char* name) {
+    return host_json_add(object, name, cJSON_CreateObject());
+}
+
+cJSON* cJSON_AddArrayToObject(cJSON* object, const char* name) {
+    return host_json_add(object, name, cJSON_CreateArray());
+}
@@ -0,0 +1,55 @@
+/**
+ * @brief   主机测试：cJSON 替身，结构体和函数名与 cJSON 相同，只实现模块用到的部分。
+ *          解析支持对象、数组、数字、字符串、true/false/null，字符串不处理 \u 转义。
+ */
+#pragma once
+
+#include <stddef.h>
+
+#define cJSON_Invalid               0
+#define cJSON_False                 (1 << 0)
+#define cJSON_True                  (1 << 1)
+#define cJSON_NULL                  (1 << 2)
+#define cJSON_Number                (1 << 3)
+#define cJSON_String                (1 << 4)
+#define cJSON_Array                 (1 << 5)
+#define cJSON_Object                (1 << 6)
+
+typedef struct cJSON {
+    struct cJSON* next;
+    struct cJSON* prev;
+    struct cJSON* child;
+    int type;
+    char* valuestring;
+    int valueint;
+    double valuedouble;
+    char* string;
+} cJSON;
+
+cJSON* cJSON_ParseWithLength(const char* value, size_t length);
+cJSON* cJSON_Parse(const char* value);
+char* cJSON_PrintUnformatted(const cJSON* item);
+void cJSON_Delete(cJSON* item);
+void cJSON_free(void* object);
+
+cJSON* cJSON_GetObjectItemCaseSensitive(const cJSON* object, const char* string);
+int cJSON_GetArraySize(const cJSON* array);
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index);
+int cJSON_IsNumber(const cJSON* item);
+int cJSON_IsString(const cJSON* item);
+int cJSON_IsArray(const cJSON* item);
+int cJSON_IsObject(const cJSON* item);
+
+cJSON* cJSON_CreateObject(void);
+cJSON* cJSON_CreateArray(void);
+cJSON* cJSON_CreateNumber(double num);
+cJSON* cJSON_CreateString(const char* string);
+cJSON* cJSON_CreateIntArray(const int* numbers, int count);
+cJSON* cJSON_CreateDoubleArray(const double* numbers, int count);
+
+int cJSON_AddItemToArray(cJSON* array, cJSON* item);
+int cJSON_AddItemToObject(cJSON* object, const char* string, cJSON* item);
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number);
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string);
+cJSON* cJSON_AddObjectToObject(cJSON* object, const char* name);
+cJSON* cJSON_AddArrayToObject(cJSON* object, const char* name);
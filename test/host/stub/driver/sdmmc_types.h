@@ -0,0 +1,10 @@
+/**
+ * @brief   主机测试：sdmmc_types 替身。
+ */
+#pragma once
+
+#include "esp_err.h"
+
+typedef struct {
+    int unused;
+} sdmmc_card_t;
@@ -0,0 +1,11 @@
+/**
+ * @brief   主机测试：UART 驱动替身的实现。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include "driver/uart.h"
+
+esp_err_t uart_set_baudrate(uart_port_t uart_num, uint32_t baudrate) {
+    return ESP_OK;
+}
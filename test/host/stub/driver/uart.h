@@ -0,0 +1,25 @@
+/**
+ * @brief   主机测试：UART 驱动替身，只有调制解调器用到的类型和函数，见 uart.c。
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef int uart_port_t;
+
+typedef enum {
+    UART_DATA_8_BITS = 3,
+} uart_word_length_t;
+
+typedef enum {
+    UART_STOP_BITS_1 = 1,
+} uart_stop_bits_t;
+
+typedef enum {
+    UART_PARITY_DISABLE = 0,
+} uart_parity_t;
+
+#define UART_NUM_1                  1
+
+esp_err_t uart_set_baudrate(uart_port_t uart_num, uint32_t baudrate);
@@ -0,0 +1,15 @@
+/**
+ * @brief   主机测试：esp_app_desc 替身，ELF 文件的 SHA256 全是 0。
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    uint8_t app_elf_sha256[32];
+} esp_app_desc_t;
+
+static inline const esp_app_desc_t* esp_app_get_description(void) {
+    static const esp_app_desc_t desc = { 0 };
+    return &desc;
+}
@@ -0,0 +1,7 @@
+/**
+ * @brief   主机测试：esp_attr 替身，段属性在主机上为空。
+ */
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
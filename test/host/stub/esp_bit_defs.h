@@ -0,0 +1,6 @@
+/**
+ * @brief   主机测试：esp_bit_defs 替身，BIT0 到 BIT7 在 FreeRTOS.h 中。
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
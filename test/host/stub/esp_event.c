@@ -0,0 +1,27 @@
+/**
+ * @brief   主机测试：esp_event 替身的实现。事件循环只是一个句柄，投递的事件直接丢弃。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include "esp_event.h"
+
+static int host_event_loop;
+
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, esp_event_loop_handle_t* event_loop) {
+    *event_loop = &host_event_loop;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop) {
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run) {
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
+    const void* event_data, size_t event_data_size, TickType_t ticks_to_wait) {
+    return ESP_OK;
+}
@@ -0,0 +1,21 @@
+/**
+ * @brief   主机测试：heap_caps 替身，PSRAM 用普通内存代替。
+ */
+#pragma once
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_SPIRAM           (1 << 10)
+#define MALLOC_CAP_INTERNAL         (1 << 11)
+#define MALLOC_CAP_DEFAULT          (1 << 12)
+#define MALLOC_CAP_8BIT             (1 << 2)
+
+static inline void* heap_caps_malloc(size_t size, uint32_t caps) {
+    (void)caps;
+    return malloc(size);
+}
+
+static inline void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    (void)caps;
+    return calloc(n, size);
+}
@@ -0,0 +1,6 @@
+/**
+ * @brief   主机测试：esp_intr_alloc 替身，只有中断标志。
+ */
+#pragma once
+
+#define ESP_INTR_FLAG_LEVEL1        (1 << 1)
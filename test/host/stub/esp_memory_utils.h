@@ -0,0 +1,11 @@
+/**
+ * @brief   主机测试：esp_memory_utils 替身。主机上没有 flash 常量区，格式字符串都按文本记录写入。
+ */
+#pragma once
+
+#include <stdbool.h>
+
+static inline bool esp_ptr_in_drom(const void* p) {
+    (void)p;
+    return false;
+}
@@ -0,0 +1,6 @@
+/**
+ * @brief   主机测试：esp_netif 替身，只有类型。
+ */
+#pragma once
+
+typedef struct esp_netif_obj esp_netif_t;
@@ -0,0 +1,11 @@
+/**
+ * @brief   主机测试：esp_random 替身，用 libc 的 random()，测试程序用 srandom() 设置种子。
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+static inline uint32_t esp_random(void) {
+    return (uint32_t)random() ^ ((uint32_t)random() << 16);
+}
@@ -0,0 +1,17 @@
+/**
+ * @brief   主机测试：ROM CRC32 替身，和 ROM 的 crc32_le 相同（zlib CRC32，可以分段计算）。
+ */
+#pragma once
+
+#include <stdint.h>
+
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
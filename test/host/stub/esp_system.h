@@ -0,0 +1,18 @@
+/**
+ * @brief   主机测试：esp_system 替身。关机回调不执行，测试用 _exit() 模拟掉电。
+ */
+#pragma once
+
+#include <stdlib.h>
+#include "esp_err.h"
+
+typedef void (*shutdown_handler_t)(void);
+
+static inline esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle) {
+    (void)handle;
+    return ESP_OK;
+}
+
+static inline void esp_restart(void) {
+    exit(0);
+}
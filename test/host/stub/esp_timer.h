@@ -0,0 +1,13 @@
+/**
+ * @brief   主机测试：esp_timer 替身，微秒时间戳用单调时钟。
+ */
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+static inline int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
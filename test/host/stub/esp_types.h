@@ -0,0 +1,12 @@
+/**
+ * @brief   主机测试：esp_types 替身。__containerof 在 ESP-IDF 中来自 newlib 的 sys/cdefs.h，glibc 没有。
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef __containerof
+#define __containerof(ptr, type, member)    ((type*)((char*)(ptr) - offsetof(type, member)))
+#endif
@@ -0,0 +1,438 @@
+/**
+ * @brief   主机测试：FreeRTOS 替身的实现。任务是分离的 pthread，阻塞等待用条件变量和 CLOCK_MONOTONIC 超时。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+
+struct host_task {
+    TaskFunction_t fn;
+    void* param;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t notify;
+};
+
+struct host_queue {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t* items;
+};
+
+struct host_event_group {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    EventBits_t bits;
+};
+
+struct host_semaphore {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int available;
+};
+
+struct host_ringbuf {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint8_t* data;
+    size_t size;
+    size_t head;
+    size_t count;
+    size_t acquired;                // 已经取出、还没有归还的字节数。
+};
+
+int host_task_create_fail = 0;
+
+/**
+ * @brief 当前线程的任务，测试主线程第一次使用时创建。
+ */
+static __thread struct host_task* host_task_self = NULL;
+
+static void host_cond_init(pthread_cond_t* cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/**
+ * @brief 等待条件变量，portMAX_DELAY 一直等待。
+ * @return 0 被唤醒，ETIMEDOUT 超时。
+ */
+static int host_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* deadline) {
+    if (deadline == NULL) {
+        return pthread_cond_wait(cond, mutex);
+    }
+    return pthread_cond_timedwait(cond, mutex, deadline);
+}
+
+static struct timespec* host_deadline(TickType_t wait, struct timespec* ts) {
+    if (wait == portMAX_DELAY) {
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += wait / 1000;
+    ts->tv_nsec += (long)(wait % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+TickType_t xTaskGetTickCount(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static struct host_task* host_task_new(TaskFunction_t fn, void* param) {
+    struct host_task* task = calloc(1, sizeof(struct host_task));
+    task->fn = fn;
+    task->param = param;
+    pthread_mutex_init(&task->mutex, NULL);
+    host_cond_init(&task->cond);
+    return task;
+}
+
+static void* host_task_main(void* arg) {
+    host_task_self = arg;
+    host_task_self->fn(host_task_self->param);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* param, UBaseType_t prio, TaskHandle_t* handle) {
+    (void)name;
+    (void)stack;
+    (void)prio;
+    if (host_task_create_fail) {
+        return pdFAIL;
+    }
+    struct host_task* task = host_task_new(fn, param);
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, host_task_main, task) != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+    if (handle != NULL) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* param, UBaseType_t prio,
+    TaskHandle_t* handle, BaseType_t core) {
+    (void)core;
+    return xTaskCreate(fn, name, stack, param, prio, handle);
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+    if (handle == NULL || handle == host_task_self) {
+        pthread_exit(NULL);
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    struct timespec ts = { .tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    if (host_task_self == NULL) {
+        host_task_self = host_task_new(NULL, NULL);
+    }
+    return host_task_self;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    pthread_mutex_lock(&task->mutex);
+    task->notify++;
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->mutex);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+    struct host_task* task = xTaskGetCurrentTaskHandle();
+    struct timespec ts;
+    struct timespec* deadline = host_deadline(wait, &ts);
+    pthread_mutex_lock(&task->mutex);
+    while (task->notify == 0 && wait != 0 && host_cond_wait(&task->cond, &task->mutex, deadline) != ETIMEDOUT) {
+    }
+    uint32_t value = task->notify;
+    if (value > 0) {
+        task->notify = clear ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->mutex);
+    return value;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct host_queue* queue = calloc(1, sizeof(struct host_queue));
+    queue->items = malloc((size_t)length * item_size);
+    queue->length = length;
+    queue->item_size = item_size;
+    pthread_mutex_init(&queue->mutex, NULL);
+    host_cond_init(&queue->cond);
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait) {
+    struct timespec ts;
+    struct timespec* deadline = host_deadline(wait, &ts);
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == queue->length) {
+        if (wait == 0 || host_cond_wait(&queue->cond, &queue->mutex, deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&queue->mutex);
+            return pdFALSE;
+        }
+    }
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + (size_t)tail * queue->item_size, item, queue->item_size);
+    queue->count++;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait) {
+    struct timespec ts;
+    struct timespec* deadline = host_deadline(wait, &ts);
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0) {
+        if (wait == 0 || host_cond_wait(&queue->cond, &queue->mutex, deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&queue->mutex);
+            return pdFALSE;
+        }
+    }
+    memcpy(item, queue->items + (size_t)queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->mutex);
+    queue->head = 0;
+    queue->count = 0;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+    return pdPASS;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    free(queue->items);
+    free(queue);
+}
+
+EventGroupHandle_t xEventGroupCreate(void) {
+    struct host_event_group* group = calloc(1, sizeof(struct host_event_group));
+    pthread_mutex_init(&group->mutex, NULL);
+    host_cond_init(&group->cond);
+    return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    pthread_mutex_lock(&group->mutex);
+    group->bits |= bits;
+    EventBits_t value = group->bits;
+    pthread_cond_broadcast(&group->cond);
+    pthread_mutex_unlock(&group->mutex);
+    return value;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    pthread_mutex_lock(&group->mutex);
+    EventBits_t value = group->bits;// 和 FreeRTOS 相同，返回清除之前的值。
+    group->bits &= ~bits;
+    pthread_mutex_unlock(&group->mutex);
+    return value;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    pthread_mutex_lock(&group->mutex);
+    EventBits_t value = group->bits;
+    pthread_mutex_unlock(&group->mutex);
+    return value;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear, BaseType_t all, TickType_t wait) {
+    struct timespec ts;
+    struct timespec* deadline = host_deadline(wait, &ts);
+    pthread_mutex_lock(&group->mutex);
+    while (1) {
+        EventBits_t match = group->bits & bits;
+        if (all ? match == bits : match != 0) {
+            break;
+        }
+        if (wait == 0 || host_cond_wait(&group->cond, &group->mutex, deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    EventBits_t value = group->bits;
+    EventBits_t match = value & bits;
+    if (clear && (all ? match == bits : match != 0)) {
+        group->bits &= ~bits;
+    }
+    pthread_mutex_unlock(&group->mutex);
+    return value;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    free(group);
+}
+
+static SemaphoreHandle_t host_semaphore_new(int available) {
+    struct host_semaphore* semaphore = calloc(1, sizeof(struct host_semaphore));
+    pthread_mutex_init(&semaphore->mutex, NULL);
+    host_cond_init(&semaphore->cond);
+    semaphore->available = available;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return host_semaphore_new(1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return host_semaphore_new(0);// 和 FreeRTOS 相同，创建以后先 Give 才能 Take。
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait) {
+    struct timespec ts;
+    struct timespec* deadline = host_deadline(wait, &ts);
+    pthread_mutex_lock(&semaphore->mutex);
+    while (!semaphore->available) {
+        if (wait == 0 || host_cond_wait(&semaphore->cond, &semaphore->mutex, deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&semaphore->mutex);
+            return pdFALSE;
+        }
+    }
+    semaphore->available = 0;
+    pthread_mutex_unlock(&semaphore->mutex);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    pthread_mutex_lock(&semaphore->mutex);
+    BaseType_t ret = semaphore->available ? pdFALSE : pdTRUE;
+    semaphore->available = 1;
+    pthread_cond_signal(&semaphore->cond);
+    pthread_mutex_unlock(&semaphore->mutex);
+    return ret;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    free(semaphore);
+}
+
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type) {
+    if (type != RINGBUF_TYPE_BYTEBUF) {
+        return NULL;
+    }
+    struct host_ringbuf* ringbuf = calloc(1, sizeof(struct host_ringbuf));
+    ringbuf->data = malloc(size);
+    ringbuf->size = size;
+    pthread_mutex_init(&ringbuf->mutex, NULL);
+    host_cond_init(&ringbuf->cond);
+    return ringbuf;
+}
+
+void vRingbufferDelete(RingbufHandle_t ringbuf) {
+    free(ringbuf->data);
+    free(ringbuf);
+}
+
+BaseType_t xRingbufferSend(RingbufHandle_t ringbuf, const void* data, size_t size, TickType_t wait) {
+    if (size > ringbuf->size) {
+        return pdFALSE;
+    }
+    struct timespec ts;
+    struct timespec* deadline = host_deadline(wait, &ts);
+    pthread_mutex_lock(&ringbuf->mutex);
+    while (ringbuf->size - ringbuf->count < size) {
+        if (wait == 0 || host_cond_wait(&ringbuf->cond, &ringbuf->mutex, deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&ringbuf->mutex);
+            return pdFALSE;
+        }
+    }
+    size_t tail = (ringbuf->head + ringbuf->count) % ringbuf->size;
+    size_t first = ringbuf->size - tail < size ? ringbuf->size - tail : size;
+    memcpy(ringbuf->data + tail, data, first);
+    memcpy(ringbuf->data, (const uint8_t*)data + first, size - first);
+    ringbuf->count += size;
+    pthread_cond_broadcast(&ringbuf->cond);
+    pthread_mutex_unlock(&ringbuf->mutex);
+    return pdTRUE;
+}
+
+void* xRingbufferReceiveUpTo(RingbufHandle_t ringbuf, size_t* size, TickType_t wait, size_t max) {
+    struct timespec ts;
+    struct timespec* deadline = host_deadline(wait, &ts);
+    pthread_mutex_lock(&ringbuf->mutex);
+    while (ringbuf->count == 0 || ringbuf->acquired) {
+        if (wait == 0 || host_cond_wait(&ringbuf->cond, &ringbuf->mutex, deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&ringbuf->mutex);
+            *size = 0;
+            return NULL;
+        }
+    }
+    // 和字节缓冲区相同，一次只取到缓冲区末尾，绕回的部分下次再取。
+    size_t n = ringbuf->size - ringbuf->head;
+    n = ringbuf->count < n ? ringbuf->count : n;
+    n = max < n ? max : n;
+    void* item = ringbuf->data + ringbuf->head;
+    ringbuf->acquired = n;
+    *size = n;
+    pthread_mutex_unlock(&ringbuf->mutex);
+    return max ? item : NULL;
+}
+
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void* item) {
+    (void)item;
+    pthread_mutex_lock(&ringbuf->mutex);
+    ringbuf->head = (ringbuf->head + ringbuf->acquired) % ringbuf->size;
+    ringbuf->count -= ringbuf->acquired;
+    ringbuf->acquired = 0;
+    pthread_cond_broadcast(&ringbuf->cond);
+    pthread_mutex_unlock(&ringbuf->mutex);
+}
+
+void vRingbufferGetInfo(RingbufHandle_t ringbuf, size_t* free, size_t* read, size_t* write, size_t* acquire, size_t* waiting) {
+    pthread_mutex_lock(&ringbuf->mutex);
+    if (free) {
+        *free = ringbuf->size - ringbuf->count;
+    }
+    if (read) {
+        *read = ringbuf->head;
+    }
+    if (write) {
+        *write = (ringbuf->head + ringbuf->count) % ringbuf->size;
+    }
+    if (acquire) {
+        *acquire = ringbuf->head + ringbuf->acquired;
+    }
+    if (waiting) {
+        *waiting = ringbuf->count - ringbuf->acquired;
+    }
+    pthread_mutex_unlock(&ringbuf->mutex);
+}
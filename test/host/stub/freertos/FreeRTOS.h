@@ -0,0 +1,36 @@
+/**
+ * @brief   主机测试：FreeRTOS 替身，任务、队列、事件组用 pthread 实现，见 freertos.c。时钟节拍 1 毫秒。
+ */
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE                      1
+#define pdFALSE                     0
+#define pdPASS                      1
+#define pdFAIL                      0
+#define portMAX_DELAY               ((TickType_t)0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS          1
+#define pdMS_TO_TICKS(ms)           ((TickType_t)(ms))
+
+#ifndef BIT0
+#define BIT0                        0x00000001
+#define BIT1                        0x00000002
+#define BIT2                        0x00000004
+#define BIT3                        0x00000008
+#define BIT4                        0x00000010
+#define BIT5                        0x00000020
+#define BIT6                        0x00000040
+#define BIT7                        0x00000080
+#endif
+
+/**
+ * @brief 系统节拍，毫秒。
+ */
+TickType_t xTaskGetTickCount(void);
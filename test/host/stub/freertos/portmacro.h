@@ -0,0 +1,6 @@
+/**
+ * @brief   主机测试：FreeRTOS portmacro 替身，类型都在 FreeRTOS.h 中。
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
@@ -0,0 +1,37 @@
+/**
+ * @brief   主机测试：FreeRTOS 环形缓冲区替身，只有字节缓冲区（RINGBUF_TYPE_BYTEBUF），见 freertos.c。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_ringbuf* RingbufHandle_t;
+
+typedef enum {
+    RINGBUF_TYPE_NOSPLIT = 0,
+    RINGBUF_TYPE_ALLOWSPLIT,
+    RINGBUF_TYPE_BYTEBUF,
+} RingbufferType_t;
+
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type);
+void vRingbufferDelete(RingbufHandle_t ringbuf);
+BaseType_t xRingbufferSend(RingbufHandle_t ringbuf, const void* data, size_t size, TickType_t wait);
+void* xRingbufferReceiveUpTo(RingbufHandle_t ringbuf, size_t* size, TickType_t wait, size_t max);
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void* item);
+
+/**
+ * @brief ESP32 上 UBaseType_t 和 size_t 同宽，驱动直接传 size_t*，主机上按 size_t 声明。
+ */
+void vRingbufferGetInfo(RingbufHandle_t ringbuf, size_t* free, size_t* read, size_t* write, size_t* acquire, size_t* waiting);
+
+/**
+ * @brief 静态创建、按条接收，只有 app_mqtt.c 的转存队列用到，由测试程序实现。
+ */
+typedef struct {
+    int unused;
+} StaticRingbuffer_t;
+
+RingbufHandle_t xRingbufferCreateStatic(size_t size, RingbufferType_t type, uint8_t* storage, StaticRingbuffer_t* buffer);
+void* xRingbufferReceive(RingbufHandle_t ringbuf, size_t* size, TickType_t wait);
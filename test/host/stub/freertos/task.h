@@ -0,0 +1,24 @@
+/**
+ * @brief   主机测试：FreeRTOS 任务替身，每个任务一个 pthread，任务通知用条件变量实现。
+ */
+#pragma once
+
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+/**
+ * @brief 非 0 时 xTaskCreate() 失败，模块不启动后台任务，测试用例在主线程中同步驱动，结果可以复现。
+ */
+extern int host_task_create_fail;
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* param, UBaseType_t prio, TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* param, UBaseType_t prio,
+    TaskHandle_t* handle, BaseType_t core);
+void vTaskDelete(TaskHandle_t handle);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void xTaskNotifyGive(TaskHandle_t handle);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
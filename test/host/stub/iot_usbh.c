@@ -0,0 +1,276 @@
+/**
+ * @brief   主机测试：iot_usbh 替身的实现。每个管道一个已提交 URB 队列和一个已完成 URB 队列，
+ *          完成时和 HCD 相同，向管道的事件队列发送 PIPE_EVENT_URB_DONE。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "iot_usbh.h"
+#include "iot_usbh_host.h"
+
+#define HOST_USBH_PIPE_MAX          8
+#define HOST_USBH_URB_OVERHEAD_US   40
+
+struct host_urb {
+    uint8_t* data;
+    size_t size;
+    size_t len;
+    struct host_urb* next;
+};
+
+struct host_urb_list {
+    struct host_urb* head;
+    struct host_urb* tail;
+};
+
+struct host_pipe {
+    uint8_t addr;
+    QueueHandle_t queue;
+    void* context;
+    struct host_urb_list pending;   // 已提交，等待总线。
+    struct host_urb_list done;      // 已完成，等待 CDC 任务取回。
+};
+
+uint32_t host_usbh_bytes_per_ms = 0;
+void (*host_usbh_sent)(const uint8_t* data, size_t len) = NULL;
+
+static pthread_mutex_t host_usbh_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t host_usbh_cond = PTHREAD_COND_INITIALIZER;
+static struct host_pipe* host_usbh_pipes[HOST_USBH_PIPE_MAX];
+static usbh_port_config_t host_usbh_port;
+static pthread_t host_usbh_bus;
+static int host_usbh_bus_started = 0;
+
+static void host_urb_push(struct host_urb_list* list, struct host_urb* urb) {
+    urb->next = NULL;
+    if (list->tail) {
+        list->tail->next = urb;
+    } else {
+        list->head = urb;
+    }
+    list->tail = urb;
+}
+
+static struct host_urb* host_urb_pop(struct host_urb_list* list) {
+    struct host_urb* urb = list->head;
+    if (urb) {
+        list->head = urb->next;
+        if (list->head == NULL) {
+            list->tail = NULL;
+        }
+    }
+    return urb;
+}
+
+/**
+ * @brief URB 完成，调用时持有 host_usbh_mutex。
+ */
+static void host_urb_done(struct host_pipe* pipe, struct host_urb* urb) {
+    host_urb_push(&pipe->done, urb);
+    usbh_event_msg_t msg = {
+        ._type = PIPE_EVENT,
+        ._handle.pipe_handle = pipe,
+        ._event.pipe_event = PIPE_EVENT_URB_DONE,
+    };
+    xQueueSend(pipe->queue, &msg, portMAX_DELAY);
+}
+
+static void host_usbh_sleep_us(long us) {
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = us % 1000000 * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * @brief 总线线程：按提交顺序发出 OUT 管道的 URB。
+ */
+static void* host_usbh_bus_main(void* arg) {
+    pthread_mutex_lock(&host_usbh_mutex);
+    while (1) {
+        struct host_pipe* pipe = NULL;
+        for (int i = 0; i < HOST_USBH_PIPE_MAX && pipe == NULL; i++) {
+            if (host_usbh_pipes[i] && !(host_usbh_pipes[i]->addr & 0x80) && host_usbh_pipes[i]->pending.head) {
+                pipe = host_usbh_pipes[i];
+            }
+        }
+        if (pipe == NULL) {
+            pthread_cond_wait(&host_usbh_cond, &host_usbh_mutex);
+            continue;
+        }
+        struct host_urb* urb = host_urb_pop(&pipe->pending);
+        pthread_mutex_unlock(&host_usbh_mutex);
+        if (host_usbh_bytes_per_ms) {
+            host_usbh_sleep_us(HOST_USBH_URB_OVERHEAD_US + (long)urb->len * 1000 / host_usbh_bytes_per_ms);
+        }
+        if (host_usbh_sent) {
+            host_usbh_sent(urb->data, urb->len);
+        }
+        pthread_mutex_lock(&host_usbh_mutex);
+        host_urb_done(pipe, urb);
+    }
+    return NULL;
+}
+
+usbh_port_handle_t iot_usbh_port_init(usbh_port_config_t* config) {
+    host_usbh_port = *config;
+    if (!host_usbh_bus_started) {
+        pthread_create(&host_usbh_bus, NULL, host_usbh_bus_main, NULL);
+        pthread_detach(host_usbh_bus);
+        host_usbh_bus_started = 1;
+    }
+    return &host_usbh_port;
+}
+
+esp_err_t iot_usbh_port_deinit(usbh_port_handle_t port_hdl) {
+    return ESP_OK;
+}
+
+void* iot_usbh_port_get_context(usbh_port_handle_t port_hdl) {
+    return host_usbh_port.context;
+}
+
+esp_err_t iot_usbh_port_start(usbh_port_handle_t port_hdl) {
+    // 设备已经插入，枚举立即完成。
+    if (host_usbh_port.conn_callback) {
+        host_usbh_port.conn_callback(port_hdl, host_usbh_port.conn_callback_arg);
+    }
+    return ESP_OK;
+}
+
+esp_err_t iot_usbh_port_stop(usbh_port_handle_t port_hdl) {
+    return ESP_OK;
+}
+
+usbh_pipe_handle_t iot_usbh_pipe_init(usbh_port_handle_t port_hdl, const usb_ep_desc_t* ep_desc, QueueHandle_t queue_hdl, void* context) {
+    struct host_pipe* pipe = calloc(1, sizeof(struct host_pipe));
+    pipe->addr = ep_desc->bEndpointAddress;
+    pipe->queue = queue_hdl;
+    pipe->context = context;
+    pthread_mutex_lock(&host_usbh_mutex);
+    for (int i = 0; i < HOST_USBH_PIPE_MAX; i++) {
+        if (host_usbh_pipes[i] == NULL) {
+            host_usbh_pipes[i] = pipe;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&host_usbh_mutex);
+    return pipe;
+}
+
+esp_err_t iot_usbh_pipe_deinit(usbh_pipe_handle_t pipe_hdl) {
+    pthread_mutex_lock(&host_usbh_mutex);
+    for (int i = 0; i < HOST_USBH_PIPE_MAX; i++) {
+        if (host_usbh_pipes[i] == pipe_hdl) {
+            host_usbh_pipes[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&host_usbh_mutex);
+    free(pipe_hdl);
+    return ESP_OK;
+}
+
+void* iot_usbh_pipe_get_context(usbh_pipe_handle_t pipe_hdl) {
+    return ((struct host_pipe*)pipe_hdl)->context;
+}
+
+esp_err_t iot_usbh_pipe_flush(usbh_pipe_handle_t pipe_hdl, size_t urb_num) {
+    struct host_pipe* pipe = pipe_hdl;
+    pthread_mutex_lock(&host_usbh_mutex);
+    struct host_urb* urb;
+    while ((urb = host_urb_pop(&pipe->pending)) != NULL) {
+        urb->len = 0;
+        host_urb_push(&pipe->done, urb);
+    }
+    pthread_mutex_unlock(&host_usbh_mutex);
+    return ESP_OK;
+}
+
+iot_usbh_urb_handle_t iot_usbh_urb_alloc(int num_isoc_packets, size_t packet_data_buffer_size, void* context) {
+    struct host_urb* urb = calloc(1, sizeof(struct host_urb));
+    urb->data = malloc(packet_data_buffer_size);
+    urb->size = packet_data_buffer_size;
+    return urb;
+}
+
+esp_err_t iot_usbh_urb_free(iot_usbh_urb_handle_t urb_hdl) {
+    struct host_urb* urb = urb_hdl;
+    free(urb->data);
+    free(urb);
+    return ESP_OK;
+}
+
+void* iot_usbh_urb_buffer_claim(iot_usbh_urb_handle_t urb_hdl, size_t* buf_size, size_t* num_isoc) {
+    struct host_urb* urb = urb_hdl;
+    if (buf_size) {
+        *buf_size = urb->size;
+    }
+    if (num_isoc) {
+        *num_isoc = 0;
+    }
+    return urb->data;
+}
+
+esp_err_t iot_usbh_urb_enqueue(usbh_pipe_handle_t pipe_hdl, iot_usbh_urb_handle_t urb_hdl, size_t xfer_size) {
+    struct host_pipe* pipe = pipe_hdl;
+    struct host_urb* urb = urb_hdl;
+    pthread_mutex_lock(&host_usbh_mutex);
+    if (xfer_size != (size_t)-1) {
+        urb->len = xfer_size;// -1 沿用上次的长度。
+    }
+    if (!(pipe->addr & 0x80) && urb->len == 0) {
+        host_urb_done(pipe, urb);// 空的 OUT URB 立即完成。
+    } else {
+        host_urb_push(&pipe->pending, urb);
+        pthread_cond_broadcast(&host_usbh_cond);
+    }
+    pthread_mutex_unlock(&host_usbh_mutex);
+    return ESP_OK;
+}
+
+iot_usbh_urb_handle_t iot_usbh_urb_dequeue(usbh_pipe_handle_t pipe_hdl, size_t* xfered_size, usb_transfer_status_t* status) {
+    struct host_pipe* pipe = pipe_hdl;
+    pthread_mutex_lock(&host_usbh_mutex);
+    struct host_urb* urb = host_urb_pop(&pipe->done);
+    pthread_mutex_unlock(&host_usbh_mutex);
+    if (xfered_size) {
+        *xfered_size = urb ? urb->len : 0;
+    }
+    if (status) {
+        *status = urb ? USB_TRANSFER_STATUS_COMPLETED : USB_TRANSFER_STATUS_ERROR;
+    }
+    return urb;
+}
+
+iot_usbh_urb_handle_t iot_usbh_urb_ctrl_xfer(usbh_port_handle_t port_hdl, iot_usbh_urb_handle_t urb_hdl, size_t xfer_size,
+    size_t* xfered_size, usb_transfer_status_t* status) {
+    if (status) {
+        *status = USB_TRANSFER_STATUS_COMPLETED;
+    }
+    return urb_hdl;
+}
+
+void host_usbh_receive(const uint8_t* data, size_t len) {
+    pthread_mutex_lock(&host_usbh_mutex);
+    while (len > 0) {
+        struct host_pipe* pipe = NULL;
+        for (int i = 0; i < HOST_USBH_PIPE_MAX && pipe == NULL; i++) {
+            if (host_usbh_pipes[i] && (host_usbh_pipes[i]->addr & 0x80) && host_usbh_pipes[i]->pending.head) {
+                pipe = host_usbh_pipes[i];
+            }
+        }
+        if (pipe == NULL) {
+            pthread_cond_wait(&host_usbh_cond, &host_usbh_mutex);
+            continue;
+        }
+        struct host_urb* urb = host_urb_pop(&pipe->pending);
+        urb->len = len < urb->size ? len : urb->size;
+        memcpy(urb->data, data, urb->len);
+        data += urb->len;
+        len -= urb->len;
+        host_urb_done(pipe, urb);
+    }
+    pthread_mutex_unlock(&host_usbh_mutex);
+}
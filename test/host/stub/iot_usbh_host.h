@@ -0,0 +1,23 @@
+/**
+ * @brief   主机测试：iot_usbh 替身的测试接口，替身实现组件的 iot_usbh.h，见 iot_usbh.c。
+ *          端口启动时立即连接设备。IN 管道的 URB 等待测试程序交给设备数据，OUT 管道的 URB 由总线线程按设定的速度发出。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 总线速度，字节/毫秒，每个 URB 另加 40 us。0 不限速。
+ */
+extern uint32_t host_usbh_bytes_per_ms;
+
+/**
+ * @brief OUT 管道发到总线上的数据，由测试程序设置，在总线线程中调用。
+ */
+extern void (*host_usbh_sent)(const uint8_t* data, size_t len);
+
+/**
+ * @brief 设备发出数据：等待 IN 管道有已提交的 URB，按 URB 大小分开完成，和设备在没有 URB 时 NAK 相同。
+ */
+void host_usbh_receive(const uint8_t* data, size_t len);
@@ -0,0 +1,6 @@
+/**
+ * @brief   主机测试：lwIP 域名解析替身，直接使用 Linux 的 getaddrinfo()。
+ */
+#pragma once
+
+#include <netdb.h>
@@ -0,0 +1,11 @@
+/**
+ * @brief   主机测试：lwIP 套接字替身，直接使用 Linux 的 BSD 套接字。
+ */
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
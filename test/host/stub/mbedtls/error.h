@@ -0,0 +1,6 @@
+/**
+ * @brief   主机测试：mbedtls 替身，声明都在 mbedtls/ssl.h 中。
+ */
+#pragma once
+
+#include "mbedtls/ssl.h"
@@ -0,0 +1,130 @@
+/**
+ * @brief   主机测试：mbedtls 替身，只有 app_tls.c 用到的类型和函数，由测试程序实现。
+ *          不做加密，握手是测试程序约定的明文报文，用来检查会话缓存和完整握手、会话恢复的区分，不检查 TLS 本身。
+ *          函数原型和 mbedtls 3.x 相同。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MBEDTLS_ERR_SSL_WANT_READ               -0x6900
+#define MBEDTLS_ERR_SSL_WANT_WRITE              -0x6880
+#define MBEDTLS_ERR_SSL_TIMEOUT                 -0x6800
+#define MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY       -0x7880
+#define MBEDTLS_ERR_SSL_CONN_EOF                -0x7280
+#define MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE     -0x7780
+#define MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL        -0x6A00
+#define MBEDTLS_ERR_SSL_BAD_INPUT_DATA          -0x7100
+#define MBEDTLS_ERR_SSL_VERSION_MISMATCH        -0x5F00
+#define MBEDTLS_ERR_X509_CERT_VERIFY_FAILED     -0x2700
+#define MBEDTLS_ERR_NET_SEND_FAILED             -0x004E
+#define MBEDTLS_ERR_NET_RECV_FAILED             -0x004C
+
+#define MBEDTLS_SSL_IS_CLIENT                   0
+#define MBEDTLS_SSL_TRANSPORT_STREAM            0
+#define MBEDTLS_SSL_PRESET_DEFAULT              0
+#define MBEDTLS_SSL_VERIFY_REQUIRED             2
+#define MBEDTLS_SSL_SESSION_TICKETS_ENABLED     1
+
+typedef struct {
+    int version;
+} mbedtls_x509_crt;
+
+typedef struct {
+    int unused;
+} mbedtls_x509_crl;
+
+typedef struct {
+    int unused;
+} mbedtls_entropy_context;
+
+typedef struct {
+    int seeded;
+} mbedtls_ctr_drbg_context;
+
+typedef struct {
+    int fd;
+} mbedtls_net_context;
+
+/**
+ * @brief 会话：格式版本、会话票据、主密钥。序列化就是结构体本身，格式版本不同时加载失败。
+ */
+typedef struct {
+    uint32_t format;
+    uint32_t ticket;
+    uint8_t master[48];
+} mbedtls_ssl_session;
+
+typedef int mbedtls_ssl_send_t(void* ctx, const unsigned char* buf, size_t len);
+typedef int mbedtls_ssl_recv_t(void* ctx, unsigned char* buf, size_t len);
+typedef int mbedtls_ssl_recv_timeout_t(void* ctx, unsigned char* buf, size_t len, uint32_t timeout);
+
+typedef struct {
+    int authmode;
+    int tickets;
+    uint32_t read_timeout;
+    mbedtls_x509_crt* ca_chain;
+    int (*f_vrfy)(void*, mbedtls_x509_crt*, int, uint32_t*);
+    void* p_vrfy;
+    int (*f_rng)(void*, unsigned char*, size_t);
+    void* p_rng;
+} mbedtls_ssl_config;
+
+typedef struct {
+    const mbedtls_ssl_config* conf;
+    void* p_bio;
+    mbedtls_ssl_send_t* f_send;
+    mbedtls_ssl_recv_timeout_t* f_recv_timeout;
+    char hostname[64];
+    int offer;                          // mbedtls_ssl_set_session() 设置了要恢复的会话。
+    mbedtls_ssl_session session;        // 握手前是要恢复的会话，握手后是协商的会话。
+    int established;
+    uint32_t verify_result;
+} mbedtls_ssl_context;
+
+void mbedtls_ssl_init(mbedtls_ssl_context* ssl);
+void mbedtls_ssl_free(mbedtls_ssl_context* ssl);
+int mbedtls_ssl_setup(mbedtls_ssl_context* ssl, const mbedtls_ssl_config* conf);
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context* ssl, const char* hostname);
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* ssl, void* p_bio, mbedtls_ssl_send_t* f_send, mbedtls_ssl_recv_t* f_recv, mbedtls_ssl_recv_timeout_t* f_recv_timeout);
+int mbedtls_ssl_set_session(mbedtls_ssl_context* ssl, const mbedtls_ssl_session* session);
+int mbedtls_ssl_get_session(const mbedtls_ssl_context* ssl, mbedtls_ssl_session* session);
+int mbedtls_ssl_handshake(mbedtls_ssl_context* ssl);
+uint32_t mbedtls_ssl_get_verify_result(const mbedtls_ssl_context* ssl);
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context* ssl);
+int mbedtls_ssl_read(mbedtls_ssl_context* ssl, unsigned char* buf, size_t len);
+int mbedtls_ssl_write(mbedtls_ssl_context* ssl, const unsigned char* buf, size_t len);
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* ssl);
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config* conf);
+void mbedtls_ssl_config_free(mbedtls_ssl_config* conf);
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* conf, int endpoint, int transport, int preset);
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config* conf, int authmode);
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config* conf, mbedtls_x509_crt* ca_chain, mbedtls_x509_crl* ca_crl);
+void mbedtls_ssl_conf_verify(mbedtls_ssl_config* conf, int (*f_vrfy)(void*, mbedtls_x509_crt*, int, uint32_t*), void* p_vrfy);
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* conf, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng);
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config* conf, int use_tickets);
+void mbedtls_ssl_conf_read_timeout(mbedtls_ssl_config* conf, uint32_t timeout);
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session* session);
+void mbedtls_ssl_session_free(mbedtls_ssl_session* session);
+int mbedtls_ssl_session_save(const mbedtls_ssl_session* session, unsigned char* buf, size_t buf_len, size_t* olen);
+int mbedtls_ssl_session_load(mbedtls_ssl_session* session, const unsigned char* buf, size_t len);
+
+void mbedtls_net_init(mbedtls_net_context* ctx);
+void mbedtls_net_free(mbedtls_net_context* ctx);
+int mbedtls_net_send(void* ctx, const unsigned char* buf, size_t len);
+int mbedtls_net_recv_timeout(void* ctx, unsigned char* buf, size_t len, uint32_t timeout);
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt* crt);
+void mbedtls_x509_crt_free(mbedtls_x509_crt* crt);
+int mbedtls_x509_crt_parse(mbedtls_x509_crt* chain, const unsigned char* buf, size_t buflen);
+
+void mbedtls_entropy_init(mbedtls_entropy_context* ctx);
+int mbedtls_entropy_func(void* data, unsigned char* output, size_t len);
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* ctx);
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* ctx, int (*f_entropy)(void*, unsigned char*, size_t), void* p_entropy, const unsigned char* custom, size_t len);
+int mbedtls_ctr_drbg_random(void* p_rng, unsigned char* output, size_t len);
+
+void mbedtls_strerror(int errnum, char* buffer, size_t buflen);
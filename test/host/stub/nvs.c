@@ -0,0 +1,82 @@
+/**
+ * @brief   主机测试：NVS 替身的实现。同时只支持一个命名空间，句柄是命名空间序号。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "nvs.h"
+
+#define HOST_NVS_DIR                SDMMC_MOUNT_POINT"/nvs"
+#define HOST_NVS_MAX                8
+
+esp_err_t host_nvs_set_fail = ESP_OK;
+esp_err_t host_nvs_commit_fail = ESP_OK;
+int host_nvs_set_count = 0;
+
+static char host_nvs_names[HOST_NVS_MAX][16];
+
+static void host_nvs_path(nvs_handle_t handle, const char* key, char* path, size_t size) {
+    snprintf(path, size, HOST_NVS_DIR"/%s.%s", host_nvs_names[handle - 1], key);
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t mode, nvs_handle_t* handle) {
+    mkdir(HOST_NVS_DIR, 0755);
+    for (int i = 0; i < HOST_NVS_MAX; i++) {
+        if (host_nvs_names[i][0] == '\0' || strcmp(host_nvs_names[i], name) == 0) {
+            snprintf(host_nvs_names[i], sizeof(host_nvs_names[i]), "%s", name);
+            *handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    if (host_nvs_set_fail != ESP_OK) {
+        return host_nvs_set_fail;
+    }
+    char path[256];
+    host_nvs_path(handle, key, path, sizeof(path));
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        return ESP_FAIL;
+    }
+    size_t n = fwrite(value, 1, length, f);
+    host_nvs_set_count++;
+    return fclose(f) == 0 && n == length ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+    char path[256];
+    host_nvs_path(handle, key, path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    fseek(f, 0, SEEK_END);
+    size_t size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    esp_err_t ret = ESP_OK;
+    if (out_value != NULL) {
+        if (*length < size) {
+            ret = ESP_ERR_INVALID_SIZE;
+        } else if (fread(out_value, 1, size, f) != size) {
+            ret = ESP_FAIL;
+        }
+    }
+    fclose(f);
+    *length = size;
+    return ret;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    (void)handle;
+    return host_nvs_commit_fail;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    (void)handle;
+}
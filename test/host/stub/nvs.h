@@ -0,0 +1,33 @@
+/**
+ * @brief   主机测试：NVS 替身，每个键一个文件，放在 SD 卡目录下的 nvs 目录中，重新启动的子进程可以读到。
+ *          和 IDF 相同，nvs_set_blob() 返回 ESP_OK 时已经写入，nvs_commit() 只是提交点。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+/**
+ * @brief 故障注入，非 0 时对应的函数返回这个错误码，不写文件。
+ */
+extern esp_err_t host_nvs_set_fail;
+extern esp_err_t host_nvs_commit_fail;
+
+/**
+ * @brief nvs_set_blob() 写入文件的次数，检查不必要的 flash 写入。
+ */
+extern int host_nvs_set_count;
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t mode, nvs_handle_t* handle);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
@@ -0,0 +1,14 @@
+/**
+ * @brief   主机测试：sdkconfig 替身，只有主机上编译的组件用到的选项，取值和工程的 sdkconfig 相同。
+ */
+#pragma once
+
+#define CONFIG_IDF_TARGET_ESP32S3               1
+#define CONFIG_USBH_TASK_CORE_ID                1
+#define CONFIG_USBH_TASK_BASE_PRIORITY          5
+#define CONFIG_CDC_BULK_IN_URB_NUM              4
+#define CONFIG_CDC_BULK_OUT_URB_NUM             6
+#define CONFIG_CDC_BULK_IN_URB_BUFFER_SIZE      2048
+#define CONFIG_CDC_BULK_OUT_URB_BUFFER_SIZE     2048
+#define CONFIG_MODEM_USB_OUT_EP_ADDR            0x0f
+#define CONFIG_MODEM_USB_IN_EP_ADDR             0x86
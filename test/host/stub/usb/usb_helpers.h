@@ -0,0 +1,6 @@
+/**
+ * @brief   主机测试：USB 辅助函数替身，主机测试用到的类型都在 usb_types_stack.h 中。
+ */
+#pragma once
+
+#include "usb/usb_types_stack.h"
@@ -0,0 +1,29 @@
+/**
+ * @brief   主机测试：USB 主机协议栈类型替身，只有 iot_usbh.h 用到的部分。
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+    USB_TRANSFER_STATUS_COMPLETED,
+    USB_TRANSFER_STATUS_ERROR,
+    USB_TRANSFER_STATUS_TIMED_OUT,
+    USB_TRANSFER_STATUS_CANCELED,
+    USB_TRANSFER_STATUS_STALL,
+    USB_TRANSFER_STATUS_OVERFLOW,
+    USB_TRANSFER_STATUS_SKIPPED,
+    USB_TRANSFER_STATUS_NO_DEVICE,
+} usb_transfer_status_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bEndpointAddress;
+    uint8_t bmAttributes;
+    uint16_t wMaxPacketSize;
+    uint8_t bInterval;
+} usb_ep_desc_t;
+
+#define USB_B_DESCRIPTOR_TYPE_ENDPOINT      0x05
+#define USB_BM_ATTRIBUTES_XFER_BULK         (2 << 0)
@@ -0,0 +1,225 @@
+/**
+ * @brief   服务器切换主机测试：本机两个 TCP 监听代替主服务器和备用服务器，测试程序代替 esp-mqtt 的连接循环。
+ *          每次连接先调用 app_broker_on_before_connect()，再对当前地址做 TCP 连接、发送 CONNECT，收到 CONNACK 时调用
+ *          app_broker_on_connected()。服务器可以关闭（拒绝连接）、静默（接受 TCP 但不回 CONNACK）或正常。
+ *          直接包含 app_broker.c，调用内部的检查函数，时钟由测试推进。
+ *          1. 主服务器连续失败以后切到备用服务器；
+ *          2. 冷却期内主服务器恢复也不切回；
+ *          3. 冷却期过后 TCP 可达但没有 CONNACK，退回备用服务器，重新开始冷却；
+ *          4. 收到主服务器的 CONNACK 才切回。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "host_test.h"
+#include "esp_log.h"
+
+/**
+ * @brief 测试时钟，毫秒。用奇数，冷却时间戳的 | 1 不改变取值，边界可以精确到毫秒。
+ */
+static uint32_t test_now = 1001;
+#define esp_log_timestamp()         test_now
+
+#include "app_broker.c"
+
+/**
+ * @brief 服务器替身状态。
+ */
+typedef enum {
+    TEST_BROKER_DOWN,           // 不监听，连接被拒绝。
+    TEST_BROKER_MUTE,           // 接受 TCP 连接，读取 CONNECT 以后直接关闭。
+    TEST_BROKER_UP,             // 回复 CONNACK。
+} test_broker_mode_t;
+
+typedef struct {
+    int port;
+    int fd;
+    atomic_int mode;
+    pthread_t thread;
+    char uri[64];
+} test_broker_t;
+
+static test_broker_t test_brokers[2];
+
+/**
+ * @brief esp-mqtt 替身：当前地址和主动重连次数。
+ */
+static char test_client_uri[64];
+static int test_reconnects = 0;
+
+esp_err_t esp_mqtt_client_set_uri(esp_mqtt_client_handle_t client, const char* uri) {
+    snprintf(test_client_uri, sizeof(test_client_uri), "%s", uri);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_disconnect(esp_mqtt_client_handle_t client) {
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client) {
+    test_reconnects++;
+    return ESP_OK;
+}
+
+/**
+ * @brief 其它模块的替身。
+ */
+void app_ctrl_get_params(app_ctrl_params_t* params) {
+    memset(params, 0, sizeof(*params));
+    params->broker_fails = APP_BROKER_FAIL_MAX;
+}
+
+void app_rtt_get_stats(app_rtt_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+void app_rtt_reset(void) {
+}
+
+static void* test_broker_main(void* arg) {
+    test_broker_t* broker = arg;
+    while (1) {
+        int fd = accept(broker->fd, NULL, NULL);
+        if (fd < 0) {
+            break;// 监听已关闭。
+        }
+        uint8_t buf[64];
+        if (read(fd, buf, sizeof(buf)) > 0 && atomic_load(&broker->mode) == TEST_BROKER_UP) {
+            static const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+            TEST_ASSERT(write(fd, connack, sizeof(connack)) == sizeof(connack));
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+static void test_broker_listen(test_broker_t* broker) {
+    broker->fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(broker->fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(broker->port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    TEST_ASSERT(bind(broker->fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    TEST_ASSERT(listen(broker->fd, 4) == 0);
+    socklen_t len = sizeof(addr);
+    getsockname(broker->fd, (struct sockaddr*)&addr, &len);
+    broker->port = ntohs(addr.sin_port);
+    pthread_create(&broker->thread, NULL, test_broker_main, broker);
+}
+
+static void test_broker_set(int index, test_broker_mode_t mode) {
+    test_broker_t* broker = &test_brokers[index];
+    test_broker_mode_t old = atomic_exchange(&broker->mode, mode);
+    if (old == TEST_BROKER_DOWN && mode != TEST_BROKER_DOWN) {
+        test_broker_listen(broker);
+    } else if (old != TEST_BROKER_DOWN && mode == TEST_BROKER_DOWN) {
+        shutdown(broker->fd, SHUT_RDWR);
+        pthread_join(broker->thread, NULL);
+        close(broker->fd);
+    }
+}
+
+/**
+ * @brief 一次连接，和 esp-mqtt 相同：发出 BEFORE_CONNECT，按当前地址连接，收到 CONNACK 发出 CONNECTED。
+ * @return 1 连接成功，0 失败。
+ */
+static int test_connect(void) {
+    app_broker_on_before_connect(NULL);
+    int index = strcmp(test_client_uri, test_brokers[0].uri) == 0 ? 0 : 1;
+    TEST_ASSERT_MSG(strcmp(test_client_uri, test_brokers[index].uri) == 0, "地址：%s", test_client_uri);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(test_brokers[index].port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int ok = 0;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        static const uint8_t connect_pkt[] = { 0x10, 13, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02, 0x00, 0x3C, 0x00, 0x01, 'x' };
+        uint8_t connack[4];
+        if (write(fd, connect_pkt, sizeof(connect_pkt)) == sizeof(connect_pkt)
+            && read(fd, connack, sizeof(connack)) == sizeof(connack) && connack[0] == 0x20 && connack[3] == 0x00) {
+            ok = 1;
+        }
+    }
+    close(fd);
+    if (ok) {
+        app_broker_on_connected();
+    }
+    return ok;
+}
+
+static int test_active(void) {
+    app_broker_stats_t stats;
+    return app_broker_get_stats(0, &stats);
+}
+
+static void test_broker_fail_over(void) {
+    test_broker_set(0, TEST_BROKER_DOWN);
+    for (int i = 0; i < APP_BROKER_FAIL_MAX; i++) {
+        TEST_ASSERT_EQUAL(0, test_connect());
+        TEST_ASSERT_EQUAL(0, test_active());
+    }
+    TEST_ASSERT_EQUAL(1, test_connect());// 第 N 次失败以后的连接使用备用服务器。
+    TEST_ASSERT_EQUAL(1, test_active());
+    TEST_ASSERT(app_brokers[0].leave_ts != 0);
+}
+
+static void test_broker_cooldown(void) {
+    test_broker_set(0, TEST_BROKER_UP);
+    test_now += APP_BROKER_FAILBACK_PERIOD * 1000;// 探测周期比冷却时间短。
+    app_broker_check_primary(1);
+    TEST_ASSERT_EQUAL(0, test_reconnects);
+    TEST_ASSERT_EQUAL(1, test_active());
+}
+
+static void test_broker_trial_no_connack(void) {
+    test_broker_set(0, TEST_BROKER_MUTE);
+    test_now += APP_BROKER_COOLDOWN;
+    app_broker_check_primary(1);
+    TEST_ASSERT_EQUAL(1, test_reconnects);// TCP 可达，开始试连。
+    TEST_ASSERT(strcmp(test_client_uri, test_brokers[0].uri) == 0);
+    TEST_ASSERT_EQUAL(0, test_connect());
+    TEST_ASSERT_EQUAL(1, test_connect());// 试连失败，下一次连接退回备用服务器。
+    TEST_ASSERT_EQUAL(1, test_active());
+    TEST_ASSERT_EQUAL(0, app_brokers[0].fails);
+    TEST_ASSERT_EQUAL(test_now, app_brokers[0].leave_ts);// 重新开始冷却。
+    test_broker_set(0, TEST_BROKER_UP);
+    test_now += APP_BROKER_COOLDOWN - 1;
+    app_broker_check_primary(1);
+    TEST_ASSERT_EQUAL(1, test_reconnects);
+}
+
+static void test_broker_failback(void) {
+    test_now += 1;
+    app_broker_check_primary(1);
+    TEST_ASSERT_EQUAL(2, test_reconnects);
+    TEST_ASSERT_EQUAL(1, test_connect());
+    TEST_ASSERT_EQUAL(0, test_active());
+    TEST_ASSERT_EQUAL(0, app_brokers[0].leave_ts);
+    TEST_ASSERT_EQUAL(1, test_connect());// 切回以后正常重连不受影响。
+    TEST_ASSERT_EQUAL(0, test_active());
+}
+
+int main(void) {
+    for (int i = 0; i < 2; i++) {
+        test_broker_set(i, TEST_BROKER_UP);
+        snprintf(test_brokers[i].uri, sizeof(test_brokers[i].uri), "mqtt://127.0.0.1:%d", test_brokers[i].port);
+        app_broker_uris[i] = test_brokers[i].uri;
+    }
+    snprintf(test_client_uri, sizeof(test_client_uri), "%s", app_broker_get_uri());
+    RUN_TEST(test_broker_fail_over);
+    RUN_TEST(test_broker_cooldown);
+    RUN_TEST(test_broker_trial_no_connack);
+    RUN_TEST(test_broker_failback);
+    return 0;
+}
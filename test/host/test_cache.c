@@ -0,0 +1,598 @@
+/**
+ * @brief   缓存日志主机测试：提交位置跨重启恢复，每个偏移恰好推送一次。
+ *          每次“启动”在子进程中运行：初始化缓存日志，随机写入、fsync、读取并提交，第 N 次 fsync() 时 _exit() 模拟掉电。
+ *          stdio 缓冲区中还没有写出的数据随进程丢失，已经写出的留在文件中。写了一半的记录、段头由 test_seg 覆盖。
+ *          子进程把每个动作追加到事件文件，父进程按事件检查：
+ *          1. 已提交的记录不再推送；
+ *          2. 重启后从提交位置继续，fsync 过的记录不跳过；
+ *          3. 一次启动内推送顺序递增，内容完整；
+ *          4. 最后一次不掉电的启动推送完所有 fsync 过的记录，剩余字节为 0。
+ *          剩余字节数另外按 app_mqtt.c 的方式测试：只提交收到 PUBACK 的记录的末尾，不提交读到末尾以后的位置。
+ *          按时间查询写满 1、4、16 个段，命中的记录恰好是时间范围内的，输出读取的字节数、耗时随段数的变化。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "host_test.h"
+#include "app_sd.h"
+#include "app_cache.h"
+#include "app_seg.h"
+#include "app_retain.h"
+#include "app_json.h"
+
+ /**
+ * @brief 事件文件，不在 CACHE 目录中，用 write() 追加，不经过 fsync()。
+ */
+#define TEST_EVENT_PATH             SDMMC_MOUNT_POINT"/EVENTS.BIN"
+
+ /**
+ * @brief 模拟掉电时子进程的退出码。
+ */
+#define TEST_CRASH_EXIT             99
+
+ /**
+ * @brief 记录编号上限。
+ */
+#define TEST_ID_MAX                 200000
+
+/**
+ * @brief 事件类型。
+ */
+typedef enum {
+    TEST_EV_BOOT = 'B',         // 启动。
+    TEST_EV_APPEND = 'A',       // 写入记录，调用之前。
+    TEST_EV_SYNC = 'S',         // app_cache_flush() 返回，之前写入的记录都已经 fsync。
+    TEST_EV_DELIVER = 'D',      // 读到记录，相当于推送。
+    TEST_EV_COMMIT_BEGIN = 'c', // 提交，调用之前。
+    TEST_EV_COMMIT = 'C',       // 提交成功。
+    TEST_EV_FSYNCS = 'N',       // 不掉电的启动结束时 fsync() 的次数。
+} test_ev_type_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t id;
+} test_ev_t;
+
+/**
+ * @brief 子进程状态。
+ */
+static int test_ev_fd = -1;
+static uint32_t test_crash_at = 0;     // 第 N 次 fsync() 时掉电，0 = 不掉电。
+static uint32_t test_fsyncs = 0;
+
+/**
+ * @brief 替换 libc 的 fsync()，app_seg.c、app_meta.c 调用的就是这里。计数，到指定次数时掉电。
+ *        子进程退出时已经写出的数据留在内核中，不需要真正写入磁盘。
+ */
+int fsync(int fd) {
+    (void)fd;
+    if (++test_fsyncs == test_crash_at) {
+        _exit(TEST_CRASH_EXIT);
+    }
+    return 0;
+}
+
+/**
+ * @brief 归档索引替身，只测试缓存日志本身。
+ */
+void app_retain_add(const char* path, uint32_t t0, bool uploaded) {
+    (void)path;
+    (void)t0;
+    (void)uploaded;
+}
+
+uint32_t app_json_get_time(const char* json) {
+    (void)json;
+    return 0;
+}
+
+static void test_ev(test_ev_type_t type, uint32_t id) {
+    test_ev_t ev = { .type = type, .id = id };
+    if (write(test_ev_fd, &ev, sizeof(ev)) != sizeof(ev)) {
+        _exit(2);
+    }
+}
+
+/**
+ * @brief 按编号生成记录，长度不同，跨段。
+ */
+static int test_make_record(uint32_t id, char* buf) {
+    int len = sprintf(buf, "{\"id\":%u,\"pad\":\"", id);
+    int pad = (id * 7919) % 700;
+    memset(buf + len, 'a' + id % 26, pad);
+    len += pad;
+    len += sprintf(buf + len, "\"}");
+    return len;
+}
+
+/**
+ * @brief 检查读到的记录，返回编号，内容不对返回 0。
+ */
+static uint32_t test_check_record(const char* data, int len) {
+    unsigned id;
+    char expected[1024];
+    if (sscanf(data, "{\"id\":%u,", &id) != 1 || id == 0 || id >= TEST_ID_MAX) {
+        return 0;
+    }
+    int n = test_make_record(id, expected);
+    return n == len && memcmp(expected, data, len) == 0 ? id : 0;
+}
+
+/**
+ * @brief 一次启动，在子进程中运行。
+ * @param seed 随机动作的种子。
+ * @param next_id 下一条记录的编号。
+ * @param steps 动作数，0 = 读取并提交全部记录后退出。
+ */
+static void test_boot(uint32_t seed, uint32_t next_id, uint32_t steps) {
+    test_ev_fd = open(TEST_EVENT_PATH, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (test_ev_fd < 0) {
+        _exit(2);
+    }
+    test_ev(TEST_EV_BOOT, seed);
+    if (app_cache_init() != ESP_OK) {
+        _exit(3);
+    }
+    app_cache_pos_t pos;
+    app_cache_get_commit(&pos);
+    char buf[1024];
+    uint32_t delivered = 0;
+    uint32_t committed = 0;
+    srand(seed);
+    for (uint32_t step = 0; step < steps; step++) {
+        int action = rand() % 5;
+        if (action <= 1) {
+            int n = 1 + rand() % 12;
+            for (int i = 0; i < n; i++) {
+                test_ev(TEST_EV_APPEND, next_id);
+                int len = test_make_record(next_id, buf);
+                if (app_cache_append(buf, len, 1700000000 + next_id) != 0) {
+                    _exit(4);
+                }
+                next_id++;
+            }
+        } else if (action == 2) {
+            app_cache_flush();
+            test_ev(TEST_EV_SYNC, next_id - 1);
+        } else {
+            int n = 1 + rand() % 16;
+            for (int i = 0; i < n; i++) {
+                int len = app_cache_read(&pos, buf, sizeof(buf));
+                if (len < 0) {
+                    _exit(5);
+                }
+                if (len == 0) {
+                    break;
+                }
+                delivered = test_check_record(buf, len);
+                if (delivered == 0) {
+                    _exit(6);
+                }
+                test_ev(TEST_EV_DELIVER, delivered);
+            }
+            if (delivered != committed && rand() % 4 != 0) {// 有时不提交，下次启动重新推送。
+                test_ev(TEST_EV_COMMIT_BEGIN, delivered);
+                if (app_cache_commit(&pos) != ESP_OK) {
+                    _exit(7);
+                }
+                test_ev(TEST_EV_COMMIT, delivered);
+                committed = delivered;
+            }
+        }
+    }
+    if (steps == 0) {
+        int len;
+        while ((len = app_cache_read(&pos, buf, sizeof(buf))) > 0) {
+            delivered = test_check_record(buf, len);
+            if (delivered == 0) {
+                _exit(6);
+            }
+            test_ev(TEST_EV_DELIVER, delivered);
+        }
+        if (len < 0) {
+            _exit(5);
+        }
+        if (delivered != committed) {
+            test_ev(TEST_EV_COMMIT_BEGIN, delivered);
+            if (app_cache_commit(&pos) != ESP_OK) {
+                _exit(7);
+            }
+            test_ev(TEST_EV_COMMIT, delivered);
+        }
+        if (app_cache_remaining() != 0) {
+            _exit(8);
+        }
+    }
+    app_cache_flush();// 正常重启，关机回调 fsync。
+    test_ev(TEST_EV_SYNC, next_id - 1);
+    test_ev(TEST_EV_FSYNCS, test_fsyncs);
+    _exit(0);
+}
+
+/**
+ * @brief 父进程的检查状态，按事件顺序重放。
+ */
+typedef struct {
+    uint8_t appended[TEST_ID_MAX];
+    uint8_t required[TEST_ID_MAX];      // 已经 fsync，重启后必须推送（除非已提交）。
+    uint8_t delivered[TEST_ID_MAX];
+    uint32_t next_id;
+    uint32_t boots;
+    uint32_t last_fsyncs;               // 最后一次不掉电的启动 fsync() 的次数。
+} test_check_t;
+
+static test_check_t test_check;
+
+/**
+ * @brief (lo, hi) 之间是否有必须推送的记录。
+ */
+static bool test_skipped(uint32_t lo, uint32_t hi) {
+    for (uint32_t id = lo + 1; id < hi; id++) {
+        if (test_check.required[id]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 读取事件文件，从头重放检查。
+ */
+static void test_replay(void) {
+    test_check_t* c = &test_check;
+    memset(c, 0, sizeof(test_check_t));
+    c->next_id = 1;
+    FILE* file = fopen(TEST_EVENT_PATH, "rb");
+    if (file == NULL) {// 第一次启动之前。
+        return;
+    }
+    uint32_t last_commit = 0;       // 确认持久化的提交。
+    uint32_t pending_commit = 0;    // 本次启动提交时掉电，可能已经持久化。
+    uint32_t crashed_commit = 0;
+    uint32_t boot_first_id = 1;     // 本次启动写入的第一条记录。
+    uint32_t prev = 0;              // 本次启动上一条推送的记录，0 = 还没有推送。
+    test_ev_t ev;
+    while (fread(&ev, sizeof(ev), 1, file) == 1) {
+        TEST_ASSERT(ev.type == TEST_EV_BOOT || ev.type == TEST_EV_FSYNCS || ev.id < TEST_ID_MAX);
+        switch (ev.type) {
+        case TEST_EV_BOOT:
+            c->boots++;
+            if (pending_commit != 0) {// 没有推送过的启动不能确定，留给下一次启动。
+                crashed_commit = pending_commit;
+                pending_commit = 0;
+            }
+            boot_first_id = c->next_id;
+            prev = 0;
+            break;
+        case TEST_EV_APPEND:
+            TEST_ASSERT_EQUAL(c->next_id, ev.id);
+            c->appended[ev.id] = 1;
+            c->next_id++;
+            break;
+        case TEST_EV_SYNC:
+            for (uint32_t id = boot_first_id; id <= ev.id; id++) {
+                c->required[id] = 1;
+            }
+            break;
+        case TEST_EV_DELIVER:
+            TEST_ASSERT_MSG(c->appended[ev.id], "启动 %u 推送了没有写入的记录 %u", c->boots, ev.id);
+            if (prev == 0 && crashed_commit != 0) {// 从哪里开始推送，就知道掉电之前的提交是否已经持久化。
+                last_commit = ev.id > crashed_commit ? crashed_commit : last_commit;
+                crashed_commit = 0;
+            }
+            TEST_ASSERT_MSG(ev.id > last_commit, "启动 %u 重复推送已提交的记录 %u，提交位置 %u", c->boots, ev.id, last_commit);
+            TEST_ASSERT_MSG(prev == 0 || ev.id > prev, "启动 %u 推送顺序错误：%u 之后 %u", c->boots, prev, ev.id);
+            TEST_ASSERT_MSG(!test_skipped(prev == 0 ? last_commit : prev, ev.id),
+                "启动 %u 跳过了已经 fsync 的记录，%u 到 %u 之间", c->boots, prev == 0 ? last_commit : prev, ev.id);
+            for (uint32_t id = boot_first_id; id < c->next_id; id++) {// 读取之前 fsync 了本次启动写入的所有记录。
+                c->required[id] = 1;
+            }
+            c->delivered[ev.id] = 1;
+            prev = ev.id;
+            break;
+        case TEST_EV_COMMIT_BEGIN:
+            TEST_ASSERT_EQUAL(prev, ev.id);
+            pending_commit = ev.id;
+            break;
+        case TEST_EV_COMMIT:
+            TEST_ASSERT_EQUAL(pending_commit, ev.id);
+            last_commit = ev.id;
+            pending_commit = 0;
+            crashed_commit = 0;
+            break;
+        case TEST_EV_FSYNCS:
+            c->last_fsyncs = ev.id;
+            break;
+        default:
+            TEST_ASSERT_MSG(false, "事件类型 %u", ev.type);
+        }
+    }
+    fclose(file);
+}
+
+/**
+ * @brief 在子进程中启动一次，等待退出。
+ * @return 是否掉电。
+ */
+static bool test_run_boot(uint32_t seed, uint32_t steps, uint32_t crash_at) {
+    test_replay();
+    uint32_t next_id = test_check.next_id;
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    TEST_ASSERT(pid >= 0);
+    if (pid == 0) {
+        test_crash_at = crash_at;
+        test_boot(seed, next_id, steps);
+    }
+    int status;
+    TEST_ASSERT(waitpid(pid, &status, 0) == pid);
+    TEST_ASSERT_MSG(WIFEXITED(status), "子进程异常退出：%d", status);
+    int code = WEXITSTATUS(status);
+    TEST_ASSERT_MSG(code == 0 || code == TEST_CRASH_EXIT, "种子 %u，掉电点 %u，子进程退出码 %d", seed, crash_at, code);
+    return code == TEST_CRASH_EXIT;
+}
+
+/**
+ * @brief 读取、提交全部记录，检查所有 fsync 过的记录都推送过。
+ */
+static void test_drain_and_check(void) {
+    test_run_boot(0, 0, 0);
+    test_replay();
+    for (uint32_t id = 1; id < test_check.next_id; id++) {
+        TEST_ASSERT_MSG(!test_check.required[id] || test_check.delivered[id], "已经 fsync 的记录 %u 没有推送", id);
+    }
+}
+
+/**
+ * @brief 多次正常重启，每次从提交位置继续。
+ */
+static void test_cache_resume(void) {
+    host_test_reset_dir(APP_SD_CACHE_DIR);
+    remove(TEST_EVENT_PATH);
+    for (uint32_t boot = 1; boot <= 40; boot++) {
+        TEST_ASSERT(!test_run_boot(boot, 60, 0));
+    }
+    test_drain_and_check();
+    printf("启动 %u 次，记录 %u 条\n", test_check.boots, test_check.next_id - 1);
+}
+
+/**
+ * @brief 固定的动作序列，在每一次 fsync() 处掉电，然后重启推送全部记录。
+ */
+static void test_cache_crash_every_fsync(void) {
+    host_test_reset_dir(APP_SD_CACHE_DIR);
+    remove(TEST_EVENT_PATH);
+    test_run_boot(1, 80, 0);
+    test_run_boot(2, 80, 0);
+    test_replay();
+    uint32_t total = test_check.last_fsyncs;
+    TEST_ASSERT(total > 10);
+    for (uint32_t crash_at = 1; crash_at <= total; crash_at++) {
+        host_test_reset_dir(APP_SD_CACHE_DIR);
+        remove(TEST_EVENT_PATH);
+        TEST_ASSERT(!test_run_boot(1, 80, 0));
+        TEST_ASSERT(test_run_boot(2, 80, crash_at));
+        test_run_boot(3, 40, 0);
+        test_drain_and_check();
+    }
+    printf("掉电点 %u 个\n", total);
+}
+
+/**
+ * @brief 随机动作、随机掉电点的连续多次启动，跨多个段文件。
+ */
+static void test_cache_crash_random(void) {
+    host_test_reset_dir(APP_SD_CACHE_DIR);
+    remove(TEST_EVENT_PATH);
+    srand(12345);
+    uint32_t seeds[400];
+    uint32_t crashes[400];
+    for (int i = 0; i < 400; i++) {// test_boot() 在子进程中重新设置种子，这里先生成好。
+        seeds[i] = rand();
+        crashes[i] = rand() % 4 == 0 ? 0 : 1 + rand() % 40;
+    }
+    uint32_t crashed = 0;
+    for (int i = 0; i < 400; i++) {
+        crashed += test_run_boot(seeds[i], 80, crashes[i]);
+    }
+    test_drain_and_check();
+    char path[64];
+    snprintf(path, sizeof(path), APP_SD_CACHE_DIR"/%08X.SEG", 3);
+    TEST_ASSERT_MSG(access(path, F_OK) == 0, "%s", "没有跨段");
+    printf("启动 %u 次，掉电 %u 次，记录 %u 条\n", test_check.boots, crashed, test_check.next_id - 1);
+}
+
+/**
+ * @brief 剩余字节数，和 app_mqtt.c 相同地提交：逐条读取，提交的是已确认记录的末尾。
+ *        新建的缓存为 0；未确认的记录都在写入段中时等于这些记录的字节数，包括刚好确认到封闭段最后一条的时候；
+ *        逐条确认时不增加；全部确认以后为 0。在父进程中运行，放在最后。
+ */
+static void test_cache_remaining(void) {
+    host_test_reset_dir(APP_SD_CACHE_DIR);
+    TEST_ASSERT_EQUAL(ESP_OK, app_cache_init());
+    TEST_ASSERT_EQUAL(0, app_cache_remaining());
+    app_cache_pos_t pos;
+    app_cache_get_commit(&pos);
+    static app_cache_pos_t end[3000];
+    static uint32_t size[3000];
+    char buf[1024];
+    uint32_t id = 1;
+    uint32_t sealed_ends = 0;
+    for (int round = 0; round < 4; round++) {
+        uint32_t first = id;
+        for (int i = 0; i < 700; i++, id++) {
+            int len = test_make_record(id, buf);
+            TEST_ASSERT_EQUAL(0, app_cache_append(buf, len, 1700000000 + id));
+            size[id] = APP_SEG_REC_HDR_SIZE + len;
+        }
+        for (uint32_t i = first; i < id; i++) {// 和 app_mqtt_pub_cache() 相同，记下每条记录之后的位置。
+            int len = app_cache_read(&pos, buf, sizeof(buf));
+            TEST_ASSERT_EQUAL(i, test_check_record(buf, len));
+            end[i] = pos;
+        }
+        uint32_t prev = app_cache_remaining();
+        for (uint32_t i = first; i < id; i++) {// 按顺序收到 PUBACK，逐条提交。
+            TEST_ASSERT_EQUAL(ESP_OK, app_cache_commit(&end[i]));
+            uint32_t pending = 0;
+            bool one_seg = true;// 未确认的记录都在写入段中。
+            for (uint32_t k = i + 1; k < id; k++) {
+                pending += size[k];
+                one_seg = one_seg && end[k].seg == end[id - 1].seg;
+            }
+            uint32_t remaining = app_cache_remaining();
+            TEST_ASSERT_MSG(remaining <= prev, "记录 %u，剩余 %u，之前 %u", i, remaining, prev);
+            if (one_seg && end[i].seg < end[id - 1].seg) {
+                sealed_ends++;// 提交位置停在封闭段末尾。
+            }
+            if (one_seg) {
+                TEST_ASSERT_MSG(remaining == pending, "记录 %u，剩余 %u，期望 %u", i, remaining, pending);
+            }
+            prev = remaining;
+        }
+        TEST_ASSERT_EQUAL(0, app_cache_remaining());
+    }
+    app_cache_get_commit(&pos);
+    TEST_ASSERT(pos.seg >= 3);
+    printf("记录 %u 条，%u 个段，确认到封闭段末尾 %u 次\n", id - 1, pos.seg + 1, sealed_ends);
+}
+
+/**
+ * @brief 段文件大小，和 app_cache.c 的 APP_CACHE_SEG_SIZE 相同。每 1/APP_SEG_IDX_MAX 段的数据一个索引项。
+ */
+#define TEST_SEG_DATA               (256 * 1024 - APP_SEG_HDR_SIZE)
+#define TEST_IDX_BLOCK              (TEST_SEG_DATA / APP_SEG_IDX_MAX)
+
+/**
+ * @brief 记录时间：编号 + TEST_T0，每条记录一秒。
+ */
+#define TEST_T0                     1700000000
+
+/**
+ * @brief 按时间查询的结果。
+ */
+typedef struct {
+    uint32_t t1;
+    uint32_t t2;
+    uint32_t next;              // 下一条应该命中的编号。
+    uint32_t matched;           // 时间范围内的记录数。
+    uint32_t read;              // 读取的记录数。
+    uint32_t bytes;             // 读取的字节数，包括记录头。
+    uint32_t in_bytes;          // 时间范围内的记录字节数。
+} test_query_t;
+
+/**
+ * @brief 和 app_drain.c 的查询回调相同，按记录时间精确过滤。命中的记录按编号连续，没有重复、没有遗漏。
+ */
+static bool test_query_cb(char* data, int len, void* arg) {
+    test_query_t* q = arg;
+    uint32_t id = test_check_record(data, len);
+    TEST_ASSERT_MSG(id != 0, "查询读到的记录内容不对：%.40s", data);
+    q->read++;
+    q->bytes += APP_SEG_REC_HDR_SIZE + len;
+    uint32_t ts = TEST_T0 + id;
+    if (ts >= q->t1 && ts <= q->t2) {
+        TEST_ASSERT_MSG(id == q->next, "时间 %u - %u，命中 %u，期望 %u", q->t1, q->t2, id, q->next);
+        q->next++;
+        q->matched++;
+        q->in_bytes += APP_SEG_REC_HDR_SIZE + len;
+    }
+    return true;
+}
+
+/**
+ * @brief 查询编号 first - last 的时间范围，检查命中的记录，返回耗时，微秒。
+ */
+static uint32_t test_query(uint32_t first, uint32_t last, uint32_t total, test_query_t* q) {
+    memset(q, 0, sizeof(test_query_t));
+    q->t1 = TEST_T0 + first;
+    q->t2 = TEST_T0 + last;
+    q->next = first < 1 ? 1 : first;
+    uint32_t expected = first > total ? 0 : (last < total ? last : total) + 1 - q->next;
+    struct timespec t0;
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int count = app_cache_query(q->t1, q->t2, test_query_cb, q);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    TEST_ASSERT_EQUAL(q->read, count);
+    TEST_ASSERT_MSG(q->matched == expected, "编号 %u - %u，命中 %u，期望 %u", first, last, q->matched, expected);
+    // 时间范围两端各有不到一个索引项的多余数据，加上写入段末尾还没有索引的数据。
+    TEST_ASSERT_MSG(q->bytes <= q->in_bytes + 3 * TEST_IDX_BLOCK, "编号 %u - %u，读取 %u 字节，命中 %u 字节",
+        first, last, q->bytes, q->in_bytes);
+    return (t1.tv_sec - t0.tv_sec) * 1000000 + (t1.tv_nsec - t0.tv_nsec) / 1000;
+}
+
+/**
+ * @brief 在子进程中写满 segs 个段，按时间查询：中间的窗口、单条记录、全部、范围之外。
+ */
+static void test_query_segs(uint32_t segs) {
+    host_test_reset_dir(APP_SD_CACHE_DIR);
+    TEST_ASSERT_EQUAL(ESP_OK, app_cache_init());
+    char buf[1024];
+    uint32_t total = 0;
+    while (app_cache_remaining() < segs * TEST_SEG_DATA) {
+        total++;
+        int len = test_make_record(total, buf);
+        TEST_ASSERT_EQUAL(0, app_cache_append(buf, len, TEST_T0 + total));
+        if (total % 64 == 0) {
+            app_cache_flush();
+        }
+    }
+    app_cache_flush();
+    test_query_t q;
+    uint32_t mid = total / 2;
+    uint32_t window_us = test_query(mid - 150, mid + 149, total, &q);
+    uint32_t window_bytes = q.bytes;
+    TEST_ASSERT_EQUAL(300, q.matched);
+    test_query(mid, mid, total, &q);
+    TEST_ASSERT_EQUAL(1, q.matched);
+    test_query(total + 10, total + 20, total, &q);
+    test_query(0, 0, total, &q);
+    uint32_t all_us = test_query(1, total, total, &q);
+    TEST_ASSERT_EQUAL(total, q.matched);
+    printf("%2u 个段，%5u 条记录：300 秒窗口读取 %6u 字节，%5u 微秒；全部读取 %7u 字节，%6u 微秒\n",
+        segs, total, window_bytes, window_us, q.bytes, all_us);
+}
+
+/**
+ * @brief 按时间查询：段数增加时窗口查询读取的字节数不变，全部查询按段数线性增加。
+ */
+static void test_cache_query(void) {
+    static const uint32_t segs[] = { 1, 4, 16 };
+    for (size_t i = 0; i < sizeof(segs) / sizeof(segs[0]); i++) {
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        TEST_ASSERT(pid >= 0);
+        if (pid == 0) {
+            test_query_segs(segs[i]);
+            fflush(stdout);
+            _exit(0);
+        }
+        int status;
+        TEST_ASSERT(waitpid(pid, &status, 0) == pid);
+        TEST_ASSERT_MSG(WIFEXITED(status) && WEXITSTATUS(status) == 0, "%u 个段，子进程退出：%d", segs[i], status);
+    }
+}
+
+int main(void) {
+    host_task_create_fail = 1;// 没有后台任务，fsync() 次数只取决于随机种子。
+    RUN_TEST(test_cache_resume);
+    RUN_TEST(test_cache_crash_every_fsync);
+    RUN_TEST(test_cache_crash_random);
+    RUN_TEST(test_cache_remaining);
+    RUN_TEST(test_cache_query);
+    return 0;
+}
@@ -0,0 +1,294 @@
+/**
+ * @brief   远程控制主机测试：测试程序代替 MQTT 服务器，通过 app_ctrl_on_cmd() 下发命令，从 app_mqtt_publish_ack() 取回应答。
+ *          控制任务是真实的线程，NVS 是文件，“重启”是用 --boot 参数重新运行测试程序，只加载参数并输出。
+ *          1. 修改成功时应答 ok，运行参数和重启以后的参数都是新值；
+ *          2. nvs_set_blob()、nvs_commit() 失败时应答 nvs，运行参数和重启以后的参数都是原值；
+ *          3. 参数无效时整条命令不生效；
+ *          4. 并发读取只会看到完整的某一组参数。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "host_test.h"
+#include "nvs.h"
+#include "app_sd.h"
+#include "app_ctrl.h"
+#include "app_mqtt.h"
+#include "app_drain.h"
+#include "app_broker.h"
+#include "app_bench.h"
+#include "app_fix.h"
+#include "app_config.h"
+
+ /**
+ * @brief 等待应答的超时，秒。
+ */
+#define TEST_ACK_TIMEOUT            5
+
+/**
+ * @brief 最近一条应答，控制任务写，测试线程读。
+ */
+static pthread_mutex_t test_ack_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t test_ack_cond = PTHREAD_COND_INITIALIZER;
+static char test_ack[1024];
+static int test_ack_count = 0;
+
+/**
+ * @brief MQTT 替身：应答交给等待的测试线程。
+ */
+int app_mqtt_publish_ack(char* ack) {
+    pthread_mutex_lock(&test_ack_mutex);
+    snprintf(test_ack, sizeof(test_ack), "%s", ack);
+    test_ack_count++;
+    pthread_cond_broadcast(&test_ack_cond);
+    pthread_mutex_unlock(&test_ack_mutex);
+    return 0;
+}
+
+/**
+ * @brief 其它模块的替身，只有 get 命令用到服务器序号。
+ */
+int app_broker_get_stats(int index, app_broker_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    return 1;
+}
+
+void app_drain_request_log(void) {
+}
+
+void app_drain_flush(void) {
+}
+
+void app_drain_request_query(int id, uint32_t t1, uint32_t t2) {
+}
+
+esp_err_t app_bench_run(uint32_t kb, app_bench_result_t* result) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void app_bench_add_json(cJSON* obj, const app_bench_result_t* result) {
+}
+
+uint32_t app_fix_head(void) {
+    return 0;
+}
+
+uint32_t app_fix_find(uint32_t ts) {
+    return 0;
+}
+
+int app_fix_read(uint32_t* pos, app_fix_t* out, int max) {
+    return 0;
+}
+
+/**
+ * @brief 下发一条命令，等待应答。
+ */
+static void test_cmd(const char* cmd, char* ack, size_t size) {
+    pthread_mutex_lock(&test_ack_mutex);
+    int count = test_ack_count;
+    pthread_mutex_unlock(&test_ack_mutex);
+    app_ctrl_on_cmd(cmd, strlen(cmd));
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += TEST_ACK_TIMEOUT;
+    pthread_mutex_lock(&test_ack_mutex);
+    int ret = 0;
+    while (test_ack_count == count && ret != ETIMEDOUT) {
+        ret = pthread_cond_timedwait(&test_ack_cond, &test_ack_mutex, &deadline);
+    }
+    snprintf(ack, size, "%s", test_ack);
+    pthread_mutex_unlock(&test_ack_mutex);
+    TEST_ASSERT_MSG(ret != ETIMEDOUT, "没有应答：%s", cmd);
+}
+
+#define TEST_ACK_HAS(ack, str)      TEST_ASSERT_MSG(strstr(ack, str) != NULL, "应答：%s", ack)
+
+/**
+ * @brief 重启：重新运行测试程序，从 NVS 加载参数并输出。
+ */
+static void test_boot_params(app_ctrl_params_t* params) {
+    char cmd[512];
+    ssize_t len = readlink("/proc/self/exe", cmd, sizeof(cmd) - 16);
+    TEST_ASSERT(len > 0);
+    snprintf(cmd + len, sizeof(cmd) - len, " --boot");
+    FILE* f = popen(cmd, "r");
+    TEST_ASSERT(f != NULL);
+    uint32_t* p = (uint32_t*)params;
+    for (int i = 0; i < sizeof(*params) / sizeof(uint32_t); i++) {
+        unsigned v;
+        TEST_ASSERT(fscanf(f, "%u", &v) == 1);
+        p[i] = v;
+    }
+    int status = pclose(f);
+    TEST_ASSERT_EQUAL(0, status);
+}
+
+static void test_ctrl_set_persist(void) {
+    char ack[1024];
+    test_cmd("{\"id\":1,\"cmd\":\"set\",\"p_fast\":500,\"rate\":50}", ack, sizeof(ack));
+    TEST_ACK_HAS(ack, "\"id\":1");
+    TEST_ACK_HAS(ack, "\"ret\":0");
+    app_ctrl_params_t params;
+    app_ctrl_get_params(&params);
+    TEST_ASSERT_EQUAL(500, params.period_fast);
+    TEST_ASSERT_EQUAL(50, params.drain_rate);
+    TEST_ASSERT_EQUAL(APP_CTRL_PERIOD_SLOW, params.period_slow);
+    app_ctrl_params_t boot;
+    test_boot_params(&boot);
+    TEST_ASSERT(memcmp(&params, &boot, sizeof(params)) == 0);
+}
+
+/**
+ * @brief 保存失败，运行参数和 NVS 中的参数都不变。
+ * @param fail 失败的函数的故障注入变量。
+ */
+static void test_ctrl_nvs_fail(esp_err_t* fail) {
+    char ack[1024];
+    app_ctrl_params_t before;
+    app_ctrl_get_params(&before);
+    *fail = ESP_ERR_NO_MEM;
+    test_cmd("{\"id\":2,\"cmd\":\"set\",\"p_fast\":700,\"s_slow\":40}", ack, sizeof(ack));
+    *fail = ESP_OK;
+    TEST_ACK_HAS(ack, "\"ret\":-1");
+    TEST_ACK_HAS(ack, "\"msg\":\"nvs\"");
+    app_ctrl_params_t params;
+    app_ctrl_get_params(&params);
+    TEST_ASSERT(memcmp(&params, &before, sizeof(params)) == 0);
+    TEST_ASSERT_EQUAL(before.period_fast, app_ctrl_report_period(true, 100));
+    app_ctrl_params_t boot;
+    test_boot_params(&boot);
+    TEST_ASSERT_MSG(memcmp(&boot, &before, sizeof(boot)) == 0, "重启以后 p_fast：%" PRIu32, boot.period_fast);
+}
+
+static void test_ctrl_set_fail(void) {
+    test_ctrl_nvs_fail(&host_nvs_set_fail);
+}
+
+/**
+ * @brief nvs_set_blob() 已经写入新参数，nvs_commit() 失败，需要写回原参数。
+ */
+static void test_ctrl_commit_fail(void) {
+    test_ctrl_nvs_fail(&host_nvs_commit_fail);
+}
+
+static void test_ctrl_set_invalid(void) {
+    static const struct {
+        const char* cmd;
+        const char* msg;
+    } cases[] = {
+        { "{\"id\":3,\"cmd\":\"set\",\"p_slow\":1500,\"p_fast\":10}", "\"msg\":\"p_fast\"" },
+        { "{\"id\":3,\"cmd\":\"set\",\"p_slow\":1500,\"rate\":\"20\"}", "\"msg\":\"rate\"" },
+        { "{\"id\":3,\"cmd\":\"set\",\"s_stop\":50,\"s_slow\":40}", "\"msg\":\"s_stop > s_slow\"" },
+        { "{\"id\":3,\"cmd\":\"set\"}", "\"msg\":\"no param\"" },
+        { "{\"id\":3,\"cmd\":\"reboot\"}", "\"msg\":\"unknown cmd\"" },
+        { "{\"id\":3,\"p_fast\":", "\"msg\":\"bad cmd\"" },
+    };
+    app_ctrl_params_t before;
+    app_ctrl_get_params(&before);
+    for (int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        char ack[1024];
+        test_cmd(cases[i].cmd, ack, sizeof(ack));
+        TEST_ACK_HAS(ack, "\"ret\":-1");
+        TEST_ACK_HAS(ack, cases[i].msg);
+    }
+    app_ctrl_params_t params;
+    app_ctrl_get_params(&params);
+    TEST_ASSERT(memcmp(&params, &before, sizeof(params)) == 0);
+}
+
+static void test_ctrl_get(void) {
+    char ack[1024];
+    test_cmd("{\"id\":4,\"cmd\":\"get\"}", ack, sizeof(ack));
+    TEST_ACK_HAS(ack, "\"p_fast\":500");
+    TEST_ACK_HAS(ack, "\"rate\":50");
+    TEST_ACK_HAS(ack, "\"broker\":1");
+    TEST_ACK_HAS(ack, "\"msg\":\"ok\"");
+}
+
+static void test_ctrl_live(void) {
+    char ack[1024];
+    test_cmd("{\"id\":5,\"cmd\":\"live\",\"period\":300,\"dur\":60}", ack, sizeof(ack));
+    TEST_ACK_HAS(ack, "\"ret\":0");
+    TEST_ASSERT_EQUAL(300, app_ctrl_report_period(false, 0));
+    test_cmd("{\"id\":5,\"cmd\":\"live\",\"dur\":0}", ack, sizeof(ack));
+    TEST_ACK_HAS(ack, "\"ret\":0");
+    TEST_ASSERT_EQUAL(500, app_ctrl_report_period(true, 100));
+    TEST_ASSERT_EQUAL(APP_CTRL_PERIOD_INVALID, app_ctrl_report_period(false, 100));
+}
+
+/**
+ * @brief 并发读取线程，每组参数的所有字段相同，读到不同就是读到了一半。
+ */
+static atomic_int test_reader_stop = 0;
+static atomic_int test_reader_torn = 0;
+
+static void* test_reader(void* arg) {
+    while (!atomic_load(&test_reader_stop)) {
+        app_ctrl_params_t params;
+        app_ctrl_get_params(&params);
+        if (params.period_invalid != params.period_stop || params.period_stop != params.period_slow
+            || params.period_slow != params.period_fast) {
+            atomic_fetch_add(&test_reader_torn, 1);
+        }
+    }
+    return NULL;
+}
+
+static void test_ctrl_snapshot(void) {
+    char ack[1024];
+    test_cmd("{\"cmd\":\"set\",\"p_inv\":1000,\"p_stop\":1000,\"p_slow\":1000,\"p_fast\":1000}", ack, sizeof(ack));
+    pthread_t thread;
+    pthread_create(&thread, NULL, test_reader, NULL);
+    for (int i = 0; i < 100; i++) {
+        char cmd[256];
+        int p = 1000 + (i % 2) * 1000;
+        snprintf(cmd, sizeof(cmd), "{\"cmd\":\"set\",\"p_inv\":%d,\"p_stop\":%d,\"p_slow\":%d,\"p_fast\":%d}", p, p, p, p);
+        host_nvs_commit_fail = i % 3 == 0 ? ESP_FAIL : ESP_OK;// 失败的修改也不能露出一半。
+        test_cmd(cmd, ack, sizeof(ack));
+    }
+    host_nvs_commit_fail = ESP_OK;
+    atomic_store(&test_reader_stop, 1);
+    pthread_join(thread, NULL);
+    TEST_ASSERT_EQUAL(0, atomic_load(&test_reader_torn));
+    app_ctrl_params_t params;
+    app_ctrl_get_params(&params);
+    app_ctrl_params_t boot;
+    test_boot_params(&boot);
+    TEST_ASSERT(memcmp(&params, &boot, sizeof(params)) == 0);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--boot") == 0) {
+        TEST_ASSERT(app_ctrl_init() == ESP_OK);
+        app_ctrl_params_t params;
+        app_ctrl_get_params(&params);
+        const uint32_t* p = (const uint32_t*)&params;
+        for (int i = 0; i < sizeof(params) / sizeof(uint32_t); i++) {
+            printf("%u\n", p[i]);
+        }
+        return 0;
+    }
+    host_test_reset_dir(SDMMC_MOUNT_POINT);
+    TEST_ASSERT(app_ctrl_init() == ESP_OK);
+    RUN_TEST(test_ctrl_set_persist);
+    RUN_TEST(test_ctrl_set_fail);
+    RUN_TEST(test_ctrl_commit_fail);
+    RUN_TEST(test_ctrl_set_invalid);
+    RUN_TEST(test_ctrl_get);
+    RUN_TEST(test_ctrl_live);
+    RUN_TEST(test_ctrl_snapshot);
+    return 0;
+}
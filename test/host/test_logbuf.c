@@ -0,0 +1,283 @@
+/**
+ * @brief   日志环形缓冲区主机测试：直接包含 app_logbuf.c，检查多生产者无锁写入。
+ *          1. 单线程写入不同长度的行，写位置多次绕回，尾部放不下时的填充记录被跳过，文件内容和写入的完全相同；
+ *          2. 不读取时写满缓冲区，之后的行全部丢弃并计数，读走以后可以继续写入；
+ *          3. 多个生产者线程同时写入，后台任务写入文件，每行完整，每个生产者的行保持顺序，写入的行数加丢弃的行数等于总数。
+ *          生产者同时输出到 UART（stdout），测试期间 stdout 重定向到 /dev/null。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "host_test.h"
+
+#include "app_logbuf.c"
+
+#define TEST_LOG_PATH               SDMMC_MOUNT_POINT"/LOG.TXT"
+
+ /**
+ * @brief 生产者线程数和每个线程写入的行数。
+ */
+#define TEST_PRODUCERS              4
+#define TEST_LINES                  20000
+
+/**
+ * @brief fsync() 替身，测试只检查写入的内容，不等待磁盘。次数由 app_logbuf 统计。
+ */
+int fsync(int fd) {
+    (void)fd;
+    return 0;
+}
+
+/**
+ * @brief stdout 重定向到 /dev/null，生产者输出到 UART 的内容不进入测试输出。
+ */
+static int test_stdout_saved = -1;
+
+static void test_stdout_mute(void) {
+    fflush(stdout);
+    test_stdout_saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    TEST_ASSERT(test_stdout_saved >= 0 && null >= 0);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+}
+
+static void test_stdout_restore(void) {
+    fflush(stdout);
+    dup2(test_stdout_saved, STDOUT_FILENO);
+    close(test_stdout_saved);
+}
+
+static int test_log(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int ret = app_logbuf_vprintf(fmt, args);
+    va_end(args);
+    return ret;
+}
+
+/**
+ * @brief 不启动后台任务，测试线程调用 app_logbuf_drain() 读取。唤醒通知发给测试线程自己。
+ */
+static FILE* test_manual_open(void) {
+    host_test_reset_dir(SDMMC_MOUNT_POINT);
+    FILE* file = fopen(TEST_LOG_PATH, "w+b");
+    TEST_ASSERT(file != NULL);
+    free(app_logbuf_ring);
+    app_logbuf_ring = calloc(1, APP_LOG_RING_SIZE);
+    TEST_ASSERT(app_logbuf_ring != NULL);
+    atomic_store(&app_logbuf_head, 0);
+    atomic_store(&app_logbuf_tail, 0);
+    atomic_store(&app_logbuf_lines, 0);
+    atomic_store(&app_logbuf_dropped, 0);
+    app_logbuf_file = file;
+    app_logbuf_task_handle = xTaskGetCurrentTaskHandle();
+    return file;
+}
+
+/**
+ * @brief 读出文件的全部内容，以 '\0' 结尾。
+ */
+static char* test_read_all(FILE* file, long* size) {
+    fflush(file);
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    char* data = malloc(*size + 1);
+    fseek(file, 0, SEEK_SET);
+    TEST_ASSERT(fread(data, 1, *size, file) == (size_t)*size);
+    data[*size] = '\0';
+    return data;
+}
+
+/**
+ * @brief 写位置绕回：行长度 1 - 300 字节循环变化，计算每一行是否需要填充记录，读出的文件和写入的相同。
+ */
+static void test_logbuf_wrap(void) {
+    FILE* file = test_manual_open();
+    size_t expect_size = 8 * APP_LOG_RING_SIZE;
+    char* expect = malloc(expect_size);
+    size_t expect_len = 0;
+    int pads = 0;
+    int lines = 0;
+    char fill[300];
+    memset(fill, 'x', sizeof(fill));
+    char line[400];
+    test_stdout_mute();
+    while (expect_len + sizeof(line) < expect_size) {
+        int len = snprintf(line, sizeof(line), "%06d %.*s\n", lines, (lines * 37) % 300, fill);
+        uint32_t head = atomic_load(&app_logbuf_head);
+        pads += APP_LOG_RING_SIZE - (head & APP_LOGBUF_MASK) < APP_LOGBUF_ALIGN(4 + len + 1);
+        TEST_ASSERT_EQUAL(len, test_log("%s", line));
+        memcpy(expect + expect_len, line, len);
+        expect_len += len;
+        lines++;
+        if (lines % 7 == 0) {// 读取落后写入几行，填充记录和普通记录混在一起读取。
+            app_logbuf_drain();
+        }
+    }
+    app_logbuf_drain();
+    test_stdout_restore();
+    TEST_ASSERT_EQUAL(atomic_load(&app_logbuf_head), atomic_load(&app_logbuf_tail));
+    TEST_ASSERT_EQUAL(0, atomic_load(&app_logbuf_dropped));
+    TEST_ASSERT_EQUAL(lines, atomic_load(&app_logbuf_lines));
+    TEST_ASSERT(pads >= 5);
+    for (uint32_t i = 0; i < APP_LOG_RING_SIZE; i++) {// 读走的记录清零，没有残留的提交标志。
+        TEST_ASSERT_MSG(app_logbuf_ring[i] == 0, "偏移 %" PRIu32, i);
+    }
+    long size;
+    char* data = test_read_all(file, &size);
+    TEST_ASSERT_EQUAL(expect_len, size);
+    TEST_ASSERT(memcmp(data, expect, expect_len) == 0);
+    printf("写入 %d 行 %zu 字节，绕回 %" PRIu32 " 次，填充记录 %d 条\n", lines, expect_len,
+        atomic_load(&app_logbuf_head) / APP_LOG_RING_SIZE, pads);
+    free(data);
+    free(expect);
+    fclose(file);
+}
+
+/**
+ * @brief 不读取时写满：能放下的行数由记录大小决定，之后的行只输出到 UART 并计数，读走以后恢复写入。
+ */
+static void test_logbuf_dropped(void) {
+    FILE* file = test_manual_open();
+    const char line[] = "0123456789012345678901234567890123456789012345678\n";// 50 字节，记录 56 字节，缓冲区不是整数倍。
+    uint32_t size = APP_LOGBUF_ALIGN(4 + sizeof(line));
+    uint32_t capacity = APP_LOG_RING_SIZE / size;
+    TEST_ASSERT(APP_LOG_RING_SIZE % size != 0);
+    test_stdout_mute();
+    for (uint32_t i = 0; i < capacity + 100; i++) {
+        TEST_ASSERT_EQUAL(sizeof(line) - 1, test_log("%s", line));
+    }
+    test_stdout_restore();
+    app_logbuf_stats_t stats;
+    app_logbuf_get_stats(&stats);
+    TEST_ASSERT_EQUAL(capacity, stats.lines);
+    TEST_ASSERT_EQUAL(100, stats.dropped);
+    TEST_ASSERT_EQUAL(capacity * size, atomic_load(&app_logbuf_head));
+
+    app_logbuf_drain();
+    test_stdout_mute();
+    for (int i = 0; i < 10; i++) {// 尾部放不下，第一行带填充记录写到开头。
+        test_log("%s", line);
+    }
+    test_stdout_restore();
+    app_logbuf_drain();
+    app_logbuf_get_stats(&stats);
+    TEST_ASSERT_EQUAL(capacity + 10, stats.lines);
+    TEST_ASSERT_EQUAL(100, stats.dropped);
+    long file_size;
+    char* data = test_read_all(file, &file_size);
+    TEST_ASSERT_EQUAL((capacity + 10) * (sizeof(line) - 1), file_size);
+    for (uint32_t i = 0; i < capacity + 10; i++) {
+        TEST_ASSERT_MSG(memcmp(data + i * (sizeof(line) - 1), line, sizeof(line) - 1) == 0, "第 %" PRIu32 " 行", i);
+    }
+    printf("缓冲区容纳 %" PRIu32 " 行，丢弃 %" PRIu32 " 行\n", capacity, stats.dropped);
+    free(data);
+    fclose(file);
+}
+
+/**
+ * @brief 生产者线程：每行是 "P<id> <序号> <序号决定长度的填充>\n"。
+ */
+static void* test_producer(void* arg) {
+    int id = (int)(intptr_t)arg;
+    char fill[128];
+    memset(fill, 'a' + id, sizeof(fill));
+    for (int i = 0; i < TEST_LINES; i++) {
+        test_log("P%d %06d %.*s\n", id, i, i % 100, fill);
+        if (i % 64 == 0) {// 让出 CPU，后台任务可以读走，缓冲区多次绕回。
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 多生产者：后台任务写入文件，检查每一行的格式和内容，每个生产者的序号递增，行数和丢弃数相加等于总数。
+ */
+static void test_logbuf_producers(void) {
+    host_test_reset_dir(SDMMC_MOUNT_POINT);
+    free(app_logbuf_ring);
+    app_logbuf_ring = NULL;
+    atomic_store(&app_logbuf_head, 0);
+    atomic_store(&app_logbuf_tail, 0);
+    atomic_store(&app_logbuf_lines, 0);
+    atomic_store(&app_logbuf_dropped, 0);
+    atomic_store(&app_logbuf_peak, 0);
+    atomic_store(&app_logbuf_kicked, 0);// 前面的测试没有后台任务清除唤醒标志。
+    FILE* file = fopen(TEST_LOG_PATH, "wb");
+    TEST_ASSERT(file != NULL);
+    TEST_ASSERT_EQUAL(ESP_OK, app_logbuf_init(file));
+
+    test_stdout_mute();
+    pthread_t threads[TEST_PRODUCERS];
+    for (int i = 0; i < TEST_PRODUCERS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, test_producer, (void*)(intptr_t)i));
+    }
+    for (int i = 0; i < TEST_PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    test_stdout_restore();
+    app_logbuf_sync(5000);
+    app_logbuf_stats_t stats;
+    app_logbuf_get_stats(&stats);
+    TEST_ASSERT_EQUAL(TEST_PRODUCERS * TEST_LINES, stats.lines + stats.dropped);
+    TEST_ASSERT_EQUAL(atomic_load(&app_logbuf_head), atomic_load(&app_logbuf_tail));
+
+    FILE* in = fopen(TEST_LOG_PATH, "rb");
+    TEST_ASSERT(in != NULL);
+    long size;
+    char* data = test_read_all(in, &size);
+    fclose(in);
+    TEST_ASSERT_EQUAL(stats.bytes, size);
+    int last[TEST_PRODUCERS];
+    int count[TEST_PRODUCERS] = { 0 };
+    for (int i = 0; i < TEST_PRODUCERS; i++) {
+        last[i] = -1;
+    }
+    uint32_t lines = 0;
+    char* p = data;
+    while (p < data + size) {
+        char* end = strchr(p, '\n');
+        TEST_ASSERT_MSG(end != NULL, "第 %" PRIu32 " 行没有换行符", lines);
+        *end = '\0';// sscanf() 每次计算整个字符串的长度。
+        int id;
+        int seq;
+        int n = 0;
+        TEST_ASSERT_MSG(sscanf(p, "P%d %6d%n", &id, &seq, &n) == 2 && n == 9 && p[n++] == ' ', "第 %" PRIu32 " 行：%.40s", lines, p);
+        TEST_ASSERT_MSG(id >= 0 && id < TEST_PRODUCERS, "第 %" PRIu32 " 行", lines);
+        TEST_ASSERT_MSG(seq > last[id], "生产者 %d 序号 %d 在 %d 之后", id, seq, last[id]);
+        TEST_ASSERT_MSG(end - p - n == seq % 100, "第 %" PRIu32 " 行长度", lines);
+        for (char* c = p + n; c < end; c++) {
+            TEST_ASSERT_MSG(*c == 'a' + id, "第 %" PRIu32 " 行内容", lines);
+        }
+        last[id] = seq;
+        count[id]++;
+        lines++;
+        p = end + 1;
+    }
+    TEST_ASSERT_EQUAL(stats.lines, lines);
+    printf("生产者 %d 个，写入 %" PRIu32 " 行，丢弃 %" PRIu32 " 行，绕回 %" PRIu32 " 次，最大占用 %" PRIu32 " 字节，写入次数 %" PRIu32 "，fsync %" PRIu32 " 次\n",
+        TEST_PRODUCERS, stats.lines, stats.dropped, atomic_load(&app_logbuf_head) / APP_LOG_RING_SIZE, stats.peak, stats.flushes, stats.fsyncs);
+    for (int i = 0; i < TEST_PRODUCERS; i++) {
+        TEST_ASSERT(count[i] > 0);
+    }
+    free(data);
+}
+
+int main(void) {
+    RUN_TEST(test_logbuf_wrap);
+    RUN_TEST(test_logbuf_dropped);
+    RUN_TEST(test_logbuf_producers);
+    return 0;
+}
@@ -0,0 +1,637 @@
+/**
+ * @brief   日志轮转主机测试：每次“启动”在子进程中运行，清单 LOGS.DAT 跨进程保存。
+ *          1. 轮转：收编旧文件、每次启动新的序号、关闭的文件加入归档索引、记录开始时间、清单丢失时不覆盖已有文件；
+ *          2. 续传：重启以后从确认的偏移继续，文件 ID 和块序号不变，当前文件按请求分几次上传，跳过被删除的文件；
+ *          3. 掉电：第 N 次 fsync() 时 _exit()，有时把正在写的槽改坏（只写了一半）。子进程把每个动作追加到事件文件，
+ *             父进程按服务器的方式拼接：已确认的数据不再上传，同一个 (文件 ID, 序号) 的偏移不变，
+ *             序号连续，最后一次不掉电的启动以后每个日志文件都完整上传。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "esp_log.h"
+
+#include "host_test.h"
+#include "app_sd.h"
+#include "app_logrot.h"
+#include "app_retain.h"
+
+ /**
+ * @brief 清单文件名，和 app_logrot.c 相同。
+ */
+#define TEST_LOGROT_DAT             APP_SD_LOG_DIR"/LOGS.DAT"
+
+ /**
+ * @brief 事件文件，不在 LOG 目录中，用 write() 追加，不经过 fsync()。
+ */
+#define TEST_EVENT_PATH             SDMMC_MOUNT_POINT"/EVENTS.BIN"
+
+ /**
+ * @brief 轮转测试在两次启动之间传递的数据。
+ */
+#define TEST_NOTE_PATH              SDMMC_MOUNT_POINT"/NOTE.BIN"
+
+ /**
+ * @brief 模拟掉电时子进程的退出码。
+ */
+#define TEST_CRASH_EXIT             99
+
+ /**
+ * @brief 上传块大小，比 app_logup.c 小，一个文件分多块。
+ */
+#define TEST_CHUNK                  256
+
+ /**
+ * @brief 序号、每个文件的块数上限。
+ */
+#define TEST_GEN_MAX                1024
+#define TEST_SEQ_MAX                64
+
+/**
+ * @brief 事件类型。
+ */
+typedef enum {
+    TEST_EV_BOOT = 'B',         // 启动。
+    TEST_EV_START = 'S',        // app_logrot_start() 返回，gen 是新的日志文件。
+    TEST_EV_DELIVER = 'D',      // 上传一块，确认之前。
+    TEST_EV_ACK = 'A',          // app_logrot_upload_ack() 返回，off 是确认以后的偏移。
+    TEST_EV_FSYNCS = 'N',       // 不掉电的启动结束时 fsync() 的次数。
+} test_ev_type_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t gen;
+    uint32_t id;
+    uint32_t seq;
+    uint32_t off;
+    uint32_t len;
+} test_ev_t;
+
+/**
+ * @brief 子进程状态。
+ */
+static int test_ev_fd = -1;
+static uint32_t test_crash_at = 0;     // 第 N 次 fsync() 时掉电，0 = 不掉电。
+static bool test_tear = false;         // 掉电时正在写的槽只写了一半。
+static uint32_t test_fsyncs = 0;
+
+/**
+ * @brief 替换 libc 的 fsync()，只有 app_meta.c 调用。计数，到指定次数时掉电。
+ *        app_meta_save() 先 fflush() 再 fsync()，文件位置就是刚写完的槽的末尾，改坏最后 4 个字节，CRC 不对。
+ */
+int fsync(int fd) {
+    if (++test_fsyncs == test_crash_at) {
+        off_t end = lseek(fd, 0, SEEK_CUR);
+        uint8_t tail[4];
+        if (test_tear && end >= 4 && pread(fd, tail, 4, end - 4) == 4) {
+            for (int i = 0; i < 4; i++) {
+                tail[i] ^= 0xFF;
+            }
+            if (pwrite(fd, tail, 4, end - 4) != 4) {
+                _exit(2);
+            }
+        }
+        _exit(TEST_CRASH_EXIT);
+    }
+    return 0;
+}
+
+/**
+ * @brief 日志文件名中的序号，不是日志文件返回 0。
+ */
+static uint32_t test_gen_of(const char* path) {
+    const char* name = strrchr(path, '/');
+    uint32_t gen;
+    if (name == NULL || sscanf(name, "/L%7" SCNx32 ".TXT", &gen) != 1) {
+        return 0;
+    }
+    return gen;
+}
+
+/**
+ * @brief 归档索引替身，记录调用。
+ */
+#define TEST_RETAIN_MAX             64
+
+typedef struct {
+    uint32_t gen;
+    uint32_t t0;
+    bool uploaded;
+} test_added_t;
+
+static test_added_t test_added[TEST_RETAIN_MAX];
+static int test_added_n = 0;
+static uint32_t test_uploaded[TEST_RETAIN_MAX];
+static int test_uploaded_n = 0;
+
+void app_retain_add(const char* path, uint32_t t0, bool uploaded) {
+    if (test_added_n < TEST_RETAIN_MAX) {
+        test_added[test_added_n++] = (test_added_t){ .gen = test_gen_of(path), .t0 = t0, .uploaded = uploaded };
+    }
+}
+
+void app_retain_uploaded(const char* path) {
+    if (test_uploaded_n < TEST_RETAIN_MAX) {
+        test_uploaded[test_uploaded_n++] = test_gen_of(path);
+    }
+}
+
+void app_retain_enforce(void) {
+}
+
+static void test_ev(test_ev_type_t type, uint32_t gen, uint32_t id, uint32_t seq, uint32_t off, uint32_t len) {
+    test_ev_t ev = { .type = type, .gen = gen, .id = id, .seq = seq, .off = off, .len = len };
+    if (write(test_ev_fd, &ev, sizeof(ev)) != sizeof(ev)) {
+        _exit(2);
+    }
+}
+
+/**
+ * @brief 写入文件，mode 是 fopen() 的模式。
+ */
+static void test_write(const char* path, const char* mode, const char* text) {
+    FILE* file = fopen(path, mode);
+    TEST_ASSERT_MSG(file != NULL, "%s", path);
+    fputs(text, file);
+    fclose(file);
+}
+
+/**
+ * @brief 追加 n 字节，相当于日志缓冲区写入文件。
+ */
+static void test_append(const char* path, int n) {
+    FILE* file = fopen(path, "ab");
+    TEST_ASSERT_MSG(file != NULL, "%s", path);
+    for (int i = 0; i < n; i++) {
+        fputc(i % 64 == 63 ? '\n' : 'a' + i % 26, file);
+    }
+    fclose(file);
+}
+
+static long test_size(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_size : -1;
+}
+
+static void test_path(uint32_t gen, char* path) {
+    app_logrot_path(gen, path, 32);
+}
+
+/**
+ * @brief 上传一块并确认，和 app_logup.c 相同地更新偏移、序号。
+ */
+static void test_upload_chunk(app_logrot_upload_t* up, uint32_t len) {
+    up->off += len;
+    up->seq++;
+    app_logrot_upload_ack(up);
+}
+
+/**
+ * @brief 在子进程中运行，断言失败时退出码不为 0。
+ * @return 子进程的退出码。
+ */
+static int test_fork(void (*fn)(void)) {
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    TEST_ASSERT(pid >= 0);
+    if (pid == 0) {
+        fn();
+        _exit(0);
+    }
+    int status;
+    TEST_ASSERT(waitpid(pid, &status, 0) == pid);
+    TEST_ASSERT_MSG(WIFEXITED(status), "子进程异常退出：%d", status);
+    return WEXITSTATUS(status);
+}
+
+/**
+ * @brief 轮转测试在两次启动之间传递的数据。
+ */
+typedef struct {
+    uint32_t id;                // 上一次启动没有上传完的文件 ID。
+    uint32_t off;               // 已确认的偏移。
+    uint32_t end;               // 上一次请求上传到的偏移。
+    uint32_t t_lo;              // app_logrot_stamp() 推算的开始时间的范围。
+    uint32_t t_hi;
+} test_note_t;
+
+static void test_note_save(const test_note_t* note) {
+    FILE* file = fopen(TEST_NOTE_PATH, "wb");
+    TEST_ASSERT(file != NULL && fwrite(note, sizeof(*note), 1, file) == 1);
+    fclose(file);
+}
+
+static void test_note_load(test_note_t* note) {
+    FILE* file = fopen(TEST_NOTE_PATH, "rb");
+    TEST_ASSERT(file != NULL && fread(note, sizeof(*note), 1, file) == 1);
+    fclose(file);
+}
+
+/**
+ * @brief 第一次启动：没有清单，收编三个旧版本的日志文件，开始第 4 个文件。上传完第 2 个，第 3 个确认 3 字节。
+ */
+static void test_rotate_boot_adopt(void) {
+    test_write(APP_SD_LOG_DIR"/FILE.TXT", "w", "old-file\n");
+    test_write(APP_SD_LOG_DIR"/MQTT.TXT", "w", "old-mqtt\n");
+    test_write(APP_SD_LOG_DIR"/LOG.TXT", "w", "old-log\n");
+    TEST_ASSERT_EQUAL(ESP_OK, app_logrot_init());
+    TEST_ASSERT_EQUAL(0, app_logrot_adopt(APP_SD_LOG_DIR"/FILE.TXT", false));
+    TEST_ASSERT_EQUAL(0, app_logrot_adopt(APP_SD_LOG_DIR"/MQTT.TXT", true));
+    TEST_ASSERT_EQUAL(0, app_logrot_adopt(APP_SD_LOG_DIR"/LOG.TXT", true));
+    TEST_ASSERT_EQUAL(-1, app_logrot_adopt(APP_SD_LOG_DIR"/NONE.TXT", true));
+    char path[32];
+    TEST_ASSERT_EQUAL(ESP_OK, app_logrot_start(path, sizeof(path)));
+    TEST_ASSERT_EQUAL(4, test_gen_of(path));
+    test_write(path, "w", "boot 1\n");
+
+    char old[32];
+    test_path(1, old);
+    TEST_ASSERT_EQUAL(9, test_size(old));// 重命名，不复制。
+    TEST_ASSERT(access(APP_SD_LOG_DIR"/FILE.TXT", F_OK) == -1);
+    TEST_ASSERT(access(APP_SD_LOG_DIR"/LOG.TXT", F_OK) == -1);
+
+    // 不上传的文件直接标记已上传，上传位置跳过。
+    TEST_ASSERT_EQUAL(3, test_added_n);
+    TEST_ASSERT(test_added[0].gen == 1 && test_added[0].t0 == 0 && test_added[0].uploaded);
+    TEST_ASSERT(test_added[1].gen == 2 && !test_added[1].uploaded);
+    TEST_ASSERT(test_added[2].gen == 3 && !test_added[2].uploaded);
+    TEST_ASSERT_EQUAL(1, test_uploaded_n);
+    TEST_ASSERT_EQUAL(1, test_uploaded[0]);
+    TEST_ASSERT(!app_logrot_pending(old));
+    test_path(2, old);
+    TEST_ASSERT(app_logrot_pending(old));
+    TEST_ASSERT(app_logrot_pending(path));
+    TEST_ASSERT(!app_logrot_pending(APP_SD_LOG_DIR"/FOO.TXT"));
+
+    app_logrot_upload_t up;
+    TEST_ASSERT(app_logrot_next_upload(&up));
+    TEST_ASSERT(up.gen == 2 && up.off == 0 && up.end == 9 && up.seq == 0 && (up.id & 1) == 1);
+    TEST_ASSERT_EQUAL(0, strcmp(up.path, old));
+    test_upload_chunk(&up, 9);
+    TEST_ASSERT_EQUAL(2, test_uploaded_n);
+    TEST_ASSERT_EQUAL(2, test_uploaded[1]);
+
+    TEST_ASSERT(app_logrot_next_upload(&up));
+    TEST_ASSERT(up.gen == 3 && up.off == 0 && up.end == 8 && up.seq == 0);
+    test_upload_chunk(&up, 3);
+    test_note_t note = { .id = up.id, .off = up.off };
+    test_note_save(&note);
+}
+
+/**
+ * @brief 第二次启动：从第 3 个文件的偏移 3 继续，文件 ID、序号不变。记录开始时间，当前文件分两次请求上传。
+ */
+static void test_rotate_boot_resume(void) {
+    test_note_t note;
+    test_note_load(&note);
+    TEST_ASSERT_EQUAL(ESP_OK, app_logrot_init());
+    char path[32];
+    TEST_ASSERT_EQUAL(ESP_OK, app_logrot_start(path, sizeof(path)));
+    TEST_ASSERT_EQUAL(5, test_gen_of(path));
+    TEST_ASSERT_EQUAL(1, test_added_n);
+    TEST_ASSERT(test_added[0].gen == 4 && test_added[0].t0 == 0 && !test_added[0].uploaded);
+    test_append(path, 300);
+
+    note.t_hi = 1700000000 - esp_log_timestamp() / 1000;
+    app_logrot_stamp(1700000000);
+    note.t_lo = 1700000000 - esp_log_timestamp() / 1000;
+    app_logrot_stamp(1800000000);// 已经记录，不再修改。
+
+    app_logrot_upload_t up;
+    TEST_ASSERT(app_logrot_next_upload(&up));
+    TEST_ASSERT(up.gen == 3 && up.off == 3 && up.end == 8 && up.seq == 1 && up.id == note.id);
+    test_upload_chunk(&up, 5);
+    TEST_ASSERT(app_logrot_next_upload(&up));
+    TEST_ASSERT(up.gen == 4 && up.off == 0 && up.end == 7 && up.seq == 0);
+    test_upload_chunk(&up, 7);
+    TEST_ASSERT(!app_logrot_next_upload(&up));// 当前文件没有请求上传。
+    TEST_ASSERT_EQUAL(2, test_uploaded_n);
+    TEST_ASSERT(test_uploaded[0] == 3 && test_uploaded[1] == 4);
+
+    app_logrot_snap();
+    TEST_ASSERT(app_logrot_next_upload(&up));
+    TEST_ASSERT(up.gen == 5 && up.off == 0 && up.end == 300 && up.seq == 0);
+    uint32_t id = up.id;
+    test_upload_chunk(&up, TEST_CHUNK);
+    TEST_ASSERT(app_logrot_next_upload(&up));
+    test_upload_chunk(&up, 300 - TEST_CHUNK);
+    TEST_ASSERT(!app_logrot_next_upload(&up));// 到达请求的位置，当前文件不进入下一个序号。
+    test_append(path, 200);
+    TEST_ASSERT(!app_logrot_next_upload(&up));
+    app_logrot_snap();
+    TEST_ASSERT(app_logrot_next_upload(&up));
+    TEST_ASSERT(up.gen == 5 && up.off == 300 && up.end == 500 && up.seq == 2 && up.id == id);
+    test_append(path, 100);// 没有确认，下次启动从 300 继续。
+    note.id = id;
+    note.off = 300;
+    note.end = 500;
+    test_note_save(&note);
+}
+
+/**
+ * @brief 第三次启动：上一次的当前文件变成旧文件，整个文件上传。关闭时带上记录的开始时间。文件被删除时跳过。
+ */
+static void test_rotate_boot_old(void) {
+    test_note_t note;
+    test_note_load(&note);
+    TEST_ASSERT_EQUAL(ESP_OK, app_logrot_init());
+    char path[32];
+    TEST_ASSERT_EQUAL(ESP_OK, app_logrot_start(path, sizeof(path)));
+    TEST_ASSERT_EQUAL(6, test_gen_of(path));
+    test_write(path, "w", "boot 3\n");
+    TEST_ASSERT_EQUAL(1, test_added_n);
+    TEST_ASSERT(test_added[0].gen == 5 && !test_added[0].uploaded);
+    TEST_ASSERT_MSG(test_added[0].t0 >= note.t_lo && test_added[0].t0 <= note.t_hi, "开始时间 %u，范围 %u - %u",
+        test_added[0].t0, note.t_lo, note.t_hi);
+
+    app_logrot_upload_t up;
+    TEST_ASSERT(app_logrot_next_upload(&up));
+    TEST_ASSERT(up.gen == 5 && up.off == note.off && up.end == 600 && up.seq == 2 && up.id == note.id);
+    TEST_ASSERT_EQUAL(0, remove(up.path));
+    TEST_ASSERT(!app_logrot_next_upload(&up));
+    TEST_ASSERT_EQUAL(1, test_uploaded_n);
+    TEST_ASSERT_EQUAL(5, test_uploaded[0]);
+    char old[32];
+    test_path(5, old);
+    TEST_ASSERT(!app_logrot_pending(old));
+    TEST_ASSERT(app_logrot_pending(path));
+}
+
+/**
+ * @brief 第四次启动：清单丢失，已有的文件不再上传，新的序号跳过已经存在的文件，不覆盖。
+ */
+static void test_rotate_boot_lost(void) {
+    TEST_ASSERT_EQUAL(0, remove(TEST_LOGROT_DAT));
+    TEST_ASSERT_EQUAL(ESP_OK, app_logrot_init());// 第 5 个文件已被删除，从第 5 个开始。
+    char path[32];
+    TEST_ASSERT_EQUAL(ESP_OK, app_logrot_start(path, sizeof(path)));
+    TEST_ASSERT_EQUAL(5, test_gen_of(path));
+    TEST_ASSERT_EQUAL(1, test_added_n);
+    TEST_ASSERT(test_added[0].gen == 4 && test_added[0].uploaded);
+    app_logrot_upload_t up;
+    TEST_ASSERT(!app_logrot_next_upload(&up));
+
+    TEST_ASSERT_EQUAL(ESP_OK, app_logrot_start(path, sizeof(path)));
+    TEST_ASSERT_EQUAL(7, test_gen_of(path));
+    char old[32];
+    test_path(6, old);
+    TEST_ASSERT_EQUAL(7, test_size(old));
+}
+
+/**
+ * @brief 轮转和续传，四次启动。
+ */
+static void test_logrot_rotate(void) {
+    host_test_reset_dir(APP_SD_LOG_DIR);
+    TEST_ASSERT_EQUAL(0, test_fork(test_rotate_boot_adopt));
+    TEST_ASSERT_EQUAL(0, test_fork(test_rotate_boot_resume));
+    TEST_ASSERT_EQUAL(0, test_fork(test_rotate_boot_old));
+    TEST_ASSERT_EQUAL(0, test_fork(test_rotate_boot_lost));
+}
+
+/**
+ * @brief 掉电测试的一次启动，在子进程中运行：开始新的日志文件，写入，有时请求上传当前文件，然后上传若干块。
+ * @param seed 随机动作的种子。
+ * @param steps 上传的块数上限。
+ * @param final 不掉电，请求上传当前文件，上传完所有日志。
+ */
+static void test_crash_boot(uint32_t seed, uint32_t steps, bool final) {
+    test_ev_fd = open(TEST_EVENT_PATH, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (test_ev_fd < 0) {
+        _exit(2);
+    }
+    test_ev(TEST_EV_BOOT, 0, 0, 0, 0, 0);
+    srand(seed);
+    srandom(seed);
+    app_logrot_init();
+    char path[32];
+    if (app_logrot_start(path, sizeof(path)) != ESP_OK) {
+        _exit(3);
+    }
+    test_ev(TEST_EV_START, test_gen_of(path), 0, 0, 0, 0);
+    test_append(path, 1 + rand() % (TEST_CHUNK * 4));
+    if (final || rand() % 2 == 0) {
+        app_logrot_snap();
+    }
+    app_logrot_upload_t up;
+    for (uint32_t step = 0; step < steps; step++) {
+        if (!final && rand() % 4 == 0) {// 上传中间又请求上传当前文件。
+            test_append(path, 1 + rand() % TEST_CHUNK);
+            app_logrot_snap();
+        }
+        if (!app_logrot_next_upload(&up)) {
+            break;
+        }
+        uint32_t len = up.end - up.off < TEST_CHUNK ? up.end - up.off : TEST_CHUNK;
+        test_ev(TEST_EV_DELIVER, up.gen, up.id, up.seq, up.off, len);
+        test_upload_chunk(&up, len);
+        test_ev(TEST_EV_ACK, up.gen, up.id, up.seq, up.off, 0);
+    }
+    if (final && app_logrot_next_upload(&up)) {
+        _exit(4);
+    }
+    test_ev(TEST_EV_FSYNCS, 0, 0, 0, test_fsyncs, 0);
+    _exit(0);
+}
+
+/**
+ * @brief 服务器端的一个日志文件，按 (文件 ID, 序号) 拼接。
+ */
+typedef struct {
+    bool started;
+    uint32_t id;                        // 正在拼接的文件 ID。
+    uint32_t acked;                     // 已确认的偏移。
+    uint32_t n;                         // 已收到的块数。
+    uint32_t off[TEST_SEQ_MAX];
+    uint32_t len[TEST_SEQ_MAX];
+} test_file_t;
+
+/**
+ * @brief 父进程的检查状态，按事件顺序重放。
+ */
+typedef struct {
+    test_file_t files[TEST_GEN_MAX];
+    uint32_t last_gen;                  // 最后一次 app_logrot_start() 返回的序号。
+    uint32_t boots;
+    uint32_t chunks;
+    uint32_t resent;                    // 掉电以后重发的块。
+    uint32_t last_fsyncs;               // 最后一次不掉电的启动 fsync() 的次数。
+} test_check_t;
+
+static test_check_t test_check;
+
+/**
+ * @brief 读取事件文件，从头重放检查。
+ */
+static void test_replay(void) {
+    test_check_t* c = &test_check;
+    memset(c, 0, sizeof(test_check_t));
+    FILE* file = fopen(TEST_EVENT_PATH, "rb");
+    TEST_ASSERT(file != NULL);
+    test_ev_t ev;
+    while (fread(&ev, sizeof(ev), 1, file) == 1) {
+        test_file_t* f = &c->files[ev.gen < TEST_GEN_MAX ? ev.gen : 0];
+        switch (ev.type) {
+        case TEST_EV_BOOT:
+            c->boots++;
+            break;
+        case TEST_EV_START:
+            TEST_ASSERT_MSG(ev.gen > c->last_gen && ev.gen < TEST_GEN_MAX, "启动 %u 重用序号 %u，上一个 %u",
+                c->boots, ev.gen, c->last_gen);
+            c->last_gen = ev.gen;
+            f->started = true;
+            break;
+        case TEST_EV_DELIVER:
+            TEST_ASSERT_MSG(f->started, "启动 %u 上传了没有开始的文件 %u", c->boots, ev.gen);
+            TEST_ASSERT(ev.len > 0 && ev.len <= TEST_CHUNK && ev.seq < TEST_SEQ_MAX);
+            if (ev.id != f->id) {// 新的文件 ID 从头开始，只能在确认任何数据之前。
+                TEST_ASSERT_MSG(f->acked == 0, "启动 %u 文件 %u 确认到 %u 以后换了文件 ID", c->boots, ev.gen, f->acked);
+                TEST_ASSERT_MSG(ev.off == 0 && ev.seq == 0, "启动 %u 文件 %u 新的文件 ID 从 %u/%u 开始",
+                    c->boots, ev.gen, ev.seq, ev.off);
+                f->id = ev.id;
+                f->n = 0;
+            }
+            TEST_ASSERT_MSG(ev.off >= f->acked, "启动 %u 文件 %u 重复上传已确认的数据：%u，确认到 %u",
+                c->boots, ev.gen, ev.off, f->acked);
+            if (ev.seq < f->n) {// 掉电以后重发，文件可能变长，长度可以不同。
+                TEST_ASSERT_MSG(ev.off == f->off[ev.seq], "启动 %u 文件 %u 块 %u 的偏移从 %u 变成 %u",
+                    c->boots, ev.gen, ev.seq, f->off[ev.seq], ev.off);
+                c->resent++;
+            } else {
+                TEST_ASSERT_MSG(ev.seq == f->n, "启动 %u 文件 %u 序号跳过：%u，已收到 %u 块", c->boots, ev.gen, ev.seq, f->n);
+                uint32_t expected = ev.seq == 0 ? 0 : f->off[ev.seq - 1] + f->len[ev.seq - 1];
+                TEST_ASSERT_MSG(ev.off == expected, "启动 %u 文件 %u 块 %u 不连续：%u，期望 %u",
+                    c->boots, ev.gen, ev.seq, ev.off, expected);
+            }
+            f->off[ev.seq] = ev.off;
+            f->len[ev.seq] = ev.len;
+            f->n = ev.seq + 1;
+            c->chunks++;
+            break;
+        case TEST_EV_ACK:
+            TEST_ASSERT(ev.id == f->id && ev.seq == f->n && ev.off == f->off[ev.seq - 1] + f->len[ev.seq - 1]);
+            f->acked = ev.off;
+            break;
+        case TEST_EV_FSYNCS:
+            c->last_fsyncs = ev.off;
+            break;
+        default:
+            TEST_ASSERT_MSG(false, "事件类型 %u", ev.type);
+        }
+    }
+    fclose(file);
+}
+
+/**
+ * @brief 在子进程中启动一次，等待退出。
+ * @return 是否掉电。
+ */
+static bool test_run_boot(uint32_t seed, uint32_t steps, uint32_t crash_at, bool tear, bool final) {
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    TEST_ASSERT(pid >= 0);
+    if (pid == 0) {
+        test_crash_at = crash_at;
+        test_tear = tear;
+        test_crash_boot(seed, steps, final);
+    }
+    int status;
+    TEST_ASSERT(waitpid(pid, &status, 0) == pid);
+    TEST_ASSERT_MSG(WIFEXITED(status), "子进程异常退出：%d", status);
+    int code = WEXITSTATUS(status);
+    TEST_ASSERT_MSG(code == 0 || code == TEST_CRASH_EXIT, "种子 %u，掉电点 %u，子进程退出码 %d", seed, crash_at, code);
+    return code == TEST_CRASH_EXIT;
+}
+
+/**
+ * @brief 不掉电地启动一次，上传完所有日志，检查每个文件都按序号完整拼接。
+ */
+static void test_final_and_check(void) {
+    TEST_ASSERT(!test_run_boot(0, UINT32_MAX, 0, false, true));
+    test_replay();
+    for (uint32_t gen = 1; gen <= test_check.last_gen; gen++) {
+        test_file_t* f = &test_check.files[gen];
+        if (!f->started) {
+            continue;
+        }
+        char path[32];
+        test_path(gen, path);
+        long size = test_size(path);
+        TEST_ASSERT_MSG(size > 0, "文件 %u 不存在", gen);
+        // 最后一块确认以后保存位置时掉电，位置已经保存，没有确认事件，按服务器收到的块检查。
+        TEST_ASSERT_MSG(f->n > 0 && f->off[f->n - 1] + f->len[f->n - 1] == size,
+            "文件 %u 没有上传完：%u 块，确认到 %u，文件 %ld 字节", gen, f->n, f->acked, size);
+    }
+}
+
+static void test_crash_reset(void) {
+    host_test_reset_dir(APP_SD_LOG_DIR);
+    remove(TEST_EVENT_PATH);
+}
+
+/**
+ * @brief 固定的动作序列，在第二次启动的每一次 fsync() 处掉电，槽写完或者只写了一半，然后重启上传全部日志。
+ */
+static void test_logrot_crash_every_fsync(void) {
+    test_crash_reset();
+    test_run_boot(1, 12, 0, false, false);
+    test_run_boot(2, 12, 0, false, false);
+    test_replay();
+    uint32_t total = test_check.last_fsyncs;
+    TEST_ASSERT(total > 5);
+    for (uint32_t crash_at = 1; crash_at <= total; crash_at++) {
+        for (int tear = 0; tear < 2; tear++) {
+            test_crash_reset();
+            TEST_ASSERT(!test_run_boot(1, 12, 0, false, false));
+            TEST_ASSERT(test_run_boot(2, 12, crash_at, tear, false));
+            test_run_boot(3, 12, 0, false, false);
+            test_final_and_check();
+        }
+    }
+    printf("掉电点 %u 个\n", total);
+}
+
+/**
+ * @brief 随机动作、随机掉电点的连续多次启动。
+ */
+static void test_logrot_crash_random(void) {
+    test_crash_reset();
+    srand(54321);
+    uint32_t seeds[300];
+    uint32_t steps[300];
+    uint32_t crashes[300];
+    bool tears[300];
+    for (int i = 0; i < 300; i++) {// test_crash_boot() 在子进程中重新设置种子，这里先生成好。
+        seeds[i] = rand();
+        steps[i] = rand() % 12;
+        crashes[i] = rand() % 3 == 0 ? 0 : 1 + rand() % 12;
+        tears[i] = rand() % 2 == 0;
+    }
+    uint32_t crashed = 0;
+    for (int i = 0; i < 300; i++) {
+        crashed += test_run_boot(seeds[i], steps[i], crashes[i], tears[i], false);
+    }
+    test_final_and_check();
+    printf("启动 %u 次，掉电 %u 次，日志文件 %u 个，上传 %u 块，重发 %u 块\n",
+        test_check.boots, crashed, test_check.last_gen, test_check.chunks, test_check.resent);
+    TEST_ASSERT(test_check.resent > 0);
+}
+
+int main(void) {
+    RUN_TEST(test_logrot_rotate);
+    RUN_TEST(test_logrot_crash_every_fsync);
+    RUN_TEST(test_logrot_crash_random);
+    return 0;
+}
@@ -0,0 +1,237 @@
+/**
+ * @brief   LZSS 压缩主机测试：压缩以后用 app_lzss_decompress() 解压，和原始数据相同。
+ *          1. 手工编码的字节序列固定格式：标记字节从低位开始，距离 - 1 占 12 位，长度 - 3 占 4 位；
+ *          2. 日志文本、随机数据、小字母表的随机数据、随机距离的重复片段，长度从 0 到 4096；
+ *          3. 最大距离、最大长度的匹配；
+ *          4. 输出缓冲区刚好够用时成功，少一个字节时返回 -1，不越界写入。
+ *             app_logup.c 用原始长度 - 1 作为输出大小，随机数据不压缩，原样发送。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "host_test.h"
+#include "app_lzss.h"
+
+ /**
+ * @brief 输出缓冲区后面的保护字节。
+ */
+#define TEST_GUARD                  64
+#define TEST_GUARD_BYTE             0xA5
+
+static uint16_t test_hash[APP_LZSS_HASH_SIZE];
+
+/**
+ * @brief 可重复的伪随机数。
+ */
+static uint32_t test_rand_state = 1;
+
+static uint32_t test_rand(void) {
+    test_rand_state ^= test_rand_state << 13;
+    test_rand_state ^= test_rand_state >> 17;
+    test_rand_state ^= test_rand_state << 5;
+    return test_rand_state;
+}
+
+/**
+ * @brief 压缩到 out_size 字节的缓冲区，检查保护字节没有被改写。
+ */
+static int test_compress(const uint8_t* in, int in_len, int out_size, uint8_t* out) {
+    memset(out, TEST_GUARD_BYTE, out_size + TEST_GUARD);
+    int ret = app_lzss_compress(in, in_len, out, out_size, test_hash);
+    for (int i = 0; i < TEST_GUARD; i++) {
+        TEST_ASSERT_MSG(out[out_size + i] == TEST_GUARD_BYTE, "长度 %d，输出大小 %d，越界写入", in_len, out_size);
+    }
+    return ret;
+}
+
+/**
+ * @brief 压缩、解压，和原始数据相同。输出大小刚好够用时成功，少一个字节时失败。
+ * @return 压缩后的字节数。
+ */
+static int test_roundtrip(const uint8_t* in, int in_len) {
+    static uint8_t out[APP_LZSS_WINDOW_SIZE * 2 + TEST_GUARD];
+    static uint8_t dec[APP_LZSS_WINDOW_SIZE];
+    int max = APP_LZSS_WINDOW_SIZE * 2;
+    int len = test_compress(in, in_len, max, out);
+    TEST_ASSERT_MSG(len >= 0 && len <= in_len + (in_len + 7) / 8, "长度 %d，压缩 %d", in_len, len);
+    TEST_ASSERT_EQUAL(in_len, app_lzss_decompress(out, len, dec, in_len));
+    TEST_ASSERT_MSG(memcmp(dec, in, in_len) == 0, "长度 %d，解压以后不同", in_len);
+    if (in_len > 0) {
+        TEST_ASSERT_EQUAL(-1, app_lzss_decompress(out, len, dec, in_len - 1));// 块头的原始长度不对，不越界。
+    }
+
+    static uint8_t exact[APP_LZSS_WINDOW_SIZE * 2 + TEST_GUARD];
+    TEST_ASSERT_EQUAL(len, test_compress(in, in_len, len, exact));
+    TEST_ASSERT(memcmp(exact, out, len) == 0);
+    if (len > 0) {
+        TEST_ASSERT_MSG(test_compress(in, in_len, len - 1, exact) == -1, "长度 %d，输出大小 %d", in_len, len - 1);
+    }
+    return len;
+}
+
+/**
+ * @brief 手工编码的字节序列。
+ */
+static void test_lzss_format(void) {
+    static uint8_t out[256 + TEST_GUARD];
+    static uint8_t dec[256];
+
+    // 3 个原始字节，然后距离 3、长度 9 的匹配，和自己重叠。
+    const uint8_t abc[] = "abcabcabcabc";
+    const uint8_t abc_out[] = { 0x07, 'a', 'b', 'c', 0x06, 0x02 };
+    TEST_ASSERT_EQUAL(sizeof(abc_out), test_compress(abc, 12, sizeof(out) - TEST_GUARD, out));
+    TEST_ASSERT(memcmp(out, abc_out, sizeof(abc_out)) == 0);
+
+    // 最大长度 18：1 个原始字节，两个距离 1、长度 18 的匹配，最后长度 3。
+    uint8_t a40[40];
+    memset(a40, 'a', sizeof(a40));
+    const uint8_t a40_out[] = { 0x01, 'a', 0x0F, 0x00, 0x0F, 0x00, 0x00, 0x00 };
+    TEST_ASSERT_EQUAL(sizeof(a40_out), test_compress(a40, sizeof(a40), sizeof(out) - TEST_GUARD, out));
+    TEST_ASSERT(memcmp(out, a40_out, sizeof(a40_out)) == 0);
+
+    // 超过 8 个单元，第二个标记字节。
+    const uint8_t text[] = "0123456789";
+    const uint8_t text_out[] = { 0xFF, '0', '1', '2', '3', '4', '5', '6', '7', 0x03, '8', '9' };
+    TEST_ASSERT_EQUAL(sizeof(text_out), test_compress(text, 10, sizeof(out) - TEST_GUARD, out));
+    TEST_ASSERT(memcmp(out, text_out, sizeof(text_out)) == 0);
+
+    // 解压器按同样的格式读取，距离超出已解压的数据时失败。
+    TEST_ASSERT_EQUAL(12, app_lzss_decompress(abc_out, sizeof(abc_out), dec, sizeof(dec)));
+    TEST_ASSERT(memcmp(dec, abc, 12) == 0);
+    const uint8_t bad_dist[] = { 0x01, 'a', 0x00, 0x01 };
+    TEST_ASSERT_EQUAL(-1, app_lzss_decompress(bad_dist, sizeof(bad_dist), dec, sizeof(dec)));
+    const uint8_t cut[] = { 0x01, 'a', 0x0F };
+    TEST_ASSERT_EQUAL(-1, app_lzss_decompress(cut, sizeof(cut), dec, sizeof(dec)));
+}
+
+/**
+ * @brief 最大距离：块开头的数据在块的末尾重复。18 字节的匹配最远 4078，3 字节的匹配最远 4093。
+ */
+static void test_lzss_max_distance(void) {
+    static uint8_t in[APP_LZSS_WINDOW_SIZE];
+    static uint8_t out[APP_LZSS_WINDOW_SIZE * 2 + TEST_GUARD];
+    const char pattern[] = "ABCDEFGHIJKLMNOPQR";
+    const struct {
+        int len;
+        uint8_t b0;
+        uint8_t b1;
+    } cases[] = {
+        { 18, 0xFF, 0xED },// 距离 4078：0xFED。
+        { 3, 0xF0, 0xFC },// 距离 4093：0xFFC。
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        memset(in, 0, sizeof(in));
+        memcpy(in, pattern, cases[c].len);
+        memcpy(in + sizeof(in) - cases[c].len, pattern, cases[c].len);
+        int len = test_roundtrip(in, sizeof(in));
+        TEST_ASSERT_EQUAL(len, test_compress(in, sizeof(in), sizeof(out) - TEST_GUARD, out));
+        TEST_ASSERT_MSG(out[len - 2] == cases[c].b0 && out[len - 1] == cases[c].b1, "匹配长度 %d，结尾 %02X %02X",
+            cases[c].len, out[len - 2], out[len - 1]);
+    }
+}
+
+/**
+ * @brief 日志文本：和 ESP_LOGx() 的输出相同的格式，时间戳和数值变化。
+ */
+static int test_make_log(uint8_t* buf, int size) {
+    static const char* const lines[] = {
+        "I (%u) app_mqtt: ------ MQTT 发送消息：成功。消息 ID：%u，在途：%u\n",
+        "W (%u) app_cache: ------ 缓存日志记录超长，丢弃。段：%08X，偏移：%u\n",
+        "I (%u) app_drain: ------ 推送缓存：%u 条，剩余 %u 字节\n",
+        "E (%u) app_modem: ------ AT+CSQ 命令，返回：失败！重试 %u/%u\n",
+        "I (%u) app_logbuf: ------ SD 卡日志，行数：%u，丢弃：%u\n",
+    };
+    int len = 0;
+    uint32_t ts = 1000;
+    while (len < size) {
+        char line[160];
+        ts += test_rand() % 500;
+        int n = snprintf(line, sizeof(line), lines[test_rand() % 5], ts, test_rand() % 70000, test_rand() % 4096);
+        if (n > size - len) {
+            n = size - len;
+        }
+        memcpy(buf + len, line, n);
+        len += n;
+    }
+    return len;
+}
+
+/**
+ * @brief 日志文本、随机数据、小字母表的随机数据，不同的长度。
+ */
+static void test_lzss_roundtrip(void) {
+    static uint8_t in[APP_LZSS_WINDOW_SIZE];
+    static const int sizes[] = { 0, 1, 2, 3, 4, 17, 18, 19, 100, 1000, 4095, 4096 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        test_make_log(in, n);
+        test_roundtrip(in, n);
+        for (int i = 0; i < n; i++) {
+            in[i] = test_rand();
+        }
+        test_roundtrip(in, n);
+        for (int i = 0; i < n; i++) {
+            in[i] = "ab\n "[test_rand() % 4];
+        }
+        test_roundtrip(in, n);
+    }
+    uint32_t raw_bytes = 0;
+    uint32_t log_bytes = 0;
+    for (int round = 0; round < 200; round++) {
+        test_make_log(in, sizeof(in));
+        log_bytes += test_roundtrip(in, sizeof(in));
+        for (int i = 0; i < (int)sizeof(in);) {// 随机字节中间复制前面任意距离、3 - 18 字节的片段。
+            int run = 3 + test_rand() % 16;
+            if (i > 0 && i + run <= (int)sizeof(in) && test_rand() % 2 == 0) {
+                memmove(in + i, in + i - 1 - test_rand() % i, run);
+                i += run;
+            } else {
+                in[i++] = test_rand();
+            }
+        }
+        test_roundtrip(in, sizeof(in));
+        raw_bytes += sizeof(in);
+    }
+    printf("日志文本：%u 字节压缩到 %u 字节，%u%%\n", raw_bytes, log_bytes, log_bytes * 100 / raw_bytes);
+}
+
+/**
+ * @brief app_logup.c 的调用方式：输出大小是原始长度 - 1，压缩以后没有变小时返回 -1，原样发送。
+ */
+static void test_lzss_fallback(void) {
+    static uint8_t in[APP_LZSS_WINDOW_SIZE];
+    static uint8_t out[APP_LZSS_WINDOW_SIZE + TEST_GUARD];
+    int fallback = 0;
+    for (int round = 0; round < 100; round++) {
+        int n = 1 + test_rand() % APP_LZSS_WINDOW_SIZE;
+        for (int i = 0; i < n; i++) {
+            in[i] = test_rand();
+        }
+        int len = test_compress(in, n, n - 1, out);
+        TEST_ASSERT_MSG(len == -1, "随机数据 %d 字节，压缩到 %d 字节", n, len);
+        fallback++;
+        test_make_log(in, n);
+        len = test_compress(in, n, n - 1, out);
+        if (n >= 256) {
+            TEST_ASSERT_MSG(len > 0 && len < n, "日志文本 %d 字节，压缩到 %d 字节", n, len);
+        }
+    }
+    // 边界：标记字节 + 3 个原始字节 + 2 字节的匹配。长度 4 的匹配小 1 个字节，长度 3 的匹配一样大，原样发送。
+    const uint8_t tight[] = "abcabca";
+    TEST_ASSERT_EQUAL(6, test_compress(tight, 7, 6, out));
+    TEST_ASSERT_EQUAL(-1, test_compress(tight, 6, 5, out));
+    printf("随机数据原样发送 %d 块\n", fallback);
+}
+
+int main(void) {
+    RUN_TEST(test_lzss_format);
+    RUN_TEST(test_lzss_max_distance);
+    RUN_TEST(test_lzss_roundtrip);
+    RUN_TEST(test_lzss_fallback);
+    return 0;
+}
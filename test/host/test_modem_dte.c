@@ -0,0 +1,308 @@
+/**
+ * @brief   调制解调器 DTE 主机测试：直接包含 esp_modem_usb_dte.c，CDC 驱动换成测试中的字节队列，按 USB 包把数据交给接收任务的处理函数。
+ *          测试程序代替接收任务，每收到一包调用一次 esp_handle_usb_data()，和 CDC 收包回调通知一次相同。
+ *          系统节拍由测试推进。DCE 替身记录收到的每一行，收到 OK 时结束命令。
+ *          1. 分包到达和整行到达得到相同的行，每包只读一次；
+ *          2. 命令超时留下的半行，发送新命令以后丢弃，不拼到新的响应前面；
+ *          3. 半行超过 ESP_MODEM_LINE_TIMEOUT_MS 没有后续数据也丢弃，超时之前到达的后续数据正常拼接；
+ *          4. 超过缓冲区的长行原样交出；
+ *          5. 输出每个响应的 CDC 读取次数和主机 CPU 时间。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "host_test.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief 测试节拍，毫秒。
+ */
+static TickType_t test_tick = 1;
+#define xTaskGetTickCount()         test_tick
+
+#include "esp_modem_usb_dte.c"
+
+#define TEST_LINE_BUFFER_SIZE       128
+#define TEST_PACKET_SIZE            64
+#define TEST_LINES_MAX              16
+
+/**
+ * @brief CDC 替身：接口 0 的接收队列，和读取次数。
+ */
+static uint8_t test_rx[1024];
+static size_t test_rx_head = 0;
+static size_t test_rx_tail = 0;
+static long test_reads = 0;
+
+/**
+ * @brief 命令的应答，写命令时按包交给接收任务，相当于接收任务在 send_cmd() 等待期间运行。
+ */
+static const char* test_reply = NULL;
+static char test_written[64];
+
+/**
+ * @brief DCE 替身收到的行。
+ */
+static char test_lines[TEST_LINES_MAX][TEST_LINE_BUFFER_SIZE];
+static int test_line_count = 0;
+
+static esp_modem_dce_t test_dce;
+static esp_modem_dte_internal_t* test_dte = NULL;
+
+ESP_EVENT_DEFINE_BASE(ESP_MODEM_EVENT);
+
+esp_err_t usbh_cdc_driver_install(const usbh_cdc_config_t* config) {
+    return ESP_FAIL;
+}
+
+esp_err_t usbh_cdc_driver_delete(void) {
+    return ESP_OK;
+}
+
+esp_err_t usbh_cdc_wait_connect(TickType_t ticks_to_wait) {
+    return ESP_FAIL;
+}
+
+esp_err_t usbh_cdc_flush_rx_buffer(uint8_t itf) {
+    return ESP_OK;
+}
+
+int usbh_cdc_get_itf_state(uint8_t itf) {
+    return itf == 0;
+}
+
+esp_err_t usbh_cdc_itf_get_buffered_data_len(uint8_t itf, size_t* size) {
+    *size = itf == 0 ? test_rx_tail - test_rx_head : 0;
+    return ESP_OK;
+}
+
+esp_err_t usbh_cdc_get_buffered_data_len(size_t* size) {
+    return usbh_cdc_itf_get_buffered_data_len(0, size);
+}
+
+int usbh_cdc_itf_read_bytes(uint8_t itf, uint8_t* buf, size_t length, TickType_t ticks_to_wait) {
+    TEST_ASSERT_EQUAL(0, itf);
+    test_reads++;
+    size_t n = MIN(length, test_rx_tail - test_rx_head);
+    memcpy(buf, test_rx + test_rx_head, n);
+    test_rx_head += n;
+    return n;
+}
+
+int usbh_cdc_read_bytes(uint8_t* buf, size_t length, TickType_t ticks_to_wait) {
+    return usbh_cdc_itf_read_bytes(0, buf, length, ticks_to_wait);
+}
+
+int usbh_cdc_write_bytes(const uint8_t* buf, size_t length) {
+    return length;
+}
+
+/**
+ * @brief 一个 USB 包到达：放进接收队列，接收任务处理。
+ */
+static void test_receive_packet(const char* data, size_t len) {
+    if (test_rx_head == test_rx_tail) {
+        test_rx_head = test_rx_tail = 0;
+    }
+    TEST_ASSERT(test_rx_tail + len <= sizeof(test_rx));
+    memcpy(test_rx + test_rx_tail, data, len);
+    test_rx_tail += len;
+    esp_handle_usb_data(test_dte);
+}
+
+/**
+ * @brief 按 packet 字节分包到达。
+ */
+static void test_receive(const char* data, size_t packet) {
+    size_t len = strlen(data);
+    for (size_t off = 0; off < len; off += packet) {
+        test_receive_packet(data + off, MIN(packet, len - off));
+    }
+}
+
+int usbh_cdc_itf_write_bytes(uint8_t itf, const uint8_t* buf, size_t length) {
+    TEST_ASSERT_EQUAL(0, itf);
+    snprintf(test_written, sizeof(test_written), "%.*s", (int)length, (const char*)buf);
+    if (test_reply) {
+        test_receive(test_reply, TEST_PACKET_SIZE);
+    }
+    return length;
+}
+
+static esp_err_t test_handle_line(esp_modem_dce_t* dce, const char* line) {
+    TEST_ASSERT(test_line_count < TEST_LINES_MAX);
+    snprintf(test_lines[test_line_count++], TEST_LINE_BUFFER_SIZE, "%s", line);
+    if (strcmp(line, "OK\r\n") == 0) {
+        dce->handle_line = NULL;
+        dce->state = ESP_MODEM_STATE_SUCCESS;
+        dce->dte->process_cmd_done(dce->dte);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 和 esp_modem_dte_new() 相同地创建 DTE，不安装 CDC 驱动、不创建接收任务。
+ */
+static void test_dte_new(void) {
+    test_dte = calloc(1, sizeof(esp_modem_dte_internal_t));
+    test_dte->line_buffer_size = TEST_LINE_BUFFER_SIZE;
+    test_dte->buffer = calloc(1, TEST_LINE_BUFFER_SIZE);
+    test_dte->data_buffer_size = TEST_LINE_BUFFER_SIZE;
+    test_dte->data_buffer = calloc(1, TEST_LINE_BUFFER_SIZE);
+    test_dte->parent.send_cmd = esp_modem_dte_send_cmd;
+    test_dte->parent.process_cmd_done = esp_modem_dte_process_cmd_done;
+    test_dte->process_group = xEventGroupCreate();
+    memset(&test_dce, 0, sizeof(test_dce));
+    test_dce.mode = ESP_MODEM_COMMAND_MODE;
+    test_dce.dte = &test_dte->parent;
+    test_dte->parent.dce = &test_dce;
+}
+
+static void test_dte_delete(void) {
+    vEventGroupDelete(test_dte->process_group);
+    free(test_dte->buffer);
+    free(test_dte->data_buffer);
+    free(test_dte);
+    test_dte = NULL;
+    test_rx_head = test_rx_tail = 0;
+    test_reply = NULL;
+    test_line_count = 0;
+}
+
+/**
+ * @brief 和 esp_modem_dce_generic_command() 相同：注册行处理函数，发送命令，等待 OK。
+ */
+static esp_err_t test_command(const char* command, const char* reply, uint32_t timeout) {
+    test_line_count = 0;
+    test_reply = reply;
+    test_dce.handle_line = test_handle_line;
+    esp_err_t err = test_dte->parent.send_cmd(&test_dte->parent, command, timeout);
+    test_reply = NULL;
+    return err;
+}
+
+static void test_assert_lines(const char* const* expected, int count) {
+    TEST_ASSERT_EQUAL(count, test_line_count);
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_MSG(strcmp(expected[i], test_lines[i]) == 0, "第 %d 行：%s", i, test_lines[i]);
+    }
+}
+
+static const char test_cgdcont[] = "\r\n+CGDCONT: 1,\"IP\",\"cmnet\",\"0.0.0.0\",0,0,0,0\r\n"
+    "+CGDCONT: 2,\"IPV4V6\",\"ims\",\"0.0.0.0\",0,0,0,0\r\n\r\nOK\r\n";
+static const char* const test_cgdcont_lines[] = {
+    "+CGDCONT: 1,\"IP\",\"cmnet\",\"0.0.0.0\",0,0,0,0\r\n",
+    "+CGDCONT: 2,\"IPV4V6\",\"ims\",\"0.0.0.0\",0,0,0,0\r\n",
+    "OK\r\n",
+};
+
+static void test_split_lines(void) {
+    static const size_t packets[] = { sizeof(test_cgdcont), TEST_PACKET_SIZE, 7, 1 };
+    for (int i = 0; i < sizeof(packets) / sizeof(packets[0]); i++) {
+        test_dte_new();
+        test_dce.handle_line = test_handle_line;
+        test_reads = 0;
+        test_receive(test_cgdcont, packets[i]);
+        test_assert_lines(test_cgdcont_lines, 3);
+        TEST_ASSERT_EQUAL((sizeof(test_cgdcont) - 1 + packets[i] - 1) / packets[i], test_reads);// 每包读一次，不等待行的其余部分。
+        TEST_ASSERT_EQUAL(0, test_dte->line_len);
+        test_dte_delete();
+    }
+}
+
+static void test_command_response(void) {
+    test_dte_new();
+    TEST_ASSERT_EQUAL(ESP_OK, test_command("AT+CGDCONT?\r", test_cgdcont, 100));
+    TEST_ASSERT(strcmp(test_written, "AT+CGDCONT?\r") == 0);
+    test_assert_lines(test_cgdcont_lines, 3);
+    test_dte_delete();
+}
+
+static void test_stale_partial_on_command(void) {
+    test_dte_new();
+    test_dce.handle_line = test_handle_line;
+    test_receive("\r\n+CSQ: 2", TEST_PACKET_SIZE);// 上一条命令超时，响应只到了一半。
+    TEST_ASSERT(test_dte->line_len > 0);
+    TEST_ASSERT_EQUAL(ESP_OK, test_command("AT+CGREG?\r", "\r\n+CGREG: 0,1\r\n\r\nOK\r\n", 100));
+    static const char* const lines[] = { "+CGREG: 0,1\r\n", "OK\r\n" };
+    test_assert_lines(lines, 2);
+    test_dte_delete();
+}
+
+static void test_partial_after_command(void) {
+    test_dte_new();
+    static const char* const lines[] = { "+CSQ: 15,99\r\n", "OK\r\n" };
+    test_reply = NULL;
+    test_line_count = 0;
+    test_dce.handle_line = test_handle_line;
+    /* 命令发出以后读到的半行属于这条命令的响应 */
+    atomic_fetch_add(&test_dte->cmd_seq, 1);
+    test_receive("\r\n+CSQ: 1", TEST_PACKET_SIZE);
+    test_tick += ESP_MODEM_LINE_TIMEOUT_MS;
+    test_receive("5,99\r\n\r\nOK\r\n", TEST_PACKET_SIZE);
+    test_assert_lines(lines, 2);
+    test_dte_delete();
+}
+
+static void test_stale_partial_on_timeout(void) {
+    test_dte_new();
+    test_dce.handle_line = test_handle_line;
+    test_receive("+CSQ: 2", TEST_PACKET_SIZE);
+    test_tick += ESP_MODEM_LINE_TIMEOUT_MS + 1;
+    test_receive("+CREG: 1\r\n", TEST_PACKET_SIZE);
+    static const char* const lines[] = { "+CREG: 1\r\n" };
+    test_assert_lines(lines, 1);
+    test_dte_delete();
+}
+
+static void test_long_line(void) {
+    test_dte_new();
+    test_dce.handle_line = test_handle_line;
+    char line[TEST_LINE_BUFFER_SIZE + 8];
+    memset(line, 'A', sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    test_receive(line, TEST_PACKET_SIZE);
+    TEST_ASSERT_EQUAL(1, test_line_count);
+    TEST_ASSERT_EQUAL(TEST_LINE_BUFFER_SIZE - 1, strlen(test_lines[0]));
+    TEST_ASSERT_EQUAL(sizeof(line) - TEST_LINE_BUFFER_SIZE, test_dte->line_len);
+    test_dte_delete();
+}
+
+/**
+ * @brief 按 64 字节 USB 包收一个多行响应，输出每个响应的 CDC 读取次数和主机 CPU 时间。
+ */
+static void test_measure(void) {
+    test_dte_new();
+    const int count = 100000;
+    test_reads = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        test_line_count = 0;
+        test_dce.handle_line = test_handle_line;
+        test_receive(test_cgdcont, TEST_PACKET_SIZE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    test_assert_lines(test_cgdcont_lines, 3);
+    double us = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / 1000.0 / count;
+    printf("%d 字节响应，%d 字节一包：CDC 读取 %.1f 次/响应，主机 CPU %.2f us/响应\n",
+        (int)sizeof(test_cgdcont) - 1, TEST_PACKET_SIZE, (double)test_reads / count, us);
+    TEST_ASSERT_EQUAL(count * ((sizeof(test_cgdcont) - 1 + TEST_PACKET_SIZE - 1) / TEST_PACKET_SIZE), test_reads);
+    test_dte_delete();
+}
+
+int main(void) {
+    RUN_TEST(test_split_lines);
+    RUN_TEST(test_command_response);
+    RUN_TEST(test_stale_partial_on_command);
+    RUN_TEST(test_partial_after_command);
+    RUN_TEST(test_stale_partial_on_timeout);
+    RUN_TEST(test_long_line);
+    RUN_TEST(test_measure);
+    return 0;
+}
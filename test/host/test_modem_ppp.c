@@ -0,0 +1,281 @@
+/**
+ * @brief   调制解调器 PPP 数据主机测试：直接包含 esp_modem_usb_dte.c，和真实的 iot_usbh_cdc.c 一起编译，USB 主机换成 stub/iot_usbh.c。
+ *          CDC 任务和 DTE 接收任务都是真实的线程，测试程序代替设备发出数据，PPP 输入回调检查收到的字节。
+ *          1. 直接交付反复关闭、打开，环形缓冲区中还有数据或接收任务正在交付时，新的 URB 不直接交付，字节不乱序、不重复，
+ *             PPP 输入不会被两个任务同时调用；
+ *          2. 输出直接使用 URB 和经过环形缓冲区两条路径的吞吐量和每 MB 的 CPU 时间；
+ *          3. PPP 输出的帧直接写入 URB，夹杂写入发送环形缓冲区的数据，总线上的字节不乱序，统计的字节数和发出的相同；
+ *          4. 按 USB 全速的速度，输出直接写入 URB 和只用发送环形缓冲区两种方式的 URB 数、利用率和吞吐量。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "host_test.h"
+#include "iot_usbh_host.h"
+
+#include "esp_modem_usb_dte.c"
+
+#define TEST_CHUNK_MAX              4096
+#define TEST_WAIT_MS                5000
+
+static esp_modem_dce_t test_dce;
+static esp_modem_dte_internal_t* test_dte = NULL;
+
+/**
+ * @brief PPP 输入替身：字节按 test_rx_next 递增，统计两条路径各自交付的字节数。
+ */
+static atomic_size_t test_rx_bytes;
+static size_t test_rx_task_bytes = 0;
+static uint8_t test_rx_next = 0;
+static atomic_int test_rx_busy;
+static int test_rx_slow = 0;
+static int test_rx_fast = 0;
+
+ESP_EVENT_DEFINE_BASE(ESP_MODEM_EVENT);
+
+static esp_err_t test_ppp_input(void* buffer, size_t len, void* context) {
+    TEST_ASSERT_MSG(atomic_exchange(&test_rx_busy, 1) == 0, "%s", "PPP 输入被两个任务同时调用");
+    const uint8_t* data = buffer;
+    if (test_rx_fast) {
+        // 测量时只检查首尾，测试程序本身的开销不计入。
+        TEST_ASSERT(data[0] == test_rx_next && data[len - 1] == (uint8_t)(test_rx_next + len - 1));
+        test_rx_next += len;
+    }
+    for (size_t i = 0; i < len && !test_rx_fast; i++) {
+        TEST_ASSERT_MSG(data[i] == test_rx_next, "第 %zu 字节：期望 %u，实际 %u", atomic_load(&test_rx_bytes) + i, test_rx_next, data[i]);
+        test_rx_next++;
+    }
+    if (xTaskGetCurrentTaskHandle() == test_dte->uart_event_task_hdl) {
+        test_rx_task_bytes += len;
+        if (test_rx_slow) {
+            vTaskDelay(1);// 接收任务交付得慢，环形缓冲区中的数据留得久一些。
+        }
+    }
+    atomic_store(&test_rx_busy, 0);
+    atomic_fetch_add(&test_rx_bytes, len);
+    return ESP_OK;
+}
+
+/**
+ * @brief 和 usbh_modem_board.c 相同地创建 DTE，绑定 DCE 替身，进入 PPP 模式。
+ */
+static void test_dte_new(void) {
+    esp_modem_dte_config_t config = ESP_MODEM_DTE_DEFAULT_CONFIG();
+    config.rx_buffer_size = 1024 * 15;
+    config.tx_buffer_size = 1024 * 15;
+    config.line_buffer_size = 1600;
+    esp_modem_dte_t* dte = esp_modem_dte_new(&config);
+    TEST_ASSERT(dte != NULL);
+    test_dte = __containerof(dte, esp_modem_dte_internal_t, parent);
+    test_dce.mode = ESP_MODEM_PPP_MODE;
+    test_dce.dte = dte;
+    dte->dce = &test_dce;
+    esp_modem_set_rx_cb(dte, test_ppp_input, NULL);
+    xEventGroupSetBits(test_dte->process_group, ESP_MODEM_START_BIT);
+}
+
+/**
+ * @brief 设备发出 total 字节，每次随机 1 到 TEST_CHUNK_MAX 字节。
+ */
+static void test_device_send(size_t total) {
+    static uint8_t pattern[TEST_CHUNK_MAX + 256];
+    static uint8_t next = 0;
+    if (pattern[1] == 0) {
+        for (size_t i = 0; i < sizeof(pattern); i++) {
+            pattern[i] = i;
+        }
+    }
+    for (size_t sent = 0; sent < total;) {
+        size_t len = 1 + rand() % TEST_CHUNK_MAX;
+        len = MIN(len, total - sent);
+        host_usbh_receive(pattern + next, len);
+        next += len;
+        sent += len;
+    }
+}
+
+/**
+ * @brief 等待设备发出的字节全部交给 PPP 输入。
+ */
+static void test_wait(size_t base, size_t total) {
+    for (int ms = 0; atomic_load(&test_rx_bytes) - base < total; ms++) {
+        TEST_ASSERT_MSG(ms < TEST_WAIT_MS, "收到 %zu 字节，期望 %zu", atomic_load(&test_rx_bytes) - base, total);
+        vTaskDelay(1);
+    }
+    TEST_ASSERT_EQUAL(total, atomic_load(&test_rx_bytes) - base);
+}
+
+static void test_rx_order(void) {
+    const size_t step = 64 << 10;
+    const int steps = 32;
+    srand(1);
+    test_rx_slow = 1;
+    test_rx_task_bytes = 0;
+    size_t base = atomic_load(&test_rx_bytes);
+    size_t total = 0;
+    for (int i = 0; i < steps; i++) {
+        usbh_cdc_itf_set_rx_direct(0, NULL, NULL);
+        test_device_send(step);
+        total += step;
+        // 环形缓冲区中还有数据时打开直接交付，这些 URB 仍然进入环形缓冲区。
+        usbh_cdc_itf_set_rx_direct(0, _usb_recv_direct_cb, test_dte);
+        test_device_send(step / 16);
+        total += step / 16;
+        test_wait(base, total);
+        size_t task_bytes = test_rx_task_bytes;
+        test_device_send(step);
+        total += step;
+        test_wait(base, total);
+        TEST_ASSERT_EQUAL(task_bytes, test_rx_task_bytes);// 环形缓冲区空了以后全部直接交付。
+    }
+    test_rx_slow = 0;
+    printf("共 %zu 字节，环形缓冲区交付 %zu 字节，其余直接交付\n", total, test_rx_task_bytes);
+    TEST_ASSERT(test_rx_task_bytes >= (step + step / 16) * steps);
+}
+
+/**
+ * @brief 输出 total 字节的吞吐量和进程 CPU 时间。PPP 输入只检查首尾字节，CPU 时间包括 stub/iot_usbh.c 复制到 URB 的部分。
+ */
+static void test_measure_once(const char* name, size_t total) {
+    struct timespec start, end, cpu_start, cpu_end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_start);
+    size_t base = atomic_load(&test_rx_bytes);
+    test_device_send(total);
+    test_wait(base, total);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end);
+    double mb = total / 1048576.0;
+    double s = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    double cpu = (cpu_end.tv_sec - cpu_start.tv_sec) + (cpu_end.tv_nsec - cpu_start.tv_nsec) / 1e9;
+    printf("%s：%.0f MB/s，CPU %.0f us/MB\n", name, mb / s, cpu * 1e6 / mb);
+}
+
+static void test_rx_measure(void) {
+    const size_t total = 64 << 20;
+    test_rx_fast = 1;
+    test_measure_once("PPP 输入直接使用 URB", total);
+    usbh_cdc_itf_set_rx_direct(0, NULL, NULL);
+    test_rx_task_bytes = 0;
+    test_measure_once("PPP 输入经过环形缓冲区", total);
+    TEST_ASSERT_EQUAL(total, test_rx_task_bytes);
+    usbh_cdc_itf_set_rx_direct(0, _usb_recv_direct_cb, test_dte);
+    test_rx_fast = 0;
+}
+
+/**
+ * @brief 总线替身：OUT 管道发出的字节按 test_tx_next 递增。
+ */
+static atomic_size_t test_tx_bytes;
+static uint8_t test_tx_next = 0;
+static uint8_t test_tx_pattern[TEST_CHUNK_MAX + 256];
+
+static void test_bus_sent(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        TEST_ASSERT_MSG(data[i] == test_tx_next, "第 %zu 字节：期望 %u，实际 %u", atomic_load(&test_tx_bytes) + i, test_tx_next, data[i]);
+        test_tx_next++;
+    }
+    atomic_fetch_add(&test_tx_bytes, len);
+}
+
+/**
+ * @brief 发出一帧 len 字节。ring 为 1 时和 AT 命令相同地写入发送环形缓冲区，否则和 PPP 输出相同地调用 DTE。
+ */
+static void test_tx_frame(size_t len, int ring) {
+    static uint8_t next = 0;
+    const char* frame = (const char*)test_tx_pattern + next;
+    int ret = ring ? usbh_cdc_write_bytes((const uint8_t*)frame, len) : test_dte->parent.send_data(&test_dte->parent, frame, len);
+    TEST_ASSERT_EQUAL((int)len, ret);
+    next += len;
+}
+
+static void test_tx_wait(size_t base, size_t total) {
+    for (int ms = 0; atomic_load(&test_tx_bytes) - base < total; ms++) {
+        TEST_ASSERT_MSG(ms < TEST_WAIT_MS, "发出 %zu 字节，期望 %zu", atomic_load(&test_tx_bytes) - base, total);
+        vTaskDelay(1);
+    }
+    TEST_ASSERT_EQUAL(total, atomic_load(&test_tx_bytes) - base);
+}
+
+static void test_tx_order(void) {
+    const size_t total = 1 << 20;
+    srand(2);
+    usbh_cdc_tx_stats_t before, after;
+    usbh_cdc_itf_get_tx_stats(0, &before);
+    size_t base = atomic_load(&test_tx_bytes);
+    uint32_t frames = 0, rings = 0;
+    for (size_t sent = 0; sent < total;) {
+        size_t len = MIN(1 + rand() % 1600, total - sent);
+        int ring = rand() % 50 == 0;// 环形缓冲区中有数据时，后面的帧也进入环形缓冲区。
+        test_tx_frame(len, ring);
+        frames += !ring;
+        rings += ring;
+        if (sent / 1024 != (sent + len) / 1024) {
+            vTaskDelay(1);// 比总线慢，环形缓冲区能发空，后面的帧回到直接写入。
+        }
+        sent += len;
+    }
+    test_tx_wait(base, total);
+    usbh_cdc_itf_get_tx_stats(0, &after);
+    printf("共 %" PRIu32 " 帧，其中 %" PRIu32 " 帧进入环形缓冲区，另写入环形缓冲区 %" PRIu32 " 次\n",
+        frames, after.fallbacks - before.fallbacks, rings);
+    TEST_ASSERT_EQUAL(frames, (after.frames - before.frames) + (after.fallbacks - before.fallbacks));
+    TEST_ASSERT(after.fallbacks > before.fallbacks);
+    TEST_ASSERT(after.frames - before.frames > frames / 2);
+    TEST_ASSERT_EQUAL(total, after.bytes - before.bytes);
+}
+
+/**
+ * @brief 满速上传：1500 字节的帧，每 5 帧夹一个 40 字节的 ACK，总线为 USB 全速。
+ */
+static void test_tx_measure_once(const char* name, size_t total, int ring) {
+    usbh_cdc_tx_stats_t before, after;
+    usbh_cdc_itf_get_tx_stats(0, &before);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t base = atomic_load(&test_tx_bytes);
+    size_t sent = 0;
+    for (int i = 0; sent < total; i++) {
+        size_t len = MIN(i % 5 == 4 ? 40 : 1500, total - sent);
+        test_tx_frame(len, ring);
+        sent += len;
+    }
+    test_tx_wait(base, total);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    usbh_cdc_itf_get_tx_stats(0, &after);
+    TEST_ASSERT_EQUAL(total, after.bytes - before.bytes);
+    uint32_t urbs = after.urbs - before.urbs;
+    double s = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%s：%" PRIu32 " 个 URB，利用率 %.1f%%，%.0f KB/s\n", name, urbs,
+        100.0 * total / ((double)urbs * after.buffer_size), total / 1024.0 / s);
+}
+
+static void test_tx_measure(void) {
+    const size_t total = 1 << 20;
+    test_tx_measure_once("PPP 输出直接写入 URB", total, 0);
+    usbh_cdc_tx_stats_t stats;
+    usbh_cdc_itf_get_tx_stats(0, &stats);
+    printf("一个 URB 最多 %" PRIu32 " 帧\n", stats.max_frames_per_urb);
+    test_tx_measure_once("PPP 输出经过环形缓冲区", total, 1);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(test_tx_pattern); i++) {
+        test_tx_pattern[i] = i;
+    }
+    test_dte_new();
+    RUN_TEST(test_rx_order);
+    RUN_TEST(test_rx_measure);
+    host_usbh_sent = test_bus_sent;
+    host_usbh_bytes_per_ms = 19 * 64;// USB 全速，每毫秒 19 个 64 字节的包。
+    RUN_TEST(test_tx_order);
+    RUN_TEST(test_tx_measure);
+    return 0;
+}
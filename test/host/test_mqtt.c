@@ -0,0 +1,589 @@
+/**
+ * @brief   缓存推送吞吐量主机测试：本机 TCP 服务器替身代替 mosquitto，测试程序代替 esp-mqtt 的发送函数和事件任务。
+ *          直接包含 app_mqtt.c，缓存用真实的 app_cache.c，每条记录 200 个字符。
+ *          服务器替身按上行带宽逐条接收，前一条传完才开始下一条，收完以后再过一个往返时间回复 PUBACK。
+ *          带宽和往返时间按 app_config.h 中的实测数据校准：1000 条 QOS = 0 耗时 2.5 秒，QOS = 1 逐条等待 9 秒左右，
+ *          即每条 2.5 毫秒、往返 6.5 毫秒。另外测量往返 50、100 毫秒，窗口不够覆盖往返时间时吞吐量下降。
+ *          比较三种方式：
+ *          1. QOS = 0 逐条发送，到服务器收到最后一条为止；
+ *          2. QOS = 1 逐条等待 PUBACK；
+ *          3. QOS = 1 在途窗口，和缓存推送任务相同地调用 app_mqtt_pub_cache()，收到 PUBACK 以后提交。
+ *          检查服务器按顺序收到每条记录，窗口方式每次提交的记录数不超过收到的 PUBACK 数，推送完以后剩余字节为 0。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "host_test.h"
+#include "esp_log.h"
+
+#include "app_mqtt.c"
+
+ /**
+ * @brief 每轮写入缓存的记录数，记录长度。
+ */
+#define TEST_RECORDS                200
+#define TEST_RECORD_LEN             200
+
+ /**
+ * @brief 往返时间较长时逐条等待太慢，只发送这么多条。
+ */
+#define TEST_SW_RECORDS             20
+
+ /**
+ * @brief 上行带宽，字节/秒。一条 200 个字符的消息加上 MQTT 头约 240 字节，2.5 毫秒。
+ */
+#define TEST_UPLINK_BPS             96000
+
+ /**
+ * @brief 校准的往返时间，微秒。
+ */
+#define TEST_RTT_CAL_US             6500
+
+/**
+ * @brief 连接：测试程序是客户端，服务器替身在另一端。
+ */
+static int test_cli_fd = -1;
+static int test_srv_fd = -1;
+
+/**
+ * @brief 客户端发送状态，esp_mqtt_client_publish() 替身使用。
+ */
+static pthread_mutex_t test_send_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint16_t test_msg_id = 0;
+static uint16_t test_alias = 0;         // esp_mqtt5_client_set_publish_property() 设置，下一次发送使用。
+
+/**
+ * @brief 服务器替身的往返时间，微秒。
+ */
+static _Atomic uint32_t test_rtt_us = ATOMIC_VAR_INIT(TEST_RTT_CAL_US);
+
+/**
+ * @brief 服务器和事件任务的状态，test_mutex 保护。
+ */
+static pthread_mutex_t test_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t test_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t test_rx_count = 0;      // 服务器本轮收到的条数。
+static uint32_t test_rx_expect = 0;     // 服务器期望的下一条记录编号。
+static uint64_t test_rx_last_us = 0;    // 服务器收完最后一条的时间。
+static uint32_t test_acks = 0;          // 客户端收到的 PUBACK 数。
+static int test_last_ack_id = 0;        // 事件回调处理完的最后一个 PUBACK。
+static uint32_t test_kicks = 0;         // app_drain_kick() 次数。
+static int test_commit_req = 0;         // app_drain_request_commit() 请求提交。
+
+/**
+ * @brief 服务器替身的 PUBACK 队列，按到期时间排列。
+ */
+#define TEST_ACKQ_SIZE              1024
+
+typedef struct {
+    uint16_t msg_id;
+    uint64_t due_us;
+} test_ack_t;
+
+static test_ack_t test_ackq[TEST_ACKQ_SIZE];
+static int test_ackq_head = 0;
+static int test_ackq_count = 0;
+static pthread_cond_t test_ackq_cond = PTHREAD_COND_INITIALIZER;
+
+static uint64_t test_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void test_sleep_until(uint64_t us) {
+    uint64_t now = test_now_us();
+    if (us > now) {
+        usleep(us - now);
+    }
+}
+
+static int test_read_full(int fd, void* buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(fd, (uint8_t*)buf + got, len - got, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        got += n;
+    }
+    return 0;
+}
+
+static void test_write_full(int fd, const void* buf, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(fd, (const uint8_t*)buf + sent, len - sent, MSG_NOSIGNAL);
+        TEST_ASSERT(n > 0);
+        sent += n;
+    }
+}
+
+/**
+ * @brief esp-mqtt 替身：编码 MQTT 5 PUBLISH 直接写入连接，QOS = 1 时分配消息 ID。
+ */
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char* topic, const char* data, int len, int qos, int retain) {
+    (void)client;
+    uint8_t buf[1280];
+    int topic_len = strlen(topic);
+    TEST_ASSERT(topic_len + len < 1200);
+    pthread_mutex_lock(&test_send_mutex);
+    int msg_id = 0;
+    if (qos > 0) {
+        if (++test_msg_id == 0) {
+            test_msg_id = 1;
+        }
+        msg_id = test_msg_id;
+    }
+    int prop_len = test_alias != 0 ? 3 : 0;
+    int rem = 2 + topic_len + (qos > 0 ? 2 : 0) + 1 + prop_len + len;
+    int n = 0;
+    buf[n++] = 0x30 | (qos << 1) | (retain ? 1 : 0);
+    do {
+        uint8_t b = rem % 128;
+        rem /= 128;
+        buf[n++] = b | (rem > 0 ? 0x80 : 0);
+    } while (rem > 0);
+    buf[n++] = topic_len >> 8;
+    buf[n++] = topic_len;
+    memcpy(buf + n, topic, topic_len);
+    n += topic_len;
+    if (qos > 0) {
+        buf[n++] = msg_id >> 8;
+        buf[n++] = msg_id;
+    }
+    buf[n++] = prop_len;
+    if (test_alias != 0) {
+        buf[n++] = 0x23;// 主题别名。
+        buf[n++] = test_alias >> 8;
+        buf[n++] = test_alias;
+        test_alias = 0;
+    }
+    memcpy(buf + n, data, len);
+    n += len;
+    test_write_full(test_cli_fd, buf, n);
+    pthread_mutex_unlock(&test_send_mutex);
+    return msg_id;
+}
+
+esp_err_t esp_mqtt5_client_set_publish_property(esp_mqtt_client_handle_t client, const esp_mqtt5_publish_property_config_t* property) {
+    (void)client;
+    test_alias = property->topic_alias;
+    return ESP_OK;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char* topic, int qos) {
+    return 0;
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t* config) {
+    return NULL;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event, esp_event_handler_t event_handler, void* event_handler_arg) {
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client) {
+    return ESP_OK;
+}
+
+/**
+ * @brief 转存队列不创建，app_mqtt_init() 不调用。
+ */
+RingbufHandle_t xRingbufferCreateStatic(size_t size, RingbufferType_t type, uint8_t* storage, StaticRingbuffer_t* buffer) {
+    return NULL;
+}
+
+void* xRingbufferReceive(RingbufHandle_t ringbuf, size_t* size, TickType_t wait) {
+    return NULL;
+}
+
+/**
+ * @brief 其它模块的替身。推送任务的通知记录下来，由测试程序的推送循环等待。
+ */
+_Atomic int app_modem_net_conn = ATOMIC_VAR_INIT(1);
+app_main_data_t app_main_data = { .dev_addr = "A0B1C2D3E4F5" };
+
+void app_broker_on_connected(void) {
+}
+
+void app_broker_on_before_connect(esp_mqtt_client_handle_t client) {
+}
+
+const char* app_broker_get_uri(void) {
+    return "";
+}
+
+esp_err_t app_broker_init(esp_mqtt_client_handle_t client) {
+    return ESP_OK;
+}
+
+int app_outbox_spill_alias_only(void) {
+    return 0;
+}
+
+void app_outbox_set_spill_cb(app_outbox_spill_cb_t cb) {
+}
+
+void app_rtt_add(uint32_t ms) {
+}
+
+void app_sd_write_cache_file(char* json) {
+    TEST_ASSERT_MSG(false, "%s", "连接一直正常，不应该转存");
+}
+
+void app_ctrl_on_cmd(const char* data, int len) {
+}
+
+void app_retain_add(const char* path, uint32_t t0, bool uploaded) {
+}
+
+uint32_t app_json_get_time(const char* json) {
+    return 0;
+}
+
+void app_drain_notify_connected(void) {
+}
+
+void app_drain_notify_disconnected(void) {
+}
+
+void app_drain_request_spill(void) {
+}
+
+void app_drain_kick(void) {
+    pthread_mutex_lock(&test_mutex);
+    test_kicks++;
+    pthread_cond_broadcast(&test_cond);
+    pthread_mutex_unlock(&test_mutex);
+}
+
+void app_drain_request_commit(void) {
+    pthread_mutex_lock(&test_mutex);
+    test_commit_req = 1;
+    test_kicks++;
+    pthread_cond_broadcast(&test_cond);
+    pthread_mutex_unlock(&test_mutex);
+}
+
+/**
+ * @brief 服务器替身接收：逐条按上行带宽计时，检查记录顺序，QOS = 1 时安排 PUBACK。
+ */
+static void* test_broker_rx_task(void* arg) {
+    static uint8_t buf[2048];
+    uint64_t link_free = 0;
+    uint8_t head;
+    while (test_read_full(test_srv_fd, &head, 1) == 0) {
+        uint32_t rem = 0;
+        uint32_t mul = 1;
+        int head_len = 1;
+        uint8_t b;
+        do {
+            TEST_ASSERT(test_read_full(test_srv_fd, &b, 1) == 0);
+            rem += (b & 0x7F) * mul;
+            mul *= 128;
+            head_len++;
+        } while (b & 0x80);
+        TEST_ASSERT(rem < sizeof(buf) && test_read_full(test_srv_fd, buf, rem) == 0);
+        buf[rem] = '\0';
+        TEST_ASSERT_MSG((head >> 4) == 3, "报文类型 %d", head >> 4);
+
+        uint64_t now = test_now_us();// 上行链路逐条传输，前一条传完才开始下一条。
+        link_free = (now > link_free ? now : link_free) + (uint64_t)(head_len + rem) * 1000000 / TEST_UPLINK_BPS;
+        test_sleep_until(link_free);
+
+        int qos = (head >> 1) & 3;
+        int topic_len = buf[0] << 8 | buf[1];
+        int p = 2 + topic_len;
+        uint16_t msg_id = 0;
+        if (qos > 0) {
+            msg_id = buf[p] << 8 | buf[p + 1];
+            p += 2;
+        }
+        int prop_len = buf[p++];
+        TEST_ASSERT_MSG(topic_len > 0 || (prop_len == 3 && buf[p] == 0x23), "%s", "只有别名的消息没有别名属性");
+        p += prop_len;
+        unsigned id;
+        TEST_ASSERT(sscanf((const char*)buf + p, "{\"id\":%u,", &id) == 1);
+
+        pthread_mutex_lock(&test_mutex);
+        TEST_ASSERT_MSG(id == test_rx_expect, "服务器收到记录 %u，期望 %u", id, test_rx_expect);
+        test_rx_expect++;
+        test_rx_count++;
+        test_rx_last_us = link_free;
+        pthread_cond_broadcast(&test_cond);
+        if (qos == 1) {
+            TEST_ASSERT(test_ackq_count < TEST_ACKQ_SIZE);
+            test_ackq[(test_ackq_head + test_ackq_count) % TEST_ACKQ_SIZE] = (test_ack_t){
+                .msg_id = msg_id,
+                .due_us = link_free + atomic_load(&test_rtt_us),
+            };
+            test_ackq_count++;
+            pthread_cond_signal(&test_ackq_cond);
+        }
+        pthread_mutex_unlock(&test_mutex);
+    }
+    return NULL;
+}
+
+/**
+ * @brief 服务器替身发送 PUBACK，到期才发。
+ */
+static void* test_broker_ack_task(void* arg) {
+    while (1) {
+        pthread_mutex_lock(&test_mutex);
+        while (test_ackq_count == 0) {
+            pthread_cond_wait(&test_ackq_cond, &test_mutex);
+        }
+        test_ack_t ack = test_ackq[test_ackq_head];
+        pthread_mutex_unlock(&test_mutex);
+
+        test_sleep_until(ack.due_us);
+        uint8_t puback[4] = { 0x40, 2, ack.msg_id >> 8, ack.msg_id };
+        test_write_full(test_srv_fd, puback, sizeof(puback));
+
+        pthread_mutex_lock(&test_mutex);
+        test_ackq_head = (test_ackq_head + 1) % TEST_ACKQ_SIZE;
+        test_ackq_count--;
+        pthread_mutex_unlock(&test_mutex);
+    }
+    return NULL;
+}
+
+/**
+ * @brief esp-mqtt 事件任务替身：收到 PUBACK 调用 app_mqtt.c 的事件回调。
+ */
+static void* test_client_rx_task(void* arg) {
+    uint8_t pkt[4];
+    while (test_read_full(test_cli_fd, pkt, sizeof(pkt)) == 0) {
+        TEST_ASSERT(pkt[0] == 0x40 && pkt[1] == 2);
+        esp_mqtt_event_t event = {
+            .event_id = MQTT_EVENT_PUBLISHED,
+            .msg_id = pkt[2] << 8 | pkt[3],
+        };
+        pthread_mutex_lock(&test_mutex);
+        test_acks++;
+        pthread_mutex_unlock(&test_mutex);
+        app_mqtt_event_handler(NULL, "MQTT_EVENTS", MQTT_EVENT_PUBLISHED, &event);
+        pthread_mutex_lock(&test_mutex);
+        test_last_ack_id = event.msg_id;
+        pthread_cond_broadcast(&test_cond);
+        pthread_mutex_unlock(&test_mutex);
+    }
+    return NULL;
+}
+
+/**
+ * @brief 建立连接，启动服务器替身和事件任务，app_mqtt.c 进入已连接状态。
+ */
+static void test_connect(void) {
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    TEST_ASSERT(listen_fd >= 0 && bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 && listen(listen_fd, 1) == 0);
+    TEST_ASSERT(getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len) == 0);
+    test_cli_fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(connect(test_cli_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    test_srv_fd = accept(listen_fd, NULL, NULL);
+    TEST_ASSERT(test_srv_fd >= 0);
+    close(listen_fd);
+    int one = 1;
+    setsockopt(test_cli_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(test_srv_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    pthread_t thread;
+    TEST_ASSERT(pthread_create(&thread, NULL, test_broker_rx_task, NULL) == 0);
+    TEST_ASSERT(pthread_create(&thread, NULL, test_broker_ack_task, NULL) == 0);
+    TEST_ASSERT(pthread_create(&thread, NULL, test_client_rx_task, NULL) == 0);
+
+    app_mqtt_init_status = 1;
+    atomic_store(&app_mqtt_connected, 1);
+    app_cache_pos_t commit_pos;
+    app_cache_get_commit(&commit_pos);// 和 app_mqtt_init() 相同，从已提交位置开始推送缓存。
+    pthread_mutex_lock(&app_mqtt_inflight_mutex);
+    app_mqtt_backlog_acked_pos = commit_pos;
+    app_mqtt_backlog_reset();
+    pthread_mutex_unlock(&app_mqtt_inflight_mutex);
+}
+
+/**
+ * @brief 写入一轮记录，编号从 first 开始，和实时消息一样带缓存标记。
+ */
+static void test_append_records(uint32_t first, int n) {
+    char rec[TEST_RECORD_LEN + 1];
+    for (int i = 0; i < n; i++) {
+        int len = snprintf(rec, sizeof(rec), "{\"id\":%u,\"pad\":\"", first + i);
+        memset(rec + len, 'a' + i % 26, TEST_RECORD_LEN - len - 8);
+        memcpy(rec + TEST_RECORD_LEN - 8, "\",\"f\":1}", 8);
+        TEST_ASSERT_EQUAL(0, app_cache_append(rec, TEST_RECORD_LEN, 1700000000 + first + i));
+    }
+    app_cache_flush();
+}
+
+static void test_rx_reset(uint32_t first) {
+    pthread_mutex_lock(&test_mutex);
+    test_rx_count = 0;
+    test_rx_expect = first;
+    pthread_mutex_unlock(&test_mutex);
+}
+
+/**
+ * @brief QOS = 0 逐条发送，从提交位置读取，不提交。
+ * @return 每秒条数，到服务器收完最后一条为止。
+ */
+static double test_run_qos0(uint32_t first, int n) {
+    test_rx_reset(first);
+    app_cache_pos_t pos;
+    app_cache_get_commit(&pos);
+    char line[1024];
+    uint64_t t0 = test_now_us();
+    for (int i = 0; i < n; i++) {
+        int len = app_cache_read(&pos, line, sizeof(line));
+        TEST_ASSERT(len > 0);
+        TEST_ASSERT_EQUAL(0, app_mqtt_publish_topic(&app_mqtt_topic_msg, line, len, 0));
+    }
+    pthread_mutex_lock(&test_mutex);
+    while (test_rx_count < (uint32_t)n) {
+        pthread_cond_wait(&test_cond, &test_mutex);
+    }
+    uint64_t t1 = test_rx_last_us;
+    pthread_mutex_unlock(&test_mutex);
+    return n * 1e6 / (t1 - t0);
+}
+
+/**
+ * @brief QOS = 1 逐条等待 PUBACK，从提交位置读取，不提交。
+ * @return 每秒条数，到收到最后一个 PUBACK 为止。
+ */
+static double test_run_stop_and_wait(uint32_t first, int n) {
+    test_rx_reset(first);
+    app_cache_pos_t pos;
+    app_cache_get_commit(&pos);
+    char line[1024];
+    uint64_t t0 = test_now_us();
+    for (int i = 0; i < n; i++) {
+        int len = app_cache_read(&pos, line, sizeof(line));
+        TEST_ASSERT(len > 0);
+        int msg_id = app_mqtt_publish_topic(&app_mqtt_topic_msg, line, len, 1);
+        TEST_ASSERT(msg_id > 0);
+        pthread_mutex_lock(&test_mutex);
+        while (test_last_ack_id != msg_id) {
+            pthread_cond_wait(&test_cond, &test_mutex);
+        }
+        pthread_mutex_unlock(&test_mutex);
+    }
+    return n * 1e6 / (test_now_us() - t0);
+}
+
+/**
+ * @brief 提交位置之前的记录数不超过收到的 PUBACK 数。
+ */
+static void test_check_commit(const app_cache_pos_t* start, uint32_t acks0) {
+    app_cache_pos_t commit;
+    app_cache_get_commit(&commit);
+    pthread_mutex_lock(&test_mutex);
+    uint32_t acked = test_acks - acks0;
+    pthread_mutex_unlock(&test_mutex);
+    app_cache_pos_t pos = *start;
+    uint32_t count = 0;
+    char line[1024];
+    while (pos.seg != commit.seg || pos.off != commit.off) {
+        TEST_ASSERT_MSG(app_cache_read(&pos, line, sizeof(line)) > 0, "提交位置 %08X/%u 不在记录边界上", commit.seg, commit.off);
+        count++;
+    }
+    TEST_ASSERT_MSG(count <= acked, "提交了 %u 条，只收到 %u 个 PUBACK", count, acked);
+}
+
+/**
+ * @brief QOS = 1 在途窗口，和缓存推送任务全速推送时相同：先提交，再填满窗口，窗口满了等待 PUBACK 唤醒。
+ * @return 每秒条数，到最后一条确认并提交为止。
+ */
+static double test_run_window(uint32_t first, int n) {
+    test_rx_reset(first);
+    app_cache_pos_t start;
+    app_cache_get_commit(&start);
+    pthread_mutex_lock(&test_mutex);
+    uint32_t acks0 = test_acks;
+    pthread_mutex_unlock(&test_mutex);
+    int commits = 0;
+    uint64_t t0 = test_now_us();
+    while (1) {
+        pthread_mutex_lock(&test_mutex);
+        uint32_t kicks = test_kicks;
+        int commit = test_commit_req;
+        test_commit_req = 0;
+        pthread_mutex_unlock(&test_mutex);
+        if (commit) {
+            app_mqtt_commit_cache();
+            test_check_commit(&start, acks0);
+            commits++;
+        }
+        int count = app_mqtt_pub_cache(INT_MAX);
+        TEST_ASSERT(count >= 0);
+        if (count == 0 && app_mqtt_cache_inflight() == 0) {
+            break;
+        }
+        if (count == 0) {// 窗口已满。
+            pthread_mutex_lock(&test_mutex);
+            while (test_kicks == kicks) {
+                pthread_cond_wait(&test_cond, &test_mutex);
+            }
+            pthread_mutex_unlock(&test_mutex);
+        }
+    }
+    app_mqtt_commit_cache();// 最后一个 PUBACK 请求的提交。
+    test_check_commit(&start, acks0);
+    uint64_t t1 = test_now_us();
+    TEST_ASSERT_EQUAL(n, test_rx_count);
+    TEST_ASSERT_EQUAL(0, app_cache_remaining());
+    TEST_ASSERT(commits >= n / APP_MQTT_COMMIT_BATCH);
+    return n * 1e6 / (t1 - t0);
+}
+
+/**
+ * @brief 三种方式的吞吐量，往返时间从校准值到 100 毫秒。
+ */
+static void test_mqtt_throughput(void) {
+    host_test_reset_dir(APP_SD_CACHE_DIR);
+    TEST_ASSERT(app_cache_init() == ESP_OK);
+    test_connect();
+    const uint32_t rtts[] = { TEST_RTT_CAL_US, 50000, 100000 };
+    uint32_t first = 1;
+    double qos0 = 0;
+    for (size_t r = 0; r < sizeof(rtts) / sizeof(rtts[0]); r++) {
+        atomic_store(&test_rtt_us, rtts[r]);
+        test_append_records(first, TEST_RECORDS);
+        if (r == 0) {// 和往返时间无关。
+            qos0 = test_run_qos0(first, TEST_RECORDS);
+        }
+        double sw = test_run_stop_and_wait(first, r == 0 ? TEST_RECORDS : TEST_SW_RECORDS);
+        double win = test_run_window(first, TEST_RECORDS);
+        printf("往返 %5.1f 毫秒：QOS = 0 逐条 %4.0f 条/秒，QOS = 1 逐条等待 %4.0f 条/秒，QOS = 1 窗口 %d 条 %4.0f 条/秒；"
+            "1000 条分别 %4.1f、%4.1f、%4.1f 秒\n", rtts[r] / 1000.0, qos0, sw, APP_MQTT_INFLIGHT_WINDOW, win,
+            1000 / qos0, 1000 / sw, 1000 / win);
+        if (r == 0) {// 窗口覆盖往返时间，接近 QOS = 0。
+            TEST_ASSERT_MSG(win >= qos0 * 0.8, "窗口 %.0f 条/秒，QOS = 0 %.0f 条/秒", win, qos0);
+            TEST_ASSERT_MSG(win >= sw * 2, "窗口 %.0f 条/秒，逐条等待 %.0f 条/秒", win, sw);
+        }
+        first += TEST_RECORDS;
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_mqtt_throughput);
+    return 0;
+}
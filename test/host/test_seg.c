@@ -0,0 +1,333 @@
+/**
+ * @brief   段文件、元数据文件主机测试：掉电时写了一半的数据，恢复以后只保留完整的记录。
+ *          按 FATFS 的写入顺序模拟掉电：先按偏移顺序写数据扇区，最后写段头所在的扇区，在每一个字节处截断。
+ *          截断处之后的字节是写入之前的内容（预分配的 0），或者随机的垃圾数据。
+ *          恢复以后检查写入位置、逐条读出的记录，再追加一条记录，确认可以继续写入。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "host_test.h"
+#include "app_sd.h"
+#include "app_seg.h"
+#include "app_meta.h"
+
+#define TEST_SEG_PATH               SDMMC_MOUNT_POINT"/TEST.SEG"
+#define TEST_META_PATH              SDMMC_MOUNT_POINT"/TEST.DAT"
+
+ /**
+ * @brief 记录条数上限。
+ */
+#define TEST_REC_MAX                256
+
+/**
+ * @brief 写入的记录和结束偏移。
+ */
+typedef struct {
+    int count;
+    uint32_t end[TEST_REC_MAX];
+    char data[TEST_REC_MAX][APP_SEG_REC_MAX];
+    int len[TEST_REC_MAX];
+} test_recs_t;
+
+static test_recs_t test_recs;
+
+/**
+ * @brief 文件镜像。
+ */
+typedef struct {
+    uint8_t* data;
+    size_t size;
+} test_image_t;
+
+static void test_image_read(const char* path, test_image_t* image) {
+    FILE* file = fopen(path, "rb");
+    TEST_ASSERT(file != NULL);
+    fseek(file, 0, SEEK_END);
+    image->size = ftell(file);
+    image->data = malloc(image->size);
+    fseek(file, 0, SEEK_SET);
+    TEST_ASSERT(fread(image->data, 1, image->size, file) == image->size);
+    fclose(file);
+}
+
+static void test_image_write(const char* path, const uint8_t* data, size_t size) {
+    FILE* file = fopen(path, "wb");
+    TEST_ASSERT(file != NULL);
+    TEST_ASSERT(fwrite(data, 1, size, file) == size);
+    fclose(file);
+}
+
+/**
+ * @brief 生成一条记录，长度 1 到 300，内容由编号决定。
+ */
+static void test_rec_make(int i) {
+    int len = 1 + (i * 37) % 300;
+    for (int k = 0; k < len; k++) {
+        test_recs.data[i][k] = 'A' + (i + k) % 26;
+    }
+    test_recs.len[i] = len;
+}
+
+/**
+ * @brief 追加记录，直到写入位置达到 until。
+ */
+static void test_append_until(app_seg_writer_t* writer, uint32_t until) {
+    while (writer->fill < until) {
+        int i = test_recs.count;
+        TEST_ASSERT(i < TEST_REC_MAX);
+        test_rec_make(i);
+        TEST_ASSERT_EQUAL(0, app_seg_append(writer, test_recs.data[i], test_recs.len[i], 1700000000 + i));
+        test_recs.end[i] = writer->fill;
+        test_recs.count++;
+    }
+}
+
+/**
+ * @brief 截断处 written 之前写完的记录条数。
+ */
+static int test_complete(uint32_t written) {
+    int n = 0;
+    while (n < test_recs.count && test_recs.end[n] <= written) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief 恢复写入位置，检查：写入位置是第 n 条记录的末尾，逐条读出前 n 条记录，追加一条记录以后可以读出。
+ */
+static void test_check_recovery(int n, const char* what, uint32_t cut) {
+    uint32_t expected = n == 0 ? APP_SEG_HDR_SIZE : test_recs.end[n - 1];
+    app_seg_writer_t writer;
+    TEST_ASSERT_EQUAL(0, app_seg_open(&writer, TEST_SEG_PATH, 0, 0, NULL, 0));
+    TEST_ASSERT_MSG(writer.fill == expected, "%s，截断 %u，写入位置 %u，期望 %u", what, cut, writer.fill, expected);
+    const char marker[] = "marker";
+    TEST_ASSERT_EQUAL(0, app_seg_append(&writer, marker, sizeof(marker) - 1, 1));
+    app_seg_close(&writer, false);
+
+    FILE* file = fopen(TEST_SEG_PATH, "rb");
+    TEST_ASSERT(file != NULL);
+    uint32_t start;
+    uint32_t fill;
+    TEST_ASSERT_EQUAL(0, app_seg_range(file, &start, &fill));
+    TEST_ASSERT_EQUAL(APP_SEG_HDR_SIZE, start);
+    TEST_ASSERT_MSG(fill == expected + APP_SEG_REC_HDR_SIZE + sizeof(marker) - 1, "%s，截断 %u，数据范围 %u", what, cut, fill);
+    char buf[APP_SEG_REC_MAX + 1];
+    uint32_t off = start;
+    for (int i = 0; i <= n; i++) {
+        uint32_t next = off;
+        int len = app_seg_read(file, off, fill, buf, sizeof(buf), &next);
+        if (i < n) {
+            TEST_ASSERT_MSG(len == test_recs.len[i] && memcmp(buf, test_recs.data[i], len) == 0, "%s，截断 %u，记录 %d", what, cut, i);
+        } else {
+            TEST_ASSERT_MSG(len == sizeof(marker) - 1 && strcmp(buf, marker) == 0, "%s，截断 %u，追加的记录", what, cut);
+        }
+        off = next;
+    }
+    uint32_t next = off;
+    TEST_ASSERT_EQUAL(0, app_seg_read(file, off, fill, buf, sizeof(buf), &next));
+    fclose(file);
+}
+
+/**
+ * @brief 写到一半的记录：段头停在 APP_SEG_HDR_SIZE，记录在每一个字节处截断，后面是 0 或者垃圾数据。
+ */
+static void test_seg_torn_record(void) {
+    host_test_reset_dir(SDMMC_MOUNT_POINT);
+    memset(&test_recs, 0, sizeof(test_recs));
+    app_seg_writer_t writer;
+    TEST_ASSERT_EQUAL(0, app_seg_open(&writer, TEST_SEG_PATH, 0, 8 * 1024, NULL, 0));
+    test_image_t base;
+    test_image_read(TEST_SEG_PATH, &base);
+    test_append_until(&writer, 4 * 1024);
+    fflush(writer.file);// 不更新段头，直接关闭，相当于最后一次 fsync 在创建时。
+    fclose(writer.file);
+    test_image_t full;
+    test_image_read(TEST_SEG_PATH, &full);
+    TEST_ASSERT_EQUAL(base.size, full.size);
+
+    uint8_t* image = malloc(full.size);
+    uint32_t end = test_recs.end[test_recs.count - 1];
+    srand(38);
+    for (int garbage = 0; garbage < 2; garbage++) {
+        for (uint32_t cut = APP_SEG_HDR_SIZE; cut <= end; cut++) {
+            memcpy(image, full.data, cut);
+            memcpy(image + cut, base.data + cut, full.size - cut);
+            if (garbage) {// 扇区中没写完的部分是旧数据，不一定是 0。
+                uint32_t sector_end = (cut + 511) / 512 * 512;
+                for (uint32_t k = cut; k < sector_end; k++) {
+                    image[k] = rand();
+                }
+            }
+            test_image_write(TEST_SEG_PATH, image, full.size);
+            test_check_recovery(test_complete(cut), garbage ? "垃圾数据" : "预分配的 0", cut);
+        }
+    }
+    printf("记录 %d 条，截断点 %u 个\n", test_recs.count, 2 * (end - APP_SEG_HDR_SIZE + 1));
+    free(image);
+    free(base.data);
+    free(full.data);
+}
+
+/**
+ * @brief 更新段头时掉电：before 是上次 fsync 以后的镜像，after 是这次 fsync 以后的镜像。
+ *        先写数据扇区，最后写段头扇区。段头扇区和最后一条最长记录范围内每一个改变的字节处截断，更早的数据间隔截断。
+ */
+static void test_seg_cut_sync(const test_image_t* before, const test_image_t* after, int before_count, const char* what) {
+    TEST_ASSERT_EQUAL(before->size, after->size);
+    uint32_t* order = malloc(after->size * sizeof(uint32_t));
+    uint32_t changed = 0;
+    for (uint32_t i = APP_SEG_HDR_SIZE; i < after->size; i++) {
+        if (before->data[i] != after->data[i]) {
+            order[changed++] = i;
+        }
+    }
+    uint32_t data_changed = changed;
+    for (uint32_t i = 0; i < APP_SEG_HDR_SIZE; i++) {
+        if (before->data[i] != after->data[i]) {
+            order[changed++] = i;
+        }
+    }
+    TEST_ASSERT(data_changed > 0 && changed > data_changed);
+    uint8_t* image = malloc(after->size);
+    memcpy(image, before->data, after->size);
+    for (uint32_t k = 0; k <= changed; k++) {
+        if (k > 0) {
+            image[order[k - 1]] = after->data[order[k - 1]];
+        }
+        if (k + APP_SEG_REC_MAX < data_changed && k % 61 != 0) {// 逐字节截断由 test_seg_torn_record 覆盖，这里只密集测试段头前后。
+            continue;
+        }
+        test_image_write(TEST_SEG_PATH, image, after->size);
+        uint32_t written = k >= data_changed ? UINT32_MAX : order[k];// 数据按偏移顺序写到这里。
+        int n = test_complete(written);
+        TEST_ASSERT(n >= before_count);
+        test_check_recovery(n, what, k);
+    }
+    free(order);
+    free(image);
+}
+
+/**
+ * @brief 更新段头时掉电：fsync 时写入位置超过 APP_SEG_HDR_SYNC 更新段头；段写满封闭时更新段头。
+ */
+static void test_seg_cut_header(void) {
+    host_test_reset_dir(SDMMC_MOUNT_POINT);
+    memset(&test_recs, 0, sizeof(test_recs));
+    app_seg_writer_t writer;
+    TEST_ASSERT_EQUAL(0, app_seg_open(&writer, TEST_SEG_PATH, 0, 40 * 1024, NULL, 0));
+    test_append_until(&writer, 12 * 1024);
+    app_seg_sync(&writer);
+    TEST_ASSERT_EQUAL(APP_SEG_HDR_SIZE, writer.hdr_fill);// 还没有更新段头。
+    test_image_t before;
+    test_image_read(TEST_SEG_PATH, &before);
+    int before_count = test_recs.count;
+    test_append_until(&writer, 20 * 1024);
+    app_seg_sync(&writer);
+    TEST_ASSERT_EQUAL(writer.fill, writer.hdr_fill);// 更新了段头。
+    test_image_t after;
+    test_image_read(TEST_SEG_PATH, &after);
+    fclose(writer.file);
+    test_seg_cut_sync(&before, &after, before_count, "更新段头");
+
+    test_image_write(TEST_SEG_PATH, after.data, after.size);
+    test_recs.count = test_complete(after.size);
+    TEST_ASSERT_EQUAL(0, app_seg_open(&writer, TEST_SEG_PATH, 0, 0, NULL, 0));
+    TEST_ASSERT_EQUAL(test_recs.end[test_recs.count - 1], writer.fill);
+    before_count = test_recs.count;
+    test_append_until(&writer, 40 * 1024 - APP_SEG_REC_MAX);
+    app_seg_close(&writer, true);
+    test_image_t sealed;
+    test_image_read(TEST_SEG_PATH, &sealed);
+    test_seg_cut_sync(&after, &sealed, before_count, "封闭");
+    printf("记录 %d 条\n", test_recs.count);
+    free(before.data);
+    free(after.data);
+    free(sealed.data);
+}
+
+/**
+ * @brief 没有段头的文件（旧版本的文本段）：不能打开写入，也不读取其中的数据。
+ */
+static void test_seg_no_header(void) {
+    host_test_reset_dir(SDMMC_MOUNT_POINT);
+    const char text[] = "{\"t\":1,\"f\":1}\n{\"t\":2,\"f\":1}\n";
+    test_image_write(TEST_SEG_PATH, (const uint8_t*)text, sizeof(text) - 1);
+    app_seg_writer_t writer;
+    TEST_ASSERT_EQUAL(APP_SEG_INVALID, app_seg_open(&writer, TEST_SEG_PATH, 0, 0, NULL, 0));
+    FILE* file = fopen(TEST_SEG_PATH, "rb");
+    TEST_ASSERT(file != NULL);
+    uint32_t start;
+    uint32_t fill;
+    TEST_ASSERT_EQUAL(-1, app_seg_range(file, &start, &fill));
+    fclose(file);
+}
+
+/**
+ * @brief 元数据文件写到一半时掉电：读出的是上一次或者这一次保存的内容，不会是混合的。
+ */
+static void test_meta_torn(void) {
+    host_test_reset_dir(SDMMC_MOUNT_POINT);
+    uint32_t value[4];
+    app_meta_t meta = {
+        .path = TEST_META_PATH,
+        .size = sizeof(value),
+    };
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, app_meta_load(&meta, value));
+    uint32_t cut_count = 0;
+    for (uint32_t seq = 1; seq <= 6; seq++) {
+        test_image_t before = { 0 };
+        if (seq > 1) {
+            test_image_read(TEST_META_PATH, &before);
+        }
+        for (int i = 0; i < 4; i++) {
+            value[i] = seq * 0x01010101UL + i;
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, app_meta_save(&meta, value));
+        app_meta_close(&meta);
+        test_image_t after;
+        test_image_read(TEST_META_PATH, &after);
+        if (seq > 1) {
+            uint8_t* image = malloc(after.size);
+            memcpy(image, before.data, before.size);
+            memset(image + before.size, 0, after.size - before.size);
+            for (uint32_t cut = 0; cut <= after.size; cut++) {
+                if (cut > 0) {
+                    image[cut - 1] = after.data[cut - 1];
+                }
+                test_image_write(TEST_META_PATH, image, after.size);
+                uint32_t loaded[4];
+                TEST_ASSERT_EQUAL(ESP_OK, app_meta_load(&meta, loaded));
+                app_meta_close(&meta);
+                uint32_t expected = memcmp(image, after.data, after.size) == 0 ? seq : seq - 1;
+                for (int i = 0; i < 4; i++) {
+                    TEST_ASSERT_MSG(loaded[i] == expected * 0x01010101UL + i, "序号 %u，截断 %u", seq, cut);
+                }
+                TEST_ASSERT_EQUAL(expected, meta.seq);
+                cut_count++;
+            }
+            free(image);
+            test_image_write(TEST_META_PATH, after.data, after.size);
+            TEST_ASSERT_EQUAL(ESP_OK, app_meta_load(&meta, value));
+        }
+        free(before.data);
+        free(after.data);
+    }
+    printf("截断点 %u 个\n", cut_count);
+}
+
+int main(void) {
+    RUN_TEST(test_seg_torn_record);
+    RUN_TEST(test_seg_cut_header);
+    RUN_TEST(test_seg_no_header);
+    RUN_TEST(test_meta_torn);
+    return 0;
+}
@@ -0,0 +1,727 @@
+/**
+ * @brief   TLS 会话缓存主机测试：直接包含 app_tls.c，mbedtls 用替身，握手是约定的明文报文，不做加密。
+ *          本机 TCP 服务器替身按会话票据决定完整握手还是会话恢复，完整握手时发送两级证书链，app_tls.c 的校验回调被调用。
+ *          1. 完整握手以后保存会话，会话恢复没有新票据时不写 NVS，有新票据时写入，重启以后用新票据恢复；
+ *          2. 服务器作废票据时退回完整握手，统计的完整握手和会话恢复次数和服务器一致；
+ *          3. 会话缓存按服务器地址和端口分开，没有空闲时轮换，NVS 中每个序号保存对应的服务器；
+ *          4. NVS 中的会话格式不对时丢弃，完整握手；
+ *          5. 握手失败时计数，会话作废，下次完整握手。
+ *
+ * @author  nyx
+ * @date    2026-10-18
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <poll.h>
+
+#include "host_test.h"
+
+#include "app_tls.c"
+
+ /**
+ * @brief 服务器替身个数，比会话缓存多一个，检查轮换。
+ */
+#define TEST_SERVERS                3
+
+ /**
+ * @brief 完整握手时发送的证书链长度和级数。
+ */
+#define TEST_CERT_LEN               1500
+#define TEST_CERT_DEPTH             2
+
+ /**
+ * @brief 替身的会话格式版本，加载时不同则失败，相当于固件升级以后 mbedtls 格式变化。
+ */
+#define TEST_SESSION_FORMAT         0x30050000
+
+#define TEST_HOST                   "127.0.0.1"
+
+/**
+ * @brief 握手报文：客户端问候带上要恢复的会话票据，服务器回复握手方式和新票据。
+ */
+typedef struct {
+    char magic[4];
+    uint32_t ticket;
+    char host[64];
+} test_hello_t;
+
+typedef struct {
+    char mode;                  // F 完整握手，R 会话恢复，X 拒绝。
+    uint8_t depth;              // 证书链级数。
+    uint16_t unused;
+    uint32_t ticket;            // 新的会话票据，0 没有。
+    uint32_t cert_len;          // 后面的证书链字节数。
+} test_reply_t;
+
+/**
+ * @brief 服务器替身。每个服务器只承认最新发出的票据。
+ */
+typedef struct {
+    int listen_fd;
+    int port;
+    uint32_t ticket;            // 有效的票据，0 没有。
+    int rotate;                 // 会话恢复时发出新票据，旧票据作废。
+    int reject;                 // 拒绝握手。
+    uint32_t full;
+    uint32_t resumed;
+} test_server_t;
+
+static test_server_t test_servers[TEST_SERVERS];
+static pthread_mutex_t test_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t test_next_ticket = 0x1000;
+
+/**
+ * @brief 校验回调的调用次数，包括 app_tls_verify()。
+ */
+static int test_verify_calls = 0;
+
+/**
+ * @brief CA 证书，固件中由 EMBED_TXTFILES 生成这两个符号。
+ */
+__asm__(".section .rodata\n"
+    ".global _binary_mqtt_ca_pem_start\n"
+    "_binary_mqtt_ca_pem_start:\n"
+    ".ascii \"-----BEGIN CERTIFICATE-----\\nTEST\\n-----END CERTIFICATE-----\\n\"\n"
+    ".global _binary_mqtt_ca_pem_end\n"
+    "_binary_mqtt_ca_pem_end:\n"
+    ".previous\n");
+
+/**
+ * @brief esp_transport 替身，MQTT 客户端通过这些函数指针调用传输层。
+ */
+struct esp_transport_item_t {
+    connect_func connect;
+    io_read_func read;
+    io_func write;
+    trans_func close;
+    poll_func poll_read;
+    poll_func poll_write;
+    trans_func destroy;
+    void* data;
+    int port;
+};
+
+esp_transport_handle_t esp_transport_init(void) {
+    return calloc(1, sizeof(struct esp_transport_item_t));
+}
+
+esp_err_t esp_transport_set_func(esp_transport_handle_t t, connect_func _connect, io_read_func _read, io_func _write,
+    trans_func _close, poll_func _poll_read, poll_func _poll_write, trans_func _destroy) {
+    t->connect = _connect;
+    t->read = _read;
+    t->write = _write;
+    t->close = _close;
+    t->poll_read = _poll_read;
+    t->poll_write = _poll_write;
+    t->destroy = _destroy;
+    return ESP_OK;
+}
+
+esp_err_t esp_transport_set_context_data(esp_transport_handle_t t, void* data) {
+    t->data = data;
+    return ESP_OK;
+}
+
+void* esp_transport_get_context_data(esp_transport_handle_t t) {
+    return t->data;
+}
+
+esp_err_t esp_transport_set_default_port(esp_transport_handle_t t, int port) {
+    t->port = port;
+    return ESP_OK;
+}
+
+/**
+ * @brief mbedtls 替身：套接字。
+ */
+void mbedtls_net_init(mbedtls_net_context* ctx) {
+    ctx->fd = -1;
+}
+
+void mbedtls_net_free(mbedtls_net_context* ctx) {
+    if (ctx->fd >= 0) {
+        close(ctx->fd);
+    }
+    ctx->fd = -1;
+}
+
+int mbedtls_net_send(void* ctx, const unsigned char* buf, size_t len) {
+    ssize_t n = send(((mbedtls_net_context*)ctx)->fd, buf, len, MSG_NOSIGNAL);
+    return n < 0 ? MBEDTLS_ERR_NET_SEND_FAILED : (int)n;
+}
+
+int mbedtls_net_recv_timeout(void* ctx, unsigned char* buf, size_t len, uint32_t timeout) {
+    struct pollfd pfd = { .fd = ((mbedtls_net_context*)ctx)->fd, .events = POLLIN };
+    int ret = poll(&pfd, 1, timeout == 0 ? -1 : (int)timeout);
+    if (ret == 0) {
+        return MBEDTLS_ERR_SSL_TIMEOUT;
+    }
+    ssize_t n = recv(pfd.fd, buf, len, 0);
+    return n < 0 ? MBEDTLS_ERR_NET_RECV_FAILED : (int)n;
+}
+
+/**
+ * @brief mbedtls 替身：配置。
+ */
+void mbedtls_ssl_config_init(mbedtls_ssl_config* conf) {
+    memset(conf, 0, sizeof(*conf));
+}
+
+void mbedtls_ssl_config_free(mbedtls_ssl_config* conf) {
+    memset(conf, 0, sizeof(*conf));
+}
+
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* conf, int endpoint, int transport, int preset) {
+    return 0;
+}
+
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config* conf, int authmode) {
+    conf->authmode = authmode;
+}
+
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config* conf, mbedtls_x509_crt* ca_chain, mbedtls_x509_crl* ca_crl) {
+    conf->ca_chain = ca_chain;
+}
+
+static int test_verify(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags);
+
+/**
+ * @brief 校验回调换成 test_verify()，计数以后再调用 app_tls_verify()。
+ */
+void mbedtls_ssl_conf_verify(mbedtls_ssl_config* conf, int (*f_vrfy)(void*, mbedtls_x509_crt*, int, uint32_t*), void* p_vrfy) {
+    TEST_ASSERT(f_vrfy == app_tls_verify);
+    conf->f_vrfy = test_verify;
+    conf->p_vrfy = p_vrfy;
+}
+
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* conf, int (*f_rng)(void*, unsigned char*, size_t), void* p_rng) {
+    conf->f_rng = f_rng;
+    conf->p_rng = p_rng;
+}
+
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config* conf, int use_tickets) {
+    conf->tickets = use_tickets;
+}
+
+void mbedtls_ssl_conf_read_timeout(mbedtls_ssl_config* conf, uint32_t timeout) {
+    conf->read_timeout = timeout;
+}
+
+/**
+ * @brief mbedtls 替身：会话。
+ */
+void mbedtls_ssl_session_init(mbedtls_ssl_session* session) {
+    memset(session, 0, sizeof(*session));
+}
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session* session) {
+    memset(session, 0, sizeof(*session));
+}
+
+int mbedtls_ssl_session_save(const mbedtls_ssl_session* session, unsigned char* buf, size_t buf_len, size_t* olen) {
+    *olen = sizeof(*session);
+    if (buf_len < sizeof(*session)) {
+        return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+    }
+    memcpy(buf, session, sizeof(*session));
+    return 0;
+}
+
+int mbedtls_ssl_session_load(mbedtls_ssl_session* session, const unsigned char* buf, size_t len) {
+    if (len != sizeof(*session)) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    if (((const mbedtls_ssl_session*)buf)->format != TEST_SESSION_FORMAT) {
+        return MBEDTLS_ERR_SSL_VERSION_MISMATCH;
+    }
+    memcpy(session, buf, sizeof(*session));
+    return 0;
+}
+
+/**
+ * @brief mbedtls 替身：连接。
+ */
+void mbedtls_ssl_init(mbedtls_ssl_context* ssl) {
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+void mbedtls_ssl_free(mbedtls_ssl_context* ssl) {
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+int mbedtls_ssl_setup(mbedtls_ssl_context* ssl, const mbedtls_ssl_config* conf) {
+    ssl->conf = conf;
+    return 0;
+}
+
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context* ssl, const char* hostname) {
+    snprintf(ssl->hostname, sizeof(ssl->hostname), "%s", hostname);
+    return 0;
+}
+
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* ssl, void* p_bio, mbedtls_ssl_send_t* f_send, mbedtls_ssl_recv_t* f_recv, mbedtls_ssl_recv_timeout_t* f_recv_timeout) {
+    ssl->p_bio = p_bio;
+    ssl->f_send = f_send;
+    ssl->f_recv_timeout = f_recv_timeout;
+}
+
+int mbedtls_ssl_set_session(mbedtls_ssl_context* ssl, const mbedtls_ssl_session* session) {
+    if (session->format != TEST_SESSION_FORMAT || session->ticket == 0) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    ssl->session = *session;
+    ssl->offer = 1;
+    return 0;
+}
+
+int mbedtls_ssl_get_session(const mbedtls_ssl_context* ssl, mbedtls_ssl_session* session) {
+    if (!ssl->established) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    *session = ssl->session;
+    return 0;
+}
+
+static int test_ssl_send_all(mbedtls_ssl_context* ssl, const void* buf, size_t len) {
+    for (size_t sent = 0; sent < len;) {
+        int ret = ssl->f_send(ssl->p_bio, (const unsigned char*)buf + sent, len - sent);
+        if (ret <= 0) {
+            return ret < 0 ? ret : MBEDTLS_ERR_NET_SEND_FAILED;
+        }
+        sent += ret;
+    }
+    return 0;
+}
+
+static int test_ssl_recv_all(mbedtls_ssl_context* ssl, void* buf, size_t len) {
+    for (size_t got = 0; got < len;) {
+        int ret = ssl->f_recv_timeout(ssl->p_bio, (unsigned char*)buf + got, len - got, ssl->conf->read_timeout);
+        if (ret <= 0) {
+            return ret < 0 ? ret : MBEDTLS_ERR_SSL_CONN_EOF;
+        }
+        got += ret;
+    }
+    return 0;
+}
+
+/**
+ * @brief 握手：发送问候，按服务器的回复完整握手或者恢复会话。完整握手时和 mbedtls 相同，从链的顶端开始逐级调用校验回调。
+ */
+int mbedtls_ssl_handshake(mbedtls_ssl_context* ssl) {
+    test_hello_t hello = { .magic = "CHLO", .ticket = ssl->offer ? ssl->session.ticket : 0 };
+    snprintf(hello.host, sizeof(hello.host), "%s", ssl->hostname);
+    test_reply_t reply;
+    int ret = test_ssl_send_all(ssl, &hello, sizeof(hello));
+    if (ret == 0) {
+        ret = test_ssl_recv_all(ssl, &reply, sizeof(reply));
+    }
+    if (ret != 0) {
+        return ret;
+    }
+    if (reply.mode == 'F') {
+        static uint8_t cert[TEST_CERT_LEN];
+        if ((ret = test_ssl_recv_all(ssl, cert, reply.cert_len)) != 0) {
+            return ret;
+        }
+        for (int depth = reply.depth - 1; depth >= 0; depth--) {
+            uint32_t flags = 0;
+            if (ssl->conf->f_vrfy != NULL && ssl->conf->f_vrfy(ssl->conf->p_vrfy, ssl->conf->ca_chain, depth, &flags) != 0) {
+                return MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+            }
+            ssl->verify_result |= flags;
+        }
+        mbedtls_ssl_session_init(&ssl->session);
+        ssl->session.format = TEST_SESSION_FORMAT;
+        memset(ssl->session.master, reply.ticket & 0xFF, sizeof(ssl->session.master));
+    } else if (reply.mode == 'R') {
+        TEST_ASSERT_MSG(ssl->offer, "%s", "没有提供会话，服务器却恢复会话");
+    } else {
+        return MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE;
+    }
+    if (reply.ticket != 0) {
+        ssl->session.ticket = reply.ticket;
+    }
+    ssl->established = 1;
+    return 0;
+}
+
+uint32_t mbedtls_ssl_get_verify_result(const mbedtls_ssl_context* ssl) {
+    return ssl->verify_result;
+}
+
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context* ssl) {
+    return 0;
+}
+
+int mbedtls_ssl_read(mbedtls_ssl_context* ssl, unsigned char* buf, size_t len) {
+    return ssl->f_recv_timeout(ssl->p_bio, buf, len, ssl->conf->read_timeout);
+}
+
+int mbedtls_ssl_write(mbedtls_ssl_context* ssl, const unsigned char* buf, size_t len) {
+    return ssl->f_send(ssl->p_bio, buf, len);
+}
+
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* ssl) {
+    return 0;
+}
+
+/**
+ * @brief mbedtls 替身：证书和随机数。
+ */
+void mbedtls_x509_crt_init(mbedtls_x509_crt* crt) {
+    crt->version = 0;
+}
+
+void mbedtls_x509_crt_free(mbedtls_x509_crt* crt) {
+    crt->version = 0;
+}
+
+int mbedtls_x509_crt_parse(mbedtls_x509_crt* chain, const unsigned char* buf, size_t buflen) {
+    if (buflen < 27 || memcmp(buf, "-----BEGIN CERTIFICATE-----", 27) != 0) {
+        return -0x2180;
+    }
+    chain->version = 3;
+    return 0;
+}
+
+void mbedtls_entropy_init(mbedtls_entropy_context* ctx) {
+}
+
+int mbedtls_entropy_func(void* data, unsigned char* output, size_t len) {
+    return 0;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* ctx) {
+    ctx->seeded = 0;
+}
+
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* ctx, int (*f_entropy)(void*, unsigned char*, size_t), void* p_entropy, const unsigned char* custom, size_t len) {
+    ctx->seeded = 1;
+    return 0;
+}
+
+int mbedtls_ctr_drbg_random(void* p_rng, unsigned char* output, size_t len) {
+    return 0;
+}
+
+void mbedtls_strerror(int errnum, char* buffer, size_t buflen) {
+    snprintf(buffer, buflen, "mbedtls -0x%04X", -errnum);
+}
+
+/**
+ * @brief 计数，检查 mbedtls 传入的参数，调用 app_tls_verify()。
+ */
+static int test_verify(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags) {
+    TEST_ASSERT(ctx == &app_tls_conn && crt == &app_tls_ca && depth >= 0 && depth < TEST_CERT_DEPTH);
+    test_verify_calls++;
+    return app_tls_verify(ctx, crt, depth, flags);
+}
+
+static int test_read_full(int fd, void* buf, size_t len) {
+    for (size_t got = 0; got < len;) {
+        ssize_t n = recv(fd, (uint8_t*)buf + got, len - got, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        got += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief 服务器替身：每次一个连接，握手以后回显数据，直到客户端关闭。
+ */
+static void* test_server_task(void* arg) {
+    test_server_t* server = arg;
+    static const uint8_t cert[TEST_CERT_LEN] = { 'C' };
+    while (1) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        TEST_ASSERT(fd >= 0);
+        test_hello_t hello;
+        if (test_read_full(fd, &hello, sizeof(hello)) != 0) {
+            close(fd);
+            continue;
+        }
+        TEST_ASSERT(memcmp(hello.magic, "CHLO", 4) == 0 && strcmp(hello.host, TEST_HOST) == 0);
+        test_reply_t reply = { .mode = 'F', .depth = TEST_CERT_DEPTH };
+        pthread_mutex_lock(&test_mutex);
+        if (server->reject) {
+            reply.mode = 'X';
+        } else if (hello.ticket != 0 && hello.ticket == server->ticket) {
+            reply.mode = 'R';
+            server->resumed++;
+            if (server->rotate) {
+                reply.ticket = server->ticket = test_next_ticket++;
+            }
+        } else {
+            server->full++;
+            reply.ticket = server->ticket = test_next_ticket++;
+            reply.cert_len = TEST_CERT_LEN;
+        }
+        pthread_mutex_unlock(&test_mutex);
+        send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+        send(fd, cert, reply.cert_len, MSG_NOSIGNAL);
+        char buf[64];
+        ssize_t n;
+        while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+            send(fd, buf, n, MSG_NOSIGNAL);
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+static void test_start_servers(void) {
+    for (int i = 0; i < TEST_SERVERS; i++) {
+        test_server_t* server = &test_servers[i];
+        server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+        socklen_t addr_len = sizeof(addr);
+        TEST_ASSERT(server->listen_fd >= 0 && bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+        TEST_ASSERT(listen(server->listen_fd, 1) == 0 && getsockname(server->listen_fd, (struct sockaddr*)&addr, &addr_len) == 0);
+        server->port = ntohs(addr.sin_port);
+        pthread_t thread;
+        TEST_ASSERT(pthread_create(&thread, NULL, test_server_task, server) == 0);
+    }
+}
+
+/**
+ * @brief 重启：清空 RAM 中的会话缓存和统计，重新初始化，从 NVS 加载会话。
+ */
+static void test_reboot(void) {
+    if (app_tls_transport != NULL) {
+        app_tls_close(app_tls_transport);
+        free(app_tls_transport);
+    }
+    app_tls_transport = NULL;
+    memset(app_tls_slots, 0, sizeof(app_tls_slots));
+    app_tls_slot_next = 0;
+    memset(&app_tls_stats, 0, sizeof(app_tls_stats));
+    memset(&app_tls_conn, 0, sizeof(app_tls_conn));
+    TEST_ASSERT(app_tls_init() == ESP_OK);
+    TEST_ASSERT(app_tls_transport->port == APP_TLS_DEFAULT_PORT);
+}
+
+/**
+ * @brief 连接服务器，握手方式和期望的相同，app_tls 的统计和服务器一致，回显正常，然后关闭。
+ */
+static void test_connect(int index, bool resumed) {
+    test_server_t* server = &test_servers[index];
+    esp_transport_handle_t t = app_tls_get_transport();
+    app_tls_stats_t before;
+    app_tls_get_stats(&before);
+    pthread_mutex_lock(&test_mutex);
+    uint32_t full = server->full;
+    uint32_t res = server->resumed;
+    pthread_mutex_unlock(&test_mutex);
+    int calls = test_verify_calls;
+
+    TEST_ASSERT_MSG(t->connect(t, TEST_HOST, server->port, 2000) == 0, "服务器 %d", index);
+
+    app_tls_stats_t after;
+    app_tls_get_stats(&after);
+    pthread_mutex_lock(&test_mutex);
+    TEST_ASSERT_MSG(server->resumed - res == (resumed ? 1 : 0) && server->full - full == (resumed ? 0 : 1),
+        "服务器 %d，期望%s", index, resumed ? "会话恢复" : "完整握手");
+    pthread_mutex_unlock(&test_mutex);
+    TEST_ASSERT_EQUAL(resumed ? 1 : 0, after.resumed - before.resumed);
+    TEST_ASSERT_EQUAL(resumed ? 0 : 1, after.full - before.full);
+    TEST_ASSERT_EQUAL(resumed ? 0 : TEST_CERT_DEPTH, test_verify_calls - calls);
+    TEST_ASSERT_EQUAL(sizeof(test_hello_t), after.last_tx);
+    TEST_ASSERT_EQUAL(sizeof(test_reply_t) + (resumed ? 0 : TEST_CERT_LEN), after.last_rx);
+
+    char buf[16];
+    TEST_ASSERT_EQUAL(4, t->write(t, "ping", 4, 1000));
+    int got = 0;
+    while (got < 4) {
+        int n = t->read(t, buf + got, sizeof(buf) - got, 1000);
+        TEST_ASSERT(n > 0);
+        got += n;
+    }
+    TEST_ASSERT(got == 4 && memcmp(buf, "ping", 4) == 0);
+    TEST_ASSERT(t->close(t) == 0);
+}
+
+/**
+ * @brief 读取 NVS 中序号 index 的会话。
+ * @return 有保存的会话时 true。
+ */
+static bool test_nvs_slot(int index, app_tls_nvs_head_t* head, mbedtls_ssl_session* session) {
+    nvs_handle_t handle;
+    TEST_ASSERT(nvs_open(APP_TLS_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK);
+    char key[8];
+    snprintf(key, sizeof(key), "s%d", index);
+    uint8_t buf[sizeof(app_tls_nvs_head_t) + sizeof(mbedtls_ssl_session)];
+    size_t size = sizeof(buf);
+    esp_err_t ret = nvs_get_blob(handle, key, buf, &size);
+    nvs_close(handle);
+    if (ret != ESP_OK) {
+        return false;
+    }
+    TEST_ASSERT_EQUAL(sizeof(buf), size);
+    memcpy(head, buf, sizeof(*head));
+    memcpy(session, buf + sizeof(*head), sizeof(*session));
+    return true;
+}
+
+/**
+ * @brief NVS 中序号 index 保存的是服务器 server 的当前票据。
+ */
+static void test_check_nvs(int index, int server) {
+    app_tls_nvs_head_t head;
+    mbedtls_ssl_session session;
+    TEST_ASSERT_MSG(test_nvs_slot(index, &head, &session), "s%d", index);
+    TEST_ASSERT_MSG(strcmp(head.host, TEST_HOST) == 0 && head.port == test_servers[server].port,
+        "s%d 保存的是 %s:%d，期望服务器 %d", index, head.host, (int)head.port, server);
+    pthread_mutex_lock(&test_mutex);
+    TEST_ASSERT_MSG(session.ticket == test_servers[server].ticket, "s%d 票据 %X，服务器 %d 的票据 %X",
+        index, session.ticket, server, test_servers[server].ticket);
+    pthread_mutex_unlock(&test_mutex);
+}
+
+static void test_reset(void) {
+    host_test_reset_dir(SDMMC_MOUNT_POINT);
+    pthread_mutex_lock(&test_mutex);
+    for (int i = 0; i < TEST_SERVERS; i++) {
+        test_servers[i].ticket = 0;
+        test_servers[i].rotate = 0;
+        test_servers[i].reject = 0;
+    }
+    pthread_mutex_unlock(&test_mutex);
+    test_reboot();
+}
+
+/**
+ * @brief 保存、会话恢复、新票据、重启以后恢复。
+ */
+static void test_tls_resume(void) {
+    test_reset();
+    test_connect(0, false);
+    test_check_nvs(0, 0);
+    int writes = host_nvs_set_count;
+
+    test_connect(0, true);// 会话没有变化，不写 NVS。
+    TEST_ASSERT_EQUAL(writes, host_nvs_set_count);
+    test_check_nvs(0, 0);
+
+    test_servers[0].rotate = 1;// 会话恢复时发出新票据，旧票据作废。
+    test_connect(0, true);
+    TEST_ASSERT_EQUAL(writes + 1, host_nvs_set_count);
+    test_check_nvs(0, 0);
+    test_servers[0].rotate = 0;
+
+    test_reboot();// 用 NVS 中的新票据恢复会话。
+    test_connect(0, true);
+    TEST_ASSERT_EQUAL(writes + 1, host_nvs_set_count);
+
+    pthread_mutex_lock(&test_mutex);
+    test_servers[0].ticket = 0;// 服务器重启，票据作废，退回完整握手，保存新会话。
+    pthread_mutex_unlock(&test_mutex);
+    test_connect(0, false);
+    TEST_ASSERT_EQUAL(writes + 2, host_nvs_set_count);
+    test_check_nvs(0, 0);
+    test_connect(0, true);
+
+    app_tls_stats_t stats;
+    app_tls_get_stats(&stats);
+    TEST_ASSERT(stats.full == 1 && stats.resumed == 2 && stats.failed == 0);
+    TEST_ASSERT(stats.full_bytes > stats.resumed_bytes);
+    printf("完整握手 %u 字节，会话恢复 %u 字节，NVS 写入 %d 次\n", stats.full_bytes, stats.resumed_bytes, host_nvs_set_count);
+}
+
+/**
+ * @brief 会话缓存按地址和端口查找，空闲的优先，没有空闲时轮换。
+ */
+static void test_tls_rotate(void) {
+    test_reset();
+    app_tls_slot_t* a = app_tls_find_slot("a", 1, true);
+    app_tls_slot_t* b = app_tls_find_slot("a", 2, true);
+    TEST_ASSERT(a == &app_tls_slots[0] && b == &app_tls_slots[1]);
+    TEST_ASSERT(app_tls_find_slot("a", 1, false) == a && app_tls_find_slot("a", 2, true) == b);
+    TEST_ASSERT(app_tls_find_slot("b", 1, false) == NULL);
+    TEST_ASSERT(app_tls_find_slot("b", 1, true) == &app_tls_slots[0]);
+    TEST_ASSERT(app_tls_find_slot("a", 1, false) == NULL);
+    TEST_ASSERT(app_tls_find_slot("c", 1, true) == &app_tls_slots[1]);
+    TEST_ASSERT(app_tls_find_slot("d", 1, true) == &app_tls_slots[0]);
+    TEST_ASSERT(app_tls_slots[0].valid == 0 && strcmp(app_tls_slots[0].host, "d") == 0);
+
+    test_reset();
+    test_connect(0, false);                 // s0 = 0
+    test_connect(1, false);                 // s1 = 1
+    test_connect(2, false);                 // s0 = 2，轮换掉 0。
+    test_check_nvs(0, 2);
+    test_check_nvs(1, 1);
+    test_connect(2, true);
+    test_connect(1, true);
+    test_connect(0, false);                 // s1 = 0，轮换掉 1。
+    test_check_nvs(1, 0);
+    test_connect(1, false);                 // s0 = 1，轮换掉 2。
+    test_check_nvs(0, 1);
+
+    test_reboot();
+    TEST_ASSERT(app_tls_slots[0].valid && app_tls_slots[1].valid);
+    test_connect(0, true);
+    test_connect(1, true);
+    test_connect(2, false);                 // 重启以后从 s0 开始轮换。
+    test_check_nvs(0, 2);
+    test_check_nvs(1, 0);
+}
+
+/**
+ * @brief NVS 中的会话格式不对或者长度不对，丢弃，完整握手以后覆盖。
+ */
+static void test_tls_bad_nvs(void) {
+    test_reset();
+    test_connect(0, false);
+    test_connect(1, false);
+
+    nvs_handle_t handle;
+    TEST_ASSERT(nvs_open(APP_TLS_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK);
+    uint8_t buf[sizeof(app_tls_nvs_head_t) + sizeof(mbedtls_ssl_session)];
+    size_t size = sizeof(buf);
+    TEST_ASSERT(nvs_get_blob(handle, "s0", buf, &size) == ESP_OK);
+    ((mbedtls_ssl_session*)(buf + sizeof(app_tls_nvs_head_t)))->format ^= 1;
+    TEST_ASSERT(nvs_set_blob(handle, "s0", buf, size) == ESP_OK);
+    TEST_ASSERT(nvs_set_blob(handle, "s1", buf, sizeof(app_tls_nvs_head_t)) == ESP_OK);
+    nvs_close(handle);
+
+    test_reboot();
+    TEST_ASSERT(!app_tls_slots[0].valid && !app_tls_slots[1].valid);
+    test_connect(0, false);
+    test_check_nvs(0, 0);
+    test_connect(1, false);
+    test_check_nvs(1, 1);
+    test_reboot();
+    test_connect(0, true);
+    test_connect(1, true);
+}
+
+/**
+ * @brief 握手失败：计数，会话作废，下次不再提供，完整握手。
+ */
+static void test_tls_fail(void) {
+    test_reset();
+    test_connect(0, false);
+    test_servers[0].reject = 1;
+    esp_transport_handle_t t = app_tls_get_transport();
+    TEST_ASSERT_EQUAL(-1, t->connect(t, TEST_HOST, test_servers[0].port, 2000));
+    TEST_ASSERT(app_tls_find_slot(TEST_HOST, test_servers[0].port, false)->valid == 0);
+    TEST_ASSERT(t->read(t, (char[4]) { 0 }, 4, 0) < 0);
+    test_servers[0].reject = 0;
+    test_connect(0, false);
+    app_tls_stats_t stats;
+    app_tls_get_stats(&stats);
+    TEST_ASSERT(stats.full == 2 && stats.resumed == 0 && stats.failed == 1);
+}
+
+int main(void) {
+    test_start_servers();
+    RUN_TEST(test_tls_resume);
+    RUN_TEST(test_tls_rotate);
+    RUN_TEST(test_tls_bad_nvs);
+    RUN_TEST(test_tls_fail);
+    return 0;
+}
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+二进制日志解码工具，把 SD 卡或者 MQTT 上传的二进制日志还原成文本，记录格式见 main/app_logbin.h。
+
+格式字符串按地址从固件的 ELF 文件中读取，必须使用和设备上相同的 ELF 文件（build/<project>.elf）。
+日志文件开头的 APP_LOGBIN_HEADER 记录带 ELF 文件的 SHA256，不一致时给出警告。
+
+用法：
+    python3 tools/logdecode.py build/esp32s3_4g_iot.elf L0000012.TXT [L0000013.TXT ...]
+    python3 tools/logdecode.py --no-color build/esp32s3_4g_iot.elf L0000012.TXT > L0000012.LOG
+
+统计信息输出到 stderr：二进制字节数、还原以后的文本字节数、减少的比例。
+
+@author  nyx
+@date    2026-10-18
+"""
+import argparse
+import hashlib
+import re
+import struct
+import sys
+
+APP_LOGBIN_HEADER = 0x1D
+APP_LOGBIN_RECORD = 0x1E
+APP_LOGBIN_TEXT = 0x1F
+APP_LOGBIN_HDR_SIZE = 3
+
+# 和 app_logbin_encode() 相同的转换说明：标志、宽度、精度、长度、类型。
+CONV_RE = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|z|j|t|L)?([diouxXcsfFeEgGaApn%])")
+ANSI_RE = re.compile(r"\x1b\[[0-9;]*m")
+
+
+class Elf:
+    """只读取分配到内存的段，按地址查找格式字符串。"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        self.sha256 = hashlib.sha256(self.data).digest()
+        if self.data[:4] != b"\x7fELF":
+            raise ValueError("不是 ELF 文件：%s" % path)
+        is64 = self.data[4] == 2
+        if is64:
+            shoff, = struct.unpack_from("<Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from("<HH", self.data, 0x3A)
+        else:
+            shoff, = struct.unpack_from("<I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            off = shoff + i * shentsize
+            if is64:
+                _, sh_type, flags, addr, offset, size = struct.unpack_from("<IIQQQQ", self.data, off)
+            else:
+                _, sh_type, flags, addr, offset, size = struct.unpack_from("<IIIIII", self.data, off)
+            if sh_type == 1 and flags & 0x2 and addr != 0:  # SHT_PROGBITS，SHF_ALLOC
+                self.sections.append((addr, offset, size))
+        self.cache = {}
+
+    def string(self, addr):
+        if addr in self.cache:
+            return self.cache[addr]
+        for base, offset, size in self.sections:
+            if base <= addr < base + size:
+                start = offset + addr - base
+                end = self.data.index(b"\0", start, offset + size)
+                text = self.data[start:end].decode("utf-8", "replace")
+                self.cache[addr] = text
+                return text
+        return None
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.off = 0
+
+    def take(self, fmt):
+        value, = struct.unpack_from(fmt, self.data, self.off)
+        self.off += struct.calcsize(fmt)
+        return value
+
+    def string(self):
+        n = self.take("<H")
+        text = self.data[self.off:self.off + n].decode("utf-8", "replace")
+        self.off += n
+        return text
+
+
+def format_record(fmt, args):
+    """按格式字符串读取参数，规则和 app_logbin_encode() 相同，用 Python 的 % 格式化。"""
+    out = []
+    pos = 0
+    for m in CONV_RE.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, precision, length, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        if width == "*":
+            width = str(args.take("<i"))
+        if precision == "*":
+            precision = str(args.take("<i"))
+        spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "")
+        wide = length in ("ll", "j")
+        if conv in "di":
+            out.append((spec + "d") % args.take("<q" if wide else "<i"))
+        elif conv in "ouxX":
+            value = args.take("<Q" if wide else "<I")
+            out.append((spec + ("d" if conv == "u" else conv)) % value)
+        elif conv == "c":
+            out.append((spec + "c") % chr(args.take("<i") & 0xFF))
+        elif conv in "fFeEgG":
+            out.append((spec + conv) % args.take("<d"))
+        elif conv in "aA":
+            out.append(float.hex(args.take("<d")))
+        elif conv == "p":
+            out.append("0x%x" % args.take("<I"))
+        elif conv == "s":
+            out.append((spec + "s") % args.string())
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def decode(elf, data, write, color):
+    """解码一个文件，返回还原以后的文本字节数。"""
+    off = 0
+    text_bytes = 0
+    while off + APP_LOGBIN_HDR_SIZE <= len(data):
+        rtype = data[off]
+        n, = struct.unpack_from("<H", data, off + 1)
+        body = data[off + APP_LOGBIN_HDR_SIZE:off + APP_LOGBIN_HDR_SIZE + n]
+        if rtype not in (APP_LOGBIN_HEADER, APP_LOGBIN_RECORD, APP_LOGBIN_TEXT) or len(body) < n:
+            # 旧版本的文本日志，或者掉电时写了一半的记录，找下一个记录头。
+            nxt = min([i for i in (data.find(bytes([t]), off + 1) for t in (0x1D, 0x1E, 0x1F)) if i >= 0] or [len(data)])
+            chunk = data[off:nxt].decode("utf-8", "replace")
+            write(chunk)
+            text_bytes += len(chunk.encode())
+            off = nxt
+            continue
+        off += APP_LOGBIN_HDR_SIZE + n
+        if rtype == APP_LOGBIN_HEADER:
+            if body[:4] != b"LBIN" or body[4:36] != elf.sha256:
+                sys.stderr.write("警告：日志和 ELF 文件的 SHA256 不一致，解码结果可能不正确。\n")
+            continue
+        if rtype == APP_LOGBIN_TEXT:
+            text = body.decode("utf-8", "replace")
+        else:
+            addr, = struct.unpack_from("<I", body, 0)
+            fmt = elf.string(addr)
+            if fmt is None:
+                text = "<未知格式 0x%08x，%d 字节参数>\n" % (addr, n - 4)
+            else:
+                try:
+                    text = format_record(fmt, Reader(body[4:]))
+                except (struct.error, TypeError, ValueError) as e:
+                    text = "<解码失败 0x%08x：%s>\n" % (addr, e)
+        text_bytes += len(text.encode())
+        write(text if color else ANSI_RE.sub("", text))
+    return text_bytes
+
+
+def main():
+    parser = argparse.ArgumentParser(description="二进制日志解码，见 main/app_logbin.h。")
+    parser.add_argument("--no-color", action="store_true", help="去除 ANSI 颜色")
+    parser.add_argument("elf", help="固件的 ELF 文件")
+    parser.add_argument("logs", nargs="+", help="二进制日志文件")
+    args = parser.parse_args()
+    elf = Elf(args.elf)
+    total_bin = 0
+    total_text = 0
+    for path in args.logs:
+        with open(path, "rb") as f:
+            data = f.read()
+        total_bin += len(data)
+        total_text += decode(elf, data, sys.stdout.write, not args.no_color)
+    if total_text > 0:
+        sys.stderr.write("二进制：%d 字节，文本：%d 字节，减少：%.1f%%\n"
+                         % (total_bin, total_text, 100.0 * (total_text - total_bin) / total_text))
+
+
+if __name__ == "__main__":
+    main()